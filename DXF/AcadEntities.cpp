@@ -9,10 +9,13 @@
 ***************************************************************************/
 #include "AcadEntities.h"
 #include <stdarg.h>
+#include <cstring>
 #include <algorithm>
 #include <fstream>
 #include <mutex>
+#ifndef _USE_MATH_DEFINES
 #define _USE_MATH_DEFINES
+#endif
 #include <cmath>
 
 #include "DxfData.h"
@@ -46,14 +49,14 @@ namespace DXF
 	{
 	}
 
-	void EntAttribute::AssignHandle(int &handle)
+	void EntAttribute::AssignHandle(HandleAllocator &allocator, HandleMap &handles) const
 	{
-		m_Handle = ++handle;
+		handles[this] = allocator.Allocate();
 	}
 
 	void EntAttribute::WriteAttribute(DxfWriter &writer, bool bInPaperSpace) const
 	{
-		writer.dxfHex(5, m_Handle);
+		writer.dxfHex(5, writer.GetHandle(this));
 		std::vector<std::shared_ptr<EntAttribute>> reactors;
 		for (const auto &reactor : m_Reactors)
 		{
@@ -65,7 +68,7 @@ namespace DXF
 		{
 			writer.dxfString(102, "{ACAD_REACTORS");
 			for (const auto &reactor : reactors)
-				writer.dxfHex(330, reactor->m_Handle);
+				writer.dxfHex(330, writer.GetHandle(reactor.get()));
 			writer.dxfString(102, "}");
 		}
 		writer.dxfHex(330, writer.m_CurrentBlockEntryHandle);
@@ -187,7 +190,7 @@ namespace DXF
 	MLeaderStyle::MLeaderStyle()
 		: m_LeaderType(acStraightLeader), m_LineColor(acByBlock), m_LineType("ByBlock"), m_LineWeight(acLnWtByBlock), m_ArrowHead() // acArrowDefault
 		  ,
-		  m_ArrowSize(0.18), m_MaxLeaderPoints(2), m_FirstSegAngleConstraint(0.0f), m_SecondSegAngleConstraint(0.0f), m_EnableLanding(true), m_IsAnnotative(false), m_LandingGap(0.09), m_DoglegLength(8.0), m_BreakGapSize(3.75), m_Content(make_shared<StyleMTextPart>())
+		  m_ArrowSize(0.18), m_MaxLeaderPoints(2), m_FirstSegAngleConstraint(0.0f), m_SecondSegAngleConstraint(0.0f), m_EnableLanding(true), m_EnableDogleg(true), m_IsAnnotative(false), m_LandingGap(0.09), m_DoglegLength(8.0), m_BreakGapSize(3.75), m_Content(make_shared<StyleMTextPart>())
 	{
 	}
 
@@ -856,7 +859,7 @@ namespace DXF
 		return 0.0;
 	}
 
-	EntityList::iterator EntityList::FindEntity(int handle)
+	EntityList::iterator EntityList::FindEntity(Handle handle)
 	{
 		return std::find_if(begin(), end(), [handle](const std::shared_ptr<EntAttribute> &pEnt) {
 			return pEnt->m_Handle == handle;
@@ -954,7 +957,7 @@ namespace DXF
 		m_Bulges.swap(bulges);
 	}
 
-	void AcadCircle::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadCircle::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "CIRCLE");
 		WriteAttribute(writer, bInPaperSpace);
@@ -963,7 +966,7 @@ namespace DXF
 		writer.dxfReal(40, m_Radius);
 	}
 
-	void AcadArc::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadArc::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "ARC");
 		WriteAttribute(writer, bInPaperSpace);
@@ -975,7 +978,7 @@ namespace DXF
 		writer.dxfReal(51, m_EndAngle);
 	}
 
-	void AcadAttDef::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadAttDef::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "ATTDEF");
 
@@ -1004,18 +1007,18 @@ namespace DXF
 		writer.dxfInt(280, m_DuplicateFlag);
 	}
 
-	void AcadAttrib::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadAttrib::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		// Not used.
 		ASSERT_DEBUG_INFO(false);
 	}
 
-	void AcadAttrib::WriteDxf(DxfWriter &writer, bool bInPaperSpace, int parentHandle)
+	void AcadAttrib::WriteDxf(DxfWriter &writer, bool bInPaperSpace, Handle parentHandle) const
 	{
 		writer.dxfString(0, "ATTRIB");
 
 		//WriteAttribute(writer, bInPaperSpace);
-		writer.dxfHex(5, m_Handle);
+		writer.dxfHex(5, writer.GetHandle(this));
 		writer.dxfHex(330, parentHandle);
 		writer.dxfString(100, "AcDbEntity");
 		if (bInPaperSpace)
@@ -1044,7 +1047,7 @@ namespace DXF
 		writer.dxfInt(280, m_DuplicateFlag);
 	}
 
-	void AcadBlockInstance::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadBlockInstance::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "INSERT");
 		WriteAttribute(writer, bInPaperSpace);
@@ -1061,31 +1064,32 @@ namespace DXF
 
 		if (m_Attribs.empty())
 			return;
+		const Handle handle = writer.GetHandle(this);
 		for (auto &attrib : m_Attribs)
-			attrib.WriteDxf(writer, bInPaperSpace, m_Handle);
+			attrib.WriteDxf(writer, bInPaperSpace, handle);
 
 		// SEQEND
 		writer.dxfString(0, "SEQEND");
-		writer.dxfHex(5, m_Attribs.back().m_Handle + 1);
-		writer.dxfHex(330, m_Handle);
+		writer.dxfHex(5, writer.GetHandle(&m_Attribs.back()) + 1);
+		writer.dxfHex(330, handle);
 		writer.dxfString(100, "AcDbEntity");
 		writer.dxfString(8, m_Layer);
 	}
 
-	void AcadBlockInstance::AssignHandle(int &handle)
+	void AcadBlockInstance::AssignHandle(HandleAllocator &allocator, HandleMap &handles) const
 	{
-		m_Handle = ++handle;
+		handles[this] = allocator.Allocate();
 		if (m_Attribs.empty())
 			return;
 		for (auto &attrib : m_Attribs)
 		{
-			attrib.m_Handle = ++handle;
+			handles[&attrib] = allocator.Allocate();
 		}
 		// Handle for SEQEND
-		++handle;
+		allocator.Allocate();
 	}
 
-	void AcadDim::WriteHeader(DxfWriter &writer, bool bInPaperSpace)
+	void AcadDim::WriteHeader(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "DIMENSION");
 		WriteAttribute(writer, bInPaperSpace);
@@ -1098,7 +1102,7 @@ namespace DXF
 			writer.coord(11, m_TextPosition.x, m_TextPosition.y);
 	}
 
-	void AcadDim::WriteOverride(DxfWriter &writer)
+	void AcadDim::WriteOverride(DxfWriter &writer) const
 	{
 		if (m_ValidMembersFlag[TEXT])
 			writer.dxfString(1, m_DimStyleOverride.Text);
@@ -1183,7 +1187,7 @@ namespace DXF
 				flag |= 1;
 			if (m_DimStyleOverride.SuppressTrailingZeros)
 				flag |= 2;
-			if (dynamic_cast<AcadDimAng *>(this))
+			if (dynamic_cast<const AcadDimAng *>(this))
 			{
 				writer.dxfInt(1070, 79);
 				writer.dxfInt(1070, flag);
@@ -1209,7 +1213,7 @@ namespace DXF
 			writer.dxfReal(53, m_TextRotation);
 	}
 
-	void AcadDimAln::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadDimAln::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		WriteHeader(writer, bInPaperSpace);
 		WriteOverride(writer);
@@ -1232,7 +1236,7 @@ namespace DXF
 			writer.dxfReal(50, m_RotationAngle);
 	}
 
-	void AcadDimAng3P::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadDimAng3P::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		WriteHeader(writer, bInPaperSpace);
 		WriteOverride(writer);
@@ -1254,7 +1258,7 @@ namespace DXF
 		writer.coord(15, m_AngleVertex.x, m_AngleVertex.y);
 	}
 
-	void AcadDimAng::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadDimAng::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		WriteHeader(writer, bInPaperSpace);
 		WriteOverride(writer);
@@ -1276,7 +1280,7 @@ namespace DXF
 		writer.coord(15, m_SecondStart.x, m_SecondStart.y);
 	}
 
-	void AcadDimDia::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadDimDia::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		WriteHeader(writer, bInPaperSpace);
 		WriteOverride(writer);
@@ -1297,7 +1301,7 @@ namespace DXF
 		writer.dxfReal(40, m_LeaderLength);
 	}
 
-	void AcadDimRad::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadDimRad::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		WriteHeader(writer, bInPaperSpace);
 		WriteOverride(writer);
@@ -1318,7 +1322,7 @@ namespace DXF
 		writer.dxfReal(40, m_LeaderLength);
 	}
 
-	void AcadDimRot::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadDimRot::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		WriteHeader(writer, bInPaperSpace);
 		WriteOverride(writer);
@@ -1335,7 +1339,7 @@ namespace DXF
 		writer.dxfString(100, "AcDbRotatedDimension");
 	}
 
-	void AcadDimOrd::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadDimOrd::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		WriteHeader(writer, bInPaperSpace);
 		WriteOverride(writer);
@@ -1356,7 +1360,7 @@ namespace DXF
 		writer.coord(14, m_LeaderPoint.x, m_LeaderPoint.y);
 	}
 
-	void AcadEllipse::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadEllipse::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "ELLIPSE");
 		WriteAttribute(writer, bInPaperSpace);
@@ -1396,7 +1400,7 @@ namespace DXF
 		return false;
 	}
 
-	void AcadHatch::WriteLoop(DxfWriter &writer, int loopIndex)
+	void AcadHatch::WriteLoop(DxfWriter &writer, int loopIndex) const
 	{
 		const EntityList *pBoundaryData = nullptr;
 		const std::vector<std::weak_ptr<EntAttribute>> *pSourceHandles = nullptr;
@@ -1551,11 +1555,11 @@ namespace DXF
 		writer.dxfInt(97, int(validSourceHandles.size()));
 		for (const auto &validSourceHandle : validSourceHandles)
 		{
-			writer.dxfHex(330, validSourceHandle->m_Handle);
+			writer.dxfHex(330, writer.GetHandle(validSourceHandle.get()));
 		}
 	}
 
-	void AcadHatch::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadHatch::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		if (m_OuterLoop.empty())
 			return;
@@ -1592,30 +1596,20 @@ namespace DXF
 			writer.dxfReal(52, m_PatternAngle);
 			writer.dxfReal(41, m_PatternScale);
 			writer.dxfInt(77, 0);
-			Pattern *pPat = writer.FindPattern(m_PatternName.c_str());
-			if (pPat)
+			const HatchLines *pLines = writer.GetHatchLines(m_PatternName.c_str(), m_PatternAngle, m_PatternScale);
+			if (pLines)
 			{
-				writer.dxfInt(78, int(pPat->dashlines.size()));
-				for (size_t i = 0; i < pPat->dashlines.size(); ++i)
+				writer.dxfInt(78, int(pLines->size()));
+				for (const HatchLine &line : *pLines)
 				{
-					writer.dxfReal(53, pPat->dashlines[i]->angle + m_PatternAngle);
-					CDblPoint origin(pPat->dashlines[i]->x_origin, pPat->dashlines[i]->y_origin);
-					origin.x *= m_PatternScale;
-					origin.y *= m_PatternScale;
-					const CDblPoint zero;
-					zero.Rotate(origin, m_PatternAngle * M_PI / 180.0);
-					writer.dxfReal(43, origin.x);
-					writer.dxfReal(44, origin.y);
-					double angle = (pPat->dashlines[i]->angle + m_PatternAngle) * M_PI / 180.0;
-					CDblPoint point(pPat->dashlines[i]->delta_x, pPat->dashlines[i]->delta_y);
-					point.x *= m_PatternScale;
-					point.y *= m_PatternScale;
-					zero.Rotate(point, angle);
-					writer.dxfReal(45, point.x);
-					writer.dxfReal(46, point.y);
-					writer.dxfInt(79, int(pPat->dashlines[i]->dashes.size()));
-					for (size_t j = 0; j < pPat->dashlines[i]->dashes.size(); ++j)
-						writer.dxfReal(49, pPat->dashlines[i]->dashes[j] * m_PatternScale);
+					writer.dxfReal(53, line.angle);
+					writer.dxfReal(43, line.origin.x);
+					writer.dxfReal(44, line.origin.y);
+					writer.dxfReal(45, line.delta.x);
+					writer.dxfReal(46, line.delta.y);
+					writer.dxfInt(79, int(line.dashes.size()));
+					for (double dash : line.dashes)
+						writer.dxfReal(49, dash);
 				}
 			}
 			else
@@ -1629,7 +1623,7 @@ namespace DXF
 		writer.dxfReal(20, 0);
 	}
 
-	void AcadLeader::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadLeader::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "LEADER");
 		WriteAttribute(writer, bInPaperSpace);
@@ -1658,9 +1652,10 @@ namespace DXF
 			writer.dxfReal(10, vp.x);
 			writer.dxfReal(20, vp.y);
 		}
-		if (annotation && annotation->m_Handle != 0)
+		const Handle annotationHandle = writer.GetHandle(annotation.get());
+		if (annotationHandle != 0)
 		{
-			writer.dxfHex(340, annotation->m_Handle);
+			writer.dxfHex(340, annotationHandle);
 		}
 		if (m_ArrowSize != 0)
 		{
@@ -1673,7 +1668,7 @@ namespace DXF
 		}
 	}
 
-	void StyleMTextPart::WriteDxf(DxfWriter &writer)
+	void StyleMTextPart::WriteDxf(DxfWriter &writer) const
 	{
 		writer.dxfHex(342, writer.LookupTextStyleHandle(m_TextStyle));
 		writer.dxfInt(174, 1); // Text Left Attachment Type
@@ -1687,7 +1682,7 @@ namespace DXF
 		writer.dxfReal(46, m_AlignSpace); // Align Space
 	}
 
-	void StyleBlockPart::WriteDxf(DxfWriter &writer)
+	void StyleBlockPart::WriteDxf(DxfWriter &writer) const
 	{
 		//CDblPoint m_BlockScale; /*142*/
 		writer.dxfHex(343, writer.LookupBlockEntryHandle(m_BlockName));
@@ -1703,7 +1698,7 @@ namespace DXF
 		writer.dxfInt(295, 1);	  // Overwrite Property Value
 	}
 
-	void MLeaderStyle::WriteDxf(DxfWriter &writer, const std::string &name, int handle)
+	void MLeaderStyle::WriteDxf(DxfWriter &writer, const std::string &name, Handle handle) const
 	{
 		ASSERT_DEBUG_INFO(!name.empty() && m_Content);
 		writer.dxfString(0, "MLEADERSTYLE");
@@ -1713,7 +1708,7 @@ namespace DXF
 		const auto &mls = writer.GetMLeaders(name);
 		for (const auto *ml : mls)
 		{
-			writer.dxfHex(330, ml->m_Handle);
+			writer.dxfHex(330, writer.GetHandle(ml));
 		}
 		writer.dxfString(102, "}");
 		writer.dxfHex(330, 0x12D);
@@ -1752,7 +1747,7 @@ namespace DXF
 		writer.dxfInt(273, 9); // Top text attachment direction:	9 = Center, 10 = Overline and Center
 	}
 
-	void LeaderPart::WriteDxf(DxfWriter &writer)
+	void LeaderPart::WriteDxf(DxfWriter &writer) const
 	{
 		writer.dxfString(302, "LEADER{");
 		writer.dxfInt(290, 1); // Has Set Last Leader Line Point
@@ -1776,7 +1771,7 @@ namespace DXF
 		writer.dxfString(303, "}");
 	}
 
-	void MTextPart::WriteDxf(DxfWriter &writer)
+	void MTextPart::WriteDxf(DxfWriter &writer) const
 	{
 		writer.dxfInt(174, 1); // Text Angle Type
 		writer.dxfInt(175, 1); // Text Alignment Type
@@ -1818,7 +1813,7 @@ namespace DXF
 		return ContentType::MTEXT_TYPE;
 	}
 
-	void BlockPart::WriteDxf(DxfWriter &writer)
+	void BlockPart::WriteDxf(DxfWriter &writer) const
 	{
 		writer.dxfInt(174, 1); // Text Angle Type
 		writer.dxfInt(175, 1); // Text Alignment Type
@@ -1848,7 +1843,7 @@ namespace DXF
 		return ContentType::BLOCK_TYPE;
 	}
 
-	void CONTEXT_DATA::WriteDxf(DxfWriter &writer)
+	void CONTEXT_DATA::WriteDxf(DxfWriter &writer) const
 	{
 		writer.dxfString(300, "CONTEXT_DATA{");
 		writer.dxfReal(40, 1.0);
@@ -1868,7 +1863,7 @@ namespace DXF
 		writer.dxfString(301, "}");
 	}
 
-	void AcadMLeader::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadMLeader::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		if (!m_ContextData.m_Content ||
 			(m_ContextData.m_Leader.m_Lines.empty() || m_ContextData.m_Leader.m_Lines[0].m_Points.empty()) ||
@@ -1914,7 +1909,7 @@ namespace DXF
 		writer.dxfInt(293, 0);			// Enable Annotation Scale
 		for (size_t i = 0; i < m_AttrValues.size(); ++i)
 		{
-			writer.dxfHex(330, m_AttrDefs[i]->m_Handle);
+			writer.dxfHex(330, writer.GetHandle(m_AttrDefs[i].get()));
 			writer.dxfInt(177, int(i + 1)); // Block Attribute Index
 			writer.dxfReal(44, 0.0);		// Block Attribute Width
 			writer.dxfString(302, m_AttrValues[i]);
@@ -1928,7 +1923,7 @@ namespace DXF
 		writer.dxfInt(273, 9);	 // Top text attachment direction:	9 = Center, 10 = Overline and Center
 	}
 
-	void CellInTableStyle::WriteDxf(DxfWriter &writer)
+	void CellInTableStyle::WriteDxf(DxfWriter &writer) const
 	{
 		writer.dxfReal(140, m_TextHeight);
 		writer.dxfInt(170, m_Alignment);
@@ -1946,7 +1941,7 @@ namespace DXF
 		}
 	}
 
-	void TableStyle::WriteDxf(DxfWriter &writer, const std::string &name, int handle)
+	void TableStyle::WriteDxf(DxfWriter &writer, const std::string &name, Handle handle) const
 	{
 		ASSERT_DEBUG_INFO(!name.empty());
 		writer.dxfString(0, "TABLESTYLE");
@@ -1956,7 +1951,7 @@ namespace DXF
 		const auto &tbls = writer.GetTables(name);
 		for (const auto *tbl : tbls)
 		{
-			writer.dxfHex(330, tbl->m_Handle);
+			writer.dxfHex(330, writer.GetHandle(tbl));
 		}
 		writer.dxfString(102, "}");
 		writer.dxfHex(330, 0x7E);
@@ -1976,7 +1971,7 @@ namespace DXF
 		}
 	}
 
-	void CellText::WriteDxf(DxfWriter &writer)
+	void CellText::WriteDxf(DxfWriter &writer) const
 	{
 		if (!m_Text.empty())
 		{
@@ -1989,7 +1984,7 @@ namespace DXF
 		writer.dxfText(303, 302, m_Text);
 	}
 
-	void CellBlock::WriteDxf(DxfWriter &writer)
+	void CellBlock::WriteDxf(DxfWriter &writer) const
 	{
 		ASSERT_DEBUG_INFO(m_AttrDefs.size() == m_AttrValues.size());
 		writer.dxfHex(340, writer.LookupBlockEntryHandle(m_BlockName));
@@ -2000,12 +1995,12 @@ namespace DXF
 			return;
 		for (size_t i = 0; i < m_AttrDefs.size(); ++i)
 		{
-			writer.dxfHex(331, m_AttrDefs[i]->m_Handle);
+			writer.dxfHex(331, writer.GetHandle(m_AttrDefs[i].get()));
 			writer.dxfString(300, m_AttrValues[i]);
 		}
 	}
 
-	void Cell::WriteDxf(DxfWriter &writer)
+	void Cell::WriteDxf(DxfWriter &writer) const
 	{
 		ASSERT_DEBUG_INFO(m_Content);
 		writer.dxfInt(171, m_Content->GetContentType());
@@ -2056,7 +2051,7 @@ namespace DXF
 		writer.dxfString(304, "ACVALUE_END");
 	}
 
-	void AcadTable::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadTable::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		if (m_RowCount <= 0 || m_ColCount <= 0 || m_RowHeights.size() != m_RowCount || m_ColWidths.size() != m_ColCount || m_Cells.size() != m_RowCount * m_ColCount)
 		{
@@ -2110,7 +2105,7 @@ namespace DXF
 			writer.dxfReal(286, 0);
 	}
 
-	void AcadLine::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadLine::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "LINE");
 		WriteAttribute(writer, bInPaperSpace);
@@ -2121,7 +2116,7 @@ namespace DXF
 		writer.dxfReal(21, m_EndPoint.y);
 	}
 
-	void AcadLWPLine::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadLWPLine::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "LWPOLYLINE");
 		WriteAttribute(writer, bInPaperSpace);
@@ -2145,7 +2140,7 @@ namespace DXF
 		}
 	}
 
-	void AcadMText::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadMText::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "MTEXT");
 		WriteAttribute(writer, bInPaperSpace);
@@ -2173,7 +2168,7 @@ namespace DXF
 		}
 	}
 
-	void AcadPoint::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadPoint::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "POINT");
 		WriteAttribute(writer, bInPaperSpace);
@@ -2182,7 +2177,7 @@ namespace DXF
 		writer.dxfReal(20, m_Point.y);
 	}
 
-	void AcadSolid::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadSolid::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "SOLID");
 		WriteAttribute(writer, bInPaperSpace);
@@ -2193,7 +2188,7 @@ namespace DXF
 		writer.coord(13, m_Point4.x, m_Point4.y);
 	}
 
-	void AcadSpline::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadSpline::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "SPLINE");
 		WriteAttribute(writer, bInPaperSpace);
@@ -2217,7 +2212,7 @@ namespace DXF
 		}
 	}
 
-	void AcadText::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadText::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "TEXT");
 		WriteAttribute(writer, bInPaperSpace);
@@ -2244,10 +2239,10 @@ namespace DXF
 			writer.dxfInt(73, m_VerAlign);
 	}
 
-	void AcadViewport::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadViewport::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "VIEWPORT");
-		writer.dxfHex(5, m_Handle);
+		writer.dxfHex(5, writer.GetHandle(this));
 		writer.dxfString(100, "AcDbEntity");
 		writer.dxfInt(67, 1);
 		writer.dxfString(8, m_Layer);
@@ -2301,7 +2296,7 @@ namespace DXF
 			if (m_locked)
 				status |= 0x4000;
 			writer.dxfInt(90, status);
-			writer.dxfHex(340, clipEnt->m_Handle);
+			writer.dxfHex(340, writer.GetHandle(clipEnt.get()));
 		}
 		else
 		{
@@ -2333,7 +2328,7 @@ namespace DXF
 		writer.dxfInt(170, 0);
 	}
 
-	void AcadXLine::WriteDxf(DxfWriter &writer, bool bInPaperSpace)
+	void AcadXLine::WriteDxf(DxfWriter &writer, bool bInPaperSpace) const
 	{
 		writer.dxfString(0, "XLINE");
 		WriteAttribute(writer, bInPaperSpace);
@@ -2372,13 +2367,13 @@ namespace DXF
 	{
 	}
 
-	void LayoutData::WriteDxf(DxfWriter &writer)
+	void LayoutData::WriteDxf(DxfWriter &writer) const
 	{
 		int viewportID = 0;
 		// TODO: assign ID to viewport
 		for (const auto &pEnt : m_Objects)
 		{
-			pEnt->WriteDxf(writer, true);
+			writer.WriteEntity(*pEnt, true);
 		}
 	}
 
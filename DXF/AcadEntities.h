@@ -14,6 +14,7 @@
 #include <map>
 #include <list>
 #include <memory>
+#include <unordered_map>
 
 #include "ImpExpMacro.h"
 #include "ACADConst.h"
@@ -33,7 +34,7 @@ namespace DXF
 	struct NameHandle
 	{
 		std::string name;
-		int handle;
+		Handle handle;
 	};
 
 	struct DXF_API LayerData
@@ -236,16 +237,44 @@ namespace DXF
 		CDblPoint m_PlotOrigin;
 	};
 
+	struct EntAttribute;
+	// entity -> handle assigned on writing
+	using HandleMap = std::unordered_map<const EntAttribute *, Handle>;
+
+	// Hands out handles of one writing in increasing order.
+	// Handles below FirstFree are fixed handles of tables, dictionaries and *Model_Space.
+	class HandleAllocator
+	{
+	public:
+		static const Handle FirstFree = 0x300;
+		HandleAllocator() : m_Next(FirstFree) {}
+		void Reset() { m_Next = FirstFree; }
+		Handle Allocate() { return m_Next++; }
+		// Allocate count consecutive handles, returns the first one.
+		Handle Allocate(Handle count)
+		{
+			Handle first = m_Next;
+			m_Next += count;
+			return first;
+		}
+		// Next unused handle, i.e. $HANDSEED.
+		Handle Seed() const { return m_Next; }
+
+	private:
+		Handle m_Next;
+	};
+
 	struct DXF_API EntAttribute
 	{
 		EntAttribute();
 		EntAttribute(const EntAttribute &) = default;
 		virtual ~EntAttribute() = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) {};
-		virtual void AssignHandle(/*in, out*/ int &handle);
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const {};
+		virtual void AssignHandle(HandleAllocator &allocator, /*out*/ HandleMap &handles) const;
 		void WriteAttribute(DxfWriter &writer, bool bInPaperSpace) const;
 
-		mutable int m_Handle; // m_Handle will be assigned value on writing.
+		// Handle read from DXF. DxfWriter(DxfData &) also sets it to the handle used on last writing.
+		mutable Handle m_Handle;
 		bool m_IsInPaperspace;
 		AcColor m_Color;
 		AcLineWeight m_Lineweight;
@@ -262,7 +291,7 @@ namespace DXF
 		// Because EntityList owns the entities, so it can not be shallow-copied.
 		EntityList(const EntityList &src) = delete;
 		~EntityList() = default;
-		iterator FindEntity(int handle);
+		iterator FindEntity(Handle handle);
 	};
 
 	using VectorOfEntityList = std::vector<std::shared_ptr<EntityList>>;
@@ -271,7 +300,7 @@ namespace DXF
 	{
 		AcadCircle();
 		AcadCircle(const AcadCircle &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_Center;
 		double m_Radius;
@@ -281,7 +310,7 @@ namespace DXF
 	{
 		AcadArc();
 		AcadArc(const AcadArc &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		double m_StartAngle; //in degrees
 		double m_EndAngle;	 //in degrees
@@ -291,7 +320,7 @@ namespace DXF
 	{
 		AcadAttDef();
 		AcadAttDef(const AcadAttDef &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		// See AcadText for explanation.
 		CDblPoint m_BaseLeftPoint;	/*10*/
@@ -312,8 +341,8 @@ namespace DXF
 	{
 		AcadAttrib();
 		AcadAttrib(const AcadAttrib &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
-		void WriteDxf(DxfWriter &writer, bool bInPaperSpace, int parentHandle);
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
+		void WriteDxf(DxfWriter &writer, bool bInPaperSpace, Handle parentHandle) const;
 
 		// See AcadText for explanation.
 		CDblPoint m_BaseLeftPoint;	/*10*/
@@ -333,8 +362,8 @@ namespace DXF
 	{
 		AcadBlockInstance();
 		AcadBlockInstance(const AcadBlockInstance &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
-		virtual void AssignHandle(/*in, out*/ int &handle);
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
+		virtual void AssignHandle(HandleAllocator &allocator, /*out*/ HandleMap &handles) const override;
 
 		std::string m_Name;
 		CDblPoint m_InsertionPoint;
@@ -347,8 +376,8 @@ namespace DXF
 	{
 		AcadDim();
 		AcadDim(const AcadDim &) = default;
-		void WriteHeader(DxfWriter &writer, bool bInPaperSpace);
-		void WriteOverride(DxfWriter &writer);
+		void WriteHeader(DxfWriter &writer, bool bInPaperSpace) const;
+		void WriteOverride(DxfWriter &writer) const;
 
 		//如果m_BlockName为空，DxfWriter需要生成标注图块，否则说明是从DXF文件读取的，已经读入显示标注图块(*D<n>)。
 		std::string m_BlockName;
@@ -454,6 +483,7 @@ namespace DXF
 #pragma endregion
 
 	public: // Used internally
+		// Add the block of the dimension to graph, and set m_BlockName. Not implemented by any dimension yet.
 		virtual void GenerateBlock(DxfData &graph, const char *blockName) = 0;
 	};
 
@@ -461,7 +491,7 @@ namespace DXF
 	{
 		AcadDimInternal();
 
-		std::vector<int> m_ReactorHandles;
+		std::vector<Handle> m_ReactorHandles;
 
 	public: // Used internally
 		virtual void GenerateBlock(DxfData &graph, const char *blockName) override {};
@@ -471,7 +501,7 @@ namespace DXF
 	{
 		AcadDimAln();
 		AcadDimAln(const AcadDimAln &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_ExtLine1Point, m_ExtLine2Point;
 		double m_RotationAngle; //in degrees
@@ -484,7 +514,7 @@ namespace DXF
 	{
 		AcadDimAng3P();
 		AcadDimAng3P(const AcadDimAng3P &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_FirstEnd, m_SecondEnd; // the endpoints of the extension lines
 		CDblPoint m_AngleVertex;		   // the vertex of the angle
@@ -497,7 +527,7 @@ namespace DXF
 	{
 		AcadDimAng();
 		AcadDimAng(const AcadDimAng &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_FirstStart, m_FirstEnd;		   // the first extension line
 		CDblPoint m_SecondStart /*, m_SecondEnd*/; // the second extension line
@@ -510,7 +540,7 @@ namespace DXF
 	{
 		AcadDimDia();
 		AcadDimDia(const AcadDimDia &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_ChordPoint /*, m_FarChordPoint*/;
 		double m_LeaderLength;
@@ -523,7 +553,7 @@ namespace DXF
 	{
 		AcadDimRad();
 		AcadDimRad(const AcadDimRad &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_ChordPoint /*, m_Center*/;
 		double m_LeaderLength;
@@ -536,7 +566,7 @@ namespace DXF
 	{
 		AcadDimRot();
 		AcadDimRot(const AcadDimRot &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 	public: // Used internally
 		virtual void GenerateBlock(DxfData &graph, const char *blockName) override;
@@ -546,7 +576,7 @@ namespace DXF
 	{
 		AcadDimOrd();
 		AcadDimOrd(const AcadDimOrd &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_OrdPoint, m_LeaderPoint;
 
@@ -558,7 +588,7 @@ namespace DXF
 	{
 		AcadEllipse();
 		AcadEllipse(const AcadEllipse &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_Center;
 		CDblPoint m_MajorAxisPoint;
@@ -618,17 +648,17 @@ namespace DXF
 		// Here, pEnt can be any entities, such as AcadText.
 		bool AddAssociatedEntity(const std::shared_ptr<EntAttribute> &pEnt, int loopIndex = -1);
 		bool HasAssociatedEntity() const;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 	private:
-		void WriteLoop(DxfWriter &writer, int loopIndex);
+		void WriteLoop(DxfWriter &writer, int loopIndex) const;
 	};
 
 	struct DXF_API AcadLeader : public EntAttribute
 	{
 		AcadLeader();
 		AcadLeader(const AcadLeader &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		std::string m_StyleName;
 		AcLeaderType m_Type;
@@ -650,8 +680,8 @@ namespace DXF
 
 	struct DXF_API StyleContent
 	{
-		virtual ~StyleContent() = 0 {}
-		virtual void WriteDxf(DxfWriter &writer) = 0;
+		virtual ~StyleContent() = default;
+		virtual void WriteDxf(DxfWriter &writer) const = 0;
 		virtual ContentType GetContentType() const = 0;
 	};
 
@@ -659,7 +689,7 @@ namespace DXF
 	{
 		StyleMTextPart();
 		StyleMTextPart(const StyleMTextPart &) = default;
-		virtual void WriteDxf(DxfWriter &writer) override;
+		virtual void WriteDxf(DxfWriter &writer) const override;
 		virtual ContentType GetContentType() const override;
 		std::string m_TextStyle;		 /*342*/
 		AcTextAngleType m_TextAngleType; /*175*/
@@ -672,7 +702,7 @@ namespace DXF
 	{
 		StyleBlockPart();
 		StyleBlockPart(const StyleBlockPart &) = default;
-		virtual void WriteDxf(DxfWriter &writer) override;
+		virtual void WriteDxf(DxfWriter &writer) const override;
 		virtual ContentType GetContentType() const override;
 		std::string m_BlockName;					 /*343*/
 		AcBlockConnectionType m_BlockConnectionType; /*177, Center Extens, Insertion point*/
@@ -684,7 +714,7 @@ namespace DXF
 	{
 		MLeaderStyle();
 		MLeaderStyle(const MLeaderStyle &) = default;
-		void WriteDxf(DxfWriter &writer, const std::string &name, int handle);
+		void WriteDxf(DxfWriter &writer, const std::string &name, Handle handle) const;
 		AcMLeaderType m_LeaderType; /*173*/
 		AcColor m_LineColor;		/*91*/
 		std::string m_LineType;		/*340*/
@@ -716,7 +746,7 @@ namespace DXF
 	{
 		LeaderPart();
 		LeaderPart(const LeaderPart &) = default;
-		void WriteDxf(DxfWriter &writer);
+		void WriteDxf(DxfWriter &writer) const;
 		CDblPoint m_CommonPoint; /*10*/
 		std::vector<LeaderLine> m_Lines;
 		double m_DoglegLength; /*40, required*/
@@ -724,16 +754,16 @@ namespace DXF
 
 	struct DXF_API Content
 	{
-		virtual void WriteDxf(DxfWriter &writer) = 0;
+		virtual void WriteDxf(DxfWriter &writer) const = 0;
 		virtual ContentType GetContentType() const = 0;
-		virtual ~Content() = 0 {}
+		virtual ~Content() = default;
 	};
 
 	struct DXF_API MTextPart : Content
 	{
 		MTextPart();
 		MTextPart(const MTextPart &) = default;
-		virtual void WriteDxf(DxfWriter &writer) override;
+		virtual void WriteDxf(DxfWriter &writer) const override;
 		virtual ContentType GetContentType() const override;
 		std::string m_Text;		  /* 304, no default value, use \P as new line. such as hello\Pworld*/
 		double m_TextWidth;		  /*43, no default value*/
@@ -748,7 +778,7 @@ namespace DXF
 	{
 		BlockPart();
 		BlockPart(const BlockPart &) = default;
-		virtual void WriteDxf(DxfWriter &writer) override;
+		virtual void WriteDxf(DxfWriter &writer) const override;
 		virtual ContentType GetContentType() const override;
 		std::string m_BlockName;   /*341, no default value*/
 		AcColor m_BlockColor;	   /*93*/
@@ -761,7 +791,7 @@ namespace DXF
 	{
 		CONTEXT_DATA();
 		CONTEXT_DATA(const CONTEXT_DATA &) = default;
-		void WriteDxf(DxfWriter &writer);
+		void WriteDxf(DxfWriter &writer) const;
 		CDblPoint m_LandingPosition; /* 10, no default value*/
 		double m_TextHeight;		 /* 41*/
 		double m_ArrowSize;			 /* 140*/
@@ -779,7 +809,7 @@ namespace DXF
 	{
 		AcadMLeader();
 		AcadMLeader(const AcadMLeader &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CONTEXT_DATA m_ContextData;
 		std::string m_LeaderStyle;	/*340*/
@@ -807,7 +837,7 @@ namespace DXF
 	{
 		CellInTableStyle();
 		CellInTableStyle(const CellInTableStyle &) = default;
-		void WriteDxf(DxfWriter &writer);
+		void WriteDxf(DxfWriter &writer) const;
 
 		double m_TextHeight;				/*140, 0.18*/
 		AcCellAlignment m_Alignment;		/*170, acMiddleCenter*/
@@ -827,7 +857,7 @@ namespace DXF
 	{
 		TableStyle();
 		TableStyle(const TableStyle &) = default;
-		void WriteDxf(DxfWriter &writer, const std::string &name, int handle);
+		void WriteDxf(DxfWriter &writer, const std::string &name, Handle handle) const;
 
 		double m_HorCellMargin;	   /*40, 0.06*/
 		double m_VerCellMargin;	   /*41, 0.06*/
@@ -841,8 +871,8 @@ namespace DXF
 
 	struct CellContent
 	{
-		virtual ~CellContent() = 0 {}
-		virtual void WriteDxf(DxfWriter &writer) = 0;
+		virtual ~CellContent() = default;
+		virtual void WriteDxf(DxfWriter &writer) const = 0;
 		virtual CellType GetContentType() const = 0;
 	};
 
@@ -850,7 +880,7 @@ namespace DXF
 	{
 		CellText();
 		CellText(const CellText &) = default;
-		virtual void WriteDxf(DxfWriter &writer) override;
+		virtual void WriteDxf(DxfWriter &writer) const override;
 		virtual CellType GetContentType() const override;
 
 		std::string m_Text;		 /*many 2 and one 1, such as {\fSimSun|b0|i0|c134|p2;王五}*/
@@ -862,7 +892,7 @@ namespace DXF
 	{
 		CellBlock();
 		CellBlock(const CellBlock &) = default;
-		virtual void WriteDxf(DxfWriter &writer) override;
+		virtual void WriteDxf(DxfWriter &writer) const override;
 		virtual CellType GetContentType() const override;
 
 		std::string m_BlockName; /*340*/
@@ -877,7 +907,7 @@ namespace DXF
 	{
 		Cell(CellType);
 		Cell(const Cell &) = default;
-		void WriteDxf(DxfWriter &writer);
+		void WriteDxf(DxfWriter &writer) const;
 
 		//Type m_Type; /*171*/
 		int m_Flag;		/*172, 0*/
@@ -914,7 +944,7 @@ namespace DXF
 	{
 		AcadTable();
 		AcadTable(const AcadTable &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		// These are convinient functions to construct a table object.
 		void InitializeCells(int rowCount, int colCount, CellType ct);
@@ -958,7 +988,7 @@ namespace DXF
 	{
 		AcadLine();
 		AcadLine(const AcadLine &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_StartPoint;
 		CDblPoint m_EndPoint;
@@ -968,7 +998,7 @@ namespace DXF
 	{
 		AcadLWPLine();
 		AcadLWPLine(const AcadLWPLine &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		DblPoints m_Vertices;
 		bool m_Closed;
@@ -978,7 +1008,7 @@ namespace DXF
 			m_Width = width;
 		}
 		double GetConstWdith() { return m_Width; }
-		bool IsConstWidth()
+		bool IsConstWidth() const
 		{
 			return m_startWidths.empty();
 		}
@@ -995,6 +1025,7 @@ namespace DXF
 		double GetBulge(size_t Index) const;
 		void SetBulges(std::vector<double> bulges);
 		bool HasBulges() const { return !m_Bulges.empty(); }
+		const std::vector<double> &bulges() const { return m_Bulges; }
 
 	private:
 		double m_Width;
@@ -1007,7 +1038,7 @@ namespace DXF
 	{
 		AcadMText();
 		AcadMText(const AcadMText &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_InsertionPoint; //对齐点的坐标
 		double m_Width;
@@ -1024,7 +1055,7 @@ namespace DXF
 	{
 		AcadPoint();
 		AcadPoint(const AcadPoint &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_Point;
 	};
@@ -1033,7 +1064,7 @@ namespace DXF
 	{
 		AcadSolid();
 		AcadSolid(const AcadSolid &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_Point1, m_Point2, m_Point3, m_Point4;
 	};
@@ -1042,7 +1073,7 @@ namespace DXF
 	{
 		AcadSpline();
 		AcadSpline(const AcadSpline &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		//样条曲线标志（按位编码）：
 		//	1 = 闭合样条曲线
@@ -1074,7 +1105,7 @@ namespace DXF
 			a = m_ObliqueAngle;
 			valid = m_IsObliqueAngleValid;
 		}
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		// m_BaseLeftPoint可以从m_InsertionPoint, m_HorAlign, m_VerAlign等信息计算出。
 		CDblPoint m_BaseLeftPoint;	//文字左下角点
@@ -1110,7 +1141,7 @@ namespace DXF
 	{
 		AcadViewport();
 		AcadViewport(const AcadViewport &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_PaperspaceCenter;
 		double m_PaperspaceWidth;
@@ -1128,7 +1159,7 @@ namespace DXF
 	{
 		AcadXLine();
 		AcadXLine(const AcadXLine &) = default;
-		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) override;
+		virtual void WriteDxf(DxfWriter &writer, bool bInPaperSpace) const override;
 
 		CDblPoint m_First;
 		CDblPoint m_Second;
@@ -1137,7 +1168,7 @@ namespace DXF
 	struct DXF_API LayoutData
 	{
 		LayoutData();
-		void WriteDxf(DxfWriter &writer);
+		void WriteDxf(DxfWriter &writer) const;
 		// convenient functions to add polygonal AcadViewport
 		void AddPolygonalViewport(const DblPoints &polygonPS, const CDblPoint &centerMS, double heighMS, double twistAngle /*degrees*/);
 		void AddPolygonalViewportByWidth(const DblPoints &polygonMS, const CDblPoint &centerPS, double widthPS, double twistAngle /*degrees*/);
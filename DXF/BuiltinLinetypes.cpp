@@ -0,0 +1,192 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+
+#include "BuiltinTables.h"
+
+namespace DXF {
+
+	// Standard ISO linetypes, the content of acadiso.lin converted to UTF-8.
+	// Non-ASCII characters are escaped so that the source compiles the same under any code page.
+	extern const char g_BuiltinLinFile[] =
+		";;\n"
+		";;  AutoCAD ISO Linetype Definition file\n"
+		";;  Version 2.0\n"
+		";;  \347\211\210\346\235\203\346\211\200\346\234\211 Autodesk, Inc. 1996-2009\343\200\202\344\277\235\347\225\231\346\211\200\346\234\211\346\235\203\345\210\251\343\200\202\n"
+		";;\n"
+		";;  Note: in order to ease migration of this file when upgrading \n"
+		";;  to a future version of AutoCAD, it is recommended that you add\n"
+		";;  your customizations to the User Defined Linetypes section at the\n"
+		";;  end of this file.\n"
+		";;\n"
+		";;  customized for ISO scaling\n"
+		";;\n"
+		"*BORDER,Border __ __ . __ __ . __ __ . __ __ . __ __ .\n"
+		"A, 12.7, -6.35, 12.7, -6.35, 0, -6.35 \n"
+		"*BORDER2,Border (.5x) __.__.__.__.__.__.__.__.__.__.__.\n"
+		"A, 6.35, -3.175, 6.35, -3.175, 0, -3.175 \n"
+		"*BORDERX2,Border (2x) ____  ____  .  ____  ____  .  ___\n"
+		"A, 25.4, -12.7, 25.4, -12.7, 0, -12.7 \n"
+		"\n"
+		"*CENTER,Center ____ _ ____ _ ____ _ ____ _ ____ _ ____\n"
+		"A, 31.75, -6.35, 6.35, -6.35 \n"
+		"*CENTER2,Center (.5x) ___ _ ___ _ ___ _ ___ _ ___ _ ___\n"
+		"A, 19.05, -3.175, 3.175, -3.175 \n"
+		"*CENTERX2,Center (2x) ________  __  ________  __  _____\n"
+		"A, 63.5, -12.7, 12.7, -12.7 \n"
+		"\n"
+		"*DASHDOT,Dash dot __ . __ . __ . __ . __ . __ . __ . __\n"
+		"A, 12.7, -6.35, 0, -6.35 \n"
+		"*DASHDOT2,Dash dot (.5x) _._._._._._._._._._._._._._._.\n"
+		"A, 6.35, -3.175, 0, -3.175 \n"
+		"*DASHDOTX2,Dash dot (2x) ____  .  ____  .  ____  .  ___\n"
+		"A, 25.4, -12.7, 0, -12.7 \n"
+		"\n"
+		"*DASHED,Dashed __ __ __ __ __ __ __ __ __ __ __ __ __ _\n"
+		"A, 12.7, -6.35 \n"
+		"*DASHED2,Dashed (.5x) _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ \n"
+		"A, 6.35, -3.175 \n"
+		"*DASHEDX2,Dashed (2x) ____  ____  ____  ____  ____  ___\n"
+		"A, 25.4, -12.7 \n"
+		"\n"
+		"*DIVIDE,Divide ____ . . ____ . . ____ . . ____ . . ____\n"
+		"A, 12.7, -6.35, 0, -6.35, 0, -6.35 \n"
+		"*DIVIDE2,Divide (.5x) __..__..__..__..__..__..__..__.._\n"
+		"A, 6.35, -3.175, 0, -3.175, 0, -3.175 \n"
+		"*DIVIDEX2,Divide (2x) ________  .  .  ________  .  .  _\n"
+		"A, 25.4, -12.7, 0, -12.7, 0, -12.7 \n"
+		"\n"
+		"*DOT,Dot . . . . . . . . . . . . . . . . . . . . . . . .\n"
+		"A, 0, -6.35 \n"
+		"*DOT2,Dot (.5x) ........................................\n"
+		"A, 0, -3.175 \n"
+		"*DOTX2,Dot (2x) .  .  .  .  .  .  .  .  .  .  .  .  .  .\n"
+		"A, 0, -12.7 \n"
+		"\n"
+		"*HIDDEN,Hidden __ __ __ __ __ __ __ __ __ __ __ __ __ __\n"
+		"A, 6.35, -3.175 \n"
+		"*HIDDEN2,Hidden (.5x) _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ \n"
+		"A, 3.175, -1.5875 \n"
+		"*HIDDENX2,Hidden (2x) ____ ____ ____ ____ ____ ____ ____ \n"
+		"A, 12.7, -6.35 \n"
+		"\n"
+		"*PHANTOM,Phantom ______  __  __  ______  __  __  ______ \n"
+		"A, 31.75, -6.35, 6.35, -6.35, 6.35, -6.35 \n"
+		"*PHANTOM2,Phantom (.5x) ___ _ _ ___ _ _ ___ _ _ ___ _ _\n"
+		"A, 15.875, -3.175, 3.175, -3.175, 3.175, -3.175 \n"
+		"*PHANTOMX2,Phantom (2x) ____________    ____    ____   _\n"
+		"A, 63.5, -12.7, 12.7, -12.7, 12.7, -12.7 \n"
+		"\n"
+		";;\n"
+		";;  ISO 128 (ISO/DIS 12011) linetypes have been added. \n"
+		";;\n"
+		";;  The size of the line segments for each defined ISO line, is \n"
+		";;  defined for an usage with a pen width of 1 mm. To use them with \n"
+		";;  the other ISO predefined pen widths, the line has to be scaled \n"
+		";;  with the appropriate value (e.g. pen width 0,5 mm -> ltscale 0.5).\n"
+		";;\n"
+		"*ACAD_ISO02W100,ISO dash __ __ __ __ __ __ __ __ __ __ __ __ __\n"
+		"A,12,-3\n"
+		"*ACAD_ISO03W100,ISO dash space __    __    __    __    __    __\n"
+		"A,12,-18\n"
+		"*ACAD_ISO04W100,ISO long-dash dot ____ . ____ . ____ . ____ . _\n"
+		"A,24,-3,0,-3\n"
+		"*ACAD_ISO05W100,ISO long-dash double-dot ____ .. ____ .. ____ . \n"
+		"A,24,-3,0,-3,0,-3\n"
+		"*ACAD_ISO06W100,ISO long-dash triple-dot ____ ... ____ ... ____\n"
+		"A,24,-3,0,-3,0,-3,0,-3\n"
+		"*ACAD_ISO07W100,ISO dot . . . . . . . . . . . . . . . . . . . . \n"
+		"A,0,-3\n"
+		"*ACAD_ISO08W100,ISO long-dash short-dash ____ __ ____ __ ____ _\n"
+		"A,24,-3,6,-3\n"
+		"*ACAD_ISO09W100,ISO long-dash double-short-dash ____ __ __ ____\n"
+		"A,24,-3,6,-3,6,-3\n"
+		"*ACAD_ISO10W100,ISO dash dot __ . __ . __ . __ . __ . __ . __ . \n"
+		"A,12,-3,0,-3\n"
+		"*ACAD_ISO11W100,ISO double-dash dot __ __ . __ __ . __ __ . __ _\n"
+		"A,12,-3,12,-3,0,-3\n"
+		"*ACAD_ISO12W100,ISO dash double-dot __ . . __ . . __ . . __ . . \n"
+		"A,12,-3,0,-3,0,-3\n"
+		"*ACAD_ISO13W100,ISO double-dash double-dot __ __ . . __ __ . . _\n"
+		"A,12,-3,12,-3,0,-3,0,-3\n"
+		"*ACAD_ISO14W100,ISO dash triple-dot __ . . . __ . . . __ . . . _\n"
+		"A,12,-3,0,-3,0,-3,0,-3\n"
+		"*ACAD_ISO15W100,ISO double-dash triple-dot __ __ . . . __ __ . .\n"
+		"A,12,-3,12,-3,0,-3,0,-3,0,-3\n"
+		"\n"
+		";;  Complex linetypes\n"
+		";;\n"
+		";;  Complex linetypes have been added to this file.\n"
+		";;  These linetypes were defined in LTYPESHP.LIN in\n"
+		";;  Release 13, and are incorporated in ACAD.LIN in\n"
+		";;  Release 14.\n"
+		";;  \n"
+		";;  These linetype definitions use LTYPESHP.SHX.\n"
+		";;\n"
+		"*FENCELINE1,Fenceline circle ----0-----0----0-----0----0-----0--\n"
+		"A,6.35,-2.54,[CIRC1,ltypeshp.shx,x=-2.54,s=2.54],-2.54,25.4\n"
+		"*FENCELINE2,Fenceline square ----[]-----[]----[]-----[]----[]---\n"
+		"A,6.35,-2.54,[BOX,ltypeshp.shx,x=-2.54,s=2.54],-2.54,25.4\n"
+		"*TRACKS,Tracks -|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-|-\n"
+		"A,3.81,[TRACK1,ltypeshp.shx,s=6.35],3.81\n"
+		"*BATTING,Batting SSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSSS\n"
+		"A,.00254,-2.54,[BAT,ltypeshp.shx,x=-2.54,s=2.54],-5.08,[BAT,ltypeshp.shx,r=180,x=2.54,s=2.54],-2.54\n"
+		"*HOT_WATER_SUPPLY,Hot water supply ---- HW ---- HW ---- HW ----\n"
+		"A,12.7,-5.08,[\"HW\",STANDARD,S=2.54,R=0.0,X=-2.54,Y=-1.27],-5.08\n"
+		"*GAS_LINE,Gas line ----GAS----GAS----GAS----GAS----GAS----GAS--\n"
+		"A,12.7,-5.08,[\"GAS\",STANDARD,S=2.54,R=0.0,X=-2.54,Y=-1.27],-6.35\n"
+		"*ZIGZAG,Zig zag /\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\\/\n"
+		"A,.00254,-5.08,[ZIG,ltypeshp.shx,x=-5.08,s=5.08],-10.16,[ZIG,ltypeshp.shx,r=180,x=5.08,s=5.08],-5.08\n"
+		";;  Linetype Definition related to JIS Z 8312\n"
+		";;\n"
+		"*JIS_08_11,1SASEN11 ___ _ ___ _ ___ _ ___ _ ___ _ ___\n"
+		"A,11,-.60,.60,-.60\n"
+		"*JIS_08_15,1SASEN15 ____ _ ____ _ ____ _ ____ _ ____ \n"
+		"A,15,-.75,.75,-.75\n"
+		"*JIS_08_25,1SASEN25 ________  __  ________  __  _____\n"
+		"A,25,-1.125,.75,-1.125\n"
+		"*JIS_08_37,1SASEN37 ________  __  ________  __  _____\n"
+		"A,37.5,-1.125,.75,-1.125\n"
+		"*JIS_08_50,1SASEN50 _______________  __  ____________\n"
+		"A,50,-1.125,.75,-1.125\n"
+		"*JIS_02_0.7,HIDDEN0.75 _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ \n"
+		"A,.75,-.60\n"
+		"*JIS_02_1.0,HIDDEN01 _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ \n"
+		"A,1,-1\n"
+		"*JIS_02_1.2,HIDDEN01.25  _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ \n"
+		"A,1.25,-1.25\n"
+		"*JIS_02_2.0,HIDDEN02 __ __ __ __ __ __ __ __ __ __ __ \n"
+		"A,2,-1\n"
+		"*JIS_02_4.0,HIDDEN04 ____ ____ ____ ____ ____ ____ ____ \n"
+		"A,4,-1.5\n"
+		"*JIS_09_08,2SASEN8 __ _ _ __ _ _ __ _ _ __ _ _ __ _ _ \n"
+		"A,8,-.55,.55,-.55,.55,-.55\n"
+		"*JIS_09_15,2SASEN15 ___ _ _ ___ _ _ ___ _ _ ___ _ _ ___ \n"
+		"A,15,-.90,.60,-.90,.60,-.90\n"
+		"*JIS_09_29,2SASEN29 ______?@__  __  ______?@__  __  ___\n"
+		"A,29,-1.2,.70,-1.2,.70,-1.2\n"
+		"*JIS_09_50,2SASEN50 ____________?@__  __  _____________\n"
+		"A,50,-1.2,.70,-1.2,.70,-1.2\n"
+		";;\n"
+		"\n"
+		";;  User Defined Linetypes\n"
+		";;\n"
+		";;  Add any linetypes that you define to this section of\n"
+		";;  the file to ensure that they migrate properly when\n"
+		";;  upgrading to a future AutoCAD version.  If duplicate\n"
+		";;  linetype definitions are found in this file, items\n"
+		";;  in the User Defined Linetypes section take precedence\n"
+		";;  over definitions that appear earlier in the file.\n"
+		";;\n"
+		;
+
+	extern const size_t g_BuiltinLinFileSize = sizeof(g_BuiltinLinFile) - 1;
+
+}
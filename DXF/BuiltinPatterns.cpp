@@ -0,0 +1,437 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+
+#include "BuiltinTables.h"
+
+namespace DXF {
+
+	// Standard ISO patterns, the content of acadiso.pat converted to UTF-8.
+	// Non-ASCII characters are escaped so that the source compiles the same under any code page.
+	extern const char g_BuiltinPatFile[] =
+		";;\n"
+		";;  \347\211\210\346\235\203\346\211\200\346\234\211 Autodesk, Inc. 1991-2009\343\200\202\344\277\235\347\225\231\346\211\200\346\234\211\346\235\203\345\210\251\343\200\202\n"
+		";;  Version 2.0\n"
+		";;  AutoCAD Hatch Patterns\n"
+		";;  Customized for ISO scaling\n"
+		";;\n"
+		";;\n"
+		";;  Note: in order to ease migration of this file when upgrading \n"
+		";;  to a future version of AutoCAD, it is recommended that you add\n"
+		";;  your customizations to the User Defined Hatch Patterns section at the\n"
+		";;  end of this file.\n"
+		";;\n"
+		"*SOLID, \345\256\236\344\275\223\345\241\253\345\205\205\n"
+		"45, 0,0, 0,.125\n"
+		"*ANGLE,\350\247\222\351\222\242\n"
+		"0, 0, 0, 0, 6.985, 5.08, -1.905 \n"
+		"90, 0, 0, 0, 6.985, 5.08, -1.905 \n"
+		"*ANSI31,ANSI \351\223\201\343\200\201\347\240\226\345\222\214\347\237\263\n"
+		"45, 0, 0, 0, 3.175 \n"
+		"*ANSI32,ANSI \351\222\242\n"
+		"45, 0, 0, 0, 9.525 \n"
+		"45, 4.49013, 0, 0, 9.525 \n"
+		"*ANSI33,ANSI \351\235\222\351\223\234\343\200\201\351\273\204\351\223\234\345\222\214\347\264\253\351\223\234\n"
+		"45, 0, 0, 0, 6.35 \n"
+		"45, 4.49013, 0, 0, 6.35, 3.175, -1.5875 \n"
+		"*ANSI34,ANSI \345\241\221\346\226\231\345\222\214\346\251\241\350\203\266\n"
+		"45, 0, 0, 0, 19.05 \n"
+		"45, 4.49013, 0, 0, 19.05 \n"
+		"45, 8.98026, 0, 0, 19.05 \n"
+		"45, 13.4704, 0, 0, 19.05 \n"
+		"*ANSI35,ANSI \350\200\220\347\201\253\347\240\226\345\222\214\350\200\220\347\201\253\346\235\220\350\264\250\n"
+		"45, 0, 0, 0, 6.35 \n"
+		"45, 4.49013, 0, 0, 6.35, 7.9375, -1.5875, 0, -1.5875 \n"
+		"*ANSI36,ANSI \345\244\247\347\220\206\347\237\263\343\200\201\346\235\277\345\262\251\345\222\214\347\216\273\347\222\203\n"
+		"45, 0, 0, 5.55625, 3.175, 7.9375, -1.5875, 0, -1.5875 \n"
+		"*ANSI37,ANSI \351\223\205\343\200\201\351\224\214\343\200\201\351\225\201\345\222\214\345\243\260/\347\203\255/\347\224\265\347\273\235\347\274\230\344\275\223\n"
+		"45, 0, 0, 0, 3.175 \n"
+		"135, 0, 0, 0, 3.175 \n"
+		"*ANSI38,ANSI \351\223\235\n"
+		"45, 0, 0, 0, 3.175 \n"
+		"135, 0, 0, 6.35, 3.175, 7.9375, -4.7625 \n"
+		"*AR-B816, 8x16 \345\235\227\347\240\226\351\241\272\347\240\214\n"
+		"0, 0, 0, 0, 203.2 \n"
+		"90, 0, 0, 203.2, 203.2, 203.2, -203.2 \n"
+		"*AR-B816C, 8x16 \345\235\227\347\240\226\351\241\272\347\240\214\357\274\214\347\224\250\347\201\260\346\263\245\346\216\245\347\274\235\n"
+		"0, 0, 0, 203.2, 203.2, 396.875, -9.525 \n"
+		"0, -203.2, 9.525, 203.2, 203.2, 396.875, -9.525 \n"
+		"90, 0, 0, 203.2, 203.2, -212.725, 193.675 \n"
+		"90, -9.525, 0, 203.2, 203.2, -212.725, 193.675 \n"
+		"*AR-B88, 8x8 \345\235\227\347\240\226\351\241\272\347\240\214\n"
+		"0, 0, 0, 0, 203.2 \n"
+		"90, 0, 0, 203.2, 101.6, 203.2, -203.2 \n"
+		"*AR-BRELM, \346\240\207\345\207\206\347\240\226\345\235\227\350\213\261\345\274\217\345\240\206\347\240\214\357\274\214\347\224\250\347\201\260\346\263\245\346\216\245\347\274\235\n"
+		"0, 0, 0, 0, 135.484, 193.675, -9.525 \n"
+		"0, 0, 57.15, 0, 135.484, 193.675, -9.525 \n"
+		"0, 50.8, 67.7418, 0, 135.484, 92.075, -9.525 \n"
+		"0, 50.8, 124.892, 0, 135.484, 92.075, -9.525 \n"
+		"90, 0, 0, 0, 203.2, 57.15, -78.3336 \n"
+		"90, -9.525, 0, 0, 203.2, 57.15, -78.3336 \n"
+		"90, 50.8, 67.7418, 0, 101.6, 57.15, -78.3336 \n"
+		"90, 41.275, 67.7418, 0, 101.6, 57.15, -78.3336 \n"
+		"*AR-BRSTD, \346\240\207\345\207\206\347\240\226\345\235\227\351\241\272\347\240\214\n"
+		"0, 0, 0, 0, 67.7418 \n"
+		"90, 0, 0, 67.7418, 101.6, 67.7418, -67.7418 \n"
+		"*AR-CONC, \351\232\217\346\234\272\347\232\204\347\202\271\345\222\214\347\237\263\345\244\264\345\233\276\346\241\210\n"
+		"50, 0, 0, 104.896, -149.807, 19.05, -209.55 \n"
+		"355, 0, 0, -51.7604, 187.258, 15.24, -167.64 \n"
+		"100.451, 15.182, -1.32825, 145.557, -176.27, 16.19, -178.09 \n"
+		"46.1842, 0, 50.8, 157.343, -224.71, 28.575, -314.325 \n"
+		"96.6356, 22.5899, 47.2965, 218.335, -264.405, 24.285, -267.135 \n"
+		"351.184, 0, 50.8, 196.679, 280.887, 22.86, -251.46 \n"
+		"21, 25.4, 38.1, 104.896, -149.807, 19.05, -209.55 \n"
+		"326, 25.4, 38.1, -51.7604, 187.258, 15.24, -167.64 \n"
+		"71.4514, 38.0345, 29.5779, 145.557, -176.27, 16.19, -178.09 \n"
+		"37.5, 0, 0, 53.9242, 65.2018, 0,        -165.608, 0, -170.18, 0, -168.275 \n"
+		"7.5, 0, 0, 79.3242, 90.6018, 0, -97.028, 0, -161.798, 0, -64.135 \n"
+		"-32.5, -56.642, 0, 117.434, 68.0212, 0, -63.5, 0, -198.12, 0, -262.89 \n"
+		"-42.5, -82.042, 0, 92.0344, 118.821, 0, -82.55, 0, -131.572, 0, -186.69 \n"
+		"*AR-HBONE, \346\240\207\345\207\206\347\232\204\347\240\226\345\235\227\346\210\220\344\272\272\345\255\227\345\275\242\345\233\276\346\241\210 @ 45 \345\272\246\350\247\222\n"
+		"45, 0, 0, 101.6, 101.6, 304.8, -101.6 \n"
+		"135, 71.842, 71.842, 101.6, -101.6, 304.8, -101.6 \n"
+		"*AR-PARQ1, 2x12 \351\225\266\346\234\250\345\234\260\346\235\277: 12x12 \347\232\204\345\233\276\346\241\210\n"
+		"90, 0, 0, 304.8, 304.8, 304.8, -304.8 \n"
+		"90, 50.8, 0, 304.8, 304.8, 304.8, -304.8 \n"
+		"90, 101.6, 0, 304.8, 304.8, 304.8, -304.8 \n"
+		"90, 152.4, 0, 304.8, 304.8, 304.8, -304.8 \n"
+		"90, 203.2, 0, 304.8, 304.8, 304.8, -304.8 \n"
+		"90, 254, 0, 304.8, 304.8, 304.8, -304.8 \n"
+		"90, 304.8, 0, 304.8, 304.8, 304.8, -304.8 \n"
+		"0, 0, 304.8, 304.8, -304.8, 304.8, -304.8 \n"
+		"0, 0, 355.6, 304.8, -304.8, 304.8, -304.8 \n"
+		"0, 0, 406.4, 304.8, -304.8, 304.8, -304.8 \n"
+		"0, 0, 457.2, 304.8, -304.8, 304.8, -304.8 \n"
+		"0, 0, 508, 304.8, -304.8, 304.8, -304.8 \n"
+		"0, 0, 558.8, 304.8, -304.8, 304.8, -304.8 \n"
+		"0, 0, 609.6, 304.8, -304.8, 304.8, -304.8 \n"
+		"*AR-RROOF, \345\261\213\351\241\266\346\234\250\347\223\246\345\233\276\346\241\210\n"
+		"0, 0, 0, 55.88, 25.4, 381, -50.8, 127, -25.4 \n"
+		"0, 33.782, 12.7, -25.4, 33.782, 76.2, -8.382, 152.4, -19.05 \n"
+		"0, 12.7, 21.59, 132.08, 17.018, 203.2, -35.56, 101.6, -25.4 \n"
+		"*AR-RSHKE, \345\261\213\351\241\266\346\240\221\346\234\250\346\221\207\346\231\203\347\232\204\345\233\276\346\241\210\n"
+		"0, 0, 0, 647.7, 304.8, 152.4,   -127, 177.8, -76.2, 228.6, -101.6 \n"
+		"0, 152.4, 12.7, 647.7, 304.8, 127, -482.6, 101.6, -152.4 \n"
+		"0, 457.2, -19.05, 647.7, 304.8, 76.2, -787.4 \n"
+		"90, 0, 0, 304.8, 215.9, 292.1, -927.1 \n"
+		"90, 152.4, 0, 304.8, 215.9, 285.75, -933.45 \n"
+		"90, 279.4, 0, 304.8, 215.9, 266.7, -952.5 \n"
+		"90, 457.2, -19.05, 304.8, 215.9, 292.1, -927.1 \n"
+		"90, 533.4, -19.05, 304.8, 215.9, 292.1, -927.1 \n"
+		"90, 762, 0, 304.8, 215.9, 279.4, -939.8 \n"
+		"*AR-SAND, \351\232\217\346\234\272\347\232\204\347\202\271\345\233\276\346\241\210\n"
+		"37.5, 0, 0, 28.5242, 39.8018, 0,        -38.608, 0, -43.18, 0, -41.275 \n"
+		"7.5, 0, 0, 53.9242, 65.2018, 0, -20.828, 0, -34.798, 0, -13.335 \n"
+		"-32.5, -31.242, 0, 66.6344, 42.6212, 0, -12.7, 0, -45.72, 0, -59.69 \n"
+		"-42.5, -31.242, 0, 41.2344, 68.0212, 0, -6.35, 0, -29.972, 0, -34.29\n"
+		"*BOX,\346\226\271\351\222\242\n"
+		"90, 0, 0, 0, 25.4 \n"
+		"90, 6.35, 0, 0, 25.4 \n"
+		"0, 0, 0, 0, 25.4, -6.35, 6.35 \n"
+		"0, 0, 6.35, 0, 25.4, -6.35, 6.35 \n"
+		"0, 0, 12.7, 0, 25.4, 6.35, -6.35 \n"
+		"0, 0, 19.05, 0, 25.4, 6.35, -6.35 \n"
+		"90, 12.7, 0, 0, 25.4, 6.35, -6.35 \n"
+		"90, 19.05, 0, 0, 25.4, 6.35, -6.35 \n"
+		"*BRASS,\351\273\204\351\223\234\346\235\220\350\264\250\n"
+		"0, 0, 0, 0, 6.35 \n"
+		"0, 0, 3.175, 0, 6.35, 3.175, -1.5875 \n"
+		"*BRICK,\347\240\226\347\237\263\347\261\273\345\236\213\347\232\204\350\241\250\351\235\242\n"
+		"0, 0, 0, 0, 6.35 \n"
+		"90, 0, 0, 0, 12.7, 6.35, -6.35 \n"
+		"90, 6.35, 0, 0, 12.7, -6.35, 6.35 \n"
+		"*BRSTONE,\347\240\226\345\222\214\347\237\263\n"
+		"0, 0, 0, 0, 8.382 \n"
+		"90, 22.86, 0, 8.382, 12.7, 8.382, -8.382 \n"
+		"90, 20.32, 0, 8.382, 12.7, 8.382, -8.382 \n"
+		"0, 22.86, 1.397, 12.7, 8.382, -22.86, 2.54 \n"
+		"0, 22.86, 2.794, 12.7, 8.382, -22.86, 2.54 \n"
+		"0, 22.86, 4.191, 12.7, 8.382, -22.86, 2.54 \n"
+		"0, 22.86, 5.588, 12.7, 8.382, -22.86, 2.54 \n"
+		"0, 22.86, 6.985, 12.7, 8.382, -22.86, 2.54 \n"
+		"*CLAY,\347\262\230\345\234\237\346\235\220\350\264\250\n"
+		"0, 0, 0, 0, 4.7625 \n"
+		"0, 0, 0.79375, 0, 4.7625 \n"
+		"0, 0, 1.5875, 0, 4.7625 \n"
+		"0, 0, 3.175, 0, 4.7625, 4.7625, -3.175 \n"
+		"*CORK,\350\275\257\346\234\250\346\235\220\350\264\250\n"
+		"0, 0, 0, 0, 3.175 \n"
+		"135, 1.5875, -1.5875, 0, 8.98026, 4.49013, -4.49013 \n"
+		"135, 2.38125, -1.5875, 0, 8.98026, 4.49013, -4.49013 \n"
+		"135, 3.175, -1.5875, 0, 8.98026, 4.49013, -4.49013 \n"
+		"*CROSS,\344\270\200\347\263\273\345\210\227\345\215\201\345\255\227\345\275\242\n"
+		"0, 0, 0, 6.35, 6.35, 3.175, -9.525 \n"
+		"90, 1.5875, -1.5875, 6.35, 6.35, 3.175, -9.525 \n"
+		"*DASH,\345\210\222\347\272\277\n"
+		"0, 0, 0, 3.175, 3.175, 3.175, -3.175 \n"
+		"*DOLMIT,\345\234\260\345\243\263\345\262\251\345\261\202\n"
+		"0, 0, 0, 0, 6.35 \n"
+		"45, 0, 0, 0, 17.9605, 8.98026, -17.9605 \n"
+		"*DOTS,\344\270\200\347\263\273\345\210\227\347\202\271\n"
+		"0, 0, 0, 0.79375, 1.5875, 0, -1.5875 \n"
+		"*EARTH,\345\234\260\351\235\242\n"
+		"0, 0, 0, 6.35, 6.35, 6.35, -6.35 \n"
+		"0, 0, 2.38125, 6.35, 6.35, 6.35, -6.35 \n"
+		"0, 0, 4.7625, 6.35, 6.35, 6.35, -6.35 \n"
+		"90, 0.79375, 5.55625, 6.35, 6.35, 6.35, -6.35 \n"
+		"90, 3.175, 5.55625, 6.35, 6.35, 6.35, -6.35 \n"
+		"90, 5.55625, 5.55625, 6.35, 6.35, 6.35, -6.35 \n"
+		"*ESCHER,Escher \345\233\276\346\241\210\n"
+		"60, 0, 0, -15.24, 26.3965, 27.94, -2.54 \n"
+		"180, 0, 0, -15.24, 26.3965, 27.94, -2.54 \n"
+		"300, 0, 0, 15.24, 26.3965, 27.94, -2.54 \n"
+		"60, 2.54, 0, -15.24, 26.3965, 5.08, -25.4 \n"
+		"300, 2.54, 0, 15.24, 26.3965, 5.08, -25.4 \n"
+		"60, -1.27, 2.1997, -15.24, 26.3965, 5.08, -25.4 \n"
+		"180, -1.27, 2.1997, -15.24, 26.3965, 5.08, -25.4 \n"
+		"300, -1.27, -2.1997, 15.24, 26.3965, 5.08, -25.4 \n"
+		"180, -1.27, -2.1997, -15.24, 26.3965, 5.08, -25.4 \n"
+		"60, -10.16, 0, -15.24, 26.3965, 5.08, -25.4 \n"
+		"300, -10.16, 0, 15.24, 26.3965, 5.08, -25.4 \n"
+		"60, 5.08, -8.79882, -15.24, 26.3965, 5.08, -25.4 \n"
+		"180, 5.08, -8.79882, -15.24, 26.3965, 5.08, -25.4 \n"
+		"300, 5.08, 8.79882, 15.24, 26.3965, 5.08, -25.4 \n"
+		"180, 5.08, 8.79882, -15.24, 26.3965, 5.08, -25.4 \n"
+		"0, 5.08, 4.39941, -15.24, 26.3965, 17.78, -12.7 \n"
+		"0, 5.08, -4.39941, -15.24, 26.3965, 17.78, -12.7 \n"
+		"120, 1.27, 6.59911, 15.24, 26.3965, 17.78, -12.7 \n"
+		"120, -6.35, 2.1997, 15.24, 26.3965, 17.78, -12.7 \n"
+		"240, -6.35, -2.1997, 15.24, 26.3965, 17.78, -12.7 \n"
+		"240, 1.27, -6.59911, 15.24, 26.3965, 17.78, -12.7 \n"
+		"*FLEX,\350\275\257\346\200\247\346\235\220\350\264\250\n"
+		"0, 0, 0, 0, 6.35, 6.35, -6.35 \n"
+		"45, 6.35, 0, 4.49013, 4.49013, 1.5875, -5.80526, 1.5875, -8.98026 \n"
+		"*GOST_GLASS,\347\216\273\347\222\203\346\235\220\350\264\250\n"
+		"45, 0, 0, 6, -6, 5, -7\n"
+		"45, 2.121320, 0, 6, -6, 2, -10\n"
+		"45, 0, 2.121320, 6, -6, 2, -10\n"
+		"*GOST_WOOD,\346\234\250\346\235\220\346\235\220\350\264\250\n"
+		"90, 0, 0, 0, -6, 10, -2\n"
+		"90, 2, -2, 0, -6, 6, -1.5, 3, -1.5\n"
+		"90, 4, -5, 0, -6, 10, -2\n"
+		"*GOST_GROUND,\345\234\260\351\235\242\n"
+		"45, 0, 0, 10, -10, 20\n"
+		"45, 3, 0, 10, -10, 20\n"
+		"45, 6, 0, 10, -10, 20\n"
+		"*GRASS,\350\215\211\345\234\260\n"
+		"90, 0, 0, 17.9605, 17.9605, 4.7625, -31.1585 \n"
+		"45, 0, 0, 0, 25.4, 4.7625, -20.6375 \n"
+		"135, 0, 0, 0, 25.4, 4.7625, -20.6375 \n"
+		"*GRATE,\346\240\274\346\240\205\345\214\272\345\237\237\n"
+		"0, 0, 0, 0, 0.79375 \n"
+		"90, 0, 0, 0, 3.175 \n"
+		"*GRAVEL,\346\262\231\347\240\276\345\233\276\346\241\210\n"
+		"228.0128, 18.288,25.4, 305.851,1.88796, 3.41721,-338.305\n"
+		"184.9697, 16.002,22.86, -305.855,1.1002, 5.86405,-580.54\n"
+		"132.5104, 10.16,22.352, -377.595,1.56032, 4.13482,-409.347\n"
+		"267.2737, 0.254,16.002, -508.633,1.20815, 5.34005,-528.664\n"
+		"292.8337, 0,10.668, -330.198,1.23208, 5.23634,-518.398\n"
+		"357.2737, 2.032,5.842, -508.633,1.20815, 5.34005,-528.664\n"
+		"37.6942, 7.366,5.588, -416.59,0.913587, 7.06194,-699.131\n"
+		"72.2553, 12.954,9.906, 586.404,0.967664, 6.6672,-660.053\n"
+		"121.4296, 14.986,16.256, 387.712,1.20409, 5.35813,-530.455\n"
+		"175.2364, 12.192,20.828, -280.544,2.10934, 6.11713,-299.739\n"
+		"222.3974, 6.096,21.336, 413.481,0.815543, 7.91078,-783.168\n"
+		"138.8141, 25.4,15.748, 234.164,2.38943, 2.70005,-267.306\n"
+		"171.4692, 23.368,17.526, -334.082,1.25595, 5.13682,-508.546\n"
+		"225, 18.288,18.288, 17.9605,17.9605, 3.59209,-32.3289\n"
+		"203.1986, 16.51,21.336, -136.743,3.33517, 1.93441,-191.506\n"
+		"291.8014, 14.732,20.574, -80.1833,4.71665, 2.73566,-134.048\n"
+		"30.9638, 15.748,18.034, 91.4773,4.35607, 4.4432,-143.663\n"
+		"161.5651, 19.558,20.32, -56.2253,8.03219, 3.21287,-77.109\n"
+		"16.3895, 0,20.574, 265.18,1.4334, 4.50088,-445.588\n"
+		"70.3462, 4.318,21.844, -297.294,1.70858, 3.77599,-373.822\n"
+		"293.1986, 19.558,25.4, -136.743,3.33517, 3.8688,-189.572\n"
+		"343.6105, 21.082,21.844, -265.18,1.4334, 4.50088,-445.588\n"
+		"339.444, 0,4.826, -136.751,2.97284, 4.34035,-212.677\n"
+		"294.7751, 4.064,3.302, -306.904,1.77401, 3.63672,-360.036\n"
+		"66.8014, 19.812,0, 136.743,3.33517, 3.8688,-189.572\n"
+		"17.354, 21.336,3.556, -345.474,1.51524, 4.25783,-421.524\n"
+		"69.444, 7.366,0, -136.751,2.97284, 2.17018,-214.848\n"
+		"101.3099, 18.288,0, 104.608,4.98135, 1.29515,-128.22\n"
+		"165.9638, 18.034,1.27, -80.0853,6.16041, 5.23634,-99.4905\n"
+		"186.009, 12.954,2.54, -255.263,1.32949, 4.85267,-480.414\n"
+		"303.6901, 15.748,15.748, -56.3575,7.04469, 3.66324,-87.9178\n"
+		"353.1572, 17.78,12.7, 434.777,1.00876, 6.39557,-633.16\n"
+		"60.9454, 24.13,11.938, -204.766,2.46708, 2.61508,-258.894\n"
+		"90, 25.4,14.224, 25.4,25.4, 1.524,-23.876\n"
+		"120.2564, 12.446,3.302, -204.773,1.82834, 3.52867,-349.339\n"
+		"48.0128, 10.668,6.35, 305.851,1.88796, 6.83443,-334.888\n"
+		"0, 15.24,11.43, 25.4,25.4, 6.604,-18.796\n"
+		"325.3048, 21.844,11.43, -310.042,1.60645, 4.0161,-397.593\n"
+		"254.0546, 25.146,9.144, 104.669,3.48897, 3.69829,-181.217\n"
+		"207.646, 24.13,5.588, 545.36,1.07142, 6.02145,-596.125\n"
+		"175.4261, 18.796,2.794, 331.174,1.01277, 6.37029,-630.658\n"
+		"175.4261, 18.796,2.794, 331.174,1.01277, 6.37029,-630.658\n"
+		"*HEX,\345\205\255\350\276\271\345\275\242\n"
+		"0, 0, 0, 0, 5.49926, 3.175, -6.35 \n"
+		"120, 0, 0, 0, 5.49926, 3.175, -6.35 \n"
+		"60, 3.175, 0, 0, 5.49926, 3.175, -6.35 \n"
+		"*HONEY,\350\234\202\345\267\242\345\233\276\346\241\210\n"
+		"0, 0, 0, 4.7625, 2.74963, 3.175, -6.35 \n"
+		"120, 0, 0, 4.7625, 2.74963, 3.175, -6.35 \n"
+		"60, 0, 0, 4.7625, 2.74963, -6.35, 3.175 \n"
+		"*HOUND,\347\212\254\347\211\231\344\272\244\351\224\231\345\233\276\346\241\210\n"
+		"0, 0, 0, 6.35, 1.5875, 25.4, -12.7 \n"
+		"90, 0, 0, -6.35, 1.5875, 25.4, -12.7 \n"
+		"*INSUL,\347\273\235\347\274\230\346\235\220\350\264\250\n"
+		"0, 0, 0, 0, 9.525 \n"
+		"0, 0, 3.175, 0, 9.525, 3.175, -3.175 \n"
+		"0, 0, 6.35, 0, 9.525, 3.175, -3.175 \n"
+		";;\n"
+		";;  Hatch Pattern Definition related to ISO/DIS 12011 line types\n"
+		";;\n"
+		";;  (Width * 5 = Distance between lines)\n"
+		";;\n"
+		";;  The size of the line segments related to the ISO/DIS 12011 linetypes\n"
+		";;  define the following hatch pattern. \n"
+		";;  The pen width of 1 mm is the base of the definition. To use them with\n"
+		";;  the other ISO/DIS 12011 predefined pen widths, the line has to be scaled\n"
+		";;  with the appropriate value (e.g. pen width 0,5 mm -> ltscale 0.5).\n"
+		";;\n"
+		"*ACAD_ISO02W100, \345\210\222\347\272\277\n"
+		"0, 0,0, 0,5, 12,-3\n"
+		"*ACAD_ISO03W100, \345\210\222\343\200\201\347\251\272\346\240\274\347\272\277\n"
+		"0, 0,0, 0,5, 12,-18\n"
+		"*ACAD_ISO04W100, \351\225\277\345\210\222\343\200\201\347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, 24,-3,.5,-3\n"
+		"*ACAD_ISO05W100, \351\225\277\345\210\222\343\200\201\345\217\214\347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, 24,-3,.5,-3,.5,-3\n"
+		"*ACAD_ISO06W100, \351\225\277\345\210\222\343\200\201\344\270\211\347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, 24,-3,.5,-3,.5,-6.5\n"
+		"0, 0,0, 0,5, -34,.5,-3\n"
+		"*ACAD_ISO07W100, \347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, .5,-3\n"
+		"*ACAD_ISO08W100, \351\225\277\345\210\222\343\200\201\347\237\255\345\210\222\347\272\277\n"
+		"0, 0,0, 0,5, 24,-3,6,-3\n"
+		"*ACAD_ISO09W100, \351\225\277\345\210\222\343\200\201\345\217\214\347\237\255\345\210\222\347\272\277\n"
+		"0, 0,0, 0,5, 24,-3,6,-3,6,-3\n"
+		"*ACAD_ISO10W100, \345\210\222\343\200\201\347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, 12,-3,.5,-3\n"
+		"*ACAD_ISO11W100, \345\217\214\345\210\222\343\200\201\347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, 12,-3,12,-3,.5,-3\n"
+		"*ACAD_ISO12W100, \345\210\222\343\200\201\345\217\214\347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, 12,-3,.5,-3,.5,-3\n"
+		"*ACAD_ISO13W100, \345\217\214\345\210\222\343\200\201\345\217\214\347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, 12,-3,12,-3,.5,-6.5\n"
+		"0, 0,0, 0,5, -33.5,.5,-3\n"
+		"*ACAD_ISO14W100, \345\210\222\343\200\201\344\270\211\347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, 12,-3,.5,-3,.5,-6.5\n"
+		"0, 0,0, 0,5, -22,.5,-3\n"
+		"*ACAD_ISO15W100, \345\217\214\345\210\222\343\200\201\344\270\211\347\202\271\347\272\277\n"
+		"0, 0,0, 0,5, 12,-3,12,-3,.5,-10\n"
+		"0, 0,0, 0,5, -33.5,.5,-3,.5,-3\n"
+		";;\n"
+		";; end of ACAD_ISO hatch pattern definition\n"
+		";;\n"
+		";;  Hatch Pattern Definition related to JIS A 0150\n"
+		";;\n"
+		"*JIS_LC_20, LC JIS A 0150(@20)\n"
+		"45,0,0,0,20\n"
+		"45,.4,0,0,20\n"
+		"*JIS_LC_20A, LC JIS A 0150(@20\342\200\230?)\n"
+		"45,0,0,0,20\n"
+		"45,1,0,0,20\n"
+		"*JIS_LC_8, LC JIS A 0150(@8)\n"
+		"45,0,0,0,7.8\n"
+		"45,.4,0,0,7.8\n"
+		"*JIS_LC_8A, LC JIS A 0150(@8\342\200\230?)\n"
+		"45,0,0,0,7.8\n"
+		"45,1,0,0,7.8\n"
+		"*JIS_RC_10, RC JIS A 0150(@10)\n"
+		"45,0,0,0,10\n"
+		"45,.725,0,0,10\n"
+		"45,1.45,0,0,10\n"
+		"*JIS_RC_15, RC JIS A 0150(@15)\n"
+		"45,0,0,0,15\n"
+		"45,.725,0,0,15\n"
+		"45,1.45,0,0,15\n"
+		"*JIS_RC_18, RC JIS A 0150(@18)\n"
+		"45,0,0,0,18\n"
+		"45,1,0,0,18\n"
+		"45,2,0,0,18\n"
+		"*JIS_RC_30, RC JIS A 0150(@30)\n"
+		"45,0,0,0,30\n"
+		"45,1,0,0,30\n"
+		"45,2,0,0,30\n"
+		"*JIS_STN_1E, STONE JIS A 0150(@1)\n"
+		"45, 0, 0, 0, 1\n"
+		"45, .705, 0, 0,1, 1, -.5\n"
+		"*JIS_STN_2.5, STONE JIS A 0150(@2.5)\n"
+		"45, 0, 0, 0, 2.5\n"
+		"45, 1.765, 0, 0,2.5, 1.2, -.5\n"
+		"*JIS_WOOD, WOOD JIS A 0150\n"
+		"45,0,0,0,.70710678\n"
+		";;\n"
+		"*LINE,\345\271\263\350\241\214\346\260\264\345\271\263\347\272\277\n"
+		"0, 0, 0, 0, 3.175 \n"
+		"*MUDST,\346\263\245\346\262\231\n"
+		"0, 0, 0, 12.7, 6.35, 6.35,      -6.35, 0, -6.35, 0, -6.35 \n"
+		"*NET,\346\260\264\345\271\263/\345\236\202\347\233\264\346\240\205\346\240\274\n"
+		"0, 0, 0, 0, 3.175 \n"
+		"90, 0, 0, 0, 3.175 \n"
+		"*NET3,\347\275\221\347\212\266\345\233\276\346\241\210 0-60-120\n"
+		"0, 0, 0, 0, 3.175 \n"
+		"60, 0, 0, 0, 3.175 \n"
+		"120, 0, 0, 0, 3.175 \n"
+		"*PLAST,\345\241\221\346\226\231\346\235\220\350\264\250\n"
+		"0, 0, 0, 0, 6.35 \n"
+		"0, 0, 0.79375, 0, 6.35 \n"
+		"0, 0, 1.5875, 0, 6.35 \n"
+		"*PLASTI,\345\241\221\346\226\231\346\235\220\350\264\250\n"
+		"0, 0, 0, 0, 6.35 \n"
+		"0, 0, 0.79375, 0, 6.35 \n"
+		"0, 0, 1.5875, 0, 6.35 \n"
+		"0, 0, 3.96875, 0, 6.35 \n"
+		"*SACNCR,\346\267\267\345\207\235\345\234\237\n"
+		"45, 0, 0, 0, 2.38125 \n"
+		"45, 1.6838, 0, 0, 2.38125, 0, -2.38125 \n"
+		"*SQUARE,\345\257\271\351\275\220\347\232\204\345\260\217\346\226\271\345\235\227\n"
+		"0, 0, 0, 0, 3.175, 3.175, -3.175 \n"
+		"90, 0, 0, 0, 3.175, 3.175, -3.175 \n"
+		"*STARS,\345\205\255\350\212\222\346\230\237\n"
+		"0, 0, 0, 0, 5.49926, 3.175, -3.175 \n"
+		"60, 0, 0, 0, 5.49926, 3.175, -3.175 \n"
+		"120, 1.5875, 2.74963, 0, 5.49926, 3.175, -3.175 \n"
+		"*STEEL,\351\222\242\346\235\220\350\264\250\n"
+		"45, 0, 0, 0, 3.175 \n"
+		"45, 0, 1.5875, 0, 3.175 \n"
+		"*SWAMP,\346\262\274\346\263\275\345\234\260\345\270\246\n"
+		"0, 0, 0, 12.7, 21.997, 3.175, -22.225 \n"
+		"90, 1.5875, 0, 21.997, 12.7, 1.5875, -42.4066 \n"
+		"90, 1.98438, 0, 21.997, 12.7, 1.27, -42.7241 \n"
+		"90, 1.19062, 0, 21.997, 12.7, 1.27, -42.7241 \n"
+		"60, 2.38125, 0, 12.7, 21.997, 1.016, -24.384 \n"
+		"120, 0.79375, 0, 12.7, 21.997, 1.016, -24.384 \n"
+		"*TRANS,\347\203\255\344\274\240\351\200\222\346\235\220\350\264\250\n"
+		"0, 0, 0, 0, 6.35 \n"
+		"0, 0, 3.175, 0, 6.35, 3.175, -3.175 \n"
+		"*TRIANG,\347\255\211\350\276\271\344\270\211\350\247\222\345\275\242\n"
+		"60, 0, 0, 4.7625, 8.24889, 4.7625, -4.7625 \n"
+		"120, 0, 0, 4.7625, 8.24889, 4.7625, -4.7625 \n"
+		"0, -2.38125, 4.12445, 4.7625, 8.24889, 4.7625, -4.7625 \n"
+		"*ZIGZAG,\346\245\274\346\242\257\346\225\210\346\236\234\n"
+		"0, 0, 0, 3.175, 3.175, 3.175, -3.175 \n"
+		"90, 3.175, 0, 3.175, 3.175, 3.175, -3.175\n"
+		"\n"
+		";;  \n"
+		";;  User Defined Hatch Patterns\n"
+		";;  Add any hatch patterns that you define to this section of\n"
+		";;  the file to ensure that they migrate properly when\n"
+		";;  upgrading to a future AutoCAD version.  If duplicate hatch\n"
+		";;  patterns are found in this file, items in the User Defined\n"
+		";;  Hatch Patterns section take precedence over patterns that\n"
+		";;  appear earlier in the file.\n"
+		";;\n"
+		;
+
+	extern const size_t g_BuiltinPatFileSize = sizeof(g_BuiltinPatFile) - 1;
+
+}
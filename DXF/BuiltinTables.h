@@ -0,0 +1,21 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+#include <cstddef>
+
+namespace DXF
+{
+	// Compiled-in copies of acadiso.lin and acadiso.pat, so that DxfWriter can write
+	// without any external file. Sizes don't include the terminating 0.
+	extern const char g_BuiltinLinFile[];
+	extern const size_t g_BuiltinLinFileSize;
+	extern const char g_BuiltinPatFile[];
+	extern const size_t g_BuiltinPatFileSize;
+} // namespace DXF
@@ -0,0 +1,530 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+#include "Compression.h"
+#include "utility.h"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef DXF_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef DXF_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#pragma warning(disable:4996)
+
+namespace DXF
+{
+	// Size of compressed data read or written at a time
+	const size_t g_ChunkSize = 64 << 10;
+
+	Compression DetectCompression(const void* data, size_t size)
+	{
+		const unsigned char* p = (const unsigned char*)data;
+		if (size >= 2 && p[0] == 0x1F && p[1] == 0x8B)
+			return Compression::Gzip;
+		if (size >= 4 && p[0] == 0x28 && p[1] == 0xB5 && p[2] == 0x2F && p[3] == 0xFD)
+			return Compression::Zstd;
+		return Compression::None;
+	}
+
+	Compression DetectFileCompression(const char* fileName)
+	{
+		FILE* fp = fopen(fileName, "rb");
+		if (fp == nullptr)
+			return Compression::None;
+		unsigned char magic[4];
+		size_t count = fread(magic, 1, sizeof(magic), fp);
+		fclose(fp);
+		return DetectCompression(magic, count);
+	}
+
+	bool IsCompressionSupported(Compression compression)
+	{
+		switch (compression)
+		{
+		case Compression::None:
+			return true;
+		case Compression::Gzip:
+#ifdef DXF_HAVE_ZLIB
+			return true;
+#else
+			return false;
+#endif
+		case Compression::Zstd:
+#ifdef DXF_HAVE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+		}
+		return false;
+	}
+
+	Decompressor::Decompressor()
+		: m_Compression(Compression::None)
+		, m_Head(0)
+		, m_Count(0)
+		, m_Done(true)
+		, m_Stop(false)
+		, m_pStream(nullptr)
+		, m_StreamCompression(Compression::None)
+	{
+	}
+
+	Decompressor::~Decompressor()
+	{
+		Stop();
+		FreeStream();
+	}
+
+	void Decompressor::FreeStream()
+	{
+		if (m_pStream == nullptr)
+			return;
+		if (m_StreamCompression == Compression::Gzip)
+		{
+#ifdef DXF_HAVE_ZLIB
+			inflateEnd((z_stream*)m_pStream);
+			delete (z_stream*)m_pStream;
+#endif
+		}
+		else
+		{
+#ifdef DXF_HAVE_ZSTD
+			ZSTD_freeDStream((ZSTD_DStream*)m_pStream);
+#endif
+		}
+		m_pStream = nullptr;
+		m_StreamCompression = Compression::None;
+	}
+
+	void Decompressor::Start(Compression compression, const Source& input, size_t ringSize)
+	{
+		ASSERT_DEBUG_INFO(IsCompressionSupported(compression) && ringSize > 0);
+		Stop();
+		m_Compression = compression;
+		m_Input = input;
+		m_Ring.resize(ringSize);
+		m_Head = 0;
+		m_Count = 0;
+		m_Done = false;
+		m_Stop = false;
+		m_Error.clear();
+		m_Thread = std::thread(&Decompressor::Run, this);
+	}
+
+	void Decompressor::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_NotFull.notify_all();
+		if (m_Thread.joinable())
+			m_Thread.join();
+		m_Input = nullptr;
+		m_Done = true;
+		m_Count = 0;
+	}
+
+	size_t Decompressor::Read(char* buffer, size_t size)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_NotEmpty.wait(lock, [this] { return m_Count > 0 || m_Done; });
+		if (m_Count == 0)
+		{
+			if (!m_Error.empty())
+			{
+				PRINT_DEBUG_INFO("%s", m_Error.c_str());
+				throw std::runtime_error(m_Error);
+			}
+			return 0;
+		}
+		size_t count = std::min(size, m_Count);
+		size_t first = std::min(count, m_Ring.size() - m_Head);
+		memcpy(buffer, &m_Ring[m_Head], first);
+		memcpy(buffer + first, &m_Ring[0], count - first);
+		m_Head = (m_Head + count) % m_Ring.size();
+		m_Count -= count;
+		lock.unlock();
+		m_NotFull.notify_one();
+		return count;
+	}
+
+	void Decompressor::Drain()
+	{
+		if (!m_Thread.joinable())
+			return;
+		std::vector<char> buffer(g_ChunkSize);
+		while (Read(buffer.data(), buffer.size()) > 0)
+		{
+		}
+	}
+
+	bool Decompressor::Write(const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_NotFull.wait(lock, [this] { return m_Count < m_Ring.size() || m_Stop; });
+			if (m_Stop)
+				return false;
+			size_t tail = (m_Head + m_Count) % m_Ring.size();
+			size_t count = std::min(size, m_Ring.size() - m_Count);
+			size_t first = std::min(count, m_Ring.size() - tail);
+			memcpy(&m_Ring[tail], data, first);
+			memcpy(&m_Ring[0], data + first, count - first);
+			m_Count += count;
+			data += count;
+			size -= count;
+			lock.unlock();
+			m_NotEmpty.notify_one();
+		}
+		return true;
+	}
+
+	void Decompressor::Run()
+	{
+		std::string error;
+		try
+		{
+			if (m_Compression == Compression::Gzip)
+				Inflate();
+			else
+				ZstdDecompress();
+		}
+		catch (const std::exception& e)
+		{
+			error = e.what();
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Error = error;
+			m_Done = true;
+		}
+		m_NotEmpty.notify_all();
+	}
+
+	void Decompressor::Inflate()
+	{
+#ifdef DXF_HAVE_ZLIB
+		if (m_StreamCompression != Compression::Gzip)
+		{
+			FreeStream();
+			z_stream* pStream = new z_stream;
+			memset(pStream, 0, sizeof(z_stream));
+			// 15 + 32: the largest window, gzip or zlib header detected automatically
+			if (inflateInit2(pStream, 15 + 32) != Z_OK)
+			{
+				delete pStream;
+				throw std::runtime_error("Can't initialize zlib.");
+			}
+			m_pStream = pStream;
+			m_StreamCompression = Compression::Gzip;
+		}
+		z_stream& zs = *(z_stream*)m_pStream;
+		inflateReset(&zs);
+		m_In.resize(g_ChunkSize);
+		m_Out.resize(g_ChunkSize);
+		std::vector<char>& in = m_In;
+		std::vector<char>& out = m_Out;
+		// Concatenated gzip members are decompressed one after another.
+		bool streamEnd = false;
+		// Output may be pending in zlib when the output buffer is filled up.
+		bool outputFull = false;
+		const char* error = nullptr;
+		while (error == nullptr)
+		{
+			if (zs.avail_in == 0 && !outputFull)
+			{
+				size_t count = m_Input(in.data(), in.size());
+				if (count == 0)
+				{
+					if (!streamEnd)
+						error = "Compressed DXF is truncated.";
+					break;
+				}
+				zs.next_in = (Bytef*)in.data();
+				zs.avail_in = (uInt)count;
+			}
+			zs.next_out = (Bytef*)out.data();
+			zs.avail_out = (uInt)out.size();
+			uInt availIn = zs.avail_in;
+			int ret = inflate(&zs, Z_NO_FLUSH);
+			if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+			{
+				error = "Compressed DXF is corrupt.";
+				break;
+			}
+			size_t produced = out.size() - zs.avail_out;
+			if (!Write(out.data(), produced))
+				break;
+			outputFull = zs.avail_out == 0;
+			// A call without progress, e.g. after a member ends as the output buffer fills up, returns Z_BUF_ERROR.
+			if (produced != 0 || zs.avail_in != availIn)
+				streamEnd = ret == Z_STREAM_END;
+			if (ret == Z_STREAM_END)
+				inflateReset(&zs);
+		}
+		if (error)
+			throw std::runtime_error(error);
+#endif
+	}
+
+	void Decompressor::ZstdDecompress()
+	{
+#ifdef DXF_HAVE_ZSTD
+		if (m_StreamCompression != Compression::Zstd)
+		{
+			FreeStream();
+			m_pStream = ZSTD_createDStream();
+			if (m_pStream == nullptr)
+				throw std::runtime_error("Can't initialize zstd.");
+			m_StreamCompression = Compression::Zstd;
+		}
+		ZSTD_DStream* ds = (ZSTD_DStream*)m_pStream;
+		ZSTD_DCtx_reset(ds, ZSTD_reset_session_only);
+		m_In.resize(g_ChunkSize);
+		m_Out.resize(g_ChunkSize);
+		std::vector<char>& in = m_In;
+		std::vector<char>& out = m_Out;
+		ZSTD_inBuffer input = { in.data(), 0, 0 };
+		// 0 when a frame is completely decoded
+		size_t hint = 1;
+		bool outputFull = false;
+		const char* error = nullptr;
+		while (error == nullptr)
+		{
+			if (input.pos == input.size && !outputFull)
+			{
+				size_t count = m_Input(in.data(), in.size());
+				if (count == 0)
+				{
+					if (hint != 0)
+						error = "Compressed DXF is truncated.";
+					break;
+				}
+				input.size = count;
+				input.pos = 0;
+			}
+			ZSTD_outBuffer output = { out.data(), out.size(), 0 };
+			size_t inputPos = input.pos;
+			size_t ret = ZSTD_decompressStream(ds, &output, &input);
+			if (ZSTD_isError(ret))
+			{
+				error = "Compressed DXF is corrupt.";
+				break;
+			}
+			// A call without progress, e.g. after a frame ends as the output buffer fills up, hints at a new frame.
+			if (output.pos != 0 || input.pos != inputPos)
+				hint = ret;
+			if (!Write(out.data(), output.pos))
+				break;
+			outputFull = output.pos == output.size;
+		}
+		if (error)
+			throw std::runtime_error(error);
+#endif
+	}
+
+	CompressStreambuf::CompressStreambuf()
+		: m_pFile(nullptr)
+		, m_Compression(Compression::None)
+		, m_pStream(nullptr)
+		, m_Level(0)
+		, m_Failed(false)
+		, m_Consumed(0)
+	{
+	}
+
+	CompressStreambuf::~CompressStreambuf()
+	{
+		close();
+		FreeStream();
+	}
+
+	void CompressStreambuf::FreeStream()
+	{
+		if (m_pStream == nullptr)
+			return;
+		if (m_Compression == Compression::Gzip)
+		{
+#ifdef DXF_HAVE_ZLIB
+			deflateEnd((z_stream*)m_pStream);
+			delete (z_stream*)m_pStream;
+#endif
+		}
+		else
+		{
+#ifdef DXF_HAVE_ZSTD
+			ZSTD_freeCStream((ZSTD_CStream*)m_pStream);
+#endif
+		}
+		m_pStream = nullptr;
+	}
+
+	bool CompressStreambuf::ResetStream()
+	{
+		if (m_Compression == Compression::Gzip)
+		{
+#ifdef DXF_HAVE_ZLIB
+			return deflateReset((z_stream*)m_pStream) == Z_OK;
+#endif
+		}
+		else
+		{
+#ifdef DXF_HAVE_ZSTD
+			return !ZSTD_isError(ZSTD_CCtx_reset((ZSTD_CStream*)m_pStream, ZSTD_reset_session_only));
+#endif
+		}
+		return false;
+	}
+
+	bool CompressStreambuf::open(const char* fileName, Compression compression, int level)
+	{
+		ASSERT_DEBUG_INFO(compression != Compression::None && IsCompressionSupported(compression));
+		close();
+		m_pFile = fopen(fileName, "wb");
+		if (m_pFile == nullptr)
+			return false;
+		m_Failed = false;
+		m_Consumed = 0;
+		// Start a new stream with the state of the last file if it is compressed the same way.
+		if (m_pStream != nullptr && (m_Compression != compression || m_Level != level || !ResetStream()))
+			FreeStream();
+		m_Compression = compression;
+		m_Level = level;
+		if (m_pStream == nullptr && compression == Compression::Gzip)
+		{
+#ifdef DXF_HAVE_ZLIB
+			z_stream* zs = new z_stream;
+			memset(zs, 0, sizeof(z_stream));
+			// 15 + 16: the largest window with a gzip header
+			if (deflateInit2(zs, level < 0 ? Z_DEFAULT_COMPRESSION : std::min(level, 9), Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			{
+				delete zs;
+				zs = nullptr;
+			}
+			m_pStream = zs;
+#endif
+		}
+		else if (m_pStream == nullptr)
+		{
+#ifdef DXF_HAVE_ZSTD
+			ZSTD_CStream* cs = ZSTD_createCStream();
+			if (cs && ZSTD_isError(ZSTD_initCStream(cs, level < 0 ? ZSTD_CLEVEL_DEFAULT : std::min(level, ZSTD_maxCLevel()))))
+			{
+				ZSTD_freeCStream(cs);
+				cs = nullptr;
+			}
+			m_pStream = cs;
+#endif
+		}
+		if (m_pStream == nullptr)
+		{
+			fclose(m_pFile);
+			m_pFile = nullptr;
+			return false;
+		}
+		m_In.resize(g_ChunkSize);
+		m_Out.resize(g_ChunkSize);
+		setp(m_In.data(), m_In.data() + m_In.size());
+		return true;
+	}
+
+	bool CompressStreambuf::close()
+	{
+		if (m_pFile == nullptr)
+			return true;
+		bool bSuccess = Compress(true);
+		bSuccess = fclose(m_pFile) == 0 && bSuccess;
+		m_pFile = nullptr;
+		setp(nullptr, nullptr);
+		return bSuccess;
+	}
+
+	CompressStreambuf::int_type CompressStreambuf::overflow(int_type ch)
+	{
+		if (m_pFile == nullptr || !Compress(false))
+			return traits_type::eof();
+		if (!traits_type::eq_int_type(ch, traits_type::eof()))
+		{
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	int CompressStreambuf::sync()
+	{
+		// The compressor isn't flushed, which would make the output larger.
+		return m_pFile != nullptr && Compress(false) ? 0 : -1;
+	}
+
+	CompressStreambuf::pos_type CompressStreambuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+	{
+		if (m_pFile == nullptr || off != 0 || dir != std::ios_base::cur || (which & std::ios_base::out) == 0)
+			return pos_type(off_type(-1));
+		return pos_type(off_type(m_Consumed + (pptr() - pbase())));
+	}
+
+	bool CompressStreambuf::Compress(bool finish)
+	{
+		size_t count = size_t(pptr() - pbase());
+		m_Consumed += count;
+		setp(m_In.data(), m_In.data() + m_In.size());
+		if (m_Failed)
+			return false;
+		if (m_Compression == Compression::Gzip)
+		{
+#ifdef DXF_HAVE_ZLIB
+			z_stream* zs = (z_stream*)m_pStream;
+			zs->next_in = (Bytef*)m_In.data();
+			zs->avail_in = (uInt)count;
+			do
+			{
+				zs->next_out = (Bytef*)m_Out.data();
+				zs->avail_out = (uInt)m_Out.size();
+				if (deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR)
+					m_Failed = true;
+				size_t have = m_Out.size() - zs->avail_out;
+				if (have && fwrite(m_Out.data(), 1, have, m_pFile) != have)
+					m_Failed = true;
+			} while (zs->avail_out == 0 && !m_Failed);
+#endif
+		}
+		else
+		{
+#ifdef DXF_HAVE_ZSTD
+			ZSTD_CStream* cs = (ZSTD_CStream*)m_pStream;
+			ZSTD_inBuffer input = { m_In.data(), count, 0 };
+			size_t remaining;
+			do
+			{
+				ZSTD_outBuffer output = { m_Out.data(), m_Out.size(), 0 };
+				remaining = ZSTD_compressStream2(cs, &output, &input, finish ? ZSTD_e_end : ZSTD_e_continue);
+				if (ZSTD_isError(remaining))
+					m_Failed = true;
+				else if (output.pos && fwrite(m_Out.data(), 1, output.pos, m_pFile) != output.pos)
+					m_Failed = true;
+			} while (!m_Failed && (finish ? remaining != 0 : input.pos < input.size));
+#endif
+		}
+		if (m_Failed)
+			PRINT_DEBUG_INFO("Failed to write compressed DXF.");
+		return !m_Failed;
+	}
+
+} // namespace DXF
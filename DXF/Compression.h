@@ -0,0 +1,126 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ImpExpMacro.h"
+
+namespace DXF
+{
+	enum class Compression
+	{
+		None,
+		Gzip,
+		Zstd
+	};
+
+	// Compression told by the magic bytes at the beginning of data.
+	Compression DetectCompression(const void *data, size_t size);
+	// Compression of a file, None if the file can't be opened.
+	Compression DetectFileCompression(const char *fileName);
+	// Whether the library is built with the codec, gzip needs zlib and zstd needs libzstd.
+	DXF_API bool IsCompressionSupported(Compression compression);
+
+	// Decompresses on its own thread into a bounded ring buffer, Read takes the output in order.
+	// The ring, the buffers and the codec state are kept for the next Start.
+	class Decompressor
+	{
+	public:
+		typedef std::function<size_t(char *buffer, size_t size)> Source;
+
+		Decompressor();
+		Decompressor(const Decompressor &) = delete;
+		~Decompressor();
+		// input is called on the decompressing thread.
+		void Start(Compression compression, const Source &input, size_t ringSize);
+		// Wait for decompressed bytes and return their count, 0 at the end of data.
+		// Throw std::runtime_error if the compressed data is corrupt or truncated.
+		size_t Read(char *buffer, size_t size);
+		// Read and discard the rest of the output, throw as Read does, e.g. if the data is truncated
+		// after the last byte the caller needs. Nothing is done if it isn't started.
+		void Drain();
+		// Stop the decompressing thread, unread output is discarded.
+		void Stop();
+
+	private:
+		void Run();
+		void Inflate();
+		void ZstdDecompress();
+		// Put output into the ring, return false if Stop is called.
+		bool Write(const char *data, size_t size);
+		void FreeStream();
+
+		Compression m_Compression;
+		Source m_Input;
+		std::thread m_Thread;
+		std::mutex m_Mutex;
+		std::condition_variable m_NotEmpty;
+		std::condition_variable m_NotFull;
+		std::vector<char> m_Ring;
+		size_t m_Head;  // read position in m_Ring
+		size_t m_Count; // bytes in m_Ring
+		bool m_Done;
+		bool m_Stop;
+		std::string m_Error;
+		// z_stream or ZSTD_DStream of m_StreamCompression, used by the decompressing thread only
+		void *m_pStream;
+		Compression m_StreamCompression;
+		std::vector<char> m_In;
+		std::vector<char> m_Out;
+	};
+
+	// Compresses everything written to it into a file.
+	// The buffers and the codec state are kept for the next file of the same compression and level.
+	class CompressStreambuf : public std::streambuf
+	{
+	public:
+		CompressStreambuf();
+		CompressStreambuf(const CompressStreambuf &) = delete;
+		~CompressStreambuf();
+		// level < 0 means the default level of the codec.
+		bool open(const char *fileName, Compression compression, int level);
+		bool is_open() const { return m_pFile != nullptr; }
+		// Finish the compressed stream and close the file, return false if writing failed.
+		bool close();
+
+	protected:
+		int_type overflow(int_type ch) override;
+		int sync() override;
+		// Only tells the count of bytes written before compression, i.e. tellp().
+		pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+	private:
+		// Compress the bytes in the put area, finish ends the compressed stream.
+		bool Compress(bool finish);
+		// Make m_pStream start a new stream, return false if it can't.
+		bool ResetStream();
+		void FreeStream();
+
+		FILE *m_pFile;
+		Compression m_Compression;
+		void *m_pStream; // z_stream or ZSTD_CStream
+		int m_Level;
+		std::vector<char> m_In;
+		std::vector<char> m_Out;
+		bool m_Failed;
+		// Bytes compressed so far
+		unsigned long long m_Consumed;
+	};
+
+} // namespace DXF
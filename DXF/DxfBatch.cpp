@@ -0,0 +1,276 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <thread>
+
+#include "DxfBatch.h"
+#include "Compression.h"
+#include "utility.h"
+
+#pragma warning(disable:4996)
+
+namespace DXF
+{
+	typedef std::chrono::steady_clock Clock;
+
+	static double Milliseconds(Clock::time_point start, Clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	static void AppendJsonString(std::string& json, const std::string& value)
+	{
+		json += '"';
+		for (char ch : value)
+		{
+			switch (ch)
+			{
+			case '"':
+				json += "\\\"";
+				break;
+			case '\\':
+				json += "\\\\";
+				break;
+			case '\n':
+				json += "\\n";
+				break;
+			case '\r':
+				json += "\\r";
+				break;
+			case '\t':
+				json += "\\t";
+				break;
+			default:
+				if ((unsigned char)ch < 0x20)
+				{
+					char escaped[8];
+					sprintf(escaped, "\\u%04x", (unsigned char)ch);
+					json += escaped;
+				}
+				else
+				{
+					json += ch;
+				}
+			}
+		}
+		json += '"';
+	}
+
+	DxfBatch::DxfBatch(const BatchOptions& options)
+		: m_Options(options)
+		, m_pJobs(nullptr)
+		, m_MemoryInUse(0)
+		, m_RunningJobs(0)
+	{
+	}
+
+	std::vector<BatchResult> DxfBatch::Run(const std::vector<BatchJob>& jobs)
+	{
+		TRACE_FUNCTION("(jobs = %zu)", jobs.size());
+
+		m_pJobs = &jobs;
+		m_Results.assign(jobs.size(), BatchResult());
+		for (size_t i = 0; i < jobs.size(); ++i)
+			m_Results[i].m_MemoryEstimate = EstimateMemory(jobs[i], m_Results[i].m_InputBytes);
+		DxfWriter::PreloadTables(m_Options.m_LinFile.empty() ? nullptr : m_Options.m_LinFile.c_str(),
+			m_Options.m_PatFile.empty() ? nullptr : m_Options.m_PatFile.c_str());
+
+		// Deal the jobs, largest first, to the queues in turn.
+		std::vector<size_t> order(jobs.size());
+		std::iota(order.begin(), order.end(), size_t(0));
+		std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+		{
+			return m_Results[a].m_MemoryEstimate > m_Results[b].m_MemoryEstimate;
+		});
+		unsigned int threadCount = m_Options.m_ThreadCount != 0 ? m_Options.m_ThreadCount : std::max(1u, std::thread::hardware_concurrency());
+		threadCount = (unsigned int)std::max(size_t(1), std::min(size_t(threadCount), jobs.size()));
+		m_Queues.clear();
+		for (unsigned int i = 0; i < threadCount; ++i)
+			m_Queues.emplace_back(new Queue);
+		for (size_t i = 0; i < order.size(); ++i)
+			m_Queues[i % threadCount]->m_Jobs.push_back(order[i]);
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 0; i < threadCount; ++i)
+			threads.emplace_back(&DxfBatch::Work, this, i);
+		for (auto& thread : threads)
+			thread.join();
+		m_Queues.clear();
+		m_pJobs = nullptr;
+		std::vector<BatchResult> results;
+		results.swap(m_Results);
+		return results;
+	}
+
+	unsigned long long DxfBatch::EstimateMemory(const BatchJob& job, unsigned long long& inputBytes) const
+	{
+		FileStamp stamp;
+		inputBytes = GetFileStamp(job.m_Input.c_str(), stamp) ? (unsigned long long)stamp.m_Size : 0;
+		double bytes = double(inputBytes) * m_Options.m_MemoryPerByte;
+		if (DetectFileCompression(job.m_Input.c_str()) != Compression::None)
+			bytes *= m_Options.m_CompressionRatio;
+		return (unsigned long long)bytes;
+	}
+
+	void DxfBatch::Work(unsigned int worker)
+	{
+		std::unique_ptr<DxfSession> pSession = m_Pool.Acquire();
+		size_t job;
+		while (TakeJob(worker, job))
+			RunJob(job, worker, *pSession);
+		m_Pool.Release(std::move(pSession));
+	}
+
+	bool DxfBatch::TakeJob(unsigned int worker, size_t& job)
+	{
+		{
+			Queue& own = *m_Queues[worker];
+			std::lock_guard<std::mutex> lock(own.m_Mutex);
+			if (!own.m_Jobs.empty())
+			{
+				job = own.m_Jobs.front();
+				own.m_Jobs.pop_front();
+				return true;
+			}
+		}
+		// Steal the smallest job of another queue, its owner keeps the large ones it is about to run.
+		// No job is added while running, so all queues being empty means the batch is done.
+		for (size_t i = 1; i < m_Queues.size(); ++i)
+		{
+			Queue& other = *m_Queues[(worker + i) % m_Queues.size()];
+			std::lock_guard<std::mutex> lock(other.m_Mutex);
+			if (!other.m_Jobs.empty())
+			{
+				job = other.m_Jobs.back();
+				other.m_Jobs.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void DxfBatch::RunJob(size_t job, unsigned int worker, DxfSession& session)
+	{
+		const BatchJob& batchJob = (*m_pJobs)[job];
+		BatchResult& result = m_Results[job];
+		result.m_Worker = worker;
+
+		Clock::time_point start = Clock::now();
+		Admit(result.m_MemoryEstimate);
+		Clock::time_point admitted = Clock::now();
+		result.m_WaitMs = Milliseconds(start, admitted);
+		try
+		{
+			DxfData& graph = session.GetGraph();
+			DxfReader& reader = session.GetReader();
+			reader.SetReadOptions(m_Options.m_ReadOptions);
+			bool bRead = reader.ReadDxf(batchJob.m_Input.c_str(), m_Options.m_OnlyReadModelSpace);
+			Clock::time_point read = Clock::now();
+			result.m_ReadMs = Milliseconds(admitted, read);
+			result.m_Entities = graph.m_Objects.size();
+			if (!bRead)
+			{
+				result.m_Error = "Can't read the file.";
+			}
+			else
+			{
+				bool bTransformed = !m_Options.m_Transform || m_Options.m_Transform(graph, batchJob);
+				Clock::time_point transformed = Clock::now();
+				result.m_TransformMs = Milliseconds(read, transformed);
+				if (!bTransformed)
+				{
+					result.m_Error = "The transform failed.";
+				}
+				else if (!batchJob.m_Output.empty())
+				{
+					DxfWriter& writer = session.GetWriter();
+					writer.SetWriteOptions(m_Options.m_WriteOptions);
+					if (!writer.WriteDxf(batchJob.m_Output.c_str(), m_Options.m_LinFile.empty() ? nullptr : m_Options.m_LinFile.c_str(),
+						m_Options.m_PatFile.empty() ? nullptr : m_Options.m_PatFile.c_str(), m_Options.m_Center, m_Options.m_Height))
+					{
+						result.m_Error = "Can't write the file.";
+					}
+					result.m_WriteMs = Milliseconds(transformed, Clock::now());
+				}
+			}
+		}
+		catch (const std::exception& e)
+		{
+			result.m_Error = e.what();
+		}
+		result.m_Success = result.m_Error.empty();
+		// Free the graph before other jobs are admitted for its memory.
+		try
+		{
+			session.Recycle();
+		}
+		catch (const std::exception&)
+		{
+		}
+		Release(result.m_MemoryEstimate);
+
+		if (m_Options.m_Done)
+		{
+			std::lock_guard<std::mutex> lock(m_DoneMutex);
+			m_Options.m_Done(batchJob, result);
+		}
+	}
+
+	void DxfBatch::Admit(unsigned long long bytes)
+	{
+		std::unique_lock<std::mutex> lock(m_MemoryMutex);
+		if (m_Options.m_MemoryBudget != 0)
+		{
+			m_MemoryReleased.wait(lock, [this, bytes]()
+			{
+				return m_RunningJobs == 0 || m_MemoryInUse + bytes <= m_Options.m_MemoryBudget;
+			});
+		}
+		m_MemoryInUse += bytes;
+		++m_RunningJobs;
+	}
+
+	void DxfBatch::Release(unsigned long long bytes)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_MemoryMutex);
+			m_MemoryInUse -= bytes;
+			--m_RunningJobs;
+		}
+		m_MemoryReleased.notify_all();
+	}
+
+	std::string DxfBatch::ToJson(const BatchJob& job, const BatchResult& result)
+	{
+		std::string json = "{\"input\":";
+		AppendJsonString(json, job.m_Input);
+		json += ",\"output\":";
+		AppendJsonString(json, job.m_Output);
+		char buffer[512];
+		sprintf(buffer, ",\"success\":%s,\"worker\":%u,\"input_bytes\":%llu,\"memory_estimate\":%llu,\"entities\":%zu"
+			",\"wait_ms\":%.3f,\"read_ms\":%.3f,\"transform_ms\":%.3f,\"write_ms\":%.3f",
+			result.m_Success ? "true" : "false", result.m_Worker, result.m_InputBytes, result.m_MemoryEstimate,
+			result.m_Entities, result.m_WaitMs, result.m_ReadMs, result.m_TransformMs, result.m_WriteMs);
+		json += buffer;
+		if (!result.m_Success)
+		{
+			json += ",\"error\":";
+			AppendJsonString(json, result.m_Error);
+		}
+		json += '}';
+		return json;
+	}
+
+} // namespace DXF
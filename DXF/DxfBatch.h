@@ -0,0 +1,140 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DxfPool.h"
+
+namespace DXF
+{
+	// A file to read and where to write it, nothing is written if m_Output is empty.
+	struct BatchJob
+	{
+		std::string m_Input;
+		std::string m_Output;
+	};
+
+	struct BatchResult
+	{
+		BatchResult()
+			: m_Success(false)
+			, m_Worker(0)
+			, m_InputBytes(0)
+			, m_MemoryEstimate(0)
+			, m_Entities(0)
+			, m_WaitMs(0)
+			, m_ReadMs(0)
+			, m_TransformMs(0)
+			, m_WriteMs(0)
+		{
+		}
+		bool m_Success;
+		// Why the job failed, empty if it succeeded.
+		std::string m_Error;
+		// Index of the thread of the batch which ran the job
+		unsigned int m_Worker;
+		unsigned long long m_InputBytes;
+		// Bytes counted against BatchOptions::m_MemoryBudget while the job runs
+		unsigned long long m_MemoryEstimate;
+		// Entities of model space after reading
+		size_t m_Entities;
+		// Milliseconds waiting for the memory budget and spent in each step
+		double m_WaitMs;
+		double m_ReadMs;
+		double m_TransformMs;
+		double m_WriteMs;
+	};
+
+	struct BatchOptions
+	{
+		BatchOptions()
+			: m_ThreadCount(0)
+			, m_MemoryBudget(0)
+			, m_MemoryPerByte(3.0)
+			, m_CompressionRatio(10.0)
+			, m_OnlyReadModelSpace(false)
+			, m_Center(0, 0)
+			, m_Height(100)
+		{
+		}
+		// 0 means std::thread::hardware_concurrency().
+		unsigned int m_ThreadCount;
+		// Jobs are started only while the memory estimated for the running jobs fits in the budget,
+		// a job larger than the budget runs alone. 0 means no budget.
+		unsigned long long m_MemoryBudget;
+		// Memory of a job is estimated as m_MemoryPerByte times the size of its DXF, which covers the graph
+		// and the mapping of the file. Sizes of compressed files are multiplied by m_CompressionRatio first.
+		double m_MemoryPerByte;
+		double m_CompressionRatio;
+		ReadOptions m_ReadOptions;
+		bool m_OnlyReadModelSpace;
+		WriteOptions m_WriteOptions;
+		// See DxfWriter::WriteDxf, they are shared by all jobs.
+		std::string m_LinFile;
+		std::string m_PatFile;
+		CDblPoint m_Center;
+		double m_Height;
+		// Called between reading and writing on the thread of the job, return false to fail the job.
+		// Null writes the graph as it is read.
+		std::function<bool(DxfData &graph, const BatchJob &job)> m_Transform;
+		// Called when a job is done, calls are serialized. e.g. to print DxfBatch::ToJson of the job.
+		std::function<void(const BatchJob &job, const BatchResult &result)> m_Done;
+	};
+
+	// Reads, transforms and writes many files on a pool of threads which steal jobs from each other.
+	// Linetypes, patterns and predefined blocks are loaded once and shared by all jobs.
+	// Each thread reads and writes its jobs with one session of a pool, which later runs reuse.
+	class DXF_API DxfBatch
+	{
+	public:
+		explicit DxfBatch(const BatchOptions &options);
+		DxfBatch(const DxfBatch &) = delete;
+		// Run the jobs and wait for them, results are in the order of jobs.
+		// Larger jobs are started first, so that a large job started last doesn't keep the others waiting.
+		std::vector<BatchResult> Run(const std::vector<BatchJob> &jobs);
+		unsigned long long EstimateMemory(const BatchJob &job, unsigned long long &inputBytes) const;
+		// A line of JSON of the job and its result, without the line end.
+		static std::string ToJson(const BatchJob &job, const BatchResult &result);
+
+	private:
+		struct Queue
+		{
+			std::mutex m_Mutex;
+			std::deque<size_t> m_Jobs;
+		};
+
+		void Work(unsigned int worker);
+		// Take a job from the queue of worker, or steal one from the back of another queue.
+		bool TakeJob(unsigned int worker, size_t &job);
+		void RunJob(size_t job, unsigned int worker, DxfSession &session);
+		// Wait until bytes fit in the budget.
+		void Admit(unsigned long long bytes);
+		void Release(unsigned long long bytes);
+
+		BatchOptions m_Options;
+		const std::vector<BatchJob> *m_pJobs;
+		std::vector<BatchResult> m_Results;
+		std::vector<std::unique_ptr<Queue>> m_Queues;
+		std::mutex m_MemoryMutex;
+		std::condition_variable m_MemoryReleased;
+		unsigned long long m_MemoryInUse;
+		size_t m_RunningJobs;
+		std::mutex m_DoneMutex;
+		DxfPool m_Pool;
+	};
+
+} // namespace DXF
@@ -9,16 +9,12 @@
 ***************************************************************************/
 #include "stdafx.h"
 #include "DxfData.h"
-#include "atlbase.h"
 #include <float.h>
-#include <eh.h>
 
 #include <map>
 #include <utility>
-#include <AtlConv.h>
 #include "ifstream.h"
 #include "DxfReader.h"
-#include "DxfWriter.h"
 #include <iomanip>
 
 #pragma warning(disable:4996)
@@ -38,7 +34,7 @@ DxfData::~DxfData()
 {
 }
 
-std::shared_ptr<EntAttribute> DxfData::FindEntity(int handle)
+std::shared_ptr<EntAttribute> DxfData::FindEntity(Handle handle)
 {
 	auto it = m_Objects.FindEntity(handle);
 	if (it != m_Objects.end())
@@ -58,9 +54,19 @@ std::shared_ptr<EntAttribute> DxfData::FindEntity(int handle)
 			return *it;
 	}
 
+	auto lazy = m_LazyIndexes.find(handle);
+	if (lazy != m_LazyIndexes.end())
+		return m_LoadedEntities[lazy->second];
+
 	return nullptr;
 }
 
+size_t DxfData::FindLazyEntity(Handle handle) const
+{
+	auto it = m_LazyIndexes.find(handle);
+	return it != m_LazyIndexes.end() ? it->second : size_t(-1);
+}
+
 void DxfData::Reset()
 {
 	m_Linetypes.clear();
@@ -74,51 +80,165 @@ void DxfData::Reset()
 	m_Layouts.clear();
 	m_RealBlockDefs.clear();
 	m_TmpBlockNo = 0;
+	ClearLazyEntities();
+}
+
+void DxfData::ClearLazyEntities()
+{
+	m_LazyEntities.clear();
+	m_LazyTypes.clear();
+	m_LazyLayers.clear();
+	m_LazyIndexes.clear();
+	m_LoadedEntities.clear();
+	m_pLazyReader.reset();
+}
+
+std::shared_ptr<EntAttribute> DxfData::LoadEntity(size_t index)
+{
+	if (index >= m_LazyEntities.size())
+		return nullptr;
+	if (m_LoadedEntities[index] == nullptr && m_pLazyReader != nullptr)
+		m_pLazyReader->LoadEntity(index);
+	return m_LoadedEntities[index];
+}
+
+bool DxfData::LoadAllEntities()
+{
+	if (m_LazyEntities.empty())
+		return true;
+	bool bSuccess = true;
+	EntityList objects;
+	objects.reserve(m_LazyEntities.size() + m_Objects.size());
+	for (size_t i = 0; i < m_LazyEntities.size(); ++i)
+	{
+		auto pEnt = LoadEntity(i);
+		if (pEnt != nullptr)
+			objects.push_back(pEnt);
+		else
+			bSuccess = false;
+	}
+	objects.insert(objects.end(), m_Objects.begin(), m_Objects.end());
+	m_Objects.swap(objects);
+
+	ClearLazyEntities();
+	return bSuccess;
+}
+
+void WriteContext::Clear()
+{
+	m_Linetypes.clear();
+	m_Layers.clear();
+	m_TextStyles.clear();
+	m_DimStyles.clear();
+	m_MLeaderStyles.clear();
+	m_TableStyles.clear();
+	m_Layouts.clear();
+	m_Handles.clear();
+	m_HandleAllocator.Reset();
 }
 
-int DxfData::PrepareBeforeWrite()
+void DxfData::PrepareBeforeWrite(WriteContext& context) const
 {
+	context.Clear();
+	context.m_Linetypes = m_Linetypes;
+	context.m_Layers = m_Layers;
+	context.m_TextStyles = m_TextStyles;
+	context.m_DimStyles = m_DimStyles;
+	context.m_MLeaderStyles = m_MLeaderStyles;
+	context.m_TableStyles = m_TableStyles;
+
 	// Remove must-not elements
-	m_Linetypes.erase("ByBlock");
-	m_Linetypes.erase("ByLayer");
-	m_Linetypes.erase("Continuous");
+	context.m_Linetypes.erase("ByBlock");
+	context.m_Linetypes.erase("ByLayer");
+	context.m_Linetypes.erase("Continuous");
 
 	// Add must-have elements
-	if (m_Layers.find("0") == m_Layers.end())
+	if (context.m_Layers.find("0") == context.m_Layers.end())
+	{
+		context.m_Layers["0"] = LayerData();
+	}
+
+	if (context.m_TextStyles.find("Standard") == context.m_TextStyles.end())
+	{
+		context.m_TextStyles["Standard"] = TextStyleData();
+	}
+
+	if (context.m_DimStyles.find("ISO-25") == context.m_DimStyles.end())
+	{
+		context.m_DimStyles["ISO-25"] = DimStyleData(0);
+	}
+
+	if (context.m_MLeaderStyles.find("Standard") == context.m_MLeaderStyles.end())
+	{
+		context.m_MLeaderStyles["Standard"] = MLeaderStyle();
+	}
+
+	if (context.m_MLeaderStyles.find("Annotative") == context.m_MLeaderStyles.end())
 	{
-		m_Layers["0"] = LayerData();
+		context.m_MLeaderStyles["Annotative"] = MLeaderStyle();
+		context.m_MLeaderStyles["Annotative"].m_IsAnnotative = true;
 	}
 
-	if (m_TextStyles.find("Standard") == m_TextStyles.end())
+	if (context.m_TableStyles.find("Standard") == context.m_TableStyles.end())
 	{
-		m_TextStyles["Standard"] = TextStyleData();
+		context.m_TableStyles["Standard"] = TableStyle();
 	}
 
-	if (m_DimStyles.find("ISO-25") == m_DimStyles.end())
+	// Assign handle to entities.
+	HandleAllocator& allocator = context.m_HandleAllocator;
+
+	for (const auto& ent : m_Objects)
 	{
-		m_DimStyles["ISO-25"] = DimStyleData(0);
+		ent->AssignHandle(allocator, context.m_Handles);
 	}
 
-	if (m_MLeaderStyles.find("Standard") == m_MLeaderStyles.end())
+	for (const auto& bd : m_RealBlockDefs)
 	{
-		m_MLeaderStyles["Standard"] = MLeaderStyle();
+		for (const auto& ent : bd.second->m_Objects)
+		{
+			ent->AssignHandle(allocator, context.m_Handles);
+		}
 	}
 
-	if (m_MLeaderStyles.find("Annotative") == m_MLeaderStyles.end())
+	// Add must-have layout
+	std::map<std::string, std::shared_ptr<const LayoutData>> layouts(m_Layouts.begin(), m_Layouts.end());
+	if (layouts.empty())
 	{
-		m_MLeaderStyles["Annotative"] = MLeaderStyle();
-		m_MLeaderStyles["Annotative"].m_IsAnnotative = true;
+		layouts["Layout1"] = std::make_shared<LayoutData>();
 	}
 
-	if (m_TableStyles.find("Standard") == m_TableStyles.end())
+	int i = -1;
+	for (const auto& ld : layouts)
 	{
-		m_TableStyles["Standard"] = TableStyle();
+		WriteContext::Layout layout;
+		layout.m_Name = ld.first;
+		layout.m_Data = ld.second;
+		// Assign block name to layouts
+		if (i == -1)
+		{
+			layout.m_BlockName = "*Paper_Space";
+		}
+		else
+		{
+			char blockName[16];
+			snprintf(blockName, sizeof(blockName), "*Paper_Space%d", i);
+			layout.m_BlockName = blockName;
+		}
+		layout.m_LayoutOrder = i + 2;
+		++i;
+		for (const auto& ent : ld.second->m_Objects)
+		{
+			ent->AssignHandle(allocator, context.m_Handles);
+		}
+		context.m_Layouts.push_back(std::move(layout));
 	}
+}
 
-	// Generate blocks for dimensions
+void DxfData::GenerateDimensionBlocks()
+{
 	char blockName[24];
 	auto GenerateBlockName = [&blockName](int blockNo) {
-		_snprintf_s(blockName, 24, _TRUNCATE, (const char *)"*D%d", blockNo);
+		snprintf(blockName, 24, "*D%d", blockNo);
 	};
 	for (const auto& ent : m_Objects)
 	{
@@ -155,62 +275,31 @@ int DxfData::PrepareBeforeWrite()
 			}
 		}
 	}
+}
 
-	// Assign handle to entities. Start from 10000, it should be enough to hold other handles.
-	int handle = 10000;
-
-	// It is harmless to assign handle to entities even if it is not exported to DXF.
-	for (const auto& pb : DxfWriter::s_PredefinedBlocks)
-	{
-		for (const auto& ent : *pb)
-		{
-			ent->AssignHandle(handle);
-		}
-	}
-
-	for (const auto& ent : m_Objects)
-	{
-		ent->AssignHandle(handle);
-	}
-
-	for (const auto& bd : m_RealBlockDefs)
-	{
-		for (const auto& ent : bd.second->m_Objects)
-		{
-			ent->AssignHandle(handle);
-		}
-	}
+void DxfData::ApplyWriteContext(const WriteContext& context)
+{
+	m_Linetypes = context.m_Linetypes;
+	m_Layers = context.m_Layers;
+	m_TextStyles = context.m_TextStyles;
+	m_DimStyles = context.m_DimStyles;
+	m_MLeaderStyles = context.m_MLeaderStyles;
+	m_TableStyles = context.m_TableStyles;
 
-	// Add must-have layout
-	if (m_Layouts.empty())
+	for (const auto& layout : context.m_Layouts)
 	{
-		auto pLayout = std::make_shared<LayoutData>();
-		m_Layouts["Layout1"] = pLayout;
+		auto& pLayout = m_Layouts[layout.m_Name];
+		// The default layout added by PrepareBeforeWrite
+		if (!pLayout)
+			pLayout = std::const_pointer_cast<LayoutData>(layout.m_Data);
+		pLayout->m_BlockName = layout.m_BlockName;
+		pLayout->m_LayoutOrder = layout.m_LayoutOrder;
 	}
 
-	int i = -1;
-	for (const auto& ld : m_Layouts)
+	for (const auto& pair : context.m_Handles)
 	{
-		// Assign block name to layouts
-		if (i == -1)
-		{
-			ld.second->m_BlockName = "*Paper_Space";
-		}
-		else
-		{
-			char blockName[16];
-			_snprintf(blockName, sizeof(blockName), "*Paper_Space%d", i);
-			ld.second->m_BlockName = blockName;
-		}
-		ld.second->m_LayoutOrder = i + 2;
-		++i;
-		for (const auto& ent : ld.second->m_Objects)
-		{
-			ent->AssignHandle(handle);
-		}
+		pair.first->m_Handle = pair.second;
 	}
-
-	return handle;
 }
 
 }
@@ -14,7 +14,7 @@
 #include <map>
 #include <set>
 using namespace std;
-#include "acadconst.h"
+#include "ACADConst.h"
 #include "AcadEntities.h"
 #include "ImpExpMacro.h"
 
@@ -22,14 +22,81 @@ namespace DXF
 {
 
 	struct EntAttribute;
+	class DxfReader;
+
+	// What DxfWriter derives from a DxfData for one writing, so that DxfData needn't be modified.
+	struct WriteContext
+	{
+		struct Layout
+		{
+			std::string m_Name;
+			std::shared_ptr<const LayoutData> m_Data;
+			// *Paper_Space, *Paper_Space0, *Paper_Space1, ...
+			std::string m_BlockName;
+			int m_LayoutOrder;
+		};
+
+		void Clear();
+
+		// Tables of DxfData, with must-have entries added and must-not entries removed.
+		std::set<std::string> m_Linetypes;
+		std::map<std::string, LayerData> m_Layers;
+		std::map<std::string, TextStyleData> m_TextStyles;
+		std::map<std::string, DimStyleData> m_DimStyles;
+		std::map<std::string, MLeaderStyle> m_MLeaderStyles;
+		std::map<std::string, TableStyle> m_TableStyles;
+		// Layouts of DxfData in name order, or a default layout if DxfData has none.
+		std::vector<Layout> m_Layouts;
+		// Handles of entities in model space, blocks and layouts.
+		HandleMap m_Handles;
+		// Entity handles are allocated first, then DxfWriter allocates handles of tables and blocks.
+		HandleAllocator m_HandleAllocator;
+	};
+
+	// An entity of model space read lazily(ReadOptions::m_Lazy), it is parsed when it is loaded.
+	struct LazyEntity
+	{
+		Handle m_Handle;
+		// Bytes of the file after the group 0 of the entity, including its ATTRIBs if it is an INSERT.
+		unsigned long long m_Offset;
+		unsigned int m_Length;
+		// Indexes into DxfData::GetLazyTypes() and DxfData::GetLazyLayers()
+		unsigned short m_Type;
+		unsigned int m_Layer;
+	};
+
 	class DXF_API DxfData
 	{
 	public:
 		DxfData();
 		virtual ~DxfData();
-		std::shared_ptr<EntAttribute> FindEntity(int handle);
+		// Lazy entities are found only if they are loaded.
+		std::shared_ptr<EntAttribute> FindEntity(Handle handle);
 		void Reset();
 
+		// Entities of model space not in m_Objects yet, in the order of the file, see ReadOptions::m_Lazy.
+		// The file is kept open until LoadAllEntities or Reset is called.
+		const std::vector<LazyEntity> &GetLazyEntities() const
+		{
+			return m_LazyEntities;
+		}
+		const std::vector<std::string> &GetLazyTypes() const
+		{
+			return m_LazyTypes;
+		}
+		const std::vector<std::string> &GetLazyLayers() const
+		{
+			return m_LazyLayers;
+		}
+		// Return the index of the lazy entity, size_t(-1) if not found.
+		size_t FindLazyEntity(Handle handle) const;
+		// Parse the lazy entity on the first call, entities it refers to are loaded as well.
+		// Return null if it can't be read.
+		std::shared_ptr<EntAttribute> LoadEntity(size_t index);
+		// Load the lazy entities into m_Objects before the others and close the file.
+		// Return false if some entity can't be read.
+		bool LoadAllEntities();
+
 		double m_LinetypeScale;
 
 		//被图元引用的线型、图层、文字样式、标注样式不可以被删除，也不可以被更名。
@@ -48,12 +115,28 @@ namespace DXF
 		std::map<std::string, std::shared_ptr<BlockDef>> m_RealBlockDefs;
 
 	public: // Used internally
-		int PrepareBeforeWrite();
+		// Fill context for writing and allocate handles of entities.
+		void PrepareBeforeWrite(WriteContext &context) const;
+		// Generate blocks for dimensions without block, only DxfWriter(DxfData &) calls it since it modifies
+		// the dimensions. See AcadDim::GenerateBlock.
+		void GenerateDimensionBlocks();
+		// Store defaults, layout block names and entity handles of context into this DxfData.
+		void ApplyWriteContext(const WriteContext &context);
 
 	private:
 		friend class DxfReader;
+		void ClearLazyEntities();
 		// Keep last generated block number, start from 1, *D1, *D2, etc
 		mutable int m_TmpBlockNo;
+
+		std::vector<LazyEntity> m_LazyEntities;
+		std::vector<std::string> m_LazyTypes;
+		std::vector<std::string> m_LazyLayers;
+		std::map<Handle, size_t> m_LazyIndexes;
+		// Entities loaded, null if not loaded yet.
+		std::vector<std::shared_ptr<EntAttribute>> m_LoadedEntities;
+		// Reads lazy entities from the file.
+		std::shared_ptr<DxfReader> m_pLazyReader;
 	};
 
 } // namespace DXF
@@ -0,0 +1,316 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "DxfEventReader.h"
+#include "utility.h"
+
+using namespace std;
+#pragma warning(disable:4996)
+
+namespace DXF
+{
+	DxfPairs::DxfPairs()
+		: m_Count(0)
+		, m_Current(size_t(-1))
+	{
+		m_Number[0] = 0;
+	}
+
+	bool DxfPairs::Next()
+	{
+		if (m_Current + 1 >= m_Count)
+		{
+			m_Current = m_Count;
+			return false;
+		}
+		++m_Current;
+		return true;
+	}
+
+	const char* DxfPairs::Value() const
+	{
+		const DxfPair& pair = m_Pairs[m_Current];
+		if (!pair.m_IsNumber)
+			return pair.m_Value.c_str();
+		if (GetBinaryValueType(pair.m_GroupCode) == BinaryValueType::Real)
+			snprintf(m_Number, sizeof(m_Number), "%.16g", pair.m_Real);
+		else
+			snprintf(m_Number, sizeof(m_Number), "%lld", pair.m_Int);
+		return m_Number;
+	}
+
+	DxfPair& DxfPairs::Add()
+	{
+		if (m_Count == m_Pairs.size())
+			m_Pairs.emplace_back();
+		return m_Pairs[m_Count++];
+	}
+
+	DxfEventReader::DxfEventReader()
+	{
+	}
+
+	DxfEventReader::~DxfEventReader()
+	{
+	}
+
+	void DxfEventReader::SetMappingWindowSize(size_t windowSize)
+	{
+		m_Tokenizer.SetMappingWindowSize(windowSize);
+	}
+
+	bool DxfEventReader::ReadDxf(const char* dxfFileName, DxfEventHandler& handler)
+	{
+		TRACE_FUNCTION("(dxfFileName = %s)", dxfFileName);
+
+		return ReadStream(handler, [this, dxfFileName]()
+		{
+			return m_Tokenizer.Open(dxfFileName);
+		});
+	}
+
+	bool DxfEventReader::ReadDxf(const char* data, size_t len, DxfEventHandler& handler)
+	{
+		TRACE_FUNCTION("(len = %zu)", len);
+
+		return ReadStream(handler, [this, data, len]()
+		{
+			return m_Tokenizer.Open(data, len);
+		});
+	}
+
+	bool DxfEventReader::ReadDxf(const DxfTokenizer::Source& source, DxfEventHandler& handler, size_t bufferSize)
+	{
+		TRACE_FUNCTION("(bufferSize = %zu)", bufferSize);
+
+		return ReadStream(handler, [this, &source, bufferSize]()
+		{
+			return m_Tokenizer.Open(source, bufferSize);
+		});
+	}
+
+	bool DxfEventReader::ReadStream(DxfEventHandler& handler, const std::function<bool()>& OpenStream)
+	{
+		bool bSuccess = true;
+		try
+		{
+			bSuccess = OpenStream();
+			// A handler stopping reading skips the check of the end.
+			if (bSuccess && ReadSections(handler))
+				m_Tokenizer.CheckEnd();
+		}
+		catch (const std::logic_error&)
+		{
+			bSuccess = false;
+		}
+		catch (const std::runtime_error&)
+		{
+			bSuccess = false;
+		}
+		m_Tokenizer.Close();
+		m_Pairs.Clear();
+		return bSuccess;
+	}
+
+	bool DxfEventReader::ReadSections(DxfEventHandler& handler)
+	{
+		int num;
+		char buffer[BUFSIZE];
+		char type[BUFSIZE];
+		while (!m_Tokenizer.fail())
+		{
+			m_Tokenizer.ReadPair(num, buffer, BUFSIZE);
+			if (num != 0)
+				continue;
+			if (strcmp(buffer, "EOF") == 0)
+				break;
+			if (strcmp(buffer, "SECTION") != 0)
+				continue;
+			m_Tokenizer.ReadPair(num, buffer, BUFSIZE);
+			if (num != 2)
+			{
+				THROW_INVALID_DXF();
+			}
+			std::string section = buffer;
+			if (!handler.OnSectionBegin(section.c_str()))
+				return false;
+			if (section == "HEADER")
+			{
+				if (!ReadHeader(handler))
+					return false;
+			}
+			// Records of the other sections are skipped.
+			bool bTables = section == "TABLES";
+			bool bBlocks = section == "BLOCKS";
+			bool bEntities = section == "ENTITIES";
+			bool bObjects = section == "OBJECTS";
+			std::string table, block;
+			while (!m_Tokenizer.fail())
+			{
+				m_Tokenizer.ReadPair(num, buffer, BUFSIZE);
+				if (num != 0)
+					continue;
+				if (strcmp(buffer, "ENDSEC") == 0)
+					break;
+				// ENDSEC is missing
+				if (strcmp(buffer, "EOF") == 0)
+				{
+					m_Tokenizer.PutBackPair(num, buffer);
+					break;
+				}
+				strcpy(type, buffer);
+				ReadRecord();
+				bool bContinue = true;
+				if (bTables)
+				{
+					if (strcmp(type, "TABLE") == 0)
+						table = RecordName();
+					else if (strcmp(type, "ENDTAB") == 0)
+						table.clear();
+					else
+						bContinue = handler.OnTableEntry(table.c_str(), RecordName(), m_Pairs);
+				}
+				else if (bBlocks && strcmp(type, "BLOCK") == 0)
+				{
+					block = RecordName();
+					bContinue = handler.OnBlockBegin(block.c_str(), m_Pairs);
+				}
+				else if (bBlocks && strcmp(type, "ENDBLK") == 0)
+				{
+					bContinue = handler.OnBlockEnd(block.c_str());
+					block.clear();
+				}
+				else if (bBlocks || bEntities)
+				{
+					ReadAttribute();
+					bContinue = handler.OnEntity(type, m_Attribute, m_Pairs);
+				}
+				else if (bObjects)
+				{
+					bContinue = handler.OnObject(type, m_Pairs);
+				}
+				if (!bContinue)
+					return false;
+			}
+			if (!handler.OnSectionEnd(section.c_str()))
+				return false;
+		}
+		return true;
+	}
+
+	bool DxfEventReader::ReadHeader(DxfEventHandler& handler)
+	{
+		int num;
+		char buffer[BUFSIZE];
+		std::string name;
+		m_Pairs.Clear();
+		while (!m_Tokenizer.fail())
+		{
+			m_Tokenizer.ReadPair(num, buffer, BUFSIZE);
+			if (num == 0 || num == 9)
+			{
+				if (!name.empty() && !handler.OnHeaderVariable(name.c_str(), m_Pairs))
+					return false;
+				m_Pairs.Clear();
+				if (num == 0)
+				{
+					m_Tokenizer.PutBackPair(num, buffer);
+					break;
+				}
+				name = buffer;
+				continue;
+			}
+			m_Tokenizer.MakePair(num, buffer, m_Pairs.Add());
+		}
+		return true;
+	}
+
+	void DxfEventReader::ReadRecord()
+	{
+		int num;
+		char buffer[BUFSIZE];
+		m_Pairs.Clear();
+		while (!m_Tokenizer.fail())
+		{
+			m_Tokenizer.ReadPair(num, buffer, BUFSIZE);
+			if (num == 0)
+			{
+				m_Tokenizer.PutBackPair(num, buffer);
+				break;
+			}
+			m_Tokenizer.MakePair(num, buffer, m_Pairs.Add());
+		}
+	}
+
+	const char* DxfEventReader::RecordName()
+	{
+		const char* name = "";
+		while (m_Pairs.Next())
+		{
+			if (m_Pairs.GroupCode() == 2)
+			{
+				name = m_Pairs.Value();
+				break;
+			}
+		}
+		m_Pairs.Rewind();
+		return name;
+	}
+
+	void DxfEventReader::ReadAttribute()
+	{
+		// The same as DxfReader::ReadAttribute
+		m_Attribute.m_Handle = 0;
+		m_Attribute.m_IsInPaperspace = false;
+		m_Attribute.m_Layer = "0";
+		m_Attribute.m_Color = acByLayer;
+		m_Attribute.m_Linetype = "ByLayer";
+		m_Attribute.m_LinetypeScale = 1.0;
+		m_Attribute.m_Lineweight = acLnWtByLayer;
+		while (m_Pairs.Next())
+		{
+			int num = m_Pairs.GroupCode();
+			if (num == 100 && stricmp(m_Pairs.Value(), "AcDbEntity") != 0)
+				break;
+			switch (num)
+			{
+			case 67:
+				m_Attribute.m_IsInPaperspace = m_Pairs.Int() == 1;
+				break;
+			case 5:
+				m_Attribute.m_Handle = m_Pairs.Hex();
+				break;
+			case 8:
+				m_Attribute.m_Layer = m_Pairs.Value();
+				break;
+			case 6:
+				m_Attribute.m_Linetype = m_Pairs.Value();
+				break;
+			case 62:
+				m_Attribute.m_Color = AcColor(m_Pairs.Int());
+				break;
+			case 370:
+				m_Attribute.m_Lineweight = AcLineWeight(m_Pairs.Int());
+				break;
+			case 48:
+				m_Attribute.m_LinetypeScale = m_Pairs.Real();
+				break;
+			default:
+				break;
+			}
+		}
+		m_Pairs.Rewind();
+	}
+
+} // namespace DXF
@@ -0,0 +1,127 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AcadEntities.h"
+#include "ImpExpMacro.h"
+#include "DxfTokenizer.h"
+
+namespace DXF
+{
+	// Group pairs of the record being reported, taken one by one.
+	class DXF_API DxfPairs
+	{
+	public:
+		DxfPairs();
+		// Move to the next pair, return false at the end of the record.
+		bool Next();
+		// Move before the first pair.
+		void Rewind()
+		{
+			m_Current = size_t(-1);
+		}
+		int GroupCode() const
+		{
+			return m_Pairs[m_Current].m_GroupCode;
+		}
+		// Numbers of binary DXF are formatted on demand.
+		const char *Value() const;
+		double Real() const
+		{
+			return m_Pairs[m_Current].Real();
+		}
+		int Int() const
+		{
+			return m_Pairs[m_Current].Int();
+		}
+		Handle Hex() const
+		{
+			return hextoi(Value());
+		}
+		size_t Size() const
+		{
+			return m_Count;
+		}
+
+	private:
+		friend class DxfEventReader;
+		void Clear()
+		{
+			m_Count = 0;
+			Rewind();
+		}
+		// Pairs are reused from record to record, so memory doesn't grow with the file.
+		DxfPair &Add();
+
+		std::vector<DxfPair> m_Pairs;
+		size_t m_Count;
+		size_t m_Current;
+		mutable char m_Number[32];
+	};
+
+	// Receives the content of DXF as it is read, nothing is kept after a call returns.
+	// Return false to stop reading.
+	class DXF_API DxfEventHandler
+	{
+	public:
+		virtual ~DxfEventHandler() = default;
+		virtual bool OnSectionBegin(const char *name) { return true; }
+		virtual bool OnSectionEnd(const char *name) { return true; }
+		// name is like "$ACADVER", values are the pairs following group code 9.
+		virtual bool OnHeaderVariable(const char *name, DxfPairs &values) { return true; }
+		// table is the name of the table, e.g. "LAYER", name is the name of the entry.
+		virtual bool OnTableEntry(const char *table, const char *name, DxfPairs &fields) { return true; }
+		virtual bool OnBlockBegin(const char *name, DxfPairs &fields) { return true; }
+		virtual bool OnBlockEnd(const char *name) { return true; }
+		// Entities of the ENTITIES section and of the blocks, between OnBlockBegin and OnBlockEnd.
+		// attributes are taken from fields, which have all pairs of the entity.
+		virtual bool OnEntity(const char *type, const EntAttribute &attributes, DxfPairs &fields) { return true; }
+		virtual bool OnObject(const char *type, DxfPairs &fields) { return true; }
+	};
+
+	// Reads DXF without building DxfData, memory use doesn't depend on the size of the file.
+	// The input is the same as that of DxfReader, but it is a parser of its own: DxfReader doesn't use it,
+	// so sections and records are parsed by both, and a fix to one of them may be needed in the other.
+	class DXF_API DxfEventReader
+	{
+	public:
+		DxfEventReader();
+		DxfEventReader(const DxfEventReader &) = delete;
+		~DxfEventReader();
+		// Return false if the data can't be read or is invalid, but not if handler stops reading.
+		bool ReadDxf(const char *dxfFileName, DxfEventHandler &handler);
+		bool ReadDxf(const char *data, size_t len, DxfEventHandler &handler);
+		bool ReadDxf(const DxfTokenizer::Source &source, DxfEventHandler &handler, size_t bufferSize = 64 << 10);
+		void SetMappingWindowSize(size_t windowSize);
+
+	private:
+		enum
+		{
+			BUFSIZE = 256
+		};
+		bool ReadStream(DxfEventHandler &handler, const std::function<bool()> &OpenStream);
+		// Return false if handler stops reading.
+		bool ReadSections(DxfEventHandler &handler);
+		bool ReadHeader(DxfEventHandler &handler);
+		// Read the pairs after group 0 into m_Pairs until the next group 0.
+		void ReadRecord();
+		// Find name(group code 2) in m_Pairs.
+		const char *RecordName();
+		void ReadAttribute();
+
+		DxfTokenizer m_Tokenizer;
+		DxfPairs m_Pairs;
+		EntAttribute m_Attribute;
+	};
+
+} // namespace DXF
@@ -0,0 +1,308 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "DxfIndex.h"
+#include "FileMapping.h"
+#include "utility.h"
+
+using namespace std;
+#pragma warning(disable:4996)
+
+namespace DXF
+{
+	const char g_IndexMagic[8] = { 'D', 'X', 'F', 'I', 'D', 'X', '\r', '\n' };
+	const unsigned int g_IndexVersion = 1;
+	// Bytes hashed at the beginning and at the end of the DXF file
+	const size_t g_StampSampleSize = 64 << 10;
+
+	// The DXF file an index is built from
+	struct IndexStamp
+	{
+		FileStamp m_File;
+		// Hash of the bytes sampled, hashing the whole file would cost as much as reading it.
+		unsigned long long m_Hash;
+	};
+
+	struct IndexHeader
+	{
+		char m_Magic[8];
+		unsigned int m_Version;
+		unsigned int m_Reserved;
+		IndexStamp m_Stamp;
+		// Offsets are from the beginning of the index file.
+		unsigned long long m_SectionCount;
+		unsigned long long m_SectionsOffset;
+		unsigned long long m_BlockCount;
+		unsigned long long m_BlocksOffset;
+		unsigned long long m_EntityCount;
+		unsigned long long m_EntitiesOffset;
+		// m_EntityCount IndexHandles
+		unsigned long long m_HandlesOffset;
+		// Offsets of 0 terminated strings
+		unsigned long long m_StringCount;
+		unsigned long long m_StringsOffset;
+	};
+
+	struct IndexHandle
+	{
+		Handle m_Handle;
+		unsigned long long m_Entity;
+	};
+
+	static bool GetIndexStamp(const char* fileName, IndexStamp& stamp)
+	{
+		if (!GetFileStamp(fileName, stamp.m_File))
+			return false;
+		stamp.m_Hash = g_HashSeed;
+		FILE* fp = fopen(fileName, "rb");
+		if (fp == nullptr)
+			return false;
+		std::vector<unsigned char> buffer(g_StampSampleSize);
+		size_t count = fread(buffer.data(), 1, buffer.size(), fp);
+		stamp.m_Hash = HashBytes(buffer.data(), count, stamp.m_Hash);
+		if (stamp.m_File.m_Size > 2 * (long long)g_StampSampleSize)
+		{
+#ifdef _WIN32
+			_fseeki64(fp, -(long long)g_StampSampleSize, SEEK_END);
+#else
+			fseeko(fp, -(off_t)g_StampSampleSize, SEEK_END);
+#endif
+			count = fread(buffer.data(), 1, buffer.size(), fp);
+			stamp.m_Hash = HashBytes(buffer.data(), count, stamp.m_Hash);
+		}
+		fclose(fp);
+		return true;
+	}
+
+	DxfIndex::DxfIndex()
+		: m_File(*new CFileMapping)
+		, m_pHeader(nullptr)
+		, m_pSections(nullptr)
+		, m_pBlocks(nullptr)
+		, m_pEntities(nullptr)
+		, m_pHandles(nullptr)
+		, m_pStrings(nullptr)
+	{
+	}
+
+	DxfIndex::~DxfIndex()
+	{
+		delete &m_File;
+	}
+
+	std::string DxfIndex::GetIndexFileName(const char* dxfFileName)
+	{
+		return std::string(dxfFileName) + ".dxfidx";
+	}
+
+	bool DxfIndex::Open(const char* dxfFileName, const char* indexFileName)
+	{
+		TRACE_FUNCTION("(dxfFileName = %s)", dxfFileName);
+
+		Close();
+		std::string fileName = indexFileName ? indexFileName : GetIndexFileName(dxfFileName);
+		IndexStamp stamp;
+		if (!GetIndexStamp(dxfFileName, stamp))
+			return false;
+		m_File.Open(fileName.c_str());
+		const unsigned char* pStart = m_File.GetStart();
+		unsigned long long size = m_File.GetFileSize();
+		const IndexHeader* pHeader = (const IndexHeader*)pStart;
+		// Arrays must be inside the file.
+		auto IsInFile = [size](unsigned long long offset, unsigned long long count, size_t elementSize)
+		{
+			return offset <= size && count <= (size - offset) / elementSize;
+		};
+		if (pStart == nullptr || size < sizeof(IndexHeader)
+			|| memcmp(pHeader->m_Magic, g_IndexMagic, sizeof(g_IndexMagic)) != 0
+			|| pHeader->m_Version != g_IndexVersion
+			|| !IsInFile(pHeader->m_SectionsOffset, pHeader->m_SectionCount, sizeof(Range))
+			|| !IsInFile(pHeader->m_BlocksOffset, pHeader->m_BlockCount, sizeof(Range))
+			|| !IsInFile(pHeader->m_EntitiesOffset, pHeader->m_EntityCount, sizeof(Entity))
+			|| !IsInFile(pHeader->m_HandlesOffset, pHeader->m_EntityCount, sizeof(IndexHandle))
+			|| !IsInFile(pHeader->m_StringsOffset, pHeader->m_StringCount, sizeof(unsigned long long)))
+		{
+			PRINT_DEBUG_INFO("Invalid index %s.", fileName.c_str());
+			m_File.Close();
+			return false;
+		}
+		if (pHeader->m_Stamp.m_File != stamp.m_File || pHeader->m_Stamp.m_Hash != stamp.m_Hash)
+		{
+			PRINT_DEBUG_INFO("%s has changed since it was indexed.", dxfFileName);
+			m_File.Close();
+			return false;
+		}
+		m_pHeader = pHeader;
+		m_pSections = (const Range*)(pStart + pHeader->m_SectionsOffset);
+		m_pBlocks = (const Range*)(pStart + pHeader->m_BlocksOffset);
+		m_pEntities = (const Entity*)(pStart + pHeader->m_EntitiesOffset);
+		m_pHandles = (const IndexHandle*)(pStart + pHeader->m_HandlesOffset);
+		m_pStrings = (const unsigned long long*)(pStart + pHeader->m_StringsOffset);
+		return true;
+	}
+
+	void DxfIndex::Close()
+	{
+		m_File.Close();
+		m_pHeader = nullptr;
+		m_pSections = nullptr;
+		m_pBlocks = nullptr;
+		m_pEntities = nullptr;
+		m_pHandles = nullptr;
+		m_pStrings = nullptr;
+	}
+
+	size_t DxfIndex::GetSectionCount() const
+	{
+		return m_pHeader ? size_t(m_pHeader->m_SectionCount) : 0;
+	}
+
+	size_t DxfIndex::GetBlockCount() const
+	{
+		return m_pHeader ? size_t(m_pHeader->m_BlockCount) : 0;
+	}
+
+	size_t DxfIndex::GetEntityCount() const
+	{
+		return m_pHeader ? size_t(m_pHeader->m_EntityCount) : 0;
+	}
+
+	const char* DxfIndex::GetString(unsigned int index) const
+	{
+		if (m_pHeader == nullptr || index >= m_pHeader->m_StringCount || m_pStrings[index] >= m_File.GetFileSize())
+			return "";
+		// The string must end inside the file, which may be corrupt.
+		const char* pString = (const char*)m_File.GetStart() + m_pStrings[index];
+		if (memchr(pString, 0, size_t(m_File.GetFileSize() - m_pStrings[index])) == nullptr)
+			return "";
+		return pString;
+	}
+
+	const DxfIndex::Range* DxfIndex::FindSection(const char* name) const
+	{
+		for (size_t i = 0; i < GetSectionCount(); ++i)
+		{
+			if (strcmp(GetString(m_pSections[i].m_Name), name) == 0)
+				return &m_pSections[i];
+		}
+		return nullptr;
+	}
+
+	const DxfIndex::Range* DxfIndex::FindBlock(const char* name) const
+	{
+		const Range* pEnd = m_pBlocks + GetBlockCount();
+		const Range* pBlock = std::lower_bound(m_pBlocks, pEnd, name, [this](const Range& block, const char* name)
+		{
+			return strcmp(GetString(block.m_Name), name) < 0;
+		});
+		if (pBlock != pEnd && strcmp(GetString(pBlock->m_Name), name) == 0)
+			return pBlock;
+		return nullptr;
+	}
+
+	size_t DxfIndex::FindEntity(Handle handle) const
+	{
+		const IndexHandle* pEnd = m_pHandles + GetEntityCount();
+		const IndexHandle* pHandle = std::lower_bound(m_pHandles, pEnd, handle, [](const IndexHandle& entry, Handle handle)
+		{
+			return entry.m_Handle < handle;
+		});
+		if (pHandle != pEnd && pHandle->m_Handle == handle && pHandle->m_Entity < GetEntityCount())
+			return size_t(pHandle->m_Entity);
+		return size_t(-1);
+	}
+
+	unsigned int DxfIndexBuilder::AddString(const std::string& str)
+	{
+		auto it = m_StringIndexes.emplace(str, (unsigned int)m_Strings.size());
+		if (it.second)
+			m_Strings.push_back(str);
+		return it.first->second;
+	}
+
+	bool DxfIndexBuilder::Write(const char* dxfFileName, const char* indexFileName) const
+	{
+		TRACE_FUNCTION("(dxfFileName = %s)", dxfFileName);
+
+		IndexHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.m_Magic, g_IndexMagic, sizeof(g_IndexMagic));
+		header.m_Version = g_IndexVersion;
+		if (!GetIndexStamp(dxfFileName, header.m_Stamp))
+			return false;
+
+		// The last section goes up to the end of the file.
+		std::vector<DxfIndex::Range> sections = m_Sections;
+		if (!sections.empty() && sections.back().m_Length == 0)
+			sections.back().m_Length = header.m_Stamp.m_File.m_Size - sections.back().m_Offset;
+		std::vector<DxfIndex::Range> blocks = m_Blocks;
+		std::sort(blocks.begin(), blocks.end(), [this](const DxfIndex::Range& a, const DxfIndex::Range& b)
+		{
+			return strcmp(m_Strings[a.m_Name].c_str(), m_Strings[b.m_Name].c_str()) < 0;
+		});
+		std::vector<IndexHandle> handles(m_Entities.size());
+		for (size_t i = 0; i < m_Entities.size(); ++i)
+		{
+			handles[i].m_Handle = m_Entities[i].m_Handle;
+			handles[i].m_Entity = i;
+		}
+		std::sort(handles.begin(), handles.end(), [](const IndexHandle& a, const IndexHandle& b)
+		{
+			return a.m_Handle < b.m_Handle;
+		});
+
+		// All records are multiples of 8 bytes, so the arrays are aligned.
+		header.m_SectionCount = sections.size();
+		header.m_SectionsOffset = sizeof(IndexHeader);
+		header.m_BlockCount = blocks.size();
+		header.m_BlocksOffset = header.m_SectionsOffset + sections.size() * sizeof(DxfIndex::Range);
+		header.m_EntityCount = m_Entities.size();
+		header.m_EntitiesOffset = header.m_BlocksOffset + blocks.size() * sizeof(DxfIndex::Range);
+		header.m_HandlesOffset = header.m_EntitiesOffset + m_Entities.size() * sizeof(DxfIndex::Entity);
+		header.m_StringCount = m_Strings.size();
+		header.m_StringsOffset = header.m_HandlesOffset + handles.size() * sizeof(IndexHandle);
+		std::vector<unsigned long long> strings(m_Strings.size());
+		unsigned long long offset = header.m_StringsOffset + strings.size() * sizeof(unsigned long long);
+		for (size_t i = 0; i < m_Strings.size(); ++i)
+		{
+			strings[i] = offset;
+			offset += m_Strings[i].size() + 1;
+		}
+
+		std::string fileName = indexFileName ? indexFileName : DxfIndex::GetIndexFileName(dxfFileName);
+		FILE* fp = fopen(fileName.c_str(), "wb");
+		if (fp == nullptr)
+		{
+			PRINT_DEBUG_INFO("Can't open %s.", fileName.c_str());
+			return false;
+		}
+		bool bSuccess = fwrite(&header, sizeof(header), 1, fp) == 1;
+		bSuccess = bSuccess && fwrite(sections.data(), sizeof(DxfIndex::Range), sections.size(), fp) == sections.size();
+		bSuccess = bSuccess && fwrite(blocks.data(), sizeof(DxfIndex::Range), blocks.size(), fp) == blocks.size();
+		bSuccess = bSuccess && fwrite(m_Entities.data(), sizeof(DxfIndex::Entity), m_Entities.size(), fp) == m_Entities.size();
+		bSuccess = bSuccess && fwrite(handles.data(), sizeof(IndexHandle), handles.size(), fp) == handles.size();
+		bSuccess = bSuccess && fwrite(strings.data(), sizeof(unsigned long long), strings.size(), fp) == strings.size();
+		for (const std::string& str : m_Strings)
+			bSuccess = bSuccess && fwrite(str.c_str(), 1, str.size() + 1, fp) == str.size() + 1;
+		bSuccess = fclose(fp) == 0 && bSuccess;
+		if (!bSuccess)
+		{
+			PRINT_DEBUG_INFO("Can't write %s.", fileName.c_str());
+			remove(fileName.c_str());
+		}
+		return bSuccess;
+	}
+
+} // namespace DXF
@@ -0,0 +1,128 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "AcadEntities.h"
+#include "ImpExpMacro.h"
+
+namespace DXF
+{
+	class CFileMapping;
+	struct IndexHeader;
+	struct IndexHandle;
+
+	// Sidecar index of a DXF file(*.dxfidx) for reading its entities and blocks at random.
+	// DxfReader writes it if ReadOptions::m_WriteIndex is set and uses it if ReadOptions::m_UseIndex is set.
+	// The index is mapped as it is, numbers are little-endian, the same as the supported platforms.
+	class DXF_API DxfIndex
+	{
+	public:
+		// A section or a block of the DXF file
+		struct Range
+		{
+			// Pairs after the name of the section, or after the group 0 of the block.
+			unsigned long long m_Offset;
+			// Up to the next section(ENDSEC for ENTITIES), or up to the next block or ENDSEC.
+			unsigned long long m_Length;
+			// Index of GetString
+			unsigned int m_Name;
+			unsigned int m_Reserved;
+		};
+
+		// An entity of the ENTITIES section
+		struct Entity
+		{
+			enum
+			{
+				PaperSpace = 1,
+				// m_Extents is known
+				Bounded = 2
+			};
+			Handle m_Handle;
+			// Pairs after the group 0 of the entity, including ATTRIBs of an INSERT.
+			unsigned long long m_Offset;
+			unsigned int m_Length;
+			// Indexes of GetString
+			unsigned int m_Type;
+			unsigned int m_Layer;
+			unsigned int m_Flags;
+			// Estimated the same way as for ReadOptions::m_Window.
+			CDblRect m_Extents;
+		};
+
+		DxfIndex();
+		DxfIndex(const DxfIndex &) = delete;
+		~DxfIndex();
+		// dxfFileName + ".dxfidx"
+		static std::string GetIndexFileName(const char *dxfFileName);
+		// Map the index of dxfFileName, indexFileName is GetIndexFileName(dxfFileName) if it is null.
+		// Return false if the index is missing or invalid, or the DXF file has changed since it was indexed.
+		bool Open(const char *dxfFileName, const char *indexFileName = nullptr);
+		void Close();
+		bool IsOpen() const
+		{
+			return m_pHeader != nullptr;
+		}
+
+		size_t GetSectionCount() const;
+		const Range &GetSection(size_t index) const
+		{
+			return m_pSections[index];
+		}
+		// Blocks are in name order.
+		size_t GetBlockCount() const;
+		const Range &GetBlock(size_t index) const
+		{
+			return m_pBlocks[index];
+		}
+		// Entities are in the order of the file.
+		size_t GetEntityCount() const;
+		const Entity &GetEntity(size_t index) const
+		{
+			return m_pEntities[index];
+		}
+		// Empty if index is out of range or the string doesn't end inside the index file.
+		const char *GetString(unsigned int index) const;
+		// Return null if not found.
+		const Range *FindSection(const char *name) const;
+		const Range *FindBlock(const char *name) const;
+		// Return the index of the entity, size_t(-1) if not found or the index of the handle is out of range.
+		size_t FindEntity(Handle handle) const;
+
+	private:
+		CFileMapping &m_File;
+		const IndexHeader *m_pHeader;
+		const Range *m_pSections;
+		const Range *m_pBlocks;
+		const Entity *m_pEntities;
+		// Sorted by handle
+		const IndexHandle *m_pHandles;
+		const unsigned long long *m_pStrings;
+	};
+
+	// Collects the index while DxfReader reads the file, for internal use.
+	struct DxfIndexBuilder
+	{
+		unsigned int AddString(const std::string &str);
+		// Write the index of dxfFileName, indexFileName is DxfIndex::GetIndexFileName(dxfFileName) if it is null.
+		bool Write(const char *dxfFileName, const char *indexFileName) const;
+
+		std::vector<DxfIndex::Range> m_Sections;
+		std::vector<DxfIndex::Range> m_Blocks;
+		std::vector<DxfIndex::Entity> m_Entities;
+		std::vector<std::string> m_Strings;
+		std::map<std::string, unsigned int> m_StringIndexes;
+	};
+
+} // namespace DXF
@@ -0,0 +1,244 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "DxfPipeline.h"
+#include "DxfTokenizer.h"
+#include "utility.h"
+
+namespace DXF
+{
+	PairPipeline::PairPipeline(size_t batchSize, size_t ringSize, int valueSize)
+		: m_pSource(new DxfTokenizer)
+		, m_Ring(ringSize)
+		, m_BatchSize(batchSize)
+		, m_ValueSize(valueSize)
+		, m_pBatch(nullptr)
+		, m_Index(0)
+		, m_Ended(false)
+		, m_Batches(0)
+		, m_Pairs(0)
+		, m_TokenizerWaits(0)
+		, m_BuilderWaits(0)
+	{
+		ASSERT_DEBUG_INFO(batchSize > 0 && ringSize > 0 && valueSize > 0);
+	}
+
+	PairPipeline::~PairPipeline()
+	{
+		Stop();
+	}
+
+	void PairPipeline::Start()
+	{
+		m_Thread = std::thread(&PairPipeline::Run, this);
+	}
+
+	void PairPipeline::Stop()
+	{
+		m_Ring.Stop();
+		if (m_Thread.joinable())
+			m_Thread.join();
+		m_pSource->Close();
+	}
+
+	void PairPipeline::Run()
+	{
+		// Don't log on this thread, errors are passed to the reading thread in the batch.
+		while (true)
+		{
+			PairBatch *pBatch = m_Ring.BeginPush(m_TokenizerWaits);
+			if (pBatch == nullptr)
+				return;
+			bool bMore;
+			try
+			{
+				bMore = Fill(*pBatch);
+			}
+			catch (const std::exception &e)
+			{
+				pBatch->m_Error = *e.what() != 0 ? e.what() : "Reading failed.";
+				pBatch->m_Last = true;
+				bMore = false;
+			}
+			m_Ring.EndPush();
+			if (!bMore)
+				return;
+		}
+	}
+
+	bool PairPipeline::Fill(PairBatch &batch)
+	{
+		batch.m_Pairs.clear();
+		batch.m_Values.clear();
+		batch.m_Last = false;
+		batch.m_Error.clear();
+		std::vector<char> value(m_ValueSize);
+		DxfTokenizer &source = *m_pSource;
+		while (batch.m_Pairs.size() < m_BatchSize)
+		{
+			PipelinedPair pair;
+			source.ReadPair(pair.m_GroupCode, value.data(), m_ValueSize);
+			pair.m_IsNumber = source.m_PairIsNumber && source.m_pPairValue == value.data();
+			pair.m_Real = source.m_PairReal;
+			pair.m_Int = source.m_PairInt;
+			pair.m_Offset = source.LastPairOffset();
+			source.Tell(pair.m_End);
+			pair.m_Fail = source.fail();
+			pair.m_Value = (unsigned int)batch.m_Values.size();
+			batch.m_Values.insert(batch.m_Values.end(), value.data(), value.data() + strlen(value.data()) + 1);
+			batch.m_Pairs.push_back(pair);
+			if (pair.m_Fail)
+			{
+				batch.m_Last = true;
+				return false;
+			}
+			// Pairs after EOF aren't read, as DxfReader doesn't read them.
+			if (pair.m_GroupCode == 0 && stricmp(value.data(), "EOF") == 0)
+			{
+				source.CheckEnd();
+				batch.m_Last = true;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const PipelinedPair *PairPipeline::Next(const char *&value)
+	{
+		while (m_pBatch == nullptr || m_Index == m_pBatch->m_Pairs.size())
+		{
+			if (m_pBatch != nullptr)
+			{
+				bool bLast = m_pBatch->m_Last;
+				m_pBatch = nullptr;
+				m_Ring.EndPop();
+				if (bLast)
+					m_Ended = true;
+			}
+			if (m_Ended)
+				return nullptr;
+			m_pBatch = &m_Ring.BeginPop(m_BuilderWaits);
+			m_Index = 0;
+			++m_Batches;
+			m_Pairs += m_pBatch->m_Pairs.size();
+			if (!m_pBatch->m_Error.empty())
+			{
+				std::string error = m_pBatch->m_Error;
+				m_pBatch = nullptr;
+				m_Ring.EndPop();
+				m_Ended = true;
+				PRINT_DEBUG_INFO("%s", error.c_str());
+				throw std::runtime_error(error);
+			}
+		}
+		const PipelinedPair &pair = m_pBatch->m_Pairs[m_Index++];
+		value = m_pBatch->m_Values.data() + pair.m_Value;
+		return &pair;
+	}
+
+	void PairPipeline::GetStats(PipelineStats &stats) const
+	{
+		stats.m_BatchSize = m_BatchSize;
+		stats.m_RingSize = m_Ring.GetCapacity();
+		stats.m_Batches = m_Batches;
+		stats.m_Pairs = m_Pairs;
+		stats.m_TokenizerWaits = m_TokenizerWaits;
+		stats.m_BuilderWaits += m_BuilderWaits;
+	}
+
+	EntityIndexer::EntityIndexer(size_t batchSize, size_t ringSize)
+		: m_Ring(ringSize)
+		, m_BatchSize(batchSize)
+		, m_pBatch(nullptr)
+		, m_Added(0)
+		, m_BuilderWaits(0)
+		, m_IndexerWaits(0)
+	{
+		ASSERT_DEBUG_INFO(batchSize > 0 && ringSize > 0);
+		m_Thread = std::thread(&EntityIndexer::Run, this);
+	}
+
+	EntityIndexer::~EntityIndexer()
+	{
+		Finish();
+	}
+
+	void EntityIndexer::Add(const std::shared_ptr<EntAttribute> &pEnt, bool bModelSpace)
+	{
+		if (m_pBatch == nullptr)
+		{
+			m_pBatch = m_Ring.BeginPush(m_BuilderWaits);
+			m_pBatch->m_Items.clear();
+			m_pBatch->m_Last = false;
+		}
+		m_pBatch->m_Items.push_back(Item{ pEnt, bModelSpace });
+		++m_Added;
+		if (m_pBatch->m_Items.size() == m_BatchSize)
+			Push(false);
+	}
+
+	void EntityIndexer::Push(bool bLast)
+	{
+		if (m_pBatch == nullptr)
+		{
+			m_pBatch = m_Ring.BeginPush(m_BuilderWaits);
+			m_pBatch->m_Items.clear();
+		}
+		m_pBatch->m_Last = bLast;
+		m_pBatch = nullptr;
+		m_Ring.EndPush();
+	}
+
+	void EntityIndexer::Finish()
+	{
+		if (!m_Thread.joinable())
+			return;
+		Push(true);
+		m_Thread.join();
+	}
+
+	void EntityIndexer::Run()
+	{
+		while (true)
+		{
+			ItemBatch &batch = m_Ring.BeginPop(m_IndexerWaits);
+			for (Item &item : batch.m_Items)
+			{
+				auto result = m_Entities.emplace(item.m_pEnt->m_Handle, item);
+				if (!result.second && item.m_ModelSpace && !result.first->second.m_ModelSpace)
+					result.first->second = item;
+			}
+			bool bLast = batch.m_Last;
+			// Release the entities, the graph owns them.
+			batch.m_Items.clear();
+			m_Ring.EndPop();
+			if (bLast)
+				return;
+		}
+	}
+
+	std::shared_ptr<EntAttribute> EntityIndexer::Find(Handle handle) const
+	{
+		auto it = m_Entities.find(handle);
+		return it == m_Entities.end() ? nullptr : it->second.m_pEnt;
+	}
+
+	void EntityIndexer::GetStats(PipelineStats &stats) const
+	{
+		stats.m_IndexedEntities = m_Added;
+		stats.m_BuilderWaits += m_BuilderWaits;
+		stats.m_IndexerWaits = m_IndexerWaits;
+	}
+
+} // namespace DXF
@@ -0,0 +1,242 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "AcadEntities.h"
+
+namespace DXF
+{
+	class DxfTokenizer;
+
+	// How the last read of DxfReader with ReadOptions::m_Pipelined went.
+	struct PipelineStats
+	{
+		PipelineStats()
+			: m_BatchSize(0)
+			, m_RingSize(0)
+			, m_Batches(0)
+			, m_Pairs(0)
+			, m_TokenizerWaits(0)
+			, m_BuilderWaits(0)
+			, m_IndexedEntities(0)
+			, m_IndexerWaits(0)
+		{
+		}
+		// Pairs in a batch and batches in a ring, see ReadOptions::m_PipelineBatchSize and m_PipelineRingSize.
+		size_t m_BatchSize;
+		size_t m_RingSize;
+		// Batches and pairs passed from the tokenizing thread to the reading thread.
+		size_t m_Batches;
+		size_t m_Pairs;
+		// Times the tokenizing thread found the ring full, and the reading thread found it empty
+		// or found the ring of the indexing thread full.
+		size_t m_TokenizerWaits;
+		size_t m_BuilderWaits;
+		// Entities passed to the indexing thread, and times it found its ring empty.
+		size_t m_IndexedEntities;
+		size_t m_IndexerWaits;
+	};
+
+	// Lock-free ring of slots between one producer thread and one consumer thread, for internal use.
+	// Slots are filled and used in place, so their buffers are reused.
+	template <typename T>
+	class SpscRing
+	{
+	public:
+		explicit SpscRing(size_t capacity)
+			: m_Slots(capacity)
+			, m_Head(0)
+			, m_Tail(0)
+			, m_Stopped(false)
+		{
+		}
+		SpscRing(const SpscRing &) = delete;
+		size_t GetCapacity() const
+		{
+			return m_Slots.size();
+		}
+		// Producer: wait for a free slot, null if the ring is stopped. waits counts the waits.
+		T *BeginPush(size_t &waits)
+		{
+			size_t tail = m_Tail.load(std::memory_order_relaxed);
+			Wait([this, tail]() { return tail - m_Head.load(std::memory_order_acquire) < m_Slots.size() || IsStopped(); }, waits);
+			return IsStopped() ? nullptr : &m_Slots[tail % m_Slots.size()];
+		}
+		void EndPush()
+		{
+			m_Tail.store(m_Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+		// Consumer: wait for a filled slot.
+		T &BeginPop(size_t &waits)
+		{
+			size_t head = m_Head.load(std::memory_order_relaxed);
+			Wait([this, head]() { return m_Tail.load(std::memory_order_acquire) != head; }, waits);
+			return m_Slots[head % m_Slots.size()];
+		}
+		void EndPop()
+		{
+			m_Head.store(m_Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+		// Make the producer give up, e.g. when the consumer quits early.
+		void Stop()
+		{
+			m_Stopped.store(true, std::memory_order_release);
+		}
+		bool IsStopped() const
+		{
+			return m_Stopped.load(std::memory_order_acquire);
+		}
+
+	private:
+		// Spin a little, then sleep between checks, so that a thread waiting long doesn't burn a core.
+		template <typename Ready>
+		static void Wait(Ready ready, size_t &waits)
+		{
+			if (ready())
+				return;
+			++waits;
+			for (int i = 0; !ready(); ++i)
+			{
+				if (i < 64)
+					std::this_thread::yield();
+				else
+					std::this_thread::sleep_for(std::chrono::microseconds(20));
+			}
+		}
+
+		std::vector<T> m_Slots;
+		// The producer and the consumer write different cache lines.
+		char m_Pad0[64];
+		std::atomic<size_t> m_Head;
+		char m_Pad1[64];
+		std::atomic<size_t> m_Tail;
+		char m_Pad2[64];
+		std::atomic<bool> m_Stopped;
+	};
+
+	// A pair read by the tokenizing thread, the same as DxfTokenizer::ReadPair gives.
+	struct PipelinedPair
+	{
+		int m_GroupCode;
+		bool m_IsNumber;
+		// DxfTokenizer::fail() after the pair is read
+		bool m_Fail;
+		// Offset of the value in PairBatch::m_Values, the value is terminated by 0.
+		unsigned int m_Value;
+		double m_Real;
+		long long m_Int;
+		// Offsets of the pair and of the next pair in the data
+		unsigned long long m_Offset;
+		unsigned long long m_End;
+	};
+
+	struct PairBatch
+	{
+		std::vector<PipelinedPair> m_Pairs;
+		std::vector<char> m_Values;
+		// The tokenizing thread stops after this batch.
+		bool m_Last;
+		// Why reading failed if it threw, reported by the reading thread.
+		std::string m_Error;
+	};
+
+	// Tokenizes data on its own thread into batches of pairs, for internal use by DxfTokenizer.
+	class PairPipeline
+	{
+	public:
+		// Values are read with buffers of valueSize bytes, see DxfTokenizer::ReadPair.
+		PairPipeline(size_t batchSize, size_t ringSize, int valueSize);
+		PairPipeline(const PairPipeline &) = delete;
+		~PairPipeline();
+		// The tokenizer reading the data, open it then call Start.
+		DxfTokenizer &GetSource()
+		{
+			return *m_pSource;
+		}
+		void Start();
+		// Stop the thread, pairs not taken are discarded.
+		void Stop();
+		// The next pair and its value, null after the last pair. Throw std::runtime_error if reading failed.
+		const PipelinedPair *Next(const char *&value);
+		void GetStats(PipelineStats &stats) const;
+
+	private:
+		void Run();
+		// Read pairs into batch, return false after the last pair.
+		bool Fill(PairBatch &batch);
+
+		std::unique_ptr<DxfTokenizer> m_pSource;
+		SpscRing<PairBatch> m_Ring;
+		std::thread m_Thread;
+		size_t m_BatchSize;
+		int m_ValueSize;
+		// Batch being taken by the reading thread
+		PairBatch *m_pBatch;
+		size_t m_Index;
+		bool m_Ended;
+		size_t m_Batches;
+		size_t m_Pairs;
+		// Written by the tokenizing thread, read after it is joined.
+		size_t m_TokenizerWaits;
+		size_t m_BuilderWaits;
+	};
+
+	// Indexes entities by handle on its own thread as they are read, for internal use by DxfReader.
+	class EntityIndexer
+	{
+	public:
+		EntityIndexer(size_t batchSize, size_t ringSize);
+		EntityIndexer(const EntityIndexer &) = delete;
+		~EntityIndexer();
+		// Handles are unique in valid DXF, otherwise entities of model space win, as DxfData::FindEntity does.
+		void Add(const std::shared_ptr<EntAttribute> &pEnt, bool bModelSpace);
+		// Wait for the entities added to be indexed, Find can be called then.
+		void Finish();
+		std::shared_ptr<EntAttribute> Find(Handle handle) const;
+		void GetStats(PipelineStats &stats) const;
+
+	private:
+		struct Item
+		{
+			std::shared_ptr<EntAttribute> m_pEnt;
+			bool m_ModelSpace;
+		};
+		struct ItemBatch
+		{
+			std::vector<Item> m_Items;
+			// Finish is called, the indexing thread stops after this batch.
+			bool m_Last;
+		};
+
+		void Run();
+		// Pass m_pBatch to the indexing thread.
+		void Push(bool bLast);
+
+		SpscRing<ItemBatch> m_Ring;
+		std::thread m_Thread;
+		size_t m_BatchSize;
+		// Batch being filled by the reading thread, null if no slot is taken.
+		ItemBatch *m_pBatch;
+		std::unordered_map<Handle, Item> m_Entities;
+		size_t m_Added;
+		size_t m_BuilderWaits;
+		// Written by the indexing thread, read after it is joined.
+		size_t m_IndexerWaits;
+	};
+
+} // namespace DXF
@@ -0,0 +1,63 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+#include "DxfPool.h"
+
+namespace DXF
+{
+	DxfSession::DxfSession()
+		: m_Reader(m_Graph)
+		, m_Writer(m_Graph)
+	{
+	}
+
+	void DxfSession::Recycle()
+	{
+		m_Reader.Recycle();
+		m_Writer.Recycle();
+	}
+
+	DxfPool::DxfPool(size_t maxIdle)
+		: m_MaxIdle(maxIdle)
+	{
+	}
+
+	std::unique_ptr<DxfSession> DxfPool::Acquire()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (!m_Idle.empty())
+			{
+				std::unique_ptr<DxfSession> pSession = std::move(m_Idle.back());
+				m_Idle.pop_back();
+				return pSession;
+			}
+		}
+		return std::unique_ptr<DxfSession>(new DxfSession);
+	}
+
+	void DxfPool::Release(std::unique_ptr<DxfSession> pSession)
+	{
+		if (!pSession)
+			return;
+		// Recycle out of the lock, it frees the graph.
+		pSession->Recycle();
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Idle.size() < m_MaxIdle)
+			m_Idle.push_back(std::move(pSession));
+	}
+
+	size_t DxfPool::GetIdleCount()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Idle.size();
+	}
+
+} // namespace DXF
@@ -0,0 +1,70 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "DxfData.h"
+#include "DxfReader.h"
+#include "DxfWriter.h"
+
+namespace DXF
+{
+	// A graph with its reader and writer, for reading and writing file after file with the same buffers.
+	class DXF_API DxfSession
+	{
+	public:
+		DxfSession();
+		DxfSession(const DxfSession &) = delete;
+		DxfData &GetGraph()
+		{
+			return m_Graph;
+		}
+		DxfReader &GetReader()
+		{
+			return m_Reader;
+		}
+		DxfWriter &GetWriter()
+		{
+			return m_Writer;
+		}
+		// Reset the graph and release the state of the last file, see DxfReader::Recycle and DxfWriter::Recycle.
+		// Options of the reader and the writer are kept.
+		void Recycle();
+
+	private:
+		DxfData m_Graph;
+		DxfReader m_Reader;
+		DxfWriter m_Writer;
+	};
+
+	// Sessions not in use, e.g. shared by the threads converting small files, so that each file
+	// doesn't create and free the buffers of a reader and a writer.
+	class DXF_API DxfPool
+	{
+	public:
+		// At most maxIdle sessions are kept.
+		explicit DxfPool(size_t maxIdle = 16);
+		DxfPool(const DxfPool &) = delete;
+		// A session released before if there is one, otherwise a new one.
+		std::unique_ptr<DxfSession> Acquire();
+		// Recycle the session and keep it for Acquire, or destroy it if maxIdle sessions are kept already.
+		void Release(std::unique_ptr<DxfSession> pSession);
+		size_t GetIdleCount();
+
+	private:
+		std::mutex m_Mutex;
+		std::vector<std::unique_ptr<DxfSession>> m_Idle;
+		size_t m_MaxIdle;
+	};
+
+} // namespace DXF
@@ -0,0 +1,75 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+#include <stdexcept>
+#include "DxfProgress.h"
+#include "utility.h"
+
+namespace DXF
+{
+	ProgressReporter::ProgressReporter()
+		: m_Interval(0)
+		, m_TotalBytes(0)
+		, m_pSection("")
+		, m_Entities(0)
+	{
+	}
+
+	void ProgressReporter::Start(const ProgressCallback& callback, unsigned int intervalMs, const std::shared_ptr<CancelToken>& token,
+		const std::function<unsigned long long()>& GetBytes, unsigned long long totalBytes)
+	{
+		m_Callback = callback;
+		m_Interval = std::chrono::milliseconds(intervalMs);
+		m_LastReport = std::chrono::steady_clock::now();
+		m_pToken = token;
+		m_GetBytes = GetBytes;
+		m_TotalBytes = totalBytes;
+		m_pSection = "";
+		m_Entities = 0;
+	}
+
+	void ProgressReporter::Finish()
+	{
+		if (m_Callback)
+			Report(true);
+		Stop();
+	}
+
+	void ProgressReporter::Stop()
+	{
+		m_Callback = nullptr;
+		m_pToken.reset();
+		m_GetBytes = nullptr;
+	}
+
+	void ProgressReporter::CheckCancelled() const
+	{
+		if (IsCancelled())
+		{
+			PRINT_DEBUG_INFO("Cancelled at %zu entities in section %s.", m_Entities, m_pSection);
+			throw std::runtime_error("Cancelled.");
+		}
+	}
+
+	void ProgressReporter::Report(bool bForce)
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (!bForce && now - m_LastReport < m_Interval)
+			return;
+		m_LastReport = now;
+		DxfProgress progress;
+		progress.m_Bytes = m_GetBytes ? m_GetBytes() : 0;
+		progress.m_TotalBytes = m_TotalBytes;
+		progress.m_Section = m_pSection;
+		progress.m_Entities = m_Entities;
+		m_Callback(progress);
+	}
+
+} // namespace DXF
@@ -0,0 +1,118 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include "ImpExpMacro.h"
+
+namespace DXF
+{
+	// Passed to the progress callback of ReadOptions and WriteOptions.
+	struct DxfProgress
+	{
+		// Bytes of DXF read or written so far, before compression.
+		unsigned long long m_Bytes;
+		// Size of DXF being read, 0 if it is unknown, e.g. compressed or pulled from a source, and for writing.
+		unsigned long long m_TotalBytes;
+		// Name of the current section, e.g. "ENTITIES", empty before the first section.
+		const char *m_Section;
+		// Entities read or written so far, including entities of blocks and entities skipped by ReadOptions.
+		size_t m_Entities;
+	};
+
+	// Called on the thread reading or writing.
+	typedef std::function<void(const DxfProgress &progress)> ProgressCallback;
+
+	// Shared by the thread reading or writing and the threads which may cancel it, e.g. on a deadline.
+	class CancelToken
+	{
+	public:
+		CancelToken()
+			: m_Cancelled(false)
+		{
+		}
+		CancelToken(const CancelToken &) = delete;
+		void Cancel()
+		{
+			m_Cancelled.store(true, std::memory_order_relaxed);
+		}
+		bool IsCancelled() const
+		{
+			return m_Cancelled.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<bool> m_Cancelled;
+	};
+
+	// Throttles the progress callback and checks the cancel token at entity boundaries, for internal use.
+	class ProgressReporter
+	{
+	public:
+		ProgressReporter();
+		// GetBytes is only called when progress is reported. totalBytes is 0 if it is unknown.
+		void Start(const ProgressCallback &callback, unsigned int intervalMs, const std::shared_ptr<CancelToken> &token,
+			const std::function<unsigned long long()> &GetBytes, unsigned long long totalBytes);
+		// Report the last progress and stop.
+		void Finish();
+		// Stop without reporting, e.g. on failure.
+		void Stop();
+		void BeginSection(const char *name)
+		{
+			m_pSection = name;
+			Check(true);
+		}
+		// Throw std::runtime_error if it is cancelled.
+		void EntityDone()
+		{
+			++m_Entities;
+			Check(false);
+		}
+		// Count entities done at once without reporting, e.g. entities loaded from a snapshot.
+		void EntitiesDone(size_t count)
+		{
+			m_Entities += count;
+		}
+		// Throw std::runtime_error if it is cancelled.
+		void CheckCancelled() const;
+		bool IsCancelled() const
+		{
+			return m_pToken && m_pToken->IsCancelled();
+		}
+		size_t GetEntityCount() const
+		{
+			return m_Entities;
+		}
+
+	private:
+		void Check(bool bForce)
+		{
+			CheckCancelled();
+			// The clock is only read every 32 entities.
+			if (m_Callback && (bForce || (m_Entities & 31) == 0))
+				Report(bForce);
+		}
+		void Report(bool bForce);
+
+		ProgressCallback m_Callback;
+		std::chrono::steady_clock::duration m_Interval;
+		std::chrono::steady_clock::time_point m_LastReport;
+		std::shared_ptr<CancelToken> m_pToken;
+		std::function<unsigned long long()> m_GetBytes;
+		unsigned long long m_TotalBytes;
+		const char *m_pSection;
+		size_t m_Entities;
+	};
+
+} // namespace DXF
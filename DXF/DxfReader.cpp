@@ -9,15 +9,20 @@
 ***************************************************************************/
 #include "stdafx.h"
 
-#include <atlconv.h>
+#ifndef _USE_MATH_DEFINES
 #define _USE_MATH_DEFINES
+#endif
 #include <cmath>
 #include <time.h>
+#include <cstring>
 #include <algorithm>
 
 #include "DxfReader.h"
 #include "DxfData.h"
-#include "ifstream.h"
+#include "Compression.h"
+#include "DxfSnapshot.h"
+#include "FileMapping.h"
+#include "ThreadPool.h"
 
 using namespace std;
 #pragma warning(disable:4996)
@@ -30,38 +35,189 @@ namespace DXF
 
 	DxfReader::DxfReader(DxfData& graph)
 		: m_Graph(graph)
-		, m_DxfFile(*new DXF::ifstream)
+		, m_MappingWindowSize(0)
+		, m_pProbe(nullptr)
 	{
 	}
 
 	DxfReader::~DxfReader(void)
 	{
-		delete &m_DxfFile;
+	}
+
+	void DxfReader::Recycle()
+	{
+		m_Tokenizer.Close();
+		m_Graph.Reset();
+		Reset();
+		m_EntityPairs.clear();
+	}
+
+	void DxfReader::SetMappingWindowSize(size_t windowSize)
+	{
+		m_MappingWindowSize = windowSize;
+		m_Tokenizer.SetMappingWindowSize(windowSize);
 	}
 
 	bool DxfReader::ReadDxf(const char* dxfFileName, bool OnlyReadModelSpace)
 	{
 		TRACE_FUNCTION("(dxfFileName = %s, OnlyReadModelSpace = %s)", dxfFileName, OnlyReadModelSpace ? "true" : "false");
 
+		std::string snapshotFileName;
+		if (!m_Options.m_SnapshotDir.empty() && IsReadingAllEntities())
+		{
+			if (m_Options.m_CancelToken && m_Options.m_CancelToken->IsCancelled())
+			{
+				PRINT_DEBUG_INFO("Cancelled before reading %s.", dxfFileName);
+				m_Graph.Reset();
+				return false;
+			}
+			snapshotFileName = DxfSnapshot::GetCacheFileName(dxfFileName, m_Options.m_SnapshotDir.c_str(), OnlyReadModelSpace);
+			if (!snapshotFileName.empty() && DxfSnapshot::Load(m_Graph, snapshotFileName.c_str()))
+			{
+				ReportSnapshotLoaded(dxfFileName);
+				return true;
+			}
+		}
+		if ((m_Options.m_UseIndex || m_Options.m_WriteIndex) && DetectFileCompression(dxfFileName) == Compression::None)
+		{
+			if (m_Options.m_UseIndex)
+			{
+				m_pIndex.reset(new DxfIndex);
+				if (!m_pIndex->Open(dxfFileName))
+					m_pIndex.reset();
+			}
+			if (m_Options.m_WriteIndex && !m_pIndex)
+				m_pIndexBuilder.reset(new DxfIndexBuilder);
+		}
+		bool bSuccess = ReadStream(OnlyReadModelSpace, [this, dxfFileName]()
+		{
+			return m_Tokenizer.Open(dxfFileName);
+		});
+		if (bSuccess && m_pIndexBuilder && !m_pIndexBuilder->Write(dxfFileName, nullptr))
+			PRINT_DEBUG_INFO("Can't write the index of %s.", dxfFileName);
+		if (bSuccess && !snapshotFileName.empty() && !DxfSnapshot::Save(m_Graph, snapshotFileName.c_str()))
+			PRINT_DEBUG_INFO("Can't save the snapshot of %s.", dxfFileName);
+		m_pIndex.reset();
+		m_pIndexBuilder.reset();
+		if (bSuccess && !m_Graph.m_LazyEntities.empty() && !OpenLazyReader([dxfFileName](DxfTokenizer& tokenizer)
+		{
+			return tokenizer.Open(dxfFileName);
+		}))
+		{
+			m_Graph.Reset();
+			bSuccess = false;
+		}
+		return bSuccess;
+	}
+
+	void DxfReader::ReportSnapshotLoaded(const char* dxfFileName)
+	{
+		if (!m_Options.m_Progress)
+			return;
+		// Bytes of a compressed file aren't known without decompressing it.
+		FileStamp stamp;
+		unsigned long long size = 0;
+		if (DetectFileCompression(dxfFileName) == Compression::None && GetFileStamp(dxfFileName, stamp))
+			size = (unsigned long long)stamp.m_Size;
+		size_t entities = m_Graph.m_Objects.size();
+		for (const auto& block : m_Graph.m_RealBlockDefs)
+			entities += block.second->m_Objects.size();
+		for (const auto& layout : m_Graph.m_Layouts)
+			entities += layout.second->m_Objects.size();
+		m_Progress.Start(m_Options.m_Progress, m_Options.m_ProgressInterval, nullptr, [size]()
+		{
+			return size;
+		}, size);
+		m_Progress.EntitiesDone(entities);
+		m_Progress.Finish();
+	}
+
+	std::future<bool> DxfReader::ReadDxfAsync(const char* dxfFileName, bool OnlyReadModelSpace)
+	{
+		PrefetchDxf(dxfFileName);
+		std::string fileName = dxfFileName;
+		auto task = std::make_shared<std::packaged_task<bool()>>([this, fileName, OnlyReadModelSpace]()
+		{
+			return ReadDxf(fileName.c_str(), OnlyReadModelSpace);
+		});
+		ThreadPool::GetAsyncPool().Submit([task]()
+		{
+			(*task)();
+		});
+		return task->get_future();
+	}
+
+	void DxfReader::PrefetchDxf(const char* dxfFileName) const
+	{
+		CFileMapping::Prefetch(dxfFileName, m_MappingWindowSize);
+	}
+
+	bool DxfReader::ReadDxf(const char* data, size_t len, bool OnlyReadModelSpace)
+	{
+		TRACE_FUNCTION("(len = %zu, OnlyReadModelSpace = %s)", len, OnlyReadModelSpace ? "true" : "false");
+
+		bool bSuccess = ReadStream(OnlyReadModelSpace, [this, data, len]()
+		{
+			return m_Tokenizer.Open(data, len);
+		});
+		if (bSuccess && !m_Graph.m_LazyEntities.empty() && !OpenLazyReader([data, len](DxfTokenizer& tokenizer)
+		{
+			return tokenizer.Open(data, len);
+		}))
+		{
+			m_Graph.Reset();
+			bSuccess = false;
+		}
+		return bSuccess;
+	}
+
+	bool DxfReader::ReadDxf(const DxfSource& source, bool OnlyReadModelSpace, size_t bufferSize)
+	{
+		TRACE_FUNCTION("(bufferSize = %zu, OnlyReadModelSpace = %s)", bufferSize, OnlyReadModelSpace ? "true" : "false");
+
+		return ReadStream(OnlyReadModelSpace, [this, &source, bufferSize]()
+		{
+			return m_Tokenizer.Open(source, bufferSize);
+		});
+	}
+
+	bool DxfReader::ReadStream(bool OnlyReadModelSpace, const std::function<bool()>& OpenStream)
+	{
 		srand((unsigned)time(nullptr));
 		m_Graph.Reset();
 		Reset();
 
 		m_OnlyReadModelSpace = OnlyReadModelSpace;
-		m_DxfFile.open(dxfFileName);
+		bool bPipelined = m_Options.m_Pipelined && !m_Options.m_Lazy && !m_pIndex;
+		m_Tokenizer.SetPipeline(bPipelined ? m_Options.m_PipelineBatchSize : 0, m_Options.m_PipelineRingSize, BUFSIZE);
+		m_PipelineStats = PipelineStats();
 		bool bSuccess = true;
 		try
 		{
-			bSuccess = m_DxfFile.is_open() && m_DxfFile.good();
+			if (bPipelined)
+				m_pIndexer.reset(new EntityIndexer(m_Options.m_PipelineBatchSize, m_Options.m_PipelineRingSize));
+			bSuccess = OpenStream();
+			if (bSuccess)
+			{
+				m_Progress.Start(m_Options.m_Progress, m_Options.m_ProgressInterval, m_Options.m_CancelToken, [this]()
+				{
+					return m_Tokenizer.LastPairOffset();
+				}, m_Tokenizer.GetSize());
+			}
 			bSuccess = bSuccess && ReadHeader();
 
 			bSuccess = bSuccess && ReadTables();
 			bSuccess = bSuccess && ReadBlocks();
 			bSuccess = bSuccess && ReadEntities();
 			bSuccess = bSuccess && ReadObjects();
-			if (m_DxfFile.is_open())
-				m_DxfFile.close();
+			if (bSuccess)
+				m_Tokenizer.CheckEnd();
+			m_Tokenizer.Close();
+			if (m_pIndexer)
+				m_pIndexer->Finish();
 			ConvertHandle();
+			if (bSuccess)
+				m_Progress.Finish();
 		}
 		catch (const std::logic_error&)
 		{
@@ -71,6 +227,15 @@ namespace DXF
 		{
 			bSuccess = false;
 		}
+		m_Tokenizer.Close();
+		m_Progress.Stop();
+		m_Tokenizer.GetPipelineStats(m_PipelineStats);
+		if (m_pIndexer)
+		{
+			m_pIndexer->Finish();
+			m_pIndexer->GetStats(m_PipelineStats);
+			m_pIndexer.reset();
+		}
 		if (!bSuccess)
 		{
 			m_Graph.Reset();
@@ -78,47 +243,273 @@ namespace DXF
 		return bSuccess;
 	}
 
-	void DxfReader::ReadPair(int& groupCode, char* value, int bufsize)
+	bool DxfReader::ProbeDxf(const char* dxfFileName, DxfProbe& probe)
 	{
-		// Don't use TRACE_FUNCTION, it is a high frequent function.
+		TRACE_FUNCTION("(dxfFileName = %s)", dxfFileName);
 
-		m_DxfFile >> groupCode;
-		m_DxfFile.ignore(INT_MAX, '\n');
-		int curPos = m_DxfFile.tellg();
-		m_DxfFile.ignore(INT_MAX, '\n');
-		int nextPos = m_DxfFile.tellg();
-		m_DxfFile.seekg(curPos);
-		m_DxfFile.getline(value, bufsize);
-		// Trim whitespace from both ends of value
-		size_t len = strlen(value);
-		char* pStart = value;
-		char* pEnd = value + len;
-		while (pStart < pEnd)
+		return ProbeStream(probe, [this, dxfFileName]()
 		{
-			if (iswspace(*pStart) == 0)
-				break;
-			++pStart;
+			return m_Tokenizer.Open(dxfFileName);
+		});
+	}
+
+	bool DxfReader::ProbeDxf(const char* data, size_t len, DxfProbe& probe)
+	{
+		TRACE_FUNCTION("(len = %zu)", len);
+
+		return ProbeStream(probe, [this, data, len]()
+		{
+			return m_Tokenizer.Open(data, len);
+		});
+	}
+
+	bool DxfReader::ProbeStream(DxfProbe& probe, const std::function<bool()>& OpenStream)
+	{
+		m_Graph.Reset();
+		Reset();
+		probe = DxfProbe();
+
+		m_pProbe = &probe;
+		m_Tokenizer.SetPipeline(0, 0, 0);
+		bool bSuccess = true;
+		try
+		{
+			bSuccess = OpenStream();
+			bSuccess = bSuccess && ReadHeader();
+			bSuccess = bSuccess && ReadTables();
+			bSuccess = bSuccess && ScanEntities();
+		}
+		catch (const std::logic_error&)
+		{
+			bSuccess = false;
+		}
+		catch (const std::runtime_error&)
+		{
+			bSuccess = false;
+		}
+		m_Tokenizer.Close();
+		m_pProbe = nullptr;
+		if (!bSuccess)
+		{
+			m_Graph.Reset();
+			return false;
 		}
-		while (pEnd > pStart)
+
+		auto FindPair = [&probe](const char* name, int groupCode) -> const DxfPair*
 		{
-			char* pTemp = pEnd - 1;
-			if (iswspace(*pTemp))
+			auto it = probe.m_Variables.find(name);
+			if (it == probe.m_Variables.end())
+				return nullptr;
+			for (const DxfPair& pair : it->second)
 			{
-				pEnd = pTemp;
+				if (pair.m_GroupCode == groupCode)
+					return &pair;
 			}
-			else
+			return nullptr;
+		};
+		if (const DxfPair* pair = FindPair("$ACADVER", 1))
+			probe.m_AcadVer = pair->m_Value;
+		if (const DxfPair* pair = FindPair("$DWGCODEPAGE", 3))
+			probe.m_CodePage = pair->m_Value;
+		probe.m_LinetypeScale = m_Graph.m_LinetypeScale;
+		const DxfPair* pMinX = FindPair("$EXTMIN", 10);
+		const DxfPair* pMinY = FindPair("$EXTMIN", 20);
+		const DxfPair* pMaxX = FindPair("$EXTMAX", 10);
+		const DxfPair* pMaxY = FindPair("$EXTMAX", 20);
+		probe.m_HasExtents = pMinX && pMinY && pMaxX && pMaxY;
+		if (probe.m_HasExtents)
+		{
+			probe.m_ExtMin.SetPoint(pMinX->Real(), pMinY->Real());
+			probe.m_ExtMax.SetPoint(pMaxX->Real(), pMaxY->Real());
+		}
+		return true;
+	}
+
+	bool DxfReader::ScanEntities()
+	{
+		DxfProbe& probe = *m_pProbe;
+		char buffer[BUFSIZE];
+		int num;
+		std::string section;
+		// The name(group code 2) after SECTION or BLOCK is expected.
+		bool bSectionName = false;
+		bool bBlockName = false;
+		// Counts of the block being scanned
+		std::map<std::string, size_t>* pCounts = nullptr;
+		// Entity of ENTITIES being scanned, its space is known at the next group 0.
+		std::string entityType;
+		bool bPaperSpace = false;
+		bool bEntities = false;
+		while (true)
+		{
+			int code = bSectionName || bBlockName ? 2 : (bEntities ? 67 : 0);
+			m_Tokenizer.SkipToPair(code, num, buffer, BUFSIZE);
+			if (num < 0)
 			{
-				break;
+				PRINT_DEBUG_INFO("Unexpected end of DXF.");
+				return false;
+			}
+			if (num == 2)
+			{
+				if (bSectionName)
+				{
+					section = buffer;
+					bEntities = stricmp(buffer, "ENTITIES") == 0;
+				}
+				else
+				{
+					probe.m_Blocks.push_back(buffer);
+					if (stricmp(buffer, "*Model_Space") == 0)
+						pCounts = &probe.m_ModelSpaceCounts;
+					else if (strnicmp(buffer, g_PaperSpace, g_LenOfPaperSpace) == 0)
+						pCounts = &probe.m_PaperSpaceCounts;
+					else
+						pCounts = &probe.m_BlockCounts;
+				}
+				bSectionName = bBlockName = false;
+				continue;
+			}
+			if (num == 67)
+			{
+				bPaperSpace = ToInt(buffer) != 0;
+				continue;
+			}
+
+			if (!entityType.empty())
+			{
+				++(bPaperSpace ? probe.m_PaperSpaceCounts : probe.m_ModelSpaceCounts)[entityType];
+				entityType.clear();
+			}
+			bSectionName = bBlockName = false;
+			if (stricmp(buffer, "SECTION") == 0)
+			{
+				bSectionName = true;
+			}
+			else if (stricmp(buffer, "ENDSEC") == 0)
+			{
+				// Nothing is counted in OBJECTS.
+				if (bEntities)
+					return true;
+				section.clear();
+				pCounts = nullptr;
+			}
+			else if (stricmp(buffer, "EOF") == 0)
+			{
+				return true;
+			}
+			else if (bEntities)
+			{
+				entityType = buffer;
+				bPaperSpace = false;
+			}
+			else if (stricmp(section.c_str(), "BLOCKS") == 0)
+			{
+				if (stricmp(buffer, "BLOCK") == 0)
+					bBlockName = true;
+				else if (stricmp(buffer, "ENDBLK") == 0)
+					pCounts = nullptr;
+				else if (pCounts)
+					++(*pCounts)[buffer];
 			}
 		}
-		*pEnd = 0;
-		if (value != pStart)
+	}
+
+	bool DxfReader::OpenLazyReader(const std::function<bool(DxfTokenizer&)>& OpenStream)
+	{
+		auto pReader = std::make_shared<DxfReader>(m_Graph);
+		pReader->m_OnlyReadModelSpace = m_OnlyReadModelSpace;
+		pReader->m_Options = m_Options;
+		pReader->m_TextStyleHandleTable = m_TextStyleHandleTable;
+		pReader->m_BlockEntryHandleTable = m_BlockEntryHandleTable;
+		pReader->m_MLeaderStyleHandleTable = m_MLeaderStyleHandleTable;
+		pReader->m_LinetypeHandleTable = m_LinetypeHandleTable;
+		pReader->m_TableStyleHandleTable = m_TableStyleHandleTable;
+		pReader->SetMappingWindowSize(m_MappingWindowSize);
+		if (!OpenStream(pReader->m_Tokenizer))
+		{
+			PRINT_DEBUG_INFO("Can't open the DXF again for lazy entities.");
+			return false;
+		}
+		m_Graph.m_LoadedEntities.resize(m_Graph.m_LazyEntities.size());
+		m_Graph.m_pLazyReader = pReader;
+		return true;
+	}
+
+	void DxfReader::LoadEntity(size_t index)
+	{
+		TRACE_FUNCTION("(index = %zu)", index);
+
+		try
+		{
+			ReadLazyEntity(index);
+			// Load the entities referred to until all of them are loaded, then their handles can be converted.
+			std::set<size_t> read;
+			read.insert(index);
+			bool bRead = true;
+			while (bRead)
+			{
+				std::vector<Handle> handles;
+				for (const auto& pair : m_ToBeConvertedReactors)
+					handles.insert(handles.end(), pair.second.begin(), pair.second.end());
+				for (const auto& pair : m_ToBeConvertedViewportClipEnts)
+					handles.push_back(pair.second);
+				for (const auto& pair : m_ToBeConvertedLeaderAnnotation)
+					handles.push_back(pair.second);
+				for (const auto& pair : m_ToBeConvertedMLeaderAttDefs)
+					handles.insert(handles.end(), pair.second.begin(), pair.second.end());
+				for (const auto& pair : m_ToBeConvertedHatchAssociatedEnts)
+				{
+					for (const auto& handleLoopIndex : pair.second)
+						handles.push_back(handleLoopIndex.first);
+				}
+				bRead = false;
+				for (Handle handle : handles)
+				{
+					auto it = m_Graph.m_LazyIndexes.find(handle);
+					if (it != m_Graph.m_LazyIndexes.end() && m_Graph.m_LoadedEntities[it->second] == nullptr
+						&& read.insert(it->second).second)
+					{
+						ReadLazyEntity(it->second);
+						bRead = true;
+					}
+				}
+			}
+			ConvertHandle();
+		}
+		catch (const std::logic_error&)
+		{
+		}
+		catch (const std::runtime_error&)
 		{
-			size_t len = size_t(pEnd - pStart);
-			memmove(value, pStart, len);
-			value[len] = 0;
 		}
-		m_DxfFile.seekg(nextPos);
+		ClearToBeConverted();
+	}
+
+	void DxfReader::ReadLazyEntity(size_t index)
+	{
+		const LazyEntity& entity = m_Graph.m_LazyEntities[index];
+		EntityList objects;
+		ReadEntityAt(entity.m_Offset, m_Graph.m_LazyTypes[entity.m_Type].c_str(), &objects);
+		if (!objects.empty())
+			m_Graph.m_LoadedEntities[index] = objects.front();
+	}
+
+	void DxfReader::ReadEntityAt(unsigned long long offset, const char* entityType, EntityList* pObjList)
+	{
+		ReadEntityFunc read = GetEntityReader(entityType);
+		if (read == nullptr)
+			return;
+		m_Tokenizer.Seek(offset);
+		ReadAttribute();
+		TRACE_ENTITY("Read %s%s", entityType, m_Attribute.m_IsInPaperspace ? "(PS)" : "");
+		(this->*read)(pObjList);
+		// ATTRIBs follow their INSERT.
+		char buffer[BUFSIZE];
+		while (stricmp(entityType, "INSERT") == 0 && NextEntity(buffer) && stricmp(buffer, "ATTRIB") == 0)
+		{
+			ReadAttribute();
+			ReadAttrib(pObjList);
+		}
 	}
 
 	bool DxfReader::AdvanceToSection(const char* sectionName)
@@ -126,13 +517,15 @@ namespace DXF
 		char buffer[BUFSIZE];
 		int num;
 		int phase = 0;
-		while (phase < 2 && !m_DxfFile.fail())
+		unsigned long long sectionOffset = 0;
+		while (phase < 2 && !m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			if (0 == phase)
 			{
 				if (num != 0 || (stricmp("SECTION", buffer) != 0))
 					continue;
+				sectionOffset = m_Tokenizer.LastPairOffset();
 			}
 			else if (1 == phase)
 			{
@@ -144,6 +537,18 @@ namespace DXF
 			}
 			++phase;
 		}
+		unsigned long long offset;
+		if (2 == phase && m_pIndexBuilder && m_Tokenizer.Tell(offset))
+		{
+			// The section indexed before ends here.
+			auto& sections = m_pIndexBuilder->m_Sections;
+			if (!sections.empty() && sections.back().m_Length == 0)
+				sections.back().m_Length = sectionOffset - sections.back().m_Offset;
+			DxfIndex::Range section = { offset, 0, m_pIndexBuilder->AddString(sectionName), 0 };
+			sections.push_back(section);
+		}
+		if (2 == phase)
+			m_Progress.BeginSection(sectionName);
 		return 2 == phase;
 	}
 
@@ -151,13 +556,12 @@ namespace DXF
 	{
 		char buffer[BUFSIZE];
 		int num;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0 && (stricmp(objectType, buffer) == 0))
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				return true;
 			}
 		}
@@ -168,20 +572,19 @@ namespace DXF
 	{
 		char buffer[BUFSIZE];
 		int num;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
 				if (stricmp(objectType, buffer) == 0)
 				{
-					m_DxfFile.seekg(pos);
+					PutBackPair(num, buffer);
 					return true;
 				}
 				else if (stricmp(objectType, "LAYOUT") == 0)
 				{
-					m_DxfFile.seekg(pos);
+					PutBackPair(num, buffer);
 					return true;
 				}
 			}
@@ -189,26 +592,34 @@ namespace DXF
 		return false;
 	}
 
-	bool DxfReader::NextVariable(char* varName, char* varVal)
-	{
-		int num;
-		ReadPair(num, varName);
-		if (num != 9)
-			return false;
-		ReadPair(num, varVal);
-		return true;
-	}
-
 	bool DxfReader::ReadHeader()
 	{
 		bool bSuccess = AdvanceToSection("HEADER");
 		if (!bSuccess)
 			return bSuccess;
-		char varName[BUFSIZE], varVal[BUFSIZE];
-		while (NextVariable(varName, varVal) && !m_DxfFile.fail())
+		char buffer[BUFSIZE];
+		int num;
+		// Variables like $EXTMIN have several pairs.
+		bool bLinetypeScale = false;
+		std::vector<DxfPair>* pValues = nullptr;
+		while (!m_Tokenizer.fail())
 		{
-			if (stricmp(varName, "$LTSCALE") == 0)
-				m_Graph.m_LinetypeScale = atof(varVal);
+			ReadPair(num, buffer);
+			if (num == 0)
+				break;
+			if (num == 9)
+			{
+				bLinetypeScale = stricmp(buffer, "$LTSCALE") == 0;
+				pValues = m_pProbe ? &m_pProbe->m_Variables[buffer] : nullptr;
+				continue;
+			}
+			if (bLinetypeScale)
+				m_Graph.m_LinetypeScale = ToReal(buffer);
+			if (pValues)
+			{
+				pValues->emplace_back();
+				m_Tokenizer.MakePair(num, buffer, pValues->back());
+			}
 		}
 		return bSuccess;
 	}
@@ -218,7 +629,7 @@ namespace DXF
 		char buffer[BUFSIZE];
 		int num;
 		int phase = 0;
-		while (phase < 2 && !m_DxfFile.fail())
+		while (phase < 2 && !m_Tokenizer.fail())
 		{
 			if (0 == phase)
 			{
@@ -257,7 +668,7 @@ namespace DXF
 	{
 		char buffer[BUFSIZE];
 		int num;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			if (num == 0)
@@ -279,9 +690,8 @@ namespace DXF
 	{
 		int groupCode;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(groupCode, buffer);
 			if (groupCode != 0)
 			{
@@ -289,7 +699,7 @@ namespace DXF
 			}
 			else
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(groupCode, buffer);
 				break;
 			}
 		}
@@ -297,7 +707,7 @@ namespace DXF
 
 	void DxfReader::HandleBlockRecordEntryCode(std::string& name, void* data, int groupCode, const char* value)
 	{
-		int* handle = (int*)data;
+		Handle* handle = (Handle*)data;
 		switch (groupCode)
 		{
 		case 2:
@@ -320,16 +730,16 @@ namespace DXF
 			name = value;
 			break;
 		case 62:
-			ld->m_Color = atol(value);
+			ld->m_Color = ToInt(value);
 			break;
 		case 6:
 			ld->m_Linetype = value;
 			break;
 		case 290:
-			ld->m_Plottable = atoi(value) != 0;
+			ld->m_Plottable = ToInt(value) != 0;
 			break;
 		case 370:
-			ld->m_LineWeight = atol(value);
+			ld->m_LineWeight = ToInt(value);
 			break;
 		default:
 			break;
@@ -338,7 +748,7 @@ namespace DXF
 
 	void DxfReader::HandleLTypeEntryCode(std::string& name, void* data, int groupCode, const char* value)
 	{
-		int* handle = (int*)data;
+		Handle* handle = (Handle*)data;
 		switch (groupCode)
 		{
 		case 2:
@@ -355,7 +765,7 @@ namespace DXF
 	struct TextStyleDataExt
 	{
 		TextStyleData tsd;
-		int handle;
+		Handle handle;
 	};
 
 	const char* FileNameFromCadFace(const char* cadFace);
@@ -385,13 +795,13 @@ namespace DXF
 			tsd->handle = hextoi(value);
 			break;
 		case 40:
-			tsd->tsd.m_Height = atof(value);
+			tsd->tsd.m_Height = ToReal(value);
 			break;
 		case 41:
-			tsd->tsd.m_WidthFactor = atof(value);
+			tsd->tsd.m_WidthFactor = ToReal(value);
 			break;
 		case 50:
-			tsd->tsd.m_ObliqueAngle = atof(value);
+			tsd->tsd.m_ObliqueAngle = ToReal(value);
 			break;
 		default:
 			break;
@@ -411,19 +821,19 @@ namespace DXF
 			dsd->Text = value;
 			break;
 		case 41:
-			dsd->ArrowHeadSize = atof(value);
+			dsd->ArrowHeadSize = ToReal(value);
 			break;
 		case 42:
-			dsd->ExtensionLineOffset = atof(value);
+			dsd->ExtensionLineOffset = ToReal(value);
 			break;
 		case 44:
-			dsd->ExtensionLineExtend = atof(value);
+			dsd->ExtensionLineExtend = ToReal(value);
 			break;
 		case 140:
-			dsd->TextHeight = atof(value);
+			dsd->TextHeight = ToReal(value);
 			break;
 		case 141:
-			dsd->CenterMarkSize = atof(value);
+			dsd->CenterMarkSize = ToReal(value);
 			{
 				if (dsd->CenterMarkSize > 0)
 					dsd->CenterType = acCenterMark;
@@ -437,90 +847,90 @@ namespace DXF
 			}
 			break;
 		case 144:
-			dsd->LinearScaleFactor = atof(value);
+			dsd->LinearScaleFactor = ToReal(value);
 			break;
 		case 77:
 		{
-			long temp = atol(value);
+			long temp = ToInt(value);
 			if (1L == temp)
 				dsd->VerticalTextPosition = acAbove;
 		}
 		break;
 		case 145:
-			dsd->VerticalTextPosition = atol(value);
+			dsd->VerticalTextPosition = ToInt(value);
 			break;
 		case 147:
-			dsd->TextGap = atof(value);
+			dsd->TextGap = ToReal(value);
 			break;
 		case 73:
 			//case 74:
-			dsd->TextAlign = atoi(value) == 1;
+			dsd->TextAlign = ToInt(value) == 1;
 			break;
 		case 75:
-			dsd->ExtLine1Suppress = atoi(value) == 1;
+			dsd->ExtLine1Suppress = ToInt(value) == 1;
 			break;
 		case 76:
-			dsd->ExtLine2Suppress = atoi(value) == 1;
+			dsd->ExtLine2Suppress = ToInt(value) == 1;
 			break;
 		case 78:
 		{
-			int flag = atoi(value);
+			int flag = ToInt(value);
 			dsd->SuppressLeadingZeros = (flag & 4) != 0;
 			dsd->SuppressTrailingZeros = (flag & 8) != 0;
 		}
 		break;
 		case 79:
 		{
-			int flag = atoi(value);
+			int flag = ToInt(value);
 			dsd->AngleSuppressLeadingZeros = (flag & 1) != 0;
 			dsd->AngleSuppressTrailingZeros = (flag & 2) != 0;
 		}
 		break;
 		case 171:
-			dsd->UnitsPrecision = atol(value);
+			dsd->UnitsPrecision = ToInt(value);
 			break;
 		case 172:
-			dsd->ForceLineInside = atoi(value) == 1;
+			dsd->ForceLineInside = ToInt(value) == 1;
 			break;
 		case 174:
-			dsd->TextInside = atoi(value) == 1;
+			dsd->TextInside = ToInt(value) == 1;
 			break;
 		case 176:
-			dsd->DimensionLineColor = atol(value);
+			dsd->DimensionLineColor = ToInt(value);
 			break;
 		case 177:
-			dsd->ExtensionLineColor = atol(value);
+			dsd->ExtensionLineColor = ToInt(value);
 			break;
 		case 178:
-			dsd->TextColor = atol(value);
+			dsd->TextColor = ToInt(value);
 			break;
 		case 179:
-			dsd->AnglePrecision = atol(value);
+			dsd->AnglePrecision = ToInt(value);
 			break;
 		case 271:
-			dsd->UnitsPrecision = atol(value);
+			dsd->UnitsPrecision = ToInt(value);
 			break;
 			//case 273:
 		case 277:
-			dsd->UnitsFormat = atol(value);
+			dsd->UnitsFormat = ToInt(value);
 			break;
 		case 275:
-			dsd->AngleFormat = atol(value);
+			dsd->AngleFormat = ToInt(value);
 			break;
 		case 279:
-			dsd->TextMovement = atol(value);
+			dsd->TextMovement = ToInt(value);
 			break;
 		case 280:
-			dsd->HorizontalTextPosition = atol(value);
+			dsd->HorizontalTextPosition = ToInt(value);
 			break;
 		case 281:
-			dsd->DimLine1Suppress = atoi(value) == 1;
+			dsd->DimLine1Suppress = ToInt(value) == 1;
 			break;
 		case 282:
-			dsd->DimLine2Suppress = atoi(value) == 1;
+			dsd->DimLine2Suppress = ToInt(value) == 1;
 			break;
 		case 289:
-			dsd->Fit = atol(value);
+			dsd->Fit = ToInt(value);
 			break;
 		case 340:
 			// 此时调用LookupTextStyleName(handle)一般不会成功。
@@ -538,10 +948,10 @@ namespace DXF
 			dsd->ArrowHead2Block = value;
 			break;
 		case 371:
-			dsd->DimensionLineWeight = atol(value);
+			dsd->DimensionLineWeight = ToInt(value);
 			break;
 		case 372:
-			dsd->ExtensionLineWeight = atol(value);
+			dsd->ExtensionLineWeight = ToInt(value);
 			break;
 		default:
 			break;
@@ -558,14 +968,14 @@ namespace DXF
 		char tableName[BUFSIZE];
 		while (NextTable(tableName))
 		{
-			PrintDebugInfo("Read Table %s", tableName);
+			LOG_DEBUG_INFO(LogLevel::Trace, "Read Table %s", tableName);
 			while (NextTableEntry(tableName))
 			{
 				void* data = nullptr;
 				if (stricmp(tableName, "BLOCK_RECORD") == 0)
 				{
 					HandleTableEntryCode = &DxfReader::HandleBlockRecordEntryCode;
-					data = new int;
+					data = new Handle;
 				}
 				else if (stricmp(tableName, "LAYER") == 0)
 				{
@@ -578,7 +988,7 @@ namespace DXF
 				else if (stricmp(tableName, "LTYPE") == 0)
 				{
 					HandleTableEntryCode = &DxfReader::HandleLTypeEntryCode;
-					data = new int;
+					data = new Handle;
 				}
 				else if (stricmp(tableName, "STYLE") == 0)
 				{
@@ -602,10 +1012,10 @@ namespace DXF
 				{
 					std::string name;
 					ReadTableEntry(name, data);
-					PrintDebugInfo("Read Entry %s", name.c_str());
+					LOG_DEBUG_INFO(LogLevel::Trace, "Read Entry %s", name.c_str());
 					if (stricmp(tableName, "BLOCK_RECORD") == 0)
 					{
-						int* handle = (int*)data;
+						Handle* handle = (Handle*)data;
 						if (!name.empty())
 							m_BlockEntryHandleTable[*handle] = name;
 						delete handle;
@@ -624,7 +1034,7 @@ namespace DXF
 						{
 							m_Graph.m_Linetypes.insert(name);
 						}
-						int* handle = (int*)data;
+						Handle* handle = (Handle*)data;
 						if (!name.empty())
 							m_LinetypeHandleTable[*handle] = name;
 						delete handle;
@@ -661,17 +1071,30 @@ namespace DXF
 		return bSuccess;
 	}
 
+	void DxfReader::SkipIndexedBlock(const std::string& blockName)
+	{
+		const DxfIndex::Range* pBlock = m_pIndex ? m_pIndex->FindBlock(blockName.c_str()) : nullptr;
+		if (pBlock)
+			m_Tokenizer.Seek(pBlock->m_Offset + pBlock->m_Length);
+	}
+
 	bool DxfReader::NextBlock()
 	{
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
-			if (num == 0 && stricmp(buffer, "BLOCK") == 0)
-				return true;
-			if (num == 0 && stricmp(buffer, "ENDSEC") == 0)
-				return false;
+			if (num == 0 && (stricmp(buffer, "BLOCK") == 0 || stricmp(buffer, "ENDSEC") == 0))
+			{
+				// The block indexed before ends here.
+				if (m_pIndexBuilder && !m_pIndexBuilder->m_Blocks.empty() && m_pIndexBuilder->m_Blocks.back().m_Length == 0)
+				{
+					DxfIndex::Range& block = m_pIndexBuilder->m_Blocks.back();
+					block.m_Length = m_Tokenizer.LastPairOffset() - block.m_Offset;
+				}
+				return stricmp(buffer, "BLOCK") == 0;
+			}
 		}
 		return false;
 	}
@@ -680,14 +1103,14 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
 				if (stricmp(buffer, objectType) == 0)
 				{
+					m_Progress.CheckCancelled();
 					ReadPair(num, buffer);
 					if (num != 5)
 					{
@@ -699,7 +1122,7 @@ namespace DXF
 				}
 				else
 				{
-					m_DxfFile.seekg(pos);
+					PutBackPair(num, buffer);
 					return false;
 				}
 			}
@@ -712,13 +1135,12 @@ namespace DXF
 		int num;
 		char buffer[BUFSIZE];
 		NameHandle curDicEntry;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				return;
 			}
 			switch (num)
@@ -740,9 +1162,8 @@ namespace DXF
 		int groupCode;
 		char buffer[BUFSIZE];
 		LayoutData* pLayout = nullptr;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(groupCode, buffer);
 			if (groupCode != 0)
 			{
@@ -761,10 +1182,10 @@ namespace DXF
 					}
 					break;
 				case 10:
-					block->m_InsertPoint.x = atof(buffer);
+					block->m_InsertPoint.x = ToReal(buffer);
 					break;
 				case 20:
-					block->m_InsertPoint.y = atof(buffer);
+					block->m_InsertPoint.y = ToReal(buffer);
 					break;
 				default:
 					break;
@@ -772,7 +1193,7 @@ namespace DXF
 			}
 			else
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(groupCode, buffer);
 				break;
 			}
 		}
@@ -782,7 +1203,7 @@ namespace DXF
 	bool DxfReader::NextEntity(char* entityType)
 	{
 		int num;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, entityType);
 			if (num == 0)
@@ -797,7 +1218,7 @@ namespace DXF
 		return false;
 	}
 
-	void DxfReader::ReadAllEntities(EntityList* pObjList, bool bIn_ENTITIES_Section)
+	bool DxfReader::ReadAllEntities(EntityList* pObjList, bool bIn_ENTITIES_Section, CDblRect* extents)
 	{
 		EntAttribute att;
 		char buffer[BUFSIZE];
@@ -812,9 +1233,97 @@ namespace DXF
 				pPaperSpaceList = &pDefaultPaperSpace->m_Objects;
 			pModelSpaceList = &m_Graph.m_Objects;
 		}
+		// ATTRIBs belong to the INSERT before them.
+		bool bInsertRead = false;
+		bool bInsertLazy = false;
+		bool bAllBounded = true;
+		bool bLazyRead = bIn_ENTITIES_Section && m_Options.m_Lazy && m_Tokenizer.IsSeekable();
+		// All entities of the ENTITIES section are indexed, the one indexed last ends at the next entity but ATTRIB.
+		bool bIndexing = bIn_ENTITIES_Section && m_pIndexBuilder != nullptr;
+		bool bIndexedOpen = false;
+		auto EndIndexedEntity = [this, &bIndexedOpen]()
+		{
+			if (bIndexedOpen)
+			{
+				DxfIndex::Entity& entity = m_pIndexBuilder->m_Entities.back();
+				entity.m_Length = (unsigned int)(m_Tokenizer.LastPairOffset() - entity.m_Offset);
+				bIndexedOpen = false;
+			}
+		};
 		while (NextEntity(buffer))
 		{
-			ReadAttribute();
+			m_Progress.EntityDone();
+			unsigned long long offset = 0;
+			bool bTold = m_Tokenizer.Tell(offset);
+			bool bLazy = bLazyRead && bTold;
+			// NextEntity skips the rest of an entity not read.
+			bool bAttrib = stricmp(buffer, "ATTRIB") == 0;
+			if (!bAttrib)
+				EndIndexedEntity();
+			bool bIndex = bIndexing && bTold && !bAttrib && GetEntityReader(buffer) != nullptr;
+			bool bRead = bAttrib ? bInsertRead : IsEntityTypeRead(buffer);
+			if (bRead || bIndex)
+			{
+				ReadAttribute();
+				if (!bAttrib)
+					bRead = bRead && IsEntityRead(bIn_ENTITIES_Section, m_Attribute.m_IsInPaperspace, m_Attribute.m_Layer);
+			}
+			// Cull entities of model space by the window, get extents of blocks for culling INSERTs,
+			// and get extents of entities to index.
+			bool bEstimate = bIndex || bRead && !bAttrib && (bIn_ENTITIES_Section
+				? !m_Options.m_Window.IsEmpty() && !m_Attribute.m_IsInPaperspace
+				: IsEstimatingExtents() && extents != nullptr);
+			if (bEstimate)
+			{
+				CDblRect entityExtents;
+				bool bBounded = ReadEntityExtents(buffer, entityExtents);
+				if (bIndex)
+				{
+					DxfIndex::Entity entity;
+					entity.m_Handle = m_Attribute.m_Handle;
+					entity.m_Offset = offset;
+					entity.m_Length = 0;
+					entity.m_Type = m_pIndexBuilder->AddString(buffer);
+					entity.m_Layer = m_pIndexBuilder->AddString(m_Attribute.m_Layer);
+					entity.m_Flags = (m_Attribute.m_IsInPaperspace ? DxfIndex::Entity::PaperSpace : 0)
+						| (bBounded ? DxfIndex::Entity::Bounded : 0);
+					entity.m_Extents = entityExtents;
+					m_pIndexBuilder->m_Entities.push_back(entity);
+					bIndexedOpen = true;
+				}
+				if (bIn_ENTITIES_Section && !m_Options.m_Window.IsEmpty() && !m_Attribute.m_IsInPaperspace
+					&& bBounded && !entityExtents.Intersects(m_Options.m_Window))
+				{
+					bRead = false;
+				}
+				if (bRead)
+				{
+					// The pairs are read again by ReadXxx.
+					for (auto it = m_EntityPairs.rbegin(); it != m_EntityPairs.rend(); ++it)
+						m_Tokenizer.PutBackPair(*it);
+					if (!bIn_ENTITIES_Section)
+					{
+						if (bBounded)
+							extents->Add(entityExtents);
+						else
+							bAllBounded = false;
+					}
+				}
+			}
+			bLazy = bLazy && bRead && !m_Attribute.m_IsInPaperspace
+				&& (bAttrib ? bInsertLazy : GetEntityReader(buffer) != nullptr);
+			if (stricmp(buffer, "INSERT") == 0)
+			{
+				bInsertRead = bRead;
+				bInsertLazy = bLazy;
+			}
+			if (!bRead)
+				continue;
+			if (bLazy)
+			{
+				SkipLazyEntity(buffer, bAttrib, offset);
+				continue;
+			}
 			if (bIn_ENTITIES_Section)
 			{
 				if (m_Attribute.m_IsInPaperspace)
@@ -829,86 +1338,281 @@ namespace DXF
 				}
 			}
 
-			PrintDebugInfo("Read %s%s", buffer, m_Attribute.m_IsInPaperspace ? "(PS)" : "");
+			TRACE_ENTITY("Read %s%s", buffer, m_Attribute.m_IsInPaperspace ? "(PS)" : "");
 
-			//按出现概率大小排序
-			if (stricmp(buffer, "LINE") == 0)
-			{
-				ReadLine(pContainerList);
-			}
-			else if (stricmp(buffer, "TEXT") == 0)
-			{
-				ReadText(pContainerList);
-			}
-			else if (stricmp(buffer, "LWPOLYLINE") == 0)
-			{
-				ReadLwpolyline(pContainerList);
-			}
-			else if (stricmp(buffer, "ARC") == 0)
-			{
-				ReadArc(pContainerList);
-			}
-			else if (stricmp(buffer, "DIMENSION") == 0)
-			{
-				ReadDimension(pContainerList);
-			}
-			else if (stricmp(buffer, "INSERT") == 0)
+			ReadEntityFunc read = GetEntityReader(buffer);
+			if (read != nullptr)
 			{
-				ReadInsert(pContainerList);
+				size_t count = pContainerList->size();
+				(this->*read)(pContainerList);
+				for (size_t i = count; m_pIndexer && i < pContainerList->size(); ++i)
+					m_pIndexer->Add((*pContainerList)[i], pContainerList == pModelSpaceList);
 			}
-			else if (stricmp(buffer, "CIRCLE") == 0)
-			{
-				ReadCircle(pContainerList);
-			}
-			else if (stricmp(buffer, "ELLIPSE") == 0)
-			{
-				ReadEllipse(pContainerList);
-			}
-			else if (stricmp(buffer, "HATCH") == 0)
-			{
-				ReadHatch(pContainerList);
-			}
-			else if (stricmp(buffer, "LEADER") == 0)
-			{
-				ReadLeader(pContainerList);
-			}
-			else if (stricmp(buffer, "MULTILEADER") == 0)
-			{
-				ReadMLeader(pContainerList);
-			}
-			else if (stricmp(buffer, "MTEXT") == 0)
-			{
-				ReadMtext(pContainerList);
-			}
-			else if (stricmp(buffer, "SPLINE") == 0)
-			{
-				ReadSpline(pContainerList);
-			}
-			else if (stricmp(buffer, "VIEWPORT") == 0)
-			{
-				ReadViewport(pContainerList);
-			}
-			else if (stricmp(buffer, "SOLID") == 0)
+		}
+		EndIndexedEntity();
+		return bAllBounded;
+	}
+
+	DxfReader::ReadEntityFunc DxfReader::GetEntityReader(const char* entityType)
+	{
+		//按出现概率大小排序
+		static const struct
+		{
+			const char* m_Type;
+			ReadEntityFunc m_Read;
+		} readers[] = {
+			{ "LINE", &DxfReader::ReadLine },
+			{ "TEXT", &DxfReader::ReadText },
+			{ "LWPOLYLINE", &DxfReader::ReadLwpolyline },
+			{ "ARC", &DxfReader::ReadArc },
+			{ "DIMENSION", &DxfReader::ReadDimension },
+			{ "INSERT", &DxfReader::ReadInsert },
+			{ "CIRCLE", &DxfReader::ReadCircle },
+			{ "ELLIPSE", &DxfReader::ReadEllipse },
+			{ "HATCH", &DxfReader::ReadHatch },
+			{ "LEADER", &DxfReader::ReadLeader },
+			{ "MULTILEADER", &DxfReader::ReadMLeader },
+			{ "MTEXT", &DxfReader::ReadMtext },
+			{ "SPLINE", &DxfReader::ReadSpline },
+			{ "VIEWPORT", &DxfReader::ReadViewport },
+			{ "SOLID", &DxfReader::ReadSolid },
+			{ "POINT", &DxfReader::ReadPoint },
+			{ "ACAD_TABLE", &DxfReader::ReadTable },
+			{ "ATTDEF", &DxfReader::ReadAttDef },
+			{ "ATTRIB", &DxfReader::ReadAttrib },
+		};
+		for (const auto& reader : readers)
+		{
+			if (stricmp(entityType, reader.m_Type) == 0)
+				return reader.m_Read;
+		}
+		return nullptr;
+	}
+
+	bool DxfReader::ReadEntityExtents(const char* entityType, CDblRect& extents)
+	{
+		int num;
+		char buffer[BUFSIZE];
+		m_EntityPairs.clear();
+		while (!m_Tokenizer.fail())
+		{
+			ReadPair(num, buffer);
+			if (num == 0)
 			{
-				ReadSolid(pContainerList);
+				PutBackPair(num, buffer);
+				break;
 			}
-			else if (stricmp(buffer, "POINT") == 0)
+			m_EntityPairs.emplace_back();
+			m_Tokenizer.MakePair(num, buffer, m_EntityPairs.back());
+		}
+
+		extents.SetEmpty();
+		// Points of group codes 10 to lastPointCode
+		int lastPointCode = 0;
+		bool bCircle = false;
+		bool bEllipse = false;
+		bool bText = false;
+		bool bMText = false;
+		if (stricmp(entityType, "LINE") == 0 || stricmp(entityType, "SPLINE") == 0)
+			lastPointCode = 11; // the spline is inside the hull of its control points(10) and fit points(11)
+		else if (stricmp(entityType, "LWPOLYLINE") == 0 || stricmp(entityType, "LEADER") == 0
+			|| stricmp(entityType, "POINT") == 0 || stricmp(entityType, "INSERT") == 0)
+			lastPointCode = 10;
+		else if (stricmp(entityType, "SOLID") == 0)
+			lastPointCode = 13;
+		else if (stricmp(entityType, "CIRCLE") == 0 || stricmp(entityType, "ARC") == 0)
+			bCircle = true;
+		else if (stricmp(entityType, "ELLIPSE") == 0)
+			bEllipse = true;
+		else if (stricmp(entityType, "TEXT") == 0 || stricmp(entityType, "ATTDEF") == 0)
+		{
+			// Insertion point(10) and alignment point(11)
+			lastPointCode = 11;
+			bText = true;
+		}
+		else if (stricmp(entityType, "MTEXT") == 0)
+		{
+			lastPointCode = 10;
+			bMText = true;
+		}
+		else
+			return false;
+
+		CDblPoint center, axis;
+		double x = 0.0;
+		double radius = 0.0;
+		double bulge = 0.0;
+		double width = 0.0;
+		double height = 0.0;
+		double widthFactor = 1.0;
+		size_t textLength = 0;
+		std::string blockName;
+		double xScale = 1.0, yScale = 1.0, rotation = 0.0;
+		for (const DxfPair& pair : m_EntityPairs)
+		{
+			int gc = pair.m_GroupCode;
+			if (gc >= 10 && gc <= 18)
+				x = pair.Real();
+			if (gc >= 20 && gc <= 28)
 			{
-				ReadPoint(pContainerList);
+				if (gc - 10 <= lastPointCode)
+					extents.Add(x, pair.Real());
+				if (gc == 20)
+					center.SetPoint(x, pair.Real());
+				else if (gc == 21)
+					axis.SetPoint(x, pair.Real());
+				continue;
 			}
-			else if (stricmp(buffer, "ACAD_TABLE") == 0)
+			switch (gc)
 			{
-				ReadTable(pContainerList);
+			case 1:
+			case 3:
+				textLength += pair.m_Value.size();
+				break;
+			case 2:
+				blockName = pair.m_Value;
+				break;
+			case 40:
+				radius = height = pair.Real();
+				width = std::max(width, fabs(pair.Real()));
+				break;
+			case 41:
+				widthFactor = xScale = pair.Real();
+				width = std::max(width, fabs(pair.Real()));
+				break;
+			case 43:
+				width = std::max(width, fabs(pair.Real()));
+				break;
+			case 42:
+				bulge = std::max(bulge, fabs(pair.Real()));
+				yScale = pair.Real();
+				break;
+			case 50:
+				rotation = pair.Real() * M_PI / 180;
+				break;
+			case 70:
+			case 71:
+				// MINSERT
+				if (stricmp(entityType, "INSERT") == 0 && pair.Int() > 1)
+					return false;
+				break;
+			default:
+				break;
 			}
-			else if (stricmp(buffer, "ATTDEF") == 0)
+		}
+
+		if (bCircle || bEllipse)
+		{
+			if (bEllipse)
+				radius = hypot(axis.x, axis.y);
+			extents.Add(center.x, center.y);
+			extents.Inflate(radius);
+		}
+		else if (bText || bMText)
+		{
+			// No glyph is wider than twice its height, MTEXT may wrap within its reference width(41).
+			double size = height * 2 * textLength * (bText ? std::max(1.0, widthFactor) : 1.0);
+			if (bMText)
+				size = std::max(size, widthFactor);
+			extents.Inflate(size + height);
+		}
+		else if (stricmp(entityType, "LWPOLYLINE") == 0)
+		{
+			// An arc segment is within its chord expanded by its sagitta, bulge * chord / 2.
+			// Widths(40, 41, 43) extend both sides of the segments.
+			extents.Inflate(bulge * hypot(extents.right - extents.left, extents.top - extents.bottom) / 2 + width / 2);
+		}
+		else if (stricmp(entityType, "INSERT") == 0)
+		{
+			auto it = m_BlockExtents.find(blockName);
+			if (it == m_BlockExtents.end())
+				return false;
+			const CDblRect& block = it->second;
+			CDblPoint insertPoint(extents.left, extents.bottom);
+			extents.SetEmpty();
+			if (block.IsEmpty())
+				return true;
+			const double corners[4][2] = {
+				{ block.left, block.bottom }, { block.right, block.bottom },
+				{ block.right, block.top }, { block.left, block.top } };
+			for (const auto& corner : corners)
 			{
-				ReadAttDef(pContainerList);
+				CDblPoint point(insertPoint.x + corner[0] * xScale, insertPoint.y + corner[1] * yScale);
+				insertPoint.Rotate(point, rotation);
+				extents.Add(point.x, point.y);
 			}
-			else if (stricmp(buffer, "ATTRIB") == 0)
+		}
+		return true;
+	}
+
+	void DxfReader::SkipLazyEntity(const char* entityType, bool bAttrib, unsigned long long offset)
+	{
+		int num;
+		char buffer[BUFSIZE];
+		while (!m_Tokenizer.fail())
+		{
+			ReadPair(num, buffer);
+			if (num == 0)
 			{
-				ReadAttrib(pContainerList);
+				PutBackPair(num, buffer);
+				break;
 			}
 		}
+		// The entity ends where the group 0 just read begins.
+		unsigned long long end = m_Tokenizer.LastPairOffset();
+		if (bAttrib)
+		{
+			LazyEntity& insert = m_Graph.m_LazyEntities.back();
+			insert.m_Length = (unsigned int)(end - insert.m_Offset);
+			return;
+		}
+		AddLazyEntity(entityType, m_Attribute.m_Layer, m_Attribute.m_Handle, offset, (unsigned int)(end - offset));
+	}
+
+	void DxfReader::AddLazyEntity(const char* entityType, const std::string& layerName, Handle handle,
+		unsigned long long offset, unsigned int length)
+	{
+		LazyEntity entity;
+		entity.m_Handle = handle;
+		entity.m_Offset = offset;
+		entity.m_Length = length;
+		auto& types = m_Graph.m_LazyTypes;
+		auto type = std::find(types.begin(), types.end(), entityType);
+		entity.m_Type = (unsigned short)(type - types.begin());
+		if (type == types.end())
+			types.push_back(entityType);
+		auto layer = m_LazyLayerIndexes.emplace(layerName, (unsigned int)m_Graph.m_LazyLayers.size());
+		if (layer.second)
+			m_Graph.m_LazyLayers.push_back(layerName);
+		entity.m_Layer = layer.first->second;
+		m_Graph.m_LazyIndexes[handle] = m_Graph.m_LazyEntities.size();
+		m_Graph.m_LazyEntities.push_back(entity);
+	}
+
+	bool DxfReader::IsEntityTypeRead(const char* entityType) const
+	{
+		return m_Options.m_EntityTypes.empty() || m_Options.m_EntityTypes.count(entityType) != 0;
+	}
+
+	bool DxfReader::IsEntityRead(bool bIn_ENTITIES_Section, bool bPaperSpace, const std::string& layer) const
+	{
+		if (bIn_ENTITIES_Section && !(bPaperSpace ? m_Options.m_ReadPaperSpace : m_Options.m_ReadModelSpace))
+			return false;
+		if (!m_Options.m_Layers.empty() && m_Options.m_Layers.count(layer) == 0)
+			return false;
+		return m_Options.m_ExcludedLayers.count(layer) == 0;
+	}
+
+	bool DxfReader::IsEstimatingExtents() const
+	{
+		return !m_Options.m_Window.IsEmpty() || m_pIndexBuilder != nullptr;
+	}
+
+	bool DxfReader::IsReadingAllEntities() const
+	{
+		return m_Options.m_EntityTypes.empty() && m_Options.m_Layers.empty() && m_Options.m_ExcludedLayers.empty()
+			&& m_Options.m_ReadModelSpace && m_Options.m_ReadPaperSpace && !m_Options.m_BlockFilter
+			&& m_Options.m_Window.IsEmpty() && !m_Options.m_Lazy;
 	}
 
 	bool DxfReader::ReadBlocks()
@@ -919,9 +1623,16 @@ namespace DXF
 		std::string blockName;
 		while (NextBlock())
 		{
+			unsigned long long blockOffset = 0;
+			bool bBlockTold = m_Tokenizer.Tell(blockOffset);
 			auto pBlockDef = std::make_shared<BlockDef>();
 			std::shared_ptr<LayoutData> pLayout(ReadBlockBegin(blockName, pBlockDef.get()));
-			PrintDebugInfo("Read Block %s", blockName.c_str());
+			LOG_DEBUG_INFO(LogLevel::Trace, "Read Block %s", blockName.c_str());
+			if (m_pIndexBuilder && bBlockTold)
+			{
+				DxfIndex::Range block = { blockOffset, 0, m_pIndexBuilder->AddString(blockName), 0 };
+				m_pIndexBuilder->m_Blocks.push_back(block);
+			}
 			if (pLayout)
 			{
 				if (!m_OnlyReadModelSpace)
@@ -930,8 +1641,12 @@ namespace DXF
 					// The key should be layout name, but layout name is not available at this time.
 					// So use unqiue block name temporarily.
 					m_Graph.m_Layouts[blockName] = pLayout;
-					ReadAllEntities(&pLayout->m_Objects, false);
 				}
+				// NextBlock skips the entities not read.
+				if (!m_OnlyReadModelSpace && m_Options.m_ReadPaperSpace)
+					ReadAllEntities(&pLayout->m_Objects, false);
+				else
+					SkipIndexedBlock(blockName);
 			}
 			else
 			{
@@ -942,7 +1657,21 @@ namespace DXF
 				// '*Paper_Space' - Paperspace blocks
 				// '*' - temporary blocks
 				m_Graph.m_RealBlockDefs[blockName] = pBlockDef;
-				ReadAllEntities(&pBlockDef->m_Objects, false);
+				if (!m_Options.m_BlockFilter || m_Options.m_BlockFilter(blockName))
+				{
+					CDblRect extents;
+					if (ReadAllEntities(&pBlockDef->m_Objects, false, &extents) && IsEstimatingExtents())
+					{
+						const CDblPoint& base = pBlockDef->m_InsertPoint;
+						if (!extents.IsEmpty())
+							extents = CDblRect(extents.left - base.x, extents.bottom - base.y, extents.right - base.x, extents.top - base.y);
+						m_BlockExtents[blockName] = extents;
+					}
+				}
+				else
+				{
+					SkipIndexedBlock(blockName);
+				}
 			}
 		}
 		return bSuccess;
@@ -953,17 +1682,58 @@ namespace DXF
 		TRACE_FUNCTION("()");
 
 		bool bSuccess = AdvanceToSection("ENTITIES");
-		ReadAllEntities(nullptr, true);
+		const DxfIndex::Range* pSection = m_pIndex ? m_pIndex->FindSection("ENTITIES") : nullptr;
+		if (bSuccess && pSection)
+		{
+			ReadIndexedEntities();
+			m_Tokenizer.Seek(pSection->m_Offset + pSection->m_Length);
+		}
+		else
+		{
+			ReadAllEntities(nullptr, true);
+			// The section is indexed up to ENDSEC, the next sections may not be read.
+			auto* pSections = m_pIndexBuilder ? &m_pIndexBuilder->m_Sections : nullptr;
+			if (bSuccess && pSections && !pSections->empty() && pSections->back().m_Length == 0)
+				pSections->back().m_Length = m_Tokenizer.LastPairOffset() - pSections->back().m_Offset;
+		}
 		return bSuccess;
 	}
 
+	void DxfReader::ReadIndexedEntities()
+	{
+		std::shared_ptr<LayoutData> pDefaultPaperSpace = LookupLayout(g_PaperSpace);
+		for (size_t i = 0; i < m_pIndex->GetEntityCount(); ++i)
+		{
+			// Select entities the same way as ReadAllEntities, without reading them.
+			const DxfIndex::Entity& entity = m_pIndex->GetEntity(i);
+			m_Progress.EntityDone();
+			const char* entityType = m_pIndex->GetString(entity.m_Type);
+			std::string layer = m_pIndex->GetString(entity.m_Layer);
+			bool bPaperSpace = (entity.m_Flags & DxfIndex::Entity::PaperSpace) != 0;
+			if (!IsEntityTypeRead(entityType) || !IsEntityRead(true, bPaperSpace, layer))
+				continue;
+			if (bPaperSpace)
+			{
+				if (pDefaultPaperSpace)
+					ReadEntityAt(entity.m_Offset, entityType, &pDefaultPaperSpace->m_Objects);
+				continue;
+			}
+			if ((entity.m_Flags & DxfIndex::Entity::Bounded) && !m_Options.m_Window.IsEmpty()
+				&& !entity.m_Extents.Intersects(m_Options.m_Window))
+				continue;
+			if (m_Options.m_Lazy)
+				AddLazyEntity(entityType, layer, entity.m_Handle, entity.m_Offset, entity.m_Length);
+			else
+				ReadEntityAt(entity.m_Offset, entityType, &m_Graph.m_Objects);
+		}
+	}
+
 	void DxfReader::ReadLayout(std::string& layoutName, LayoutData& lo)
 	{
 		bool IsThis330 = false;
-		int pos;
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			if (num == 100 && stricmp(buffer, "AcDbLayout") == 0)
@@ -977,43 +1747,42 @@ namespace DXF
 				lo.m_PlotSettings.m_PaperName = buffer;
 				break;
 			case 40:
-				lo.m_PlotSettings.m_LeftMargin = atof(buffer);
+				lo.m_PlotSettings.m_LeftMargin = ToReal(buffer);
 				break;
 			case 41:
-				lo.m_PlotSettings.m_BottomMargin = atof(buffer);
+				lo.m_PlotSettings.m_BottomMargin = ToReal(buffer);
 				break;
 			case 42:
-				lo.m_PlotSettings.m_RightMargin = atof(buffer);
+				lo.m_PlotSettings.m_RightMargin = ToReal(buffer);
 				break;
 			case 43:
-				lo.m_PlotSettings.m_TopMargin = atof(buffer);
+				lo.m_PlotSettings.m_TopMargin = ToReal(buffer);
 				break;
 			case 44:
-				lo.m_PlotSettings.m_Width = atof(buffer);
+				lo.m_PlotSettings.m_Width = ToReal(buffer);
 				break;
 			case 45:
-				lo.m_PlotSettings.m_Height = atof(buffer);
+				lo.m_PlotSettings.m_Height = ToReal(buffer);
 				break;
 			case 46:
-				lo.m_PlotSettings.m_PlotOrigin.x = atof(buffer);
+				lo.m_PlotSettings.m_PlotOrigin.x = ToReal(buffer);
 				break;
 			case 47:
-				lo.m_PlotSettings.m_PlotOrigin.y = atof(buffer);
+				lo.m_PlotSettings.m_PlotOrigin.y = ToReal(buffer);
 				break;
 			case 73:
-				lo.m_PlotSettings.m_PlotRotation = atoi(buffer);
+				lo.m_PlotSettings.m_PlotRotation = ToInt(buffer);
 				break;
 			default:
 				break;
 			}
 		}
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -1022,35 +1791,35 @@ namespace DXF
 				layoutName = buffer;
 				break;
 			case 71:
-				lo.m_LayoutOrder = atoi(buffer);
+				lo.m_LayoutOrder = ToInt(buffer);
 				break;
 			case 10:
-				lo.m_MinLim.x = atof(buffer);
+				lo.m_MinLim.x = ToReal(buffer);
 				break;
 			case 20:
-				lo.m_MinLim.y = atof(buffer);
+				lo.m_MinLim.y = ToReal(buffer);
 				break;
 			case 11:
-				lo.m_MaxLim.x = atof(buffer);
+				lo.m_MaxLim.x = ToReal(buffer);
 				break;
 			case 21:
-				lo.m_MaxLim.y = atof(buffer);
+				lo.m_MaxLim.y = ToReal(buffer);
 				break;
 			case 14:
-				lo.m_MinExt.x = atof(buffer);
+				lo.m_MinExt.x = ToReal(buffer);
 				break;
 			case 24:
-				lo.m_MinExt.y = atof(buffer);
+				lo.m_MinExt.y = ToReal(buffer);
 				break;
 			case 15:
-				lo.m_MaxExt.x = atof(buffer);
+				lo.m_MaxExt.x = ToReal(buffer);
 				break;
 			case 25:
-				lo.m_MaxExt.y = atof(buffer);
+				lo.m_MaxExt.y = ToReal(buffer);
 				break;
 			case 330:
 			{
-				int handle = hextoi(buffer);
+				Handle handle = hextoi(buffer);
 				lo.m_BlockName = LookupBlockEntryName(handle);
 			}
 			break;
@@ -1064,65 +1833,64 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		int pos = m_DxfFile.tellg();
 		ContentType ct = MTEXT_TYPE;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 170:
-				if ((ct = ContentType(atoi(buffer))) == BLOCK_TYPE)
+				if ((ct = ContentType(ToInt(buffer))) == BLOCK_TYPE)
 					mls.m_Content = make_shared<StyleBlockPart>();
 				else
 					mls.m_Content = make_shared<StyleMTextPart>();
 				break;
 			case 90:
-				mls.m_MaxLeaderPoints = atoi(buffer);
+				mls.m_MaxLeaderPoints = ToInt(buffer);
 				break;
 			case 40:
-				mls.m_FirstSegAngleConstraint = atof(buffer);
+				mls.m_FirstSegAngleConstraint = ToReal(buffer);
 				break;
 			case 41:
-				mls.m_SecondSegAngleConstraint = atof(buffer);
+				mls.m_SecondSegAngleConstraint = ToReal(buffer);
 				break;
 			case 173:
-				mls.m_LeaderType = AcMLeaderType(atoi(buffer));
+				mls.m_LeaderType = AcMLeaderType(ToInt(buffer));
 				break;
 			case 91:
-				mls.m_LineColor = AcColor(atoi(buffer));
+				mls.m_LineColor = AcColor(ToInt(buffer));
 				break;
 			case 340:
 				mls.m_LineType = LookupLinetypeName(hextoi(buffer));
 				break;
 			case 92:
-				mls.m_LineWeight = AcLineWeight(atoi(buffer));
+				mls.m_LineWeight = AcLineWeight(ToInt(buffer));
 				break;
 			case 290:
-				mls.m_EnableLanding = !!atoi(buffer);
+				mls.m_EnableLanding = !!ToInt(buffer);
 				break;
 			case 42:
-				mls.m_LandingGap = atof(buffer);
+				mls.m_LandingGap = ToReal(buffer);
 				break;
 			case 291:
-				mls.m_EnableDogleg = !!atoi(buffer);
+				mls.m_EnableDogleg = !!ToInt(buffer);
 				break;
 			case 43:
-				mls.m_DoglegLength = atof(buffer);
+				mls.m_DoglegLength = ToReal(buffer);
 				break;
 			case 44:
-				mls.m_ArrowSize = atof(buffer);
+				mls.m_ArrowSize = ToReal(buffer);
 				break;
 			case 296:
-				mls.m_IsAnnotative = !!atoi(buffer);
+				mls.m_IsAnnotative = !!ToInt(buffer);
 				break;
 			case 143:
-				mls.m_BreakGapSize = atof(buffer);
+				mls.m_BreakGapSize = ToReal(buffer);
 				break;
 			case 341:
 				mls.m_ArrowHead = LookupBlockEntryName(hextoi(buffer));
@@ -1142,13 +1910,12 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -1157,16 +1924,16 @@ namespace DXF
 				block.m_BlockName = LookupBlockEntryName(hextoi(buffer));
 				break;
 			case 177:
-				block.m_BlockConnectionType = AcBlockConnectionType(atoi(buffer));
+				block.m_BlockConnectionType = AcBlockConnectionType(ToInt(buffer));
 				break;
 			case 94:
-				block.m_BlockColor = AcColor(atoi(buffer));
+				block.m_BlockColor = AcColor(ToInt(buffer));
 				break;
 			case 47:
-				block.m_BlockScale.x = atof(buffer);
+				block.m_BlockScale.x = ToReal(buffer);
 				break;
 			case 49:
-				block.m_BlockScale.y = atof(buffer);
+				block.m_BlockScale.y = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -1178,13 +1945,12 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -1193,16 +1959,16 @@ namespace DXF
 				mtext.m_TextStyle = LookupTextStyleName(hextoi(buffer));
 				break;
 			case 175:
-				mtext.m_TextAngleType = AcTextAngleType(atoi(buffer));
+				mtext.m_TextAngleType = AcTextAngleType(ToInt(buffer));
 				break;
 			case 93:
-				mtext.m_TextColor = AcColor(atoi(buffer));
+				mtext.m_TextColor = AcColor(ToInt(buffer));
 				break;
 			case 45:
-				mtext.m_TextHeight = atof(buffer);
+				mtext.m_TextHeight = ToReal(buffer);
 				break;
 			case 46:
-				mtext.m_AlignSpace = atof(buffer);
+				mtext.m_AlignSpace = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -1216,13 +1982,12 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pTable = std::make_shared<AcadTable>();
 		SetAttribute(pTable.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -1231,10 +1996,10 @@ namespace DXF
 				pTable->m_TableBlockName = buffer;
 				break;
 			case 10:
-				pTable->m_InsertionPoint.x = atof(buffer);
+				pTable->m_InsertionPoint.x = ToReal(buffer);
 				break;
 			case 20:
-				pTable->m_InsertionPoint.y = atof(buffer);
+				pTable->m_InsertionPoint.y = ToReal(buffer);
 				break;
 			case 342:
 				//此时转换TableStyle handle到name不会成功。
@@ -1243,11 +2008,11 @@ namespace DXF
 			case 343:
 				break;
 			case 91:
-				pTable->m_RowCount = atoi(buffer);
+				pTable->m_RowCount = ToInt(buffer);
 				pTable->m_RowHeights.reserve(pTable->m_RowCount);
 				break;
 			case 92:
-				pTable->m_ColCount = atoi(buffer);
+				pTable->m_ColCount = ToInt(buffer);
 				pTable->m_ColWidths.reserve(pTable->m_ColCount);
 				if (pTable->m_RowCount > 0 && pTable->m_ColCount > 0)
 				{
@@ -1255,15 +2020,15 @@ namespace DXF
 				}
 				break;
 			case 141:
-				pTable->m_RowHeights.push_back(atof(buffer));
+				pTable->m_RowHeights.push_back(ToReal(buffer));
 				break;
 			case 142:
-				pTable->m_ColWidths.push_back(atof(buffer));
+				pTable->m_ColWidths.push_back(ToReal(buffer));
 				break;
 			case 171:
 			{
 				// Suppose cell begins with group code 171.
-				pTable->m_Cells.push_back(Cell(CellType(atoi(buffer))));
+				pTable->m_Cells.push_back(Cell(CellType(ToInt(buffer))));
 				Cell& cell = pTable->m_Cells.back();
 				ReadCell(cell);
 			}
@@ -1281,7 +2046,7 @@ namespace DXF
 		char buffer[BUFSIZE];
 		bool bFirst91 = true;
 		bool bBefore301 = true;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			if (num == 304)
@@ -1292,69 +2057,69 @@ namespace DXF
 			switch (num)
 			{
 			case 172:
-				cell.m_Flag = atoi(buffer);
+				cell.m_Flag = ToInt(buffer);
 				break;
 			case 173:
-				cell.m_Merged = !!atoi(buffer);
+				cell.m_Merged = !!ToInt(buffer);
 				break;
 			case 174:
-				cell.m_AutoFit = !!atoi(buffer);
+				cell.m_AutoFit = !!ToInt(buffer);
 				break;
 			case 175:
-				cell.m_ColSpan = atoi(buffer);
+				cell.m_ColSpan = ToInt(buffer);
 				break;
 			case 176:
-				cell.m_RowSpan = atoi(buffer);
+				cell.m_RowSpan = ToInt(buffer);
 				break;
 			case 93:
-				cell.m_Flag93 = atoi(buffer);
+				cell.m_Flag93 = ToInt(buffer);
 				break;
 			case 90:
-				cell.m_Flag90 = atoi(buffer);
+				cell.m_Flag90 = ToInt(buffer);
 				break;
 			case 91:
 				if (bFirst91)
 				{
-					cell.m_OverrideFlag1 = atoi(buffer);
+					cell.m_OverrideFlag1 = ToInt(buffer);
 					bFirst91 = false;
 				}
 				else
 				{
-					cell.m_OverrideFlag2 = atoi(buffer);
+					cell.m_OverrideFlag2 = ToInt(buffer);
 				}
 				break;
 			case 178:
-				cell.m_VirtualEdgeFlag = atoi(buffer);
+				cell.m_VirtualEdgeFlag = ToInt(buffer);
 				break;
 			case 145:
-				cell.m_Rotation = atof(buffer);
+				cell.m_Rotation = ToReal(buffer);
 				break;
 			case 170:
-				cell.m_Alignment = AcCellAlignment(atoi(buffer));
+				cell.m_Alignment = AcCellAlignment(ToInt(buffer));
 				break;
 			case 283:
-				cell.m_BgColorEnabled = !!atoi(buffer);
+				cell.m_BgColorEnabled = !!ToInt(buffer);
 				break;
 			case 63:
-				cell.m_BgColor = AcColor(atoi(buffer));
+				cell.m_BgColor = AcColor(ToInt(buffer));
 				break;
 			case 64:
-				cell.m_TextColor = AcColor(atoi(buffer));
+				cell.m_TextColor = AcColor(ToInt(buffer));
 				break;
 			case 140:
-				cell.m_TextHeight = atof(buffer);
+				cell.m_TextHeight = ToReal(buffer);
 				break;
 			case 288:
-				cell.m_LeftBorderVisible = !!atoi(buffer);
+				cell.m_LeftBorderVisible = !!ToInt(buffer);
 				break;
 			case 285:
-				cell.m_RightBorderVisible = !!atoi(buffer);
+				cell.m_RightBorderVisible = !!ToInt(buffer);
 				break;
 			case 289:
-				cell.m_TopBorderVisible = !!atoi(buffer);
+				cell.m_TopBorderVisible = !!ToInt(buffer);
 				break;
 			case 286:
-				cell.m_BottomBorderVisible = !!atoi(buffer);
+				cell.m_BottomBorderVisible = !!ToInt(buffer);
 				break;
 			case 302:
 			case 303:
@@ -1382,7 +2147,7 @@ namespace DXF
 				if (cell.m_Content->GetContentType() == BLOCK_CELL)
 				{
 					CellBlock* pCell = static_cast<CellBlock*>(cell.m_Content.get());
-					pCell->m_BlockScale = atof(buffer);
+					pCell->m_BlockScale = ToReal(buffer);
 				}
 				break;
 			case 331:
@@ -1418,7 +2183,6 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		int pos = m_DxfFile.tellg();
 		bool first280IsRead = false;
 		std::map<int, int> cellAttribCount;
 		int curCellIndex = -1;
@@ -1440,21 +2204,21 @@ namespace DXF
 				curCellIndex = it->second;
 			}
 		};
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 40:
-				ts.m_HorCellMargin = atof(buffer);
+				ts.m_HorCellMargin = ToReal(buffer);
 				break;
 			case 41:
-				ts.m_VerCellMargin = atof(buffer);
+				ts.m_VerCellMargin = ToReal(buffer);
 				break;
 			case 280:
 				if (!first280IsRead)
@@ -1463,42 +2227,42 @@ namespace DXF
 				}
 				else
 				{
-					ts.m_HasNoTitle = !!atoi(buffer);
+					ts.m_HasNoTitle = !!ToInt(buffer);
 				}
 				break;
 			case 281:
-				ts.m_HasNoColumnHeading = !!atoi(buffer);
+				ts.m_HasNoColumnHeading = !!ToInt(buffer);
 				break;
 			case 7:
 				ts.m_TextStyle = buffer;
 				break;
 			case 140:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_TextHeight = atof(buffer);
+				ts.m_Cells.back().m_TextHeight = ToReal(buffer);
 				break;
 			case 170:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_Alignment = AcCellAlignment(atoi(buffer));
+				ts.m_Cells.back().m_Alignment = AcCellAlignment(ToInt(buffer));
 				break;
 			case 62:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_TextColor = AcColor(atoi(buffer));
+				ts.m_Cells.back().m_TextColor = AcColor(ToInt(buffer));
 				break;
 			case 63:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_BgColor = AcColor(atoi(buffer));
+				ts.m_Cells.back().m_BgColor = AcColor(ToInt(buffer));
 				break;
 			case 283:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_BgColorEnabled = !!atoi(buffer);
+				ts.m_Cells.back().m_BgColorEnabled = !!ToInt(buffer);
 				break;
 			case 90:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_CellDataType = AcValueDataType(atoi(buffer));
+				ts.m_Cells.back().m_CellDataType = AcValueDataType(ToInt(buffer));
 				break;
 			case 91:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_CellUnitType = AcValueUnitType(atoi(buffer));
+				ts.m_Cells.back().m_CellUnitType = AcValueUnitType(ToInt(buffer));
 				break;
 			case 274:
 			case 275:
@@ -1507,7 +2271,7 @@ namespace DXF
 			case 278:
 			case 279:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_BorderLineWeight[num - 274] = AcLineWeight(atoi(buffer));
+				ts.m_Cells.back().m_BorderLineWeight[num - 274] = AcLineWeight(ToInt(buffer));
 				break;
 			case 284:
 			case 285:
@@ -1516,7 +2280,7 @@ namespace DXF
 			case 288:
 			case 289:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_BorderVisible[num - 284] = !!atoi(buffer);
+				ts.m_Cells.back().m_BorderVisible[num - 284] = !!ToInt(buffer);
 				break;
 			case 64:
 			case 65:
@@ -1525,7 +2289,7 @@ namespace DXF
 			case 68:
 			case 69:
 				PushCellIfFirst(num);
-				ts.m_Cells.back().m_BorderColor[num - 64] = AcColor(atoi(buffer));
+				ts.m_Cells.back().m_BorderColor[num - 64] = AcColor(ToInt(buffer));
 				break;
 			default:
 				break;
@@ -1543,8 +2307,8 @@ namespace DXF
 
 		// Get handle of dictionary ACAD_MLEADERSTYLE and ACAD_TABLESTYLE
 		bSuccess = bSuccess && NextObject("DICTIONARY");
-		int mLeaderStyleDicHandle = 0;
-		int tableStyleDicHandle = 0;
+		Handle mLeaderStyleDicHandle = 0;
+		Handle tableStyleDicHandle = 0;
 		ReadDictionaryEntries([&mLeaderStyleDicHandle, &tableStyleDicHandle](const NameHandle& curDicEntry) {
 			if (curDicEntry.name == "ACAD_MLEADERSTYLE")
 			{
@@ -1594,7 +2358,7 @@ namespace DXF
 		{
 			LayoutData lo;
 			ReadLayout(layoutName, lo);
-			PrintDebugInfo("Read Layout %s", layoutName.c_str());
+			LOG_DEBUG_INFO(LogLevel::Trace, "Read Layout %s", layoutName.c_str());
 			if (strnicmp(lo.m_BlockName.c_str(), g_PaperSpace, g_LenOfPaperSpace) == 0)
 			{
 				auto pLayout = LookupLayout(lo.m_BlockName.c_str());
@@ -1616,7 +2380,7 @@ namespace DXF
 			MLeaderStyle mls;
 			ReadMLeaderStyle(mls);
 			string name = LookupMLeaderStyleName(m_CurObjectHandle);
-			PrintDebugInfo("Read MLEADERSTYLE %s", name.c_str());
+			LOG_DEBUG_INFO(LogLevel::Trace, "Read MLEADERSTYLE %s", name.c_str());
 			m_Graph.m_MLeaderStyles[name] = mls;
 		}
 
@@ -1627,55 +2391,55 @@ namespace DXF
 			TableStyle tbls;
 			ReadTableStyle(tbls);
 			string name = LookupTableStyleName(m_CurObjectHandle);
-			PrintDebugInfo("Read TABLESTYLE %s", name.c_str());
+			LOG_DEBUG_INFO(LogLevel::Trace, "Read TABLESTYLE %s", name.c_str());
 			m_Graph.m_TableStyles[name] = tbls;
 		}
 
 		return bSuccess;
 	}
 
-	string DxfReader::LookupTextStyleName(int handle)
+	string DxfReader::LookupTextStyleName(Handle handle)
 	{
 		auto it = m_TextStyleHandleTable.find(handle);
 		if (it != m_TextStyleHandleTable.end())
 			return it->second;
-		PRINT_DEBUG_INFO("Can't convert handle 0x%X to TextStyle name", handle);
+		PRINT_DEBUG_INFO("Can't convert handle 0x%llX to TextStyle name", handle);
 		return string();
 	}
 
-	string DxfReader::LookupBlockEntryName(int handle)
+	string DxfReader::LookupBlockEntryName(Handle handle)
 	{
 		auto it = m_BlockEntryHandleTable.find(handle);
 		if (it != m_BlockEntryHandleTable.end())
 			return it->second;
-		PRINT_DEBUG_INFO("Can't convert handle 0x%X to Block name", handle);
+		PRINT_DEBUG_INFO("Can't convert handle 0x%llX to Block name", handle);
 		return string();
 	}
 
-	std::string DxfReader::LookupMLeaderStyleName(int handle)
+	std::string DxfReader::LookupMLeaderStyleName(Handle handle)
 	{
 		auto it = m_MLeaderStyleHandleTable.find(handle);
 		if (it != m_MLeaderStyleHandleTable.end())
 			return it->second;
-		PRINT_DEBUG_INFO("Can't convert handle 0x%X to MLeaderStyle name", handle);
+		PRINT_DEBUG_INFO("Can't convert handle 0x%llX to MLeaderStyle name", handle);
 		return std::string();
 	}
 
-	std::string DxfReader::LookupLinetypeName(int handle)
+	std::string DxfReader::LookupLinetypeName(Handle handle)
 	{
 		auto it = m_LinetypeHandleTable.find(handle);
 		if (it != m_LinetypeHandleTable.end())
 			return it->second;
-		PRINT_DEBUG_INFO("Can't convert handle 0x%X to Linetype name", handle);
+		PRINT_DEBUG_INFO("Can't convert handle 0x%llX to Linetype name", handle);
 		return std::string();
 	}
 
-	std::string DxfReader::LookupTableStyleName(int handle)
+	std::string DxfReader::LookupTableStyleName(Handle handle)
 	{
 		auto it = m_TableStyleHandleTable.find(handle);
 		if (it != m_TableStyleHandleTable.end())
 			return it->second;
-		PRINT_DEBUG_INFO("Can't convert handle 0x%X to TableStyle name", handle);
+		PRINT_DEBUG_INFO("Can't convert handle 0x%llX to TableStyle name", handle);
 		return std::string();
 	}
 
@@ -1696,20 +2460,20 @@ namespace DXF
 
 		for (auto pair : m_ToBeConvertedReactors)
 		{
-			int handle = pair.first;
-			auto ent = m_Graph.FindEntity(handle);
+			Handle handle = pair.first;
+			auto ent = FindEntity(handle);
 			if (ent != nullptr)
 			{
 				for (auto reactorHandle : pair.second)
 				{
-					auto reactor = m_Graph.FindEntity(reactorHandle);
+					auto reactor = FindEntity(reactorHandle);
 					if (reactor != nullptr)
 					{
 						ent->m_Reactors.push_back(reactor);
 					}
 					else
 					{
-						PRINT_DEBUG_INFO("Can't convert handle 0x%X to Reactor", reactorHandle);
+						PRINT_DEBUG_INFO("Can't convert handle 0x%llX to Reactor", reactorHandle);
 					}
 				}
 			}
@@ -1717,58 +2481,58 @@ namespace DXF
 
 		for (auto pair : m_ToBeConvertedViewportClipEnts)
 		{
-			int handle = pair.first;
-			auto vp = std::dynamic_pointer_cast<AcadViewport>(m_Graph.FindEntity(handle));
+			Handle handle = pair.first;
+			auto vp = std::dynamic_pointer_cast<AcadViewport>(FindEntity(handle));
 			if (vp != nullptr)
 			{
-				int clipEntHandle = pair.second;
-				auto clipEnt = m_Graph.FindEntity(clipEntHandle);
+				Handle clipEntHandle = pair.second;
+				auto clipEnt = FindEntity(clipEntHandle);
 				if (clipEnt != nullptr)
 				{
 					vp->m_ClipEnt = clipEnt;
 				}
 				else
 				{
-					PRINT_DEBUG_INFO("Can't convert handle 0x%X to Clip entity", clipEntHandle);
+					PRINT_DEBUG_INFO("Can't convert handle 0x%llX to Clip entity", clipEntHandle);
 				}
 			}
 		}
 
 		for (auto pair : m_ToBeConvertedLeaderAnnotation)
 		{
-			int handle = pair.first;
-			auto leader = std::dynamic_pointer_cast<AcadLeader>(m_Graph.FindEntity(handle));
+			Handle handle = pair.first;
+			auto leader = std::dynamic_pointer_cast<AcadLeader>(FindEntity(handle));
 			if (leader != nullptr)
 			{
-				int annotationHandle = pair.second;
-				auto annotation = m_Graph.FindEntity(annotationHandle);
+				Handle annotationHandle = pair.second;
+				auto annotation = FindEntity(annotationHandle);
 				if (annotation != nullptr)
 				{
 					leader->m_Annotation = annotation;
 				}
 				else
 				{
-					PRINT_DEBUG_INFO("Can't convert handle 0x%X to Annotation", annotationHandle);
+					PRINT_DEBUG_INFO("Can't convert handle 0x%llX to Annotation", annotationHandle);
 				}
 			}
 		}
 
 		for (auto pair : m_ToBeConvertedMLeaderAttDefs)
 		{
-			int handle = pair.first;
-			auto mleader = std::dynamic_pointer_cast<AcadMLeader>(m_Graph.FindEntity(handle));
+			Handle handle = pair.first;
+			auto mleader = std::dynamic_pointer_cast<AcadMLeader>(FindEntity(handle));
 			if (mleader != nullptr)
 			{
 				for (auto attDefHandle : pair.second)
 				{
-					auto attDef = std::dynamic_pointer_cast<AcadAttDef>(m_Graph.FindEntity(attDefHandle));
+					auto attDef = std::dynamic_pointer_cast<AcadAttDef>(FindEntity(attDefHandle));
 					if (attDef != nullptr)
 					{
 						mleader->m_AttrDefs.push_back(attDef);
 					}
 					else
 					{
-						PRINT_DEBUG_INFO("Can't convert handle 0x%X to AttDef", attDef);
+						PRINT_DEBUG_INFO("Can't convert handle 0x%llX to AttDef", attDefHandle);
 					}
 				}
 			}
@@ -1776,11 +2540,11 @@ namespace DXF
 
 		for (auto pair : m_ToBeConvertedMLeaderStyleName)
 		{
-			int handle = pair.first;
-			auto mleader = std::dynamic_pointer_cast<AcadMLeader>(m_Graph.FindEntity(handle));
+			Handle handle = pair.first;
+			auto mleader = std::dynamic_pointer_cast<AcadMLeader>(FindEntity(handle));
 			if (mleader != nullptr)
 			{
-				int styleHandle = pair.second;
+				Handle styleHandle = pair.second;
 				string name = LookupMLeaderStyleName(styleHandle);
 				if (!name.empty())
 				{
@@ -1788,18 +2552,18 @@ namespace DXF
 				}
 				else
 				{
-					PRINT_DEBUG_INFO("Can't convert handle 0x%X to MLeaderStyleName", styleHandle);
+					PRINT_DEBUG_INFO("Can't convert handle 0x%llX to MLeaderStyleName", styleHandle);
 				}
 			}
 		}
 
 		for (auto pair : m_ToBeConvertedTableStyleName)
 		{
-			int handle = pair.first;
-			auto table = std::dynamic_pointer_cast<AcadTable>(m_Graph.FindEntity(handle));
+			Handle handle = pair.first;
+			auto table = std::dynamic_pointer_cast<AcadTable>(FindEntity(handle));
 			if (table != nullptr)
 			{
-				int styleHandle = pair.second;
+				Handle styleHandle = pair.second;
 				string name = LookupTableStyleName(styleHandle);
 				if (!name.empty())
 				{
@@ -1807,7 +2571,7 @@ namespace DXF
 				}
 				else
 				{
-					PRINT_DEBUG_INFO("Can't convert handle 0x%X to TableStyleName", styleHandle);
+					PRINT_DEBUG_INFO("Can't convert handle 0x%llX to TableStyleName", styleHandle);
 				}
 			}
 		}
@@ -1817,7 +2581,7 @@ namespace DXF
 			auto it = m_Graph.m_DimStyles.find(pair.first);
 			if (it != m_Graph.m_DimStyles.end())
 			{
-				int styleHandle = pair.second;
+				Handle styleHandle = pair.second;
 				string name = LookupTextStyleName(styleHandle);
 				if (!name.empty())
 				{
@@ -1825,7 +2589,7 @@ namespace DXF
 				}
 				else
 				{
-					PRINT_DEBUG_INFO("Can't convert handle 0x%X to TextStyle", styleHandle);
+					PRINT_DEBUG_INFO("Can't convert handle 0x%llX to TextStyle", styleHandle);
 				}
 			}
 		}
@@ -1835,7 +2599,7 @@ namespace DXF
 			auto it = m_Graph.m_DimStyles.find(pair.first);
 			if (it != m_Graph.m_DimStyles.end())
 			{
-				int blockHandle = pair.second;
+				Handle blockHandle = pair.second;
 				string name = LookupBlockEntryName(blockHandle);
 				int arrowType = GetArrowHeadType(name.c_str());
 				if (!name.empty())
@@ -1845,7 +2609,7 @@ namespace DXF
 				}
 				else
 				{
-					PRINT_DEBUG_INFO("Can't convert handle 0x%X to BlockName", blockHandle);
+					PRINT_DEBUG_INFO("Can't convert handle 0x%llX to BlockName", blockHandle);
 				}
 			}
 		}
@@ -1855,7 +2619,7 @@ namespace DXF
 			auto it = m_Graph.m_DimStyles.find(pair.first);
 			if (it != m_Graph.m_DimStyles.end())
 			{
-				int blockHandle = pair.second;
+				Handle blockHandle = pair.second;
 				string name = LookupBlockEntryName(blockHandle);
 				int arrowType = GetArrowHeadType(name.c_str());
 				if (!name.empty())
@@ -1865,15 +2629,15 @@ namespace DXF
 				}
 				else
 				{
-					PRINT_DEBUG_INFO("Can't convert handle 0x%X to BlockName", blockHandle);
+					PRINT_DEBUG_INFO("Can't convert handle 0x%llX to BlockName", blockHandle);
 				}
 			}
 		}
 
 		for (auto pair : m_ToBeConvertedHatchAssociatedEnts)
 		{
-			int handle = pair.first;
-			auto hatch = std::dynamic_pointer_cast<AcadHatch>(m_Graph.FindEntity(handle));
+			Handle handle = pair.first;
+			auto hatch = std::dynamic_pointer_cast<AcadHatch>(FindEntity(handle));
 			if (hatch != nullptr)
 			{
 				auto list = pair.second;
@@ -1881,14 +2645,14 @@ namespace DXF
 				{
 					auto boundaryEntHandle = handleLoopIndex.first;
 					auto loopIndex = handleLoopIndex.second;
-					auto boundaryEnt = m_Graph.FindEntity(boundaryEntHandle);
+					auto boundaryEnt = FindEntity(boundaryEntHandle);
 					if (boundaryEnt != nullptr)
 					{
 						hatch->AddAssociatedEntity(boundaryEnt, loopIndex);
 					}
 					else
 					{
-						PRINT_DEBUG_INFO("Source handle 0x%X of loop %d : Hatch is invalid.", handle, loopIndex);
+						PRINT_DEBUG_INFO("Source handle 0x%llX of loop %d : Hatch is invalid.", handle, loopIndex);
 					}
 				}
 			}
@@ -1908,20 +2672,19 @@ namespace DXF
 		m_Attribute.m_Lineweight = acLnWtByLayer;
 		m_Attribute.m_ReactorHandles.clear();
 		bool bReactor = false;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 100 && stricmp(buffer, "AcDbEntity") != 0
 				|| num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 67:
-				m_Attribute.m_IsInPaperspace = atoi(buffer) == 1;
+				m_Attribute.m_IsInPaperspace = ToInt(buffer) == 1;
 				break;
 			case 5:
 				m_Attribute.m_Handle = hextoi(buffer);
@@ -1933,13 +2696,13 @@ namespace DXF
 				m_Attribute.m_Linetype = buffer;
 				break;
 			case 62:
-				m_Attribute.m_Color = AcColor(atol(buffer));
+				m_Attribute.m_Color = AcColor(ToInt(buffer));
 				break;
 			case 370:
-				m_Attribute.m_Lineweight = AcLineWeight(atol(buffer));
+				m_Attribute.m_Lineweight = AcLineWeight(ToInt(buffer));
 				break;
 			case 48:
-				m_Attribute.m_LinetypeScale = atof(buffer);
+				m_Attribute.m_LinetypeScale = ToReal(buffer);
 				break;
 			case 102:
 				if (strcmp("{ACAD_REACTORS", buffer) == 0)
@@ -1970,7 +2733,14 @@ namespace DXF
 		pObj->m_Color = m_Attribute.m_Color;
 		pObj->m_Lineweight = m_Attribute.m_Lineweight;
 		pObj->m_LinetypeScale = m_Attribute.m_LinetypeScale;
-		m_ToBeConvertedReactors[m_Attribute.m_Handle] = m_Attribute.m_ReactorHandles;
+		// Most entities have no reactors, ConvertHandle needn't look them up.
+		if (!m_Attribute.m_ReactorHandles.empty())
+			m_ToBeConvertedReactors[m_Attribute.m_Handle] = m_Attribute.m_ReactorHandles;
+	}
+
+	std::shared_ptr<EntAttribute> DxfReader::FindEntity(Handle handle)
+	{
+		return m_pIndexer ? m_pIndexer->Find(handle) : m_Graph.FindEntity(handle);
 	}
 
 	void DxfReader::Reset()
@@ -1981,6 +2751,13 @@ namespace DXF
 		m_LinetypeHandleTable.clear();
 		m_TableStyleHandleTable.clear();
 		//m_ConvertHandlePtrFunctors.clear();
+		ClearToBeConverted();
+		m_BlockExtents.clear();
+		m_LazyLayerIndexes.clear();
+	}
+
+	void DxfReader::ClearToBeConverted()
+	{
 		m_ToBeConvertedReactors.clear();
 		m_ToBeConvertedViewportClipEnts.clear();
 		m_ToBeConvertedLeaderAnnotation.clear();
@@ -1999,31 +2776,30 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pArc = std::make_shared<AcadArc>();
 		SetAttribute(pArc.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 10:
-				pArc->m_Center.x = atof(buffer);
+				pArc->m_Center.x = ToReal(buffer);
 				break;
 			case 20:
-				pArc->m_Center.y = atof(buffer);
+				pArc->m_Center.y = ToReal(buffer);
 				break;
 			case 40:
-				pArc->m_Radius = atof(buffer);
+				pArc->m_Radius = ToReal(buffer);
 				break;
 			case 50:
-				pArc->m_StartAngle = atof(buffer);
+				pArc->m_StartAngle = ToReal(buffer);
 				break;
 			case 51:
-				pArc->m_EndAngle = atof(buffer);
+				pArc->m_EndAngle = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2039,46 +2815,45 @@ namespace DXF
 		auto pAttDef = std::make_shared<AcadAttDef>();
 		SetAttribute(pAttDef.get());
 		bool bFirst280 = true;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 10:
-				pAttDef->m_BaseLeftPoint.x = atof(buffer);
+				pAttDef->m_BaseLeftPoint.x = ToReal(buffer);
 				break;
 			case 20:
-				pAttDef->m_BaseLeftPoint.y = atof(buffer);
+				pAttDef->m_BaseLeftPoint.y = ToReal(buffer);
 				break;
 			case 11:
-				pAttDef->m_InsertionPoint.x = atof(buffer);
+				pAttDef->m_InsertionPoint.x = ToReal(buffer);
 				break;
 			case 21:
-				pAttDef->m_InsertionPoint.y = atof(buffer);
+				pAttDef->m_InsertionPoint.y = ToReal(buffer);
 				break;
 			case 40:
-				pAttDef->m_TextHeight = atof(buffer);
+				pAttDef->m_TextHeight = ToReal(buffer);
 				break;
 			case 50:
-				pAttDef->m_RotationAngle = atof(buffer);
+				pAttDef->m_RotationAngle = ToReal(buffer);
 				break;
 			case 7:
 				pAttDef->m_TextStyle = buffer;
 				break;
 			case 72:
-				pAttDef->m_HorAlign = atoi(buffer);
+				pAttDef->m_HorAlign = ToInt(buffer);
 				break;
 			case 280:
 				if (bFirst280)
 					bFirst280 = false;
 				else
-					pAttDef->m_DuplicateFlag = atoi(buffer);
+					pAttDef->m_DuplicateFlag = ToInt(buffer);
 				break;
 			case 1:
 				pAttDef->m_Text = buffer;
@@ -2090,10 +2865,10 @@ namespace DXF
 				pAttDef->m_Prompt = buffer;
 				break;
 			case 70:
-				pAttDef->m_Flags = AcAttributeMode(atoi(buffer));
+				pAttDef->m_Flags = AcAttributeMode(ToInt(buffer));
 				break;
 			case 74:
-				pAttDef->m_VerAlign = atoi(buffer);
+				pAttDef->m_VerAlign = ToInt(buffer);
 				break;
 			default:
 				break;
@@ -2109,46 +2884,45 @@ namespace DXF
 		char buffer[BUFSIZE];
 		SetAttribute(&att);
 		bool bFirst280 = true;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 10:
-				att.m_BaseLeftPoint.x = atof(buffer);
+				att.m_BaseLeftPoint.x = ToReal(buffer);
 				break;
 			case 20:
-				att.m_BaseLeftPoint.y = atof(buffer);
+				att.m_BaseLeftPoint.y = ToReal(buffer);
 				break;
 			case 11:
-				att.m_InsertionPoint.x = atof(buffer);
+				att.m_InsertionPoint.x = ToReal(buffer);
 				break;
 			case 21:
-				att.m_InsertionPoint.y = atof(buffer);
+				att.m_InsertionPoint.y = ToReal(buffer);
 				break;
 			case 40:
-				att.m_TextHeight = atof(buffer);
+				att.m_TextHeight = ToReal(buffer);
 				break;
 			case 50:
-				att.m_RotationAngle = atof(buffer);
+				att.m_RotationAngle = ToReal(buffer);
 				break;
 			case 7:
 				att.m_TextStyle = buffer;
 				break;
 			case 72:
-				att.m_HorAlign = atoi(buffer);
+				att.m_HorAlign = ToInt(buffer);
 				break;
 			case 280:
 				if (bFirst280)
 					bFirst280 = false;
 				else
-					att.m_DuplicateFlag = atoi(buffer);
+					att.m_DuplicateFlag = ToInt(buffer);
 				break;
 			case 1:
 				att.m_Text = buffer;
@@ -2157,10 +2931,10 @@ namespace DXF
 				att.m_Tag = buffer;
 				break;
 			case 70:
-				att.m_Flags = AcAttributeMode(atoi(buffer));
+				att.m_Flags = AcAttributeMode(ToInt(buffer));
 				break;
 			case 74:
-				att.m_VerAlign = atoi(buffer);
+				att.m_VerAlign = ToInt(buffer);
 				break;
 			default:
 				break;
@@ -2187,13 +2961,12 @@ namespace DXF
 		auto pBlock = std::make_shared<AcadBlockInstance>();
 		pBlock->m_Xscale = pBlock->m_Yscale = pBlock->m_Zscale = 1.0;
 		SetAttribute(pBlock.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -2202,25 +2975,25 @@ namespace DXF
 				pBlock->m_Name = buffer;
 				break;
 			case 10:
-				pBlock->m_InsertionPoint.x = atof(buffer);
+				pBlock->m_InsertionPoint.x = ToReal(buffer);
 				break;
 			case 20:
-				pBlock->m_InsertionPoint.y = atof(buffer);
+				pBlock->m_InsertionPoint.y = ToReal(buffer);
 				break;
 			case 11:
-				pBlock->m_InsertionPoint.x = atof(buffer);
+				pBlock->m_InsertionPoint.x = ToReal(buffer);
 				break;
 			case 21:
-				pBlock->m_InsertionPoint.y = atof(buffer);
+				pBlock->m_InsertionPoint.y = ToReal(buffer);
 				break;
 			case 41:
-				pBlock->m_Xscale = atof(buffer);
+				pBlock->m_Xscale = ToReal(buffer);
 				break;
 			case 42:
-				pBlock->m_Yscale = atof(buffer);
+				pBlock->m_Yscale = ToReal(buffer);
 				break;
 			case 50:
-				pBlock->m_RotationAngle = atof(buffer);
+				pBlock->m_RotationAngle = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2236,25 +3009,24 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pCircle = std::make_shared<AcadCircle>();
 		SetAttribute(pCircle.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 10:
-				pCircle->m_Center.x = atof(buffer);
+				pCircle->m_Center.x = ToReal(buffer);
 				break;
 			case 20:
-				pCircle->m_Center.y = atof(buffer);
+				pCircle->m_Center.y = ToReal(buffer);
 				break;
 			case 40:
-				pCircle->m_Radius = atof(buffer);
+				pCircle->m_Radius = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2270,13 +3042,12 @@ namespace DXF
 		int type = 0; //当不存在subtype时，缺省为转角标注
 		CDblPoint defPoint;
 		CDblPoint textPoint;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 100 && stricmp(buffer, "AcDbDimension") != 0 || num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -2285,20 +3056,20 @@ namespace DXF
 				m_Attribute.m_BlockName = buffer;
 				break;
 			case 10:
-				m_Attribute.m_DefPoint.x = atof(buffer);
+				m_Attribute.m_DefPoint.x = ToReal(buffer);
 				break;
 			case 20:
-				m_Attribute.m_DefPoint.y = atof(buffer);
+				m_Attribute.m_DefPoint.y = ToReal(buffer);
 				break;
 			case 11:
-				m_Attribute.m_TextPosition.x = atof(buffer);
+				m_Attribute.m_TextPosition.x = ToReal(buffer);
 				m_Attribute.m_ValidMembersFlag[TEXTPOSITION] = true;
 				break;
 			case 21:
-				m_Attribute.m_TextPosition.y = atof(buffer);
+				m_Attribute.m_TextPosition.y = ToReal(buffer);
 				break;
 			case 70:
-				m_Attribute.m_DimType = atoi(buffer);
+				m_Attribute.m_DimType = ToInt(buffer);
 				break;
 			case 1:
 				m_Attribute.OverrideText(buffer);
@@ -2307,7 +3078,7 @@ namespace DXF
 				m_Attribute.m_DimStyleName = buffer;
 				break;
 			case 53:
-				m_Attribute.OverrideTextRotation(atof(buffer));
+				m_Attribute.OverrideTextRotation(ToReal(buffer));
 				break;
 			default:
 				break;
@@ -2364,31 +3135,30 @@ namespace DXF
 		auto pDim = std::make_shared<AcadDimAln>();
 		SetAttribute(pDim.get());
 		SetDimCommon(pDim.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 13:
-				pDim->m_ExtLine1Point.x = atof(buffer);
+				pDim->m_ExtLine1Point.x = ToReal(buffer);
 				break;
 			case 23:
-				pDim->m_ExtLine1Point.y = atof(buffer);
+				pDim->m_ExtLine1Point.y = ToReal(buffer);
 				break;
 			case 14:
-				pDim->m_ExtLine2Point.x = atof(buffer);
+				pDim->m_ExtLine2Point.x = ToReal(buffer);
 				break;
 			case 24:
-				pDim->m_ExtLine2Point.y = atof(buffer);
+				pDim->m_ExtLine2Point.y = ToReal(buffer);
 				break;
 			case 50:
-				pDim->m_RotationAngle = atof(buffer);
+				pDim->m_RotationAngle = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2404,28 +3174,27 @@ namespace DXF
 		auto pDim = std::make_shared<AcadDimOrd>();
 		SetAttribute(pDim.get());
 		SetDimCommon(pDim.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 13:
-				pDim->m_OrdPoint.x = atof(buffer);
+				pDim->m_OrdPoint.x = ToReal(buffer);
 				break;
 			case 23:
-				pDim->m_OrdPoint.y = atof(buffer);
+				pDim->m_OrdPoint.y = ToReal(buffer);
 				break;
 			case 14:
-				pDim->m_LeaderPoint.x = atof(buffer);
+				pDim->m_LeaderPoint.x = ToReal(buffer);
 				break;
 			case 24:
-				pDim->m_LeaderPoint.y = atof(buffer);
+				pDim->m_LeaderPoint.y = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2441,31 +3210,30 @@ namespace DXF
 		auto pDim = std::make_shared<AcadDimRot>();
 		SetAttribute(pDim.get());
 		SetDimCommon(pDim.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 13:
-				pDim->m_ExtLine1Point.x = atof(buffer);
+				pDim->m_ExtLine1Point.x = ToReal(buffer);
 				break;
 			case 23:
-				pDim->m_ExtLine1Point.y = atof(buffer);
+				pDim->m_ExtLine1Point.y = ToReal(buffer);
 				break;
 			case 14:
-				pDim->m_ExtLine2Point.x = atof(buffer);
+				pDim->m_ExtLine2Point.x = ToReal(buffer);
 				break;
 			case 24:
-				pDim->m_ExtLine2Point.y = atof(buffer);
+				pDim->m_ExtLine2Point.y = ToReal(buffer);
 				break;
 			case 50:
-				pDim->m_RotationAngle = atof(buffer);
+				pDim->m_RotationAngle = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2481,25 +3249,24 @@ namespace DXF
 		auto pDim = std::make_shared<AcadDimDia>();
 		SetAttribute(pDim.get());
 		SetDimCommon(pDim.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 15:
-				pDim->m_ChordPoint.x = atof(buffer);
+				pDim->m_ChordPoint.x = ToReal(buffer);
 				break;
 			case 25:
-				pDim->m_ChordPoint.y = atof(buffer);
+				pDim->m_ChordPoint.y = ToReal(buffer);
 				break;
 			case 40:
-				pDim->m_LeaderLength = atof(buffer);
+				pDim->m_LeaderLength = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2515,25 +3282,24 @@ namespace DXF
 		auto pDim = std::make_shared<AcadDimRad>();
 		SetAttribute(pDim.get());
 		SetDimCommon(pDim.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 15:
-				pDim->m_ChordPoint.x = atof(buffer);
+				pDim->m_ChordPoint.x = ToReal(buffer);
 				break;
 			case 25:
-				pDim->m_ChordPoint.y = atof(buffer);
+				pDim->m_ChordPoint.y = ToReal(buffer);
 				break;
 			case 40:
-				pDim->m_LeaderLength = atof(buffer);
+				pDim->m_LeaderLength = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2549,34 +3315,33 @@ namespace DXF
 		auto pDim = std::make_shared<AcadDimAng3P>();
 		SetAttribute(pDim.get());
 		SetDimCommon(pDim.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 13:
-				pDim->m_FirstEnd.x = atof(buffer);
+				pDim->m_FirstEnd.x = ToReal(buffer);
 				break;
 			case 23:
-				pDim->m_FirstEnd.y = atof(buffer);
+				pDim->m_FirstEnd.y = ToReal(buffer);
 				break;
 			case 14:
-				pDim->m_SecondEnd.x = atof(buffer);
+				pDim->m_SecondEnd.x = ToReal(buffer);
 				break;
 			case 24:
-				pDim->m_SecondEnd.y = atof(buffer);
+				pDim->m_SecondEnd.y = ToReal(buffer);
 				break;
 			case 15:
-				pDim->m_AngleVertex.x = atof(buffer);
+				pDim->m_AngleVertex.x = ToReal(buffer);
 				break;
 			case 25:
-				pDim->m_AngleVertex.y = atof(buffer);
+				pDim->m_AngleVertex.y = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2592,34 +3357,33 @@ namespace DXF
 		auto pDim = std::make_shared<AcadDimAng>();
 		SetAttribute(pDim.get());
 		SetDimCommon(pDim.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 13:
-				pDim->m_FirstStart.x = atof(buffer);
+				pDim->m_FirstStart.x = ToReal(buffer);
 				break;
 			case 23:
-				pDim->m_FirstStart.y = atof(buffer);
+				pDim->m_FirstStart.y = ToReal(buffer);
 				break;
 			case 14:
-				pDim->m_FirstEnd.x = atof(buffer);
+				pDim->m_FirstEnd.x = ToReal(buffer);
 				break;
 			case 24:
-				pDim->m_FirstEnd.y = atof(buffer);
+				pDim->m_FirstEnd.y = ToReal(buffer);
 				break;
 			case 15:
-				pDim->m_SecondStart.x = atof(buffer);
+				pDim->m_SecondStart.x = ToReal(buffer);
 				break;
 			case 25:
-				pDim->m_SecondStart.x = atof(buffer);
+				pDim->m_SecondStart.x = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2634,37 +3398,36 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pEllipse = std::make_shared<AcadEllipse>();
 		SetAttribute(pEllipse.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 10:
-				pEllipse->m_Center.x = atof(buffer);
+				pEllipse->m_Center.x = ToReal(buffer);
 				break;
 			case 20:
-				pEllipse->m_Center.y = atof(buffer);
+				pEllipse->m_Center.y = ToReal(buffer);
 				break;
 			case 11:
-				pEllipse->m_MajorAxisPoint.x = atof(buffer);
+				pEllipse->m_MajorAxisPoint.x = ToReal(buffer);
 				break;
 			case 21:
-				pEllipse->m_MajorAxisPoint.y = atof(buffer);
+				pEllipse->m_MajorAxisPoint.y = ToReal(buffer);
 				break;
 			case 40:
-				pEllipse->m_MinorAxisRatio = atof(buffer);
+				pEllipse->m_MinorAxisRatio = ToReal(buffer);
 				break;
 			case 41:
-				pEllipse->m_StartAngle = atof(buffer);
+				pEllipse->m_StartAngle = ToReal(buffer);
 				break;
 			case 42:
-				pEllipse->m_EndAngle = atof(buffer);
+				pEllipse->m_EndAngle = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2680,13 +3443,12 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pHatch = std::make_shared<AcadHatch>();
 		SetAttribute(pHatch.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -2697,36 +3459,44 @@ namespace DXF
 					pHatch->m_PatternName = pHatch->m_PatternName.substr(0, pHatch->m_PatternName.length() - 3);
 				break;
 			case 70:
-				pHatch->m_FillFlag = (AcadHatch::FillFlag)atoi(buffer);
+				pHatch->m_FillFlag = (AcadHatch::FillFlag)ToInt(buffer);
 				break;
 			case 71:
 				// 关联性标志（关联 = 1；无关联 = 0）；
 				break;
 			case 75:
-				pHatch->m_HatchStyle = (AcHatchStyle)atol(buffer);
+				pHatch->m_HatchStyle = (AcHatchStyle)ToInt(buffer);
 				break;
 			case 76:
-				pHatch->m_PatternType = (AcPatternType)atol(buffer);
+				pHatch->m_PatternType = (AcPatternType)ToInt(buffer);
 				break;
 			case 52:
-				pHatch->m_PatternAngle = atof(buffer);
+				pHatch->m_PatternAngle = ToReal(buffer);
 				break;
 			case 41:
-				pHatch->m_PatternScale = atof(buffer);
+				pHatch->m_PatternScale = ToReal(buffer);
 				break;
 			case 91:
 			{
 				// 解析边界路径
-				int loopCount = atoi(buffer);
+				int loopCount = ToInt(buffer);
 				// loopIndex == -1, outer loop; loopIndex >=0, inner loops
 				int loopIndex = -2;
 				BoundaryEntType entType;
 				BoundaryPathFlag pathFlag;
 				CDblPoint point1, point2;
 				int entCount;
-				while (!m_DxfFile.fail())
+				// Declared out of the loop, the pointers must survive between pairs.
+				union
+				{
+					AcadLWPLine* pLWPLine;
+					AcadLine* pLine;
+					AcadArc* pArc;
+					AcadEllipse* pEllipseArc;
+					AcadSpline* pSpline;
+				};
+				while (!m_Tokenizer.fail())
 				{
-					pos = m_DxfFile.tellg();
 					ReadPair(num, buffer);
 					// Last boundary loop
 					if (loopIndex == loopCount - 2)
@@ -2734,24 +3504,16 @@ namespace DXF
 						if (num == 75 || num == 76 || num == 70 || num == 71 || num == 52 || num == 41 || num == 77 || num == 78)
 						{
 							// 如果遇到这些属于Hatch但不属于边界路径的code，必须结束边界路径解析。
-							m_DxfFile.seekg(pos);
+							PutBackPair(num, buffer);
 							break;
 						}
 					}
 					if (num == 0)
 					{
 						// 边界路径解析没能在上面的情形退出，那么至少在遇到0时必须退出。一般不会发生这种情况。
-						m_DxfFile.seekg(pos);
+						PutBackPair(num, buffer);
 						break;
 					}
-					union
-					{
-						AcadLWPLine* pLWPLine;
-						AcadLine* pLine;
-						AcadArc* pArc;
-						AcadEllipse* pEllipseArc;
-						AcadSpline* pSpline;
-					};
 					switch (num)
 					{
 						// 边界路径类型标志（按位编码）：
@@ -2760,7 +3522,7 @@ namespace DXF
 					case 92:
 						++loopIndex;
 						pLWPLine = nullptr; // This clears all union members.
-						pathFlag = BoundaryPathFlag(atoi(buffer));
+						pathFlag = BoundaryPathFlag(ToInt(buffer));
 						if (loopIndex == -1)
 							pHatch->m_OuterFlag = pathFlag;
 						else
@@ -2775,7 +3537,7 @@ namespace DXF
 						// 该边界路径中的边数（仅当边界不是多段线时）
 						// 多段线顶点数
 					case 93:
-						entCount = atoi(buffer);
+						entCount = ToInt(buffer);
 						break;
 						// 源边界对象数/样条曲线拟合数据数目
 					case 97:
@@ -2783,7 +3545,7 @@ namespace DXF
 						// 330 - 源边界对象的参照（多个条目）
 					case 330:
 					{
-						int handle = hextoi(buffer);
+						Handle handle = hextoi(buffer);
 						m_ToBeConvertedHatchAssociatedEnts[pHatch->m_Handle].push_back(std::make_pair(handle, loopIndex));
 					}
 					break;
@@ -2793,7 +3555,7 @@ namespace DXF
 					case 72:
 						if ((pathFlag & BoundaryPathFlag::LWPline) == 0)
 						{
-							entType = BoundaryEntType(atoi(buffer));
+							entType = BoundaryEntType(ToInt(buffer));
 							--entCount;
 							switch (entType)
 							{
@@ -2831,11 +3593,11 @@ namespace DXF
 					case 73:
 						if (pathFlag & BoundaryPathFlag::LWPline)
 						{
-							pLWPLine->m_Closed = atoi(buffer) != 0;
+							pLWPLine->m_Closed = ToInt(buffer) != 0;
 						}
 						else if (entType == BoundaryEntType::Spline)
 						{
-							int value = atoi(buffer);
+							int value = ToInt(buffer);
 							if (value)
 								pSpline->m_Flag |= 4;
 						}
@@ -2843,7 +3605,7 @@ namespace DXF
 					case 74:
 						if (entType == BoundaryEntType::Spline)
 						{
-							int value = atoi(buffer);
+							int value = ToInt(buffer);
 							if (value)
 								pSpline->m_Flag |= 4;
 						}
@@ -2854,10 +3616,10 @@ namespace DXF
 						break;
 						// 多段线顶点/线段起点/[椭]圆弧中心/样条曲线控制点（在 OCS 中）
 					case 10:
-						point1.x = atof(buffer);
+						point1.x = ToReal(buffer);
 						break;
 					case 20:
-						point1.y = atof(buffer);
+						point1.y = ToReal(buffer);
 						if (pathFlag & BoundaryPathFlag::LWPline)
 						{
 							pLWPLine->m_Vertices.push_back(point1);
@@ -2881,10 +3643,10 @@ namespace DXF
 						break;
 						// 线段终点/椭圆相对于中心点的长轴端点/样条线拟合点（在 OCS 中）
 					case 11:
-						point2.x = atof(buffer);
+						point2.x = ToReal(buffer);
 						break;
 					case 21:
-						point2.y = atof(buffer);
+						point2.y = ToReal(buffer);
 						if (entType == BoundaryEntType::Line)
 						{
 							pLine->m_EndPoint = point2;
@@ -2901,69 +3663,69 @@ namespace DXF
 					case 12:
 						if (entType == BoundaryEntType::Spline)
 						{
-							pSpline->m_StartTangent.x = atof(buffer);
+							pSpline->m_StartTangent.x = ToReal(buffer);
 						}
 						break;
 					case 22:
 						if (entType == BoundaryEntType::Spline)
 						{
-							pSpline->m_StartTangent.y = atof(buffer);
+							pSpline->m_StartTangent.y = ToReal(buffer);
 						}
 						break;
 					case 13:
 						if (entType == BoundaryEntType::Spline)
 						{
-							pSpline->m_EndTangent.x = atof(buffer);
+							pSpline->m_EndTangent.x = ToReal(buffer);
 						}
 						break;
 					case 23:
 						if (entType == BoundaryEntType::Spline)
 						{
-							pSpline->m_EndTangent.y = atof(buffer);
+							pSpline->m_EndTangent.y = ToReal(buffer);
 						}
 						break;
 						// 多段线凸度（可选；默认值 = 0）
 					case 42:
 						if (pathFlag & BoundaryPathFlag::LWPline)
 						{
-							pLWPLine->SetBulge(pLWPLine->m_Vertices.size() - 1, atof(buffer));
+							pLWPLine->SetBulge(pLWPLine->m_Vertices.size() - 1, ToReal(buffer));
 						}
 						break;
 						// 圆的半径/短轴的长度（占长轴长度的比例）/节点值（多个条目）
 					case 40:
 						if (entType == BoundaryEntType::Arc)
 						{
-							pArc->m_Radius = atof(buffer);
+							pArc->m_Radius = ToReal(buffer);
 						}
 						else if (entType == BoundaryEntType::EllipseArc)
 						{
-							pEllipseArc->m_MinorAxisRatio = atof(buffer);
+							pEllipseArc->m_MinorAxisRatio = ToReal(buffer);
 						}
 						else if (entType == BoundaryEntType::Spline)
 						{
-							pSpline->m_Knots.push_back(atof(buffer));
+							pSpline->m_Knots.push_back(ToReal(buffer));
 						}
 						break;
 						// 起点角度
 					case 50:
 						if (entType == BoundaryEntType::Arc)
 						{
-							pArc->m_StartAngle = atof(buffer);
+							pArc->m_StartAngle = ToReal(buffer);
 						}
 						else if (entType == BoundaryEntType::EllipseArc)
 						{
-							pEllipseArc->m_StartAngle = atof(buffer);
+							pEllipseArc->m_StartAngle = ToReal(buffer);
 						}
 						break;
 						// 终点角度
 					case 51:
 						if (entType == BoundaryEntType::Arc)
 						{
-							pArc->m_EndAngle = atof(buffer);
+							pArc->m_EndAngle = ToReal(buffer);
 						}
 						else if (entType == BoundaryEntType::EllipseArc)
 						{
-							pEllipseArc->m_EndAngle = atof(buffer);
+							pEllipseArc->m_EndAngle = ToReal(buffer);
 						}
 						break;
 					}
@@ -2971,7 +3733,7 @@ namespace DXF
 			}
 			break;
 			case 47:
-				pHatch->m_PixelSize = atof(buffer);
+				pHatch->m_PixelSize = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -2987,13 +3749,12 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pLeader = std::make_shared<AcadLeader>();
 		SetAttribute(pLeader.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -3002,31 +3763,31 @@ namespace DXF
 				pLeader->m_StyleName = buffer;
 				break;
 			case 71:
-				pLeader->m_Type = AcLeaderType(pLeader->m_Type & (atoi(buffer) << 1));
+				pLeader->m_Type = AcLeaderType(pLeader->m_Type & (ToInt(buffer) << 1));
 				break;
 			case 72:
-				pLeader->m_Type = AcLeaderType(pLeader->m_Type & atoi(buffer));
+				pLeader->m_Type = AcLeaderType(pLeader->m_Type & ToInt(buffer));
 				break;
 			case 10:
-				pLeader->m_Vertices.push_back(CDblPoint(atof(buffer), 0));
+				pLeader->m_Vertices.push_back(CDblPoint(ToReal(buffer), 0));
 				break;
 			case 20:
-				pLeader->m_Vertices[pLeader->m_Vertices.size() - 1].y = atof(buffer);
+				pLeader->m_Vertices[pLeader->m_Vertices.size() - 1].y = ToReal(buffer);
 				break;
 			case 40:
-				pLeader->m_CharHeight = atof(buffer);
+				pLeader->m_CharHeight = ToReal(buffer);
 				break;
 			case 41:
-				pLeader->m_TextWidth = atof(buffer);
+				pLeader->m_TextWidth = ToReal(buffer);
 				break;
 			case 340:
 			{
-				int handle = hextoi(buffer);
+				Handle handle = hextoi(buffer);
 				m_ToBeConvertedLeaderAnnotation[pLeader->m_Handle] = handle;
 			}
 			break;
 			case 1040:
-				pLeader->m_ArrowSize = atof(buffer);
+				pLeader->m_ArrowSize = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -3043,13 +3804,12 @@ namespace DXF
 		auto pLeader = std::make_shared<AcadMLeader>();
 		SetAttribute(pLeader.get());
 		ReadContextData(pLeader->m_ContextData);
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -3059,25 +3819,25 @@ namespace DXF
 				m_ToBeConvertedMLeaderStyleName[pLeader->m_Handle] = hextoi(buffer);
 				break;
 			case 170:
-				pLeader->m_LeaderType = AcMLeaderType(atoi(buffer));
+				pLeader->m_LeaderType = AcMLeaderType(ToInt(buffer));
 				break;
 			case 341:
 				pLeader->m_LineType = LookupLinetypeName(hextoi(buffer));
 				break;
 			case 171:
-				pLeader->m_LineWeight = AcLineWeight(atoi(buffer));
+				pLeader->m_LineWeight = AcLineWeight(ToInt(buffer));
 				break;
 			case 290:
-				pLeader->m_EnableLanding = !!atoi(buffer);
+				pLeader->m_EnableLanding = !!ToInt(buffer);
 				break;
 			case 291:
-				pLeader->m_EnableDogleg = !!atoi(buffer);
+				pLeader->m_EnableDogleg = !!ToInt(buffer);
 				break;
 				//case 41:
-				//	pLeader->m_DoglegLength = atof(buffer);
+				//	pLeader->m_DoglegLength = ToReal(buffer);
 				//	break;
 				//case 42:
-				//	pLeader->m_ArrowSize = atof(buffer);
+				//	pLeader->m_ArrowSize = ToReal(buffer);
 				//	break;
 				//case 343:
 				//	pLeader->m_TextStyle = LookupTextStyleName(hextoi(buffer));
@@ -3099,7 +3859,7 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			// Begin of CONTEXT_DATA
@@ -3118,7 +3878,7 @@ namespace DXF
 			ReadMTextPart(*static_cast<MTextPart*>(cd.m_Content.get()));
 		}
 		ReadLeaderPart(cd.m_Leader);
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			// End of CONTEXT_DATA
@@ -3131,7 +3891,7 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			if (num == 303)
@@ -3144,13 +3904,13 @@ namespace DXF
 			switch (num)
 			{
 			case 10:
-				leader.m_CommonPoint.x = atof(buffer);
+				leader.m_CommonPoint.x = ToReal(buffer);
 				break;
 			case 20:
-				leader.m_CommonPoint.y = atof(buffer);
+				leader.m_CommonPoint.y = ToReal(buffer);
 				break;
 			case 40:
-				leader.m_DoglegLength = atof(buffer);
+				leader.m_DoglegLength = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -3162,7 +3922,7 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			if (num == 305)
@@ -3171,10 +3931,10 @@ namespace DXF
 			{
 			case 10:
 				leaderLine.m_Points.resize(leaderLine.m_Points.size() + 1);
-				leaderLine.m_Points.back().x = atof(buffer);
+				leaderLine.m_Points.back().x = ToReal(buffer);
 				break;
 			case 20:
-				leaderLine.m_Points.back().y = atof(buffer);
+				leaderLine.m_Points.back().y = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -3184,39 +3944,42 @@ namespace DXF
 
 	ContentType DxfReader::GetContentData(CONTEXT_DATA & cd)
 	{
-		int pos = m_DxfFile.tellg();
 		int num;
 		char buffer[BUFSIZE];
 		ContentType ct = MTEXT_TYPE;
-		while (!m_DxfFile.fail())
+		// The pairs are read again by ReadBlockPart or ReadMTextPart.
+		std::vector<DxfPair> pairs;
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
+			pairs.emplace_back();
+			m_Tokenizer.MakePair(num, buffer, pairs.back());
 			// Start of LEADER
 			if (num == 302)
 				break;
 			switch (num)
 			{
 			case 10:
-				cd.m_LandingPosition.x = atof(buffer);
+				cd.m_LandingPosition.x = ToReal(buffer);
 				break;
 			case 20:
-				cd.m_LandingPosition.y = atof(buffer);
+				cd.m_LandingPosition.y = ToReal(buffer);
 				break;
 			case 41:
-				cd.m_TextHeight = atof(buffer);
+				cd.m_TextHeight = ToReal(buffer);
 				break;
 			case 140:
-				cd.m_ArrowSize = atof(buffer);
+				cd.m_ArrowSize = ToReal(buffer);
 				break;
 			case 145:
-				cd.m_LandingGap = atof(buffer);
+				cd.m_LandingGap = ToReal(buffer);
 				break;
 			case 290:
-				if (atoi(buffer))
+				if (ToInt(buffer))
 					ct = MTEXT_TYPE;
 				break;
 			case 296:
-				if (atoi(buffer))
+				if (ToInt(buffer))
 					ct = BLOCK_TYPE;
 				break;
 			default:
@@ -3224,7 +3987,8 @@ namespace DXF
 			}
 		}
 
-		m_DxfFile.seekg(pos);
+		for (auto it = pairs.rbegin(); it != pairs.rend(); ++it)
+			m_Tokenizer.PutBackPair(*it);
 		return ct;
 	}
 
@@ -3232,7 +3996,7 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			// Start of LEADER
@@ -3244,22 +4008,22 @@ namespace DXF
 				block.m_BlockName = LookupBlockEntryName(hextoi(buffer));
 				break;
 			case 93:
-				block.m_BlockColor = AcColor(atoi(buffer));
+				block.m_BlockColor = AcColor(ToInt(buffer));
 				break;
 			case 15:
-				block.m_BlockPosition.x = atof(buffer);
+				block.m_BlockPosition.x = ToReal(buffer);
 				break;
 			case 25:
-				block.m_BlockPosition.y = atof(buffer);
+				block.m_BlockPosition.y = ToReal(buffer);
 				break;
 			case 16:
-				block.m_BlockScale.x = atof(buffer);
+				block.m_BlockScale.x = ToReal(buffer);
 				break;
 			case 26:
-				block.m_BlockScale.y = atof(buffer);
+				block.m_BlockScale.y = ToReal(buffer);
 				break;
 			case 46:
-				block.m_BlockRotation = atof(buffer);
+				block.m_BlockRotation = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -3271,7 +4035,7 @@ namespace DXF
 	{
 		int num;
 		char buffer[BUFSIZE];
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
 			ReadPair(num, buffer);
 			// Start of LEADER
@@ -3283,25 +4047,25 @@ namespace DXF
 				mtext.m_Text = buffer;
 				break;
 			case 43:
-				mtext.m_TextWidth = atof(buffer);
+				mtext.m_TextWidth = ToReal(buffer);
 				break;
 			case 340:
 				mtext.m_TextStyle = LookupTextStyleName(hextoi(buffer));
 				break;
 			case 90:
-				mtext.m_TextColor = AcColor(atoi(buffer));
+				mtext.m_TextColor = AcColor(ToInt(buffer));
 				break;
 			case 12:
-				mtext.m_TextLocation.x = atof(buffer);
+				mtext.m_TextLocation.x = ToReal(buffer);
 				break;
 			case 22:
-				mtext.m_TextLocation.y = atof(buffer);
+				mtext.m_TextLocation.y = ToReal(buffer);
 				break;
 			case 42:
-				mtext.m_TextRotation = atof(buffer);
+				mtext.m_TextRotation = ToReal(buffer);
 				break;
 			case 171:
-				mtext.m_AttachmentPoint = AcAttachmentPoint(atoi(buffer));
+				mtext.m_AttachmentPoint = AcAttachmentPoint(ToInt(buffer));
 				break;
 			default:
 				break;
@@ -3315,28 +4079,27 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pLine = std::make_shared<AcadLine>();
 		SetAttribute(pLine.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 10:
-				pLine->m_StartPoint.x = atof(buffer);
+				pLine->m_StartPoint.x = ToReal(buffer);
 				break;
 			case 20:
-				pLine->m_StartPoint.y = atof(buffer);
+				pLine->m_StartPoint.y = ToReal(buffer);
 				break;
 			case 11:
-				pLine->m_EndPoint.x = atof(buffer);
+				pLine->m_EndPoint.x = ToReal(buffer);
 				break;
 			case 21:
-				pLine->m_EndPoint.y = atof(buffer);
+				pLine->m_EndPoint.y = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -3353,38 +4116,37 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pLine = std::make_shared<AcadLWPLine>();
 		SetAttribute(pLine.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 70:
-				pLine->m_Closed = atoi(buffer) & 1;
+				pLine->m_Closed = ToInt(buffer) & 1;
 				break;
 			case 43:
-				pLine->SetConstWidth(atof(buffer));
+				pLine->SetConstWidth(ToReal(buffer));
 				break;
 			case 10:
-				temp = atof(buffer);
+				temp = ToReal(buffer);
 				pLine->m_Vertices.push_back(CDblPoint(temp, 0));
 				break;
 			case 20:
-				pLine->m_Vertices[pLine->m_Vertices.size() - 1].y = atof(buffer);
+				pLine->m_Vertices[pLine->m_Vertices.size() - 1].y = ToReal(buffer);
 				break;
 			case 40:
-				pLine->SetStartWidth(pLine->m_Vertices.size() - 1, atof(buffer));
+				pLine->SetStartWidth(pLine->m_Vertices.size() - 1, ToReal(buffer));
 				break;
 			case 41:
-				pLine->SetEndWidth(pLine->m_Vertices.size() - 1, atof(buffer));
+				pLine->SetEndWidth(pLine->m_Vertices.size() - 1, ToReal(buffer));
 				break;
 			case 42:
-				pLine->SetBulge(pLine->m_Vertices.size() - 1, atof(buffer));
+				pLine->SetBulge(pLine->m_Vertices.size() - 1, ToReal(buffer));
 				break;
 			default:
 				break;
@@ -3401,13 +4163,12 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pMText = std::make_shared<AcadMText>();
 		SetAttribute(pMText.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -3420,35 +4181,35 @@ namespace DXF
 				pMText->m_StyleName = buffer;
 				break;
 			case 10:
-				pMText->m_InsertionPoint.x = atof(buffer);
+				pMText->m_InsertionPoint.x = ToReal(buffer);
 				break;
 			case 20:
-				pMText->m_InsertionPoint.y = atof(buffer);
+				pMText->m_InsertionPoint.y = ToReal(buffer);
 				break;
 			case 11:
-				cosRot = atof(buffer);
+				cosRot = ToReal(buffer);
 				break;
 			case 21:
-				sinRot = atof(buffer);
+				sinRot = ToReal(buffer);
 				pMText->m_RotationAngle = atan2(sinRot, cosRot) * 180.0 / M_PI;
 				break;
 			case 40:
-				pMText->m_CharHeight = atof(buffer);
+				pMText->m_CharHeight = ToReal(buffer);
 				break;
 			case 41:
-				pMText->m_Width = atof(buffer);
+				pMText->m_Width = ToReal(buffer);
 				break;
 			case 44:
-				pMText->m_LineSpacingFactor = atof(buffer);
+				pMText->m_LineSpacingFactor = ToReal(buffer);
 				break;
 			case 50:
-				pMText->m_RotationAngle = atof(buffer);
+				pMText->m_RotationAngle = ToReal(buffer);
 				break;
 			case 71:
-				pMText->m_AttachmentPoint = (AcAttachmentPoint)atol(buffer);
+				pMText->m_AttachmentPoint = (AcAttachmentPoint)ToInt(buffer);
 				break;
 			case 72:
-				pMText->m_DrawingDirection = (AcDrawingDirection)atoi(buffer);
+				pMText->m_DrawingDirection = (AcDrawingDirection)ToInt(buffer);
 				break;
 			default:
 				break;
@@ -3464,22 +4225,21 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pPoint = std::make_shared<AcadPoint>();
 		SetAttribute(pPoint.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 10:
-				pPoint->m_Point.x = atof(buffer);
+				pPoint->m_Point.x = ToReal(buffer);
 				break;
 			case 20:
-				pPoint->m_Point.y = atof(buffer);
+				pPoint->m_Point.y = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -3495,40 +4255,39 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pSolid = std::make_shared<AcadSolid>();
 		SetAttribute(pSolid.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 10:
-				pSolid->m_Point1.x = atof(buffer);
+				pSolid->m_Point1.x = ToReal(buffer);
 				break;
 			case 20:
-				pSolid->m_Point1.y = atof(buffer);
+				pSolid->m_Point1.y = ToReal(buffer);
 				break;
 			case 11:
-				pSolid->m_Point2.x = atof(buffer);
+				pSolid->m_Point2.x = ToReal(buffer);
 				break;
 			case 21:
-				pSolid->m_Point2.y = atof(buffer);
+				pSolid->m_Point2.y = ToReal(buffer);
 				break;
 			case 12:
-				pSolid->m_Point3.x = atof(buffer);
+				pSolid->m_Point3.x = ToReal(buffer);
 				break;
 			case 22:
-				pSolid->m_Point3.y = atof(buffer);
+				pSolid->m_Point3.y = ToReal(buffer);
 				break;
 			case 13:
-				pSolid->m_Point4.x = atof(buffer);
+				pSolid->m_Point4.x = ToReal(buffer);
 				break;
 			case 23:
-				pSolid->m_Point4.y = atof(buffer);
+				pSolid->m_Point4.y = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -3547,61 +4306,60 @@ namespace DXF
 		int numberOfFitPoints;
 		auto pSpline = std::make_shared<AcadSpline>();
 		SetAttribute(pSpline.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 70:
-				pSpline->m_Flag = atoi(buffer);
+				pSpline->m_Flag = ToInt(buffer);
 				break;
 			case 71:
-				pSpline->m_Degree = atoi(buffer);
+				pSpline->m_Degree = ToInt(buffer);
 				break;
 			case 72:
-				numberOfKnots = atoi(buffer);
+				numberOfKnots = ToInt(buffer);
 				break;
 			case 73:
-				numberOfControlPoints = atoi(buffer);
+				numberOfControlPoints = ToInt(buffer);
 				break;
 			case 74:
-				numberOfFitPoints = atoi(buffer);
+				numberOfFitPoints = ToInt(buffer);
 				break;
 			case 12:
-				pSpline->m_StartTangent.x = atof(buffer);
+				pSpline->m_StartTangent.x = ToReal(buffer);
 				break;
 			case 22:
-				pSpline->m_StartTangent.y = atof(buffer);
+				pSpline->m_StartTangent.y = ToReal(buffer);
 				break;
 			case 13:
-				pSpline->m_EndTangent.x = atof(buffer);
+				pSpline->m_EndTangent.x = ToReal(buffer);
 				break;
 			case 23:
-				pSpline->m_EndTangent.y = atof(buffer);
+				pSpline->m_EndTangent.y = ToReal(buffer);
 				break;
 			case 40:
-				pSpline->m_Knots.push_back(atof(buffer));
+				pSpline->m_Knots.push_back(ToReal(buffer));
 				break;
 			case 41:
-				pSpline->m_Weights.push_back(atof(buffer));
+				pSpline->m_Weights.push_back(ToReal(buffer));
 				break;
 			case 10:
-				pSpline->m_ControlPoints.push_back(CDblPoint(atof(buffer), 0));
+				pSpline->m_ControlPoints.push_back(CDblPoint(ToReal(buffer), 0));
 				break;
 			case 20:
-				pSpline->m_ControlPoints[pSpline->m_ControlPoints.size() - 1].y = atof(buffer);
+				pSpline->m_ControlPoints[pSpline->m_ControlPoints.size() - 1].y = ToReal(buffer);
 				break;
 			case 11:
-				pSpline->m_FitPoints.push_back(CDblPoint(atof(buffer), 0));
+				pSpline->m_FitPoints.push_back(CDblPoint(ToReal(buffer), 0));
 				break;
 			case 21:
-				pSpline->m_FitPoints[pSpline->m_FitPoints.size() - 1].y = atof(buffer);
+				pSpline->m_FitPoints[pSpline->m_FitPoints.size() - 1].y = ToReal(buffer);
 				break;
 			default:
 				break;
@@ -3617,13 +4375,12 @@ namespace DXF
 		char buffer[BUFSIZE];
 		auto pText = std::make_shared<AcadText>();
 		SetAttribute(pText.get());
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
@@ -3635,34 +4392,34 @@ namespace DXF
 				pText->m_StyleName = buffer;
 				break;
 			case 10:
-				pText->m_BaseLeftPoint.x = atof(buffer);
+				pText->m_BaseLeftPoint.x = ToReal(buffer);
 				break;
 			case 20:
-				pText->m_BaseLeftPoint.y = atof(buffer);
+				pText->m_BaseLeftPoint.y = ToReal(buffer);
 				break;
 			case 11:
-				pText->m_InsertionPoint.x = atof(buffer);
+				pText->m_InsertionPoint.x = ToReal(buffer);
 				break;
 			case 21:
-				pText->m_InsertionPoint.y = atof(buffer);
+				pText->m_InsertionPoint.y = ToReal(buffer);
 				break;
 			case 40:
-				pText->m_Height = atof(buffer);
+				pText->m_Height = ToReal(buffer);
 				break;
 			case 41:
-				pText->m_WidthFactor = atof(buffer);
+				pText->m_WidthFactor = ToReal(buffer);
 				break;
 			case 50:
-				pText->m_RotationAngle = atof(buffer);
+				pText->m_RotationAngle = ToReal(buffer);
 				break;
 			case 51:
-				pText->SetObliqueAngle(atof(buffer));
+				pText->SetObliqueAngle(ToReal(buffer));
 				break;
 			case 72:
-				pText->m_HorAlign = atol(buffer) & 0x7;
+				pText->m_HorAlign = ToInt(buffer) & 0x7;
 				break;
 			case 73:
-				pText->m_VerAlign = (atol(buffer) & 0x3) << 16;
+				pText->m_VerAlign = (ToInt(buffer) & 0x3) << 16;
 				break;
 			default:
 				break;
@@ -3679,56 +4436,55 @@ namespace DXF
 		auto vp = std::make_shared<AcadViewport>();
 		SetAttribute(vp.get());
 		bool HasClipEnt = false;
-		int clipEntHandle = 0;
+		Handle clipEntHandle = 0;
 		int viewPortID = 0;
-		while (!m_DxfFile.fail())
+		while (!m_Tokenizer.fail())
 		{
-			int pos = m_DxfFile.tellg();
 			ReadPair(num, buffer);
 			if (num == 0)
 			{
-				m_DxfFile.seekg(pos);
+				PutBackPair(num, buffer);
 				break;
 			}
 			switch (num)
 			{
 			case 69:
-				viewPortID = atoi(buffer);
+				viewPortID = ToInt(buffer);
 				break;
 			case 10:
-				vp->m_PaperspaceCenter.x = atof(buffer);
+				vp->m_PaperspaceCenter.x = ToReal(buffer);
 				break;
 			case 20:
-				vp->m_PaperspaceCenter.y = atof(buffer);
+				vp->m_PaperspaceCenter.y = ToReal(buffer);
 				break;
 			case 40:
-				vp->m_PaperspaceWidth = atof(buffer);
+				vp->m_PaperspaceWidth = ToReal(buffer);
 				break;
 			case 41:
-				vp->m_PaperspaceHeight = atof(buffer);
+				vp->m_PaperspaceHeight = ToReal(buffer);
 				break;
 			case 12:
-				vp->m_ModelSpaceCenter.x = atof(buffer);
+				vp->m_ModelSpaceCenter.x = ToReal(buffer);
 				break;
 			case 22:
-				vp->m_ModelSpaceCenter.y = atof(buffer);
+				vp->m_ModelSpaceCenter.y = ToReal(buffer);
 				break;
 			case 45:
-				vp->m_ModelSpaceHeight = atof(buffer);
+				vp->m_ModelSpaceHeight = ToReal(buffer);
 				break;
 			case 51:
-				vp->m_TwistAngle = atof(buffer);
+				vp->m_TwistAngle = ToReal(buffer);
 				break;
 			case 90:
 			{
-				int flag = atoi(buffer);
+				int flag = ToInt(buffer);
 				HasClipEnt = (flag & 0x10000) != 0;
 				vp->m_locked = (flag & 0x4000) != 0;
 			}
 			break;
 			case 340:
 			{
-				int handle = hextoi(buffer);
+				Handle handle = hextoi(buffer);
 				m_ToBeConvertedViewportClipEnts[vp->m_Handle] = handle;
 			}
 			break;
@@ -9,13 +9,21 @@
 ***************************************************************************/
 #pragma once
 
+#include <cstdlib>
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <functional>
+#include <memory>
+#include <future>
 
 #include "AcadEntities.h"
 #include "ImpExpMacro.h"
+#include "DxfTokenizer.h"
+#include "DxfIndex.h"
+#include "DxfProgress.h"
+#include "DxfPipeline.h"
 
 namespace DXF
 {
@@ -25,7 +33,98 @@ namespace DXF
 	struct EntAttribute;
 	struct LayoutData;
 	struct NameHandle;
-	class ifstream;
+
+	// Entities not selected are skipped as soon as they are known to be rejected, their objects aren't created.
+	struct ReadOptions
+	{
+		ReadOptions()
+			: m_ReadModelSpace(true)
+			, m_ReadPaperSpace(true)
+			, m_Lazy(false)
+			, m_UseIndex(false)
+			, m_WriteIndex(false)
+			, m_ProgressInterval(100)
+			, m_Pipelined(false)
+			, m_PipelineBatchSize(1024)
+			, m_PipelineRingSize(16)
+		{
+		}
+		// Types of entities to read, e.g. "TEXT", "MTEXT". Empty means all types.
+		// ATTRIBs are read with their INSERT.
+		std::set<std::string> m_EntityTypes;
+		// Only entities on these layers are read. Empty means all layers.
+		std::set<std::string> m_Layers;
+		// Entities on these layers aren't read.
+		std::set<std::string> m_ExcludedLayers;
+		// Entities of the ENTITIES section in model space and in paper space.
+		// m_ReadPaperSpace also applies to entities of the other layouts.
+		bool m_ReadModelSpace;
+		bool m_ReadPaperSpace;
+		// Return false if entities of the block aren't read, the block is kept empty. Null means all blocks.
+		std::function<bool(const std::string &blockName)> m_BlockFilter;
+		// Only entities of model space intersecting the window are read, no window if it is empty.
+		// Extents of entities are estimated conservatively from their group codes, entities whose
+		// extents can't be estimated, e.g. HATCH and DIMENSION, are always read.
+		CDblRect m_Window;
+		// Entities of model space in the ENTITIES section are only indexed when they are read, they are parsed
+		// by DxfData::LoadEntity or DxfData::LoadAllEntities, and the file stays open until then.
+		// It applies to uncompressed files and memory buffers only, the buffer must be kept until then.
+		// Handles in the other entities, e.g. reactors, aren't converted to lazy entities.
+		bool m_Lazy;
+		// Read the selected entities of the ENTITIES section at their offsets in the index of the file, see DxfIndex,
+		// and skip the blocks not read. The index is ignored if it is missing or the file has changed.
+		bool m_UseIndex;
+		// Write the index of the file after it is read successfully, unless a valid index is used.
+		// Both apply to uncompressed files only.
+		bool m_WriteIndex;
+		// Directory of snapshots of files read, see DxfSnapshot, none if it is empty.
+		// A file is loaded from its snapshot if the content is unchanged, otherwise it is read and the snapshot is saved.
+		// It applies to reading files with all entities, i.e. without filters, window and m_Lazy.
+		// A file loaded from its snapshot isn't parsed, so m_WriteIndex doesn't write its index, and progress
+		// is only reported once at the end.
+		std::string m_SnapshotDir;
+		// Called at most once every m_ProgressInterval milliseconds while reading, at the start of each section
+		// and once at the end. Bytes are counted in the DXF being parsed, i.e. after decompression.
+		ProgressCallback m_Progress;
+		unsigned int m_ProgressInterval;
+		// Checked before each entity and object, reading fails once it is cancelled and graph is reset.
+		std::shared_ptr<CancelToken> m_CancelToken;
+		// Tokenize on another thread and index entities by handle on a third one while entities are parsed,
+		// handles are converted from the index at the end. It doesn't apply to m_Lazy or an index used.
+		// Pairs and entities are passed between the threads in batches of m_PipelineBatchSize,
+		// at most m_PipelineRingSize batches ahead. See DxfReader::GetPipelineStats.
+		bool m_Pipelined;
+		size_t m_PipelineBatchSize;
+		size_t m_PipelineRingSize;
+	};
+
+	// What DxfReader::ProbeDxf finds in a DXF without reading its entities.
+	struct DxfProbe
+	{
+		DxfProbe()
+			: m_LinetypeScale(1.0)
+			, m_HasExtents(false)
+		{
+		}
+		// Values of all header variables, e.g. "$EXTMIN" has the pairs of group code 10, 20 and 30.
+		std::map<std::string, std::vector<DxfPair>> m_Variables;
+		// Taken from m_Variables
+		std::string m_AcadVer;
+		std::string m_CodePage;
+		double m_LinetypeScale;
+		// $EXTMIN and $EXTMAX, m_HasExtents is false if they are missing.
+		CDblPoint m_ExtMin;
+		CDblPoint m_ExtMax;
+		bool m_HasExtents;
+		// Names of blocks of the BLOCKS section in the order of the file, including *Model_Space and *Paper_Space.
+		std::vector<std::string> m_Blocks;
+		// Counts of group 0 records by type, ATTRIB, VERTEX and SEQEND are counted as they are.
+		// Paper space has entities of ENTITIES with group code 67 and entities of *Paper_Space blocks.
+		std::map<std::string, size_t> m_ModelSpaceCounts;
+		std::map<std::string, size_t> m_PaperSpaceCounts;
+		// Entities of the other blocks
+		std::map<std::string, size_t> m_BlockCounts;
+	};
 
 	class DXF_API DxfReader
 	{
@@ -33,26 +132,94 @@ namespace DXF
 		DxfReader(DxfData &graph);
 		DxfReader(const DxfReader &) = delete;
 		//返回true，表示成功;如果返回false,表示失败,graph处于不可用状态．
+		//gzip或zstd压缩的DXF根据开头的magic bytes识别，在另一个线程中边解压边读。
 		bool ReadDxf(const char *dxfFileName, bool OnlyReadModelSpace);
+		// Read DXF text in a memory buffer owned by the caller, the buffer is not copied.
+		bool ReadDxf(const char *data, size_t len, bool OnlyReadModelSpace);
+		// Fill buffer with at most size bytes and return the count, 0 means the end of data.
+		typedef DxfTokenizer::Source DxfSource;
+		// Read DXF text pulled from source, e.g. a pipe or a socket, through a buffer of bufferSize bytes.
+		// If the data is compressed, source is called on the decompressing thread.
+		bool ReadDxf(const DxfSource &source, bool OnlyReadModelSpace, size_t bufferSize = 64 << 10);
+		// Read the file on a thread of the library, see SetAsyncThreadCount. The file is prefetched at once,
+		// so files queued are read into the file cache while the files before them are parsed.
+		// The reader and its graph must not be used until the future is ready.
+		std::future<bool> ReadDxfAsync(const char *dxfFileName, bool OnlyReadModelSpace);
+		// Ask the system to read the file into the file cache without waiting, e.g. for the next file to read.
+		// Only the first window is prefetched if the file is mapped by window, see SetMappingWindowSize.
+		void PrefetchDxf(const char *dxfFileName) const;
+		// Map the file windowSize bytes at a time instead of as a whole, so that huge files
+		// are read with bounded address space. 0(default) maps the whole file.
+		void SetMappingWindowSize(size_t windowSize);
+		// Read HEADER and TABLES, then only scan group 0 records of BLOCKS and ENTITIES to fill probe.
+		// Tables of graph are read as ReadDxf does, the others are kept empty. Return false if the DXF is invalid.
+		bool ProbeDxf(const char *dxfFileName, DxfProbe &probe);
+		bool ProbeDxf(const char *data, size_t len, DxfProbe &probe);
+		void SetReadOptions(const ReadOptions &options)
+		{
+			m_Options = options;
+		}
+		// Reset the graph and release what the last read kept, e.g. handle tables and the file of lazy entities.
+		// The tokenizer with its buffers and decompressor is kept. A reader can read file after file
+		// without it, it only releases memory between files.
+		void Recycle();
+		// Stats of the last read with ReadOptions::m_Pipelined, all 0 if it wasn't pipelined.
+		const PipelineStats &GetPipelineStats() const
+		{
+			return m_PipelineStats;
+		}
 		~DxfReader(void);
 
 	private:
+		friend class DxfData;
+		// OpenStream opens m_Tokenizer, it is called in the try block that catches read errors.
+		bool ReadStream(bool OnlyReadModelSpace, const std::function<bool()> &OpenStream);
+		bool ProbeStream(DxfProbe &probe, const std::function<bool()> &OpenStream);
+		// Count group 0 records from the tokenizer on into m_pProbe, up to the end of ENTITIES.
+		bool ScanEntities();
 		bool ReadHeader();
 		bool ReadTables();
 		bool ReadBlocks();
 		bool ReadEntities();
 		bool ReadObjects();
+		// Create the reader of lazy entities of m_Graph, OpenStream opens its tokenizer on the DXF just read.
+		bool OpenLazyReader(const std::function<bool(DxfTokenizer &)> &OpenStream);
+		// Report the end of reading a file loaded from its snapshot.
+		void ReportSnapshotLoaded(const char *dxfFileName);
+		// Read the lazy entity and the lazy entities it refers to, and convert their handles.
+		void LoadEntity(size_t index);
+		void ReadLazyEntity(size_t index);
+		// Read the entities selected by the index.
+		void ReadIndexedEntities();
+		// Read the entity(and its ATTRIBs) whose pairs begin at offset.
+		void ReadEntityAt(unsigned long long offset, const char *entityType, EntityList *pObjList);
 
 	private:
 		enum
 		{
 			BUFSIZE = 256
 		};
-		void ReadPair(int &groupCode, char *value, int bufsize = BUFSIZE);
+		void ReadPair(int &groupCode, char *value, int bufsize = BUFSIZE)
+		{
+			m_Tokenizer.ReadPair(groupCode, value, bufsize);
+		}
+		// The next ReadPair returns this pair, so the reader never seeks backward.
+		void PutBackPair(int groupCode, const char *value)
+		{
+			m_Tokenizer.PutBackPair(groupCode, value);
+		}
+		// value must be the buffer just passed to ReadPair.
+		double ToReal(const char *value) const
+		{
+			return m_Tokenizer.ToReal(value);
+		}
+		int ToInt(const char *value) const
+		{
+			return m_Tokenizer.ToInt(value);
+		}
 		bool AdvanceToSection(const char *sectionName);
 		bool AdvanceToObject(const char *objectType);
 		bool AdvanceToObjectStopAtLayout(const char *objectType);
-		bool NextVariable(char *varName, char *varVal);
 		bool NextTable(char *tableName);
 		bool NextTableEntry(const char *entryName);
 		void ReadTableEntry(std::string &name, void *data);
@@ -63,11 +230,32 @@ namespace DXF
 		void HandleStyleEntryCode(std::string &name, void *data, int groupCode, const char *value);
 		void HandleDimStyleEntryCode(std::string &name, void *data, int groupCode, const char *value);
 		bool NextBlock();
+		// Seek to the end of the block if it is in the index.
+		void SkipIndexedBlock(const std::string &blockName);
 		bool NextObject(const char *objectType);
 		void ReadDictionaryEntries(std::function<bool(const NameHandle &)> HandleDicEntry);
 		LayoutData *ReadBlockBegin(std::string &blockName, /*in,out*/ BlockDef *block);
 		bool NextEntity(char *entityType);
-		void ReadAllEntities(EntityList *pObjList, bool bIn_ENTITIES_Section);
+		typedef void (DxfReader::*ReadEntityFunc)(EntityList *pObjList);
+		// Null if the type of entities isn't supported.
+		static ReadEntityFunc GetEntityReader(const char *entityType);
+		// Return false if extents of some entity read are unknown, they are only estimated if IsEstimatingExtents.
+		// extents is the union of the others.
+		bool ReadAllEntities(EntityList *pObjList, bool bIn_ENTITIES_Section, CDblRect *extents = nullptr);
+		// Read pairs of the entity into m_EntityPairs, return false if its extents can't be estimated.
+		bool ReadEntityExtents(const char *entityType, CDblRect &extents);
+		bool IsEntityTypeRead(const char *entityType) const;
+		// Check m_Attribute of the entity against m_Options.
+		bool IsEntityRead(bool bIn_ENTITIES_Section, bool bPaperSpace, const std::string &layer) const;
+		// Extents of block entities are needed by the window or the index.
+		bool IsEstimatingExtents() const;
+		// No entity is filtered out by m_Options.
+		bool IsReadingAllEntities() const;
+		// Skip the entity just after ReadAttribute and add it to the lazy entities of m_Graph,
+		// offset is where its pairs begin. An ATTRIB is added to the INSERT before it.
+		void SkipLazyEntity(const char *entityType, bool bAttrib, unsigned long long offset);
+		void AddLazyEntity(const char *entityType, const std::string &layer, Handle handle,
+			unsigned long long offset, unsigned int length);
 
 		void ReadAttribute();
 		void SetAttribute(EntAttribute *pEnt);
@@ -112,39 +300,58 @@ namespace DXF
 		void ReadCell(Cell &cell);
 		void ReadTableStyle(TableStyle &ts);
 
-		std::string LookupTextStyleName(int handle);
-		std::string LookupBlockEntryName(int handle);
-		std::string LookupMLeaderStyleName(int handle);
-		std::string LookupLinetypeName(int handle);
-		std::string LookupTableStyleName(int handle);
+		std::string LookupTextStyleName(Handle handle);
+		std::string LookupBlockEntryName(Handle handle);
+		std::string LookupMLeaderStyleName(Handle handle);
+		std::string LookupLinetypeName(Handle handle);
+		std::string LookupTableStyleName(Handle handle);
 		std::shared_ptr<LayoutData> LookupLayout(const char *blockName);
 
 		void ConvertHandle();
+		// Find the entity in m_pIndexer if entities are indexed, otherwise in m_Graph.
+		std::shared_ptr<EntAttribute> FindEntity(Handle handle);
+		void ClearToBeConverted();
 		void Reset();
 
 	private:
-		DXF::ifstream &m_DxfFile;
+		DxfTokenizer m_Tokenizer;
 		DxfData &m_Graph;
 		AcadDimInternal m_Attribute;
 		bool m_OnlyReadModelSpace;
-		std::map<int, std::string> m_TextStyleHandleTable;
-		std::map<int, std::string> m_BlockEntryHandleTable;
-		std::map<int, std::string> m_MLeaderStyleHandleTable;
-		std::map<int, std::string> m_LinetypeHandleTable;
-		std::map<int, std::string> m_TableStyleHandleTable;
-
-		std::map<int, std::vector<int>> m_ToBeConvertedReactors;
-		std::map<int, int> m_ToBeConvertedViewportClipEnts;
-		std::map<int, int> m_ToBeConvertedLeaderAnnotation;
-		std::map<int, std::vector<int>> m_ToBeConvertedMLeaderAttDefs;
-		std::map<int, int> m_ToBeConvertedMLeaderStyleName;
-		std::map<int, int> m_ToBeConvertedTableStyleName;
-		std::map<std::string, int> m_ToBeConvertedTextStyleName;
-		std::map<std::string, int> m_ToBeConvertedArrow1Name;
-		std::map<std::string, int> m_ToBeConvertedArrow2Name;
-		std::map<int, std::vector<std::pair<int, int>>> m_ToBeConvertedHatchAssociatedEnts;
-
-		int m_CurObjectHandle;
+		ReadOptions m_Options;
+		ProgressReporter m_Progress;
+		size_t m_MappingWindowSize;
+		std::map<Handle, std::string> m_TextStyleHandleTable;
+		std::map<Handle, std::string> m_BlockEntryHandleTable;
+		std::map<Handle, std::string> m_MLeaderStyleHandleTable;
+		std::map<Handle, std::string> m_LinetypeHandleTable;
+		std::map<Handle, std::string> m_TableStyleHandleTable;
+
+		std::map<Handle, std::vector<Handle>> m_ToBeConvertedReactors;
+		std::map<Handle, Handle> m_ToBeConvertedViewportClipEnts;
+		std::map<Handle, Handle> m_ToBeConvertedLeaderAnnotation;
+		std::map<Handle, std::vector<Handle>> m_ToBeConvertedMLeaderAttDefs;
+		std::map<Handle, Handle> m_ToBeConvertedMLeaderStyleName;
+		std::map<Handle, Handle> m_ToBeConvertedTableStyleName;
+		std::map<std::string, Handle> m_ToBeConvertedTextStyleName;
+		std::map<std::string, Handle> m_ToBeConvertedArrow1Name;
+		std::map<std::string, Handle> m_ToBeConvertedArrow2Name;
+		std::map<Handle, std::vector<std::pair<Handle, int>>> m_ToBeConvertedHatchAssociatedEnts;
+
+		Handle m_CurObjectHandle;
+		// Extents of blocks relative to their base points, for culling INSERTs by m_Options.m_Window.
+		std::map<std::string, CDblRect> m_BlockExtents;
+		std::vector<DxfPair> m_EntityPairs;
+		// Indexes of layers in m_Graph.m_LazyLayers
+		std::map<std::string, unsigned int> m_LazyLayerIndexes;
+		// Only one of them exists while reading a file, see ReadOptions::m_UseIndex.
+		std::unique_ptr<DxfIndex> m_pIndex;
+		std::unique_ptr<DxfIndexBuilder> m_pIndexBuilder;
+		// Entities read so far while reading with ReadOptions::m_Pipelined
+		std::unique_ptr<EntityIndexer> m_pIndexer;
+		PipelineStats m_PipelineStats;
+		// Header variables are kept in it while probing.
+		DxfProbe *m_pProbe;
 	};
 
 } // namespace DXF
@@ -0,0 +1,1107 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+
+#include <cstdio>
+#include <cstring>
+#include <bitset>
+#include <stdexcept>
+#include <typeinfo>
+
+#include "DxfSnapshot.h"
+#include "DxfData.h"
+#include "FileMapping.h"
+#include "utility.h"
+
+using namespace std;
+#pragma warning(disable:4996)
+
+namespace DXF
+{
+	const char g_SnapshotMagic[8] = { 'D', 'X', 'F', 'S', 'N', 'P', '\r', '\n' };
+	// Increase it whenever a serialized type changes.
+	const unsigned int g_SnapshotVersion = 1;
+	const unsigned int g_NullEntity = ~0u;
+
+	struct SnapshotHeader
+	{
+		char m_Magic[8];
+		unsigned int m_Version;
+		unsigned int m_Reserved;
+		// Offsets are from the beginning of the file.
+		// m_StringCount + 1 offsets, each string ends with 0 before the next one.
+		unsigned long long m_StringCount;
+		unsigned long long m_StringsOffset;
+		// x and y of points
+		unsigned long long m_PointCount;
+		unsigned long long m_PointsOffset;
+		unsigned long long m_RealCount;
+		unsigned long long m_RealsOffset;
+		unsigned long long m_EntityCount;
+		unsigned long long m_EntitiesOffset;
+		unsigned long long m_RecordsSize;
+		unsigned long long m_RecordsOffset;
+		// Offset of the record of DxfData in the records
+		unsigned long long m_GraphRecord;
+	};
+
+	struct SnapshotEntity
+	{
+		// Index of g_SnapshotTypes
+		unsigned int m_Type;
+		unsigned int m_Reserved;
+		// Offset in the records
+		unsigned long long m_Record;
+	};
+
+	static void ThrowInvalidSnapshot()
+	{
+		PRINT_DEBUG_INFO("Invalid snapshot.");
+		throw std::runtime_error("Invalid snapshot.");
+	}
+
+	// Visits the entities owned by the others, so that each entity gets an index.
+	class SnapshotCollector
+	{
+	public:
+		enum { IsLoading = false };
+		SnapshotCollector(std::vector<EntAttribute*>& entities, std::map<const EntAttribute*, unsigned int>& indexes)
+			: m_Entities(entities)
+			, m_Indexes(indexes)
+		{
+		}
+		template <class T>
+		void Pod(T&)
+		{
+		}
+		unsigned int CheckCount(unsigned int count)
+		{
+			return count;
+		}
+		void String(std::string&)
+		{
+		}
+		void Points(DblPoints&)
+		{
+		}
+		void Reals(std::vector<double>&)
+		{
+		}
+		template <class T>
+		void Entity(std::shared_ptr<T>& p);
+		template <class T>
+		void Entity(std::weak_ptr<T>&)
+		{
+		}
+
+	private:
+		std::vector<EntAttribute*>& m_Entities;
+		std::map<const EntAttribute*, unsigned int>& m_Indexes;
+	};
+
+	class SnapshotWriter
+	{
+	public:
+		enum { IsLoading = false };
+		SnapshotWriter(const std::map<const EntAttribute*, unsigned int>& indexes)
+			: m_Indexes(indexes)
+		{
+		}
+		template <class T>
+		void Pod(T& value)
+		{
+			const char* p = (const char*)&value;
+			m_Records.insert(m_Records.end(), p, p + sizeof(T));
+		}
+		unsigned int CheckCount(unsigned int count)
+		{
+			return count;
+		}
+		void String(std::string& str)
+		{
+			auto it = m_StringIndexes.emplace(str, (unsigned int)m_Strings.size());
+			if (it.second)
+				m_Strings.push_back(str);
+			Pod(it.first->second);
+		}
+		void Points(DblPoints& points)
+		{
+			unsigned int count = (unsigned int)points.size();
+			unsigned long long first = m_Points.size() / 2;
+			Pod(count);
+			Pod(first);
+			for (const CDblPoint& point : points)
+			{
+				m_Points.push_back(point.x);
+				m_Points.push_back(point.y);
+			}
+		}
+		void Reals(std::vector<double>& reals)
+		{
+			unsigned int count = (unsigned int)reals.size();
+			unsigned long long first = m_Reals.size();
+			Pod(count);
+			Pod(first);
+			m_Reals.insert(m_Reals.end(), reals.begin(), reals.end());
+		}
+		template <class T>
+		void Entity(std::shared_ptr<T>& p)
+		{
+			WriteEntity(p.get());
+		}
+		template <class T>
+		void Entity(std::weak_ptr<T>& p)
+		{
+			WriteEntity(p.lock().get());
+		}
+		bool Write(const char* fileName, const std::vector<SnapshotEntity>& entities, unsigned long long graphRecord) const;
+
+	private:
+		void WriteEntity(const EntAttribute* pEntity)
+		{
+			// Entities not owned by graph, e.g. expired reactors, are stored as null.
+			auto it = m_Indexes.find(pEntity);
+			unsigned int index = it != m_Indexes.end() ? it->second : g_NullEntity;
+			Pod(index);
+		}
+
+	public:
+		std::vector<char> m_Records;
+
+	private:
+		const std::map<const EntAttribute*, unsigned int>& m_Indexes;
+		std::vector<std::string> m_Strings;
+		std::map<std::string, unsigned int> m_StringIndexes;
+		std::vector<double> m_Points;
+		std::vector<double> m_Reals;
+	};
+
+	class SnapshotReader
+	{
+	public:
+		enum { IsLoading = true };
+		SnapshotReader(const unsigned char* pStart, unsigned long long size)
+			: m_pStart(pStart)
+			, m_Size(size)
+			, m_pHeader((const SnapshotHeader*)pStart)
+			, m_pCur(nullptr)
+			, m_pEnd(nullptr)
+		{
+		}
+		// Check the header, return false if it isn't a snapshot of this version.
+		bool Open();
+		void Seek(unsigned long long record)
+		{
+			if (record > m_pHeader->m_RecordsSize)
+				ThrowInvalidSnapshot();
+			m_pCur = m_pStart + m_pHeader->m_RecordsOffset + record;
+		}
+		template <class T>
+		void Pod(T& value)
+		{
+			if (size_t(m_pEnd - m_pCur) < sizeof(T))
+				ThrowInvalidSnapshot();
+			memcpy(&value, m_pCur, sizeof(T));
+			m_pCur += sizeof(T);
+		}
+		// Each element takes 1 byte at least, so a corrupted count can't exhaust memory.
+		unsigned int CheckCount(unsigned int count)
+		{
+			if (count > size_t(m_pEnd - m_pCur))
+				ThrowInvalidSnapshot();
+			return count;
+		}
+		void String(std::string& str)
+		{
+			unsigned int index;
+			Pod(index);
+			if (index >= m_pHeader->m_StringCount)
+				ThrowInvalidSnapshot();
+			unsigned long long offsets[2];
+			memcpy(offsets, m_pStart + m_pHeader->m_StringsOffset + index * sizeof(unsigned long long), sizeof(offsets));
+			if (offsets[0] >= offsets[1] || offsets[1] > m_Size)
+				ThrowInvalidSnapshot();
+			str.assign((const char*)m_pStart + offsets[0], size_t(offsets[1] - offsets[0] - 1));
+		}
+		void Points(DblPoints& points)
+		{
+			unsigned int count;
+			unsigned long long first;
+			Pod(count);
+			Pod(first);
+			if (first > m_pHeader->m_PointCount || count > m_pHeader->m_PointCount - first)
+				ThrowInvalidSnapshot();
+			const unsigned char* p = m_pStart + m_pHeader->m_PointsOffset + first * 2 * sizeof(double);
+			points.resize(count);
+			for (CDblPoint& point : points)
+			{
+				memcpy(&point.x, p, sizeof(double));
+				memcpy(&point.y, p + sizeof(double), sizeof(double));
+				p += 2 * sizeof(double);
+			}
+		}
+		void Reals(std::vector<double>& reals)
+		{
+			unsigned int count;
+			unsigned long long first;
+			Pod(count);
+			Pod(first);
+			if (first > m_pHeader->m_RealCount || count > m_pHeader->m_RealCount - first)
+				ThrowInvalidSnapshot();
+			reals.resize(count);
+			if (count > 0)
+				memcpy(reals.data(), m_pStart + m_pHeader->m_RealsOffset + first * sizeof(double), count * sizeof(double));
+		}
+		template <class T>
+		void Entity(std::shared_ptr<T>& p)
+		{
+			unsigned int index;
+			Pod(index);
+			if (index == g_NullEntity)
+			{
+				p.reset();
+				return;
+			}
+			if (index >= m_Entities.size())
+				ThrowInvalidSnapshot();
+			p = std::dynamic_pointer_cast<T>(m_Entities[index]);
+			if (!p)
+				ThrowInvalidSnapshot();
+		}
+		template <class T>
+		void Entity(std::weak_ptr<T>& p)
+		{
+			std::shared_ptr<T> entity;
+			Entity(entity);
+			p = entity;
+		}
+		const SnapshotHeader& GetHeader() const
+		{
+			return *m_pHeader;
+		}
+		const SnapshotEntity& GetEntity(size_t index) const
+		{
+			return ((const SnapshotEntity*)(m_pStart + m_pHeader->m_EntitiesOffset))[index];
+		}
+
+	public:
+		// Created before their records are read, so that they can refer to each other.
+		std::vector<std::shared_ptr<EntAttribute>> m_Entities;
+
+	private:
+		const unsigned char* m_pStart;
+		unsigned long long m_Size;
+		const SnapshotHeader* m_pHeader;
+		const unsigned char* m_pCur;
+		const unsigned char* m_pEnd;
+	};
+
+	// Field(archive, member) saves, loads or visits a member of a serialized type.
+	// Overloads for types of std are declared first, they aren't found by argument-dependent lookup.
+	template <class Archive, class T>
+	typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type Field(Archive& ar, T& value)
+	{
+		ar.Pod(value);
+	}
+
+	template <class Archive, class T, size_t N>
+	void Field(Archive& ar, T (&values)[N])
+	{
+		for (T& value : values)
+			Field(ar, value);
+	}
+
+	template <class Archive, size_t N>
+	void Field(Archive& ar, std::bitset<N>& bits)
+	{
+		static_assert(N <= 64, "The bitset must fit in unsigned long long.");
+		unsigned long long value = bits.to_ullong();
+		ar.Pod(value);
+		if (Archive::IsLoading)
+			bits = std::bitset<N>(value);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, std::string& str)
+	{
+		ar.String(str);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, DblPoints& points)
+	{
+		ar.Points(points);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, std::vector<double>& reals)
+	{
+		ar.Reals(reals);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, std::shared_ptr<EntAttribute>& p)
+	{
+		ar.Entity(p);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, std::shared_ptr<AcadAttDef>& p)
+	{
+		ar.Entity(p);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, std::weak_ptr<EntAttribute>& p)
+	{
+		ar.Entity(p);
+	}
+
+	template <class Archive, class T>
+	void Field(Archive& ar, std::vector<T>& values)
+	{
+		unsigned int count = (unsigned int)values.size();
+		ar.Pod(count);
+		if (Archive::IsLoading)
+			values.resize(ar.CheckCount(count));
+		for (T& value : values)
+			Field(ar, value);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, std::set<std::string>& values)
+	{
+		unsigned int count = (unsigned int)values.size();
+		ar.Pod(count);
+		if (!Archive::IsLoading)
+		{
+			for (const std::string& value : values)
+				Field(ar, const_cast<std::string&>(value));
+			return;
+		}
+		values.clear();
+		std::string value;
+		for (unsigned int i = ar.CheckCount(count); i > 0; --i)
+		{
+			Field(ar, value);
+			values.insert(value);
+		}
+	}
+
+	template <class Archive, class T>
+	void Field(Archive& ar, std::map<std::string, T>& values)
+	{
+		unsigned int count = (unsigned int)values.size();
+		ar.Pod(count);
+		if (!Archive::IsLoading)
+		{
+			for (auto& value : values)
+			{
+				Field(ar, const_cast<std::string&>(value.first));
+				Field(ar, value.second);
+			}
+			return;
+		}
+		values.clear();
+		std::string key;
+		for (unsigned int i = ar.CheckCount(count); i > 0; --i)
+		{
+			Field(ar, key);
+			Field(ar, values[key]);
+		}
+	}
+
+	// Objects owned by the pointer, e.g. blocks and loops of hatches.
+	template <class Archive, class T>
+	void Field(Archive& ar, std::shared_ptr<T>& p)
+	{
+		bool bNull = !p;
+		ar.Pod(bNull);
+		if (Archive::IsLoading)
+			p = bNull ? nullptr : std::make_shared<T>();
+		if (p)
+			Field(ar, *p);
+	}
+
+	// Content of MLEADERs, MLEADERSTYLEs and table cells, which is a block or text.
+	template <class Block, class Text, class Archive, class T>
+	void ContentField(Archive& ar, std::shared_ptr<T>& p, int blockType, int textType)
+	{
+		int type = p ? int(p->GetContentType()) : 0;
+		ar.Pod(type);
+		if (Archive::IsLoading)
+		{
+			if (type == blockType)
+				p = std::make_shared<Block>();
+			else if (type == textType)
+				p = std::make_shared<Text>();
+			else if (type == 0)
+				p.reset();
+			else
+				ThrowInvalidSnapshot();
+		}
+		if (type == blockType)
+			Field(ar, static_cast<Block&>(*p));
+		else if (type == textType)
+			Field(ar, static_cast<Text&>(*p));
+	}
+
+	template <class Archive>
+	void Fields(Archive&)
+	{
+	}
+
+	template <class Archive, class T, class... Rest>
+	void Fields(Archive& ar, T& first, Rest&... rest)
+	{
+		Field(ar, first);
+		Fields(ar, rest...);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, CDblPoint& point)
+	{
+		Fields(ar, point.x, point.y);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, EntityList& entities)
+	{
+		Field(ar, static_cast<std::vector<std::shared_ptr<EntAttribute>>&>(entities));
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, LayerData& layer)
+	{
+		Fields(ar, layer.m_Linetype, layer.m_Color, layer.m_LineWeight, layer.m_Plottable);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, TextStyleData& style)
+	{
+		Fields(ar, style.m_PrimaryFontFile, style.m_BigFontFile, style.m_TrueType, style.m_Height,
+			style.m_WidthFactor, style.m_ObliqueAngle);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, DimStyleData& style)
+	{
+		Fields(ar, style.DimensionLineColor, style.DimensionLineWeight, style.DimLine1Suppress, style.DimLine2Suppress,
+			style.ForceLineInside, style.ExtensionLineColor, style.ExtensionLineWeight, style.ExtensionLineExtend,
+			style.ExtensionLineOffset, style.ExtLine1Suppress, style.ExtLine2Suppress, style.ArrowHead1Type,
+			style.ArrowHead2Type, style.ArrowHead1Block, style.ArrowHead2Block, style.ArrowHeadSize, style.CenterType,
+			style.CenterMarkSize, style.TextStyle, style.TextHeight, style.TextColor, style.VerticalTextPosition,
+			style.HorizontalTextPosition, style.TextAlign, style.TextGap, style.Text, style.Fit, style.TextMovement,
+			style.TextInside, style.UnitsFormat, style.UnitsPrecision, style.SuppressLeadingZeros,
+			style.SuppressTrailingZeros, style.AngleSuppressLeadingZeros, style.AngleSuppressTrailingZeros,
+			style.AngleFormat, style.AnglePrecision, style.LinearScaleFactor);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, StyleMTextPart& part)
+	{
+		Fields(ar, part.m_TextStyle, part.m_TextAngleType, part.m_TextColor, part.m_TextHeight, part.m_AlignSpace);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, StyleBlockPart& part)
+	{
+		Fields(ar, part.m_BlockName, part.m_BlockConnectionType, part.m_BlockColor, part.m_BlockScale);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, std::shared_ptr<StyleContent>& p)
+	{
+		ContentField<StyleBlockPart, StyleMTextPart>(ar, p, BLOCK_TYPE, MTEXT_TYPE);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, MLeaderStyle& style)
+	{
+		Fields(ar, style.m_LeaderType, style.m_LineColor, style.m_LineType, style.m_LineWeight, style.m_ArrowHead,
+			style.m_ArrowSize, style.m_MaxLeaderPoints, style.m_FirstSegAngleConstraint,
+			style.m_SecondSegAngleConstraint, style.m_EnableLanding, style.m_EnableDogleg, style.m_IsAnnotative,
+			style.m_LandingGap, style.m_DoglegLength, style.m_BreakGapSize, style.m_Content);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, CellInTableStyle& cell)
+	{
+		Fields(ar, cell.m_TextHeight, cell.m_Alignment, cell.m_TextColor, cell.m_BgColor, cell.m_BgColorEnabled,
+			cell.m_CellDataType, cell.m_CellUnitType, cell.m_BorderLineWeight, cell.m_BorderVisible, cell.m_BorderColor);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, TableStyle& style)
+	{
+		Fields(ar, style.m_HorCellMargin, style.m_VerCellMargin, style.m_HasNoTitle, style.m_HasNoColumnHeading,
+			style.m_TextStyle, style.m_Cells);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, EntAttribute& entity)
+	{
+		Fields(ar, entity.m_Handle, entity.m_IsInPaperspace, entity.m_Color, entity.m_Lineweight,
+			entity.m_LinetypeScale, entity.m_Layer, entity.m_Linetype, entity.m_Reactors);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadCircle& circle)
+	{
+		Fields(ar, static_cast<EntAttribute&>(circle), circle.m_Center, circle.m_Radius);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadArc& arc)
+	{
+		Fields(ar, static_cast<AcadCircle&>(arc), arc.m_StartAngle, arc.m_EndAngle);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadAttDef& attDef)
+	{
+		Fields(ar, static_cast<EntAttribute&>(attDef), attDef.m_BaseLeftPoint, attDef.m_InsertionPoint,
+			attDef.m_TextHeight, attDef.m_Text, attDef.m_Tag, attDef.m_Flags, attDef.m_RotationAngle,
+			attDef.m_TextStyle, attDef.m_HorAlign, attDef.m_VerAlign, attDef.m_DuplicateFlag, attDef.m_Prompt);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadAttrib& attrib)
+	{
+		Fields(ar, static_cast<EntAttribute&>(attrib), attrib.m_BaseLeftPoint, attrib.m_InsertionPoint,
+			attrib.m_TextHeight, attrib.m_Text, attrib.m_Tag, attrib.m_Flags, attrib.m_RotationAngle,
+			attrib.m_TextStyle, attrib.m_HorAlign, attrib.m_VerAlign, attrib.m_DuplicateFlag);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadBlockInstance& insert)
+	{
+		Fields(ar, static_cast<EntAttribute&>(insert), insert.m_Name, insert.m_InsertionPoint, insert.m_Xscale,
+			insert.m_Yscale, insert.m_Zscale, insert.m_RotationAngle, insert.m_Attribs);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadDim& dim)
+	{
+		Fields(ar, static_cast<EntAttribute&>(dim), dim.m_BlockName, dim.m_DefPoint, dim.m_TextPosition, dim.m_DimType,
+			dim.m_Attachment, dim.m_DimStyleName, dim.m_ValidMembersFlag, dim.m_DimStyleOverride, dim.m_TextRotation);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadDimAln& dim)
+	{
+		Fields(ar, static_cast<AcadDim&>(dim), dim.m_ExtLine1Point, dim.m_ExtLine2Point, dim.m_RotationAngle);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadDimRot& dim)
+	{
+		Field(ar, static_cast<AcadDimAln&>(dim));
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadDimAng3P& dim)
+	{
+		Fields(ar, static_cast<AcadDim&>(dim), dim.m_FirstEnd, dim.m_SecondEnd, dim.m_AngleVertex);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadDimAng& dim)
+	{
+		Fields(ar, static_cast<AcadDim&>(dim), dim.m_FirstStart, dim.m_FirstEnd, dim.m_SecondStart);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadDimDia& dim)
+	{
+		Fields(ar, static_cast<AcadDim&>(dim), dim.m_ChordPoint, dim.m_LeaderLength);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadDimRad& dim)
+	{
+		Fields(ar, static_cast<AcadDim&>(dim), dim.m_ChordPoint, dim.m_LeaderLength);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadDimOrd& dim)
+	{
+		Fields(ar, static_cast<AcadDim&>(dim), dim.m_OrdPoint, dim.m_LeaderPoint);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadEllipse& ellipse)
+	{
+		Fields(ar, static_cast<EntAttribute&>(ellipse), ellipse.m_Center, ellipse.m_MajorAxisPoint,
+			ellipse.m_MinorAxisRatio, ellipse.m_StartAngle, ellipse.m_EndAngle);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadHatch& hatch)
+	{
+		Fields(ar, static_cast<EntAttribute&>(hatch), hatch.m_FillFlag, hatch.m_HatchStyle, hatch.m_PatternName,
+			hatch.m_PatternType, hatch.m_PatternScale, hatch.m_PatternAngle, hatch.m_PixelSize, hatch.m_OuterLoop,
+			hatch.m_InnerLoops, hatch.m_OuterAssociatedEntities, hatch.m_InnerAssociatedEntities, hatch.m_OuterFlag,
+			hatch.m_InnerFlags);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadLeader& leader)
+	{
+		Fields(ar, static_cast<EntAttribute&>(leader), leader.m_StyleName, leader.m_Type, leader.m_ArrowSize,
+			leader.m_HasBaseLine, leader.m_BaseLineDirection, leader.m_Vertices, leader.m_CharHeight,
+			leader.m_TextWidth, leader.m_Annotation);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, MTextPart& part)
+	{
+		Fields(ar, part.m_Text, part.m_TextWidth, part.m_TextStyle, part.m_TextColor, part.m_TextLocation,
+			part.m_TextRotation, part.m_AttachmentPoint);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, BlockPart& part)
+	{
+		Fields(ar, part.m_BlockName, part.m_BlockColor, part.m_BlockPosition, part.m_BlockScale, part.m_BlockRotation);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, std::shared_ptr<Content>& p)
+	{
+		ContentField<BlockPart, MTextPart>(ar, p, BLOCK_TYPE, MTEXT_TYPE);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, LeaderLine& line)
+	{
+		Field(ar, line.m_Points);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, LeaderPart& leader)
+	{
+		Fields(ar, leader.m_CommonPoint, leader.m_Lines, leader.m_DoglegLength);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, CONTEXT_DATA& context)
+	{
+		Fields(ar, context.m_LandingPosition, context.m_TextHeight, context.m_ArrowSize, context.m_LandingGap,
+			context.m_Content, context.m_Leader);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadMLeader& mleader)
+	{
+		Fields(ar, static_cast<EntAttribute&>(mleader), mleader.m_ContextData, mleader.m_LeaderStyle,
+			mleader.m_LeaderType, mleader.m_LineType, mleader.m_LineWeight, mleader.m_EnableLanding,
+			mleader.m_EnableDogleg, mleader.m_AttrDefs, mleader.m_AttrValues);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, CellText& text)
+	{
+		Fields(ar, text.m_Text, text.m_TextStyle);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, CellBlock& block)
+	{
+		Fields(ar, block.m_BlockName, block.m_BlockScale, block.m_AttrDefs, block.m_AttrValues);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, std::shared_ptr<CellContent>& p)
+	{
+		ContentField<CellBlock, CellText>(ar, p, BLOCK_CELL, TEXT_CELL);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, Cell& cell)
+	{
+		Fields(ar, cell.m_Flag, cell.m_Merged, cell.m_AutoFit, cell.m_ColSpan, cell.m_RowSpan, cell.m_OverrideFlag1,
+			cell.m_VirtualEdgeFlag, cell.m_Rotation, cell.m_Alignment, cell.m_BgColor, cell.m_TextColor,
+			cell.m_BgColorEnabled, cell.m_TextHeight, cell.m_Flag93, cell.m_Flag90, cell.m_OverrideFlag2, cell.m_Content,
+			cell.m_LeftBorderVisible, cell.m_RightBorderVisible, cell.m_TopBorderVisible, cell.m_BottomBorderVisible);
+	}
+
+	// Cell has no default constructor.
+	template <class Archive>
+	void Field(Archive& ar, std::vector<Cell>& cells)
+	{
+		unsigned int count = (unsigned int)cells.size();
+		ar.Pod(count);
+		if (Archive::IsLoading)
+			cells.assign(ar.CheckCount(count), Cell(TEXT_CELL));
+		for (Cell& cell : cells)
+			Field(ar, cell);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadTable& table)
+	{
+		Fields(ar, static_cast<EntAttribute&>(table), table.m_TableBlockName, table.m_InsertionPoint,
+			table.m_TableStyle, table.m_RowCount, table.m_ColCount, table.m_RowHeights, table.m_ColWidths,
+			table.m_Cells, table.m_HorCellMargin, table.m_VerCellMargin, table.m_LeftBorderVisible,
+			table.m_RightBorderVisible, table.m_TopBorderVisible, table.m_BottomBorderVisible);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadLine& line)
+	{
+		Fields(ar, static_cast<EntAttribute&>(line), line.m_StartPoint, line.m_EndPoint);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadLWPLine& pline)
+	{
+		// Widths and bulges are private.
+		double width = pline.GetConstWdith();
+		std::vector<double> bulges = pline.bulges();
+		std::vector<double> startWidths = pline.startWidths();
+		std::vector<double> endWidths = pline.endWidths();
+		Fields(ar, static_cast<EntAttribute&>(pline), pline.m_Vertices, pline.m_Closed, width, bulges, startWidths,
+			endWidths);
+		if (Archive::IsLoading)
+		{
+			pline.SetConstWidth(width);
+			pline.SetBulges(bulges);
+			pline.SetWidths(startWidths, endWidths);
+		}
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadMText& mtext)
+	{
+		Fields(ar, static_cast<EntAttribute&>(mtext), mtext.m_InsertionPoint, mtext.m_Width, mtext.m_CharHeight,
+			mtext.m_Text, mtext.m_LineSpacingFactor, mtext.m_RotationAngle, mtext.m_AttachmentPoint,
+			mtext.m_DrawingDirection, mtext.m_StyleName);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadPoint& point)
+	{
+		Fields(ar, static_cast<EntAttribute&>(point), point.m_Point);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadSolid& solid)
+	{
+		Fields(ar, static_cast<EntAttribute&>(solid), solid.m_Point1, solid.m_Point2, solid.m_Point3, solid.m_Point4);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadSpline& spline)
+	{
+		Fields(ar, static_cast<EntAttribute&>(spline), spline.m_Flag, spline.m_Degree, spline.m_StartTangent,
+			spline.m_EndTangent, spline.m_Knots, spline.m_Weights, spline.m_ControlPoints, spline.m_FitPoints);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadText& text)
+	{
+		// The oblique angle is private.
+		double obliqueAngle;
+		bool bObliqueAngleValid;
+		text.GetObliqueAngle(obliqueAngle, bObliqueAngleValid);
+		Fields(ar, static_cast<EntAttribute&>(text), text.m_BaseLeftPoint, text.m_InsertionPoint, text.m_Text,
+			text.m_RotationAngle, text.m_HorAlign, text.m_VerAlign, text.m_StyleName, text.m_Height,
+			text.m_WidthFactor, bObliqueAngleValid, obliqueAngle);
+		if (Archive::IsLoading && bObliqueAngleValid)
+			text.SetObliqueAngle(obliqueAngle);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadViewport& viewport)
+	{
+		Fields(ar, static_cast<EntAttribute&>(viewport), viewport.m_PaperspaceCenter, viewport.m_PaperspaceWidth,
+			viewport.m_PaperspaceHeight, viewport.m_ModelSpaceCenter, viewport.m_ModelSpaceHeight,
+			viewport.m_TwistAngle, viewport.m_locked, viewport.m_ClipEnt);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, AcadXLine& xline)
+	{
+		Fields(ar, static_cast<EntAttribute&>(xline), xline.m_First, xline.m_Second);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, PlotSettings& settings)
+	{
+		Fields(ar, settings.m_PlotConfigFile, settings.m_PaperName, settings.m_LeftMargin, settings.m_BottomMargin,
+			settings.m_RightMargin, settings.m_TopMargin, settings.m_Width, settings.m_Height,
+			settings.m_PlotRotation, settings.m_PlotOrigin);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, LayoutData& layout)
+	{
+		Fields(ar, layout.m_BlockName, layout.m_PlotSettings, layout.m_MinLim, layout.m_MaxLim, layout.m_MinExt,
+			layout.m_MaxExt, layout.m_Objects, layout.m_LayoutOrder);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, BlockDef& block)
+	{
+		Fields(ar, block.m_InsertPoint, block.m_Objects);
+	}
+
+	template <class Archive>
+	void Field(Archive& ar, DxfData& graph)
+	{
+		Fields(ar, graph.m_LinetypeScale, graph.m_Linetypes, graph.m_Layers, graph.m_TextStyles, graph.m_DimStyles,
+			graph.m_MLeaderStyles, graph.m_TableStyles, graph.m_Objects, graph.m_Layouts, graph.m_RealBlockDefs);
+	}
+
+	template <class T>
+	std::shared_ptr<EntAttribute> CreateEntity()
+	{
+		return std::make_shared<T>();
+	}
+
+	template <class T, class Archive>
+	void SerializeEntity(Archive& ar, EntAttribute& entity)
+	{
+		Field(ar, static_cast<T&>(entity));
+	}
+
+	// Types of entities in a snapshot, append new types to keep the indexes of the others.
+	struct SnapshotType
+	{
+		const std::type_info* m_Type;
+		std::shared_ptr<EntAttribute> (*m_Create)();
+		void (*m_Collect)(SnapshotCollector& ar, EntAttribute& entity);
+		void (*m_Save)(SnapshotWriter& ar, EntAttribute& entity);
+		void (*m_Load)(SnapshotReader& ar, EntAttribute& entity);
+	};
+
+#define SNAPSHOT_TYPE(T) \
+	{ &typeid(T), &CreateEntity<T>, &SerializeEntity<T, SnapshotCollector>, &SerializeEntity<T, SnapshotWriter>, &SerializeEntity<T, SnapshotReader> }
+
+	static const SnapshotType g_SnapshotTypes[] =
+	{
+		SNAPSHOT_TYPE(AcadLine),
+		SNAPSHOT_TYPE(AcadText),
+		SNAPSHOT_TYPE(AcadLWPLine),
+		SNAPSHOT_TYPE(AcadArc),
+		SNAPSHOT_TYPE(AcadCircle),
+		SNAPSHOT_TYPE(AcadDimAln),
+		SNAPSHOT_TYPE(AcadDimRot),
+		SNAPSHOT_TYPE(AcadDimAng3P),
+		SNAPSHOT_TYPE(AcadDimAng),
+		SNAPSHOT_TYPE(AcadDimDia),
+		SNAPSHOT_TYPE(AcadDimRad),
+		SNAPSHOT_TYPE(AcadDimOrd),
+		SNAPSHOT_TYPE(AcadBlockInstance),
+		SNAPSHOT_TYPE(AcadEllipse),
+		SNAPSHOT_TYPE(AcadHatch),
+		SNAPSHOT_TYPE(AcadLeader),
+		SNAPSHOT_TYPE(AcadMLeader),
+		SNAPSHOT_TYPE(AcadMText),
+		SNAPSHOT_TYPE(AcadSpline),
+		SNAPSHOT_TYPE(AcadViewport),
+		SNAPSHOT_TYPE(AcadSolid),
+		SNAPSHOT_TYPE(AcadPoint),
+		SNAPSHOT_TYPE(AcadTable),
+		SNAPSHOT_TYPE(AcadAttDef),
+		SNAPSHOT_TYPE(AcadXLine),
+	};
+
+#undef SNAPSHOT_TYPE
+
+	// Return the index of the type of entity in g_SnapshotTypes.
+	static unsigned int GetSnapshotType(const EntAttribute& entity)
+	{
+		for (unsigned int i = 0; i < _countof(g_SnapshotTypes); ++i)
+		{
+			if (*g_SnapshotTypes[i].m_Type == typeid(entity))
+				return i;
+		}
+		PRINT_DEBUG_INFO("Entities of type %s can't be saved.", typeid(entity).name());
+		throw std::logic_error("Unsupported entity type.");
+	}
+
+	template <class T>
+	void SnapshotCollector::Entity(std::shared_ptr<T>& p)
+	{
+		if (!p || !m_Indexes.emplace(p.get(), (unsigned int)m_Entities.size()).second)
+			return;
+		m_Entities.push_back(p.get());
+		// Entities owned by this one, e.g. loops of hatches
+		g_SnapshotTypes[GetSnapshotType(*p)].m_Collect(*this, *p);
+	}
+
+	bool SnapshotWriter::Write(const char* fileName, const std::vector<SnapshotEntity>& entities, unsigned long long graphRecord) const
+	{
+		SnapshotHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.m_Magic, g_SnapshotMagic, sizeof(g_SnapshotMagic));
+		header.m_Version = g_SnapshotVersion;
+		header.m_GraphRecord = graphRecord;
+		// Arrays are aligned to 8 bytes, records and strings are at the end.
+		header.m_PointCount = m_Points.size() / 2;
+		header.m_PointsOffset = sizeof(SnapshotHeader);
+		header.m_RealCount = m_Reals.size();
+		header.m_RealsOffset = header.m_PointsOffset + m_Points.size() * sizeof(double);
+		header.m_EntityCount = entities.size();
+		header.m_EntitiesOffset = header.m_RealsOffset + m_Reals.size() * sizeof(double);
+		header.m_StringCount = m_Strings.size();
+		header.m_StringsOffset = header.m_EntitiesOffset + entities.size() * sizeof(SnapshotEntity);
+		std::vector<unsigned long long> strings(m_Strings.size() + 1);
+		unsigned long long offset = header.m_StringsOffset + strings.size() * sizeof(unsigned long long);
+		for (size_t i = 0; i < m_Strings.size(); ++i)
+		{
+			strings[i] = offset;
+			offset += m_Strings[i].size() + 1;
+		}
+		strings.back() = offset;
+		header.m_RecordsSize = m_Records.size();
+		header.m_RecordsOffset = offset;
+
+		FILE* fp = fopen(fileName, "wb");
+		if (fp == nullptr)
+		{
+			PRINT_DEBUG_INFO("Can't open %s.", fileName);
+			return false;
+		}
+		bool bSuccess = fwrite(&header, sizeof(header), 1, fp) == 1;
+		bSuccess = bSuccess && fwrite(m_Points.data(), sizeof(double), m_Points.size(), fp) == m_Points.size();
+		bSuccess = bSuccess && fwrite(m_Reals.data(), sizeof(double), m_Reals.size(), fp) == m_Reals.size();
+		bSuccess = bSuccess && fwrite(entities.data(), sizeof(SnapshotEntity), entities.size(), fp) == entities.size();
+		bSuccess = bSuccess && fwrite(strings.data(), sizeof(unsigned long long), strings.size(), fp) == strings.size();
+		for (const std::string& str : m_Strings)
+			bSuccess = bSuccess && fwrite(str.c_str(), 1, str.size() + 1, fp) == str.size() + 1;
+		bSuccess = bSuccess && fwrite(m_Records.data(), 1, m_Records.size(), fp) == m_Records.size();
+		bSuccess = fclose(fp) == 0 && bSuccess;
+		if (!bSuccess)
+		{
+			PRINT_DEBUG_INFO("Can't write %s.", fileName);
+			remove(fileName);
+		}
+		return bSuccess;
+	}
+
+	bool SnapshotReader::Open()
+	{
+		// Arrays must be inside the file.
+		unsigned long long size = m_Size;
+		auto IsInFile = [size](unsigned long long offset, unsigned long long count, size_t elementSize)
+		{
+			return offset <= size && count <= (size - offset) / elementSize;
+		};
+		if (m_pStart == nullptr || m_Size < sizeof(SnapshotHeader)
+			|| memcmp(m_pHeader->m_Magic, g_SnapshotMagic, sizeof(g_SnapshotMagic)) != 0
+			|| m_pHeader->m_Version != g_SnapshotVersion
+			|| !IsInFile(m_pHeader->m_PointsOffset, m_pHeader->m_PointCount, 2 * sizeof(double))
+			|| !IsInFile(m_pHeader->m_RealsOffset, m_pHeader->m_RealCount, sizeof(double))
+			|| !IsInFile(m_pHeader->m_EntitiesOffset, m_pHeader->m_EntityCount, sizeof(SnapshotEntity))
+			|| !IsInFile(m_pHeader->m_StringsOffset, m_pHeader->m_StringCount + 1, sizeof(unsigned long long))
+			|| !IsInFile(m_pHeader->m_RecordsOffset, m_pHeader->m_RecordsSize, 1))
+			return false;
+		m_pEnd = m_pStart + m_pHeader->m_RecordsOffset + m_pHeader->m_RecordsSize;
+		return true;
+	}
+
+	bool DxfSnapshot::Save(const DxfData& graph, const char* fileName)
+	{
+		TRACE_FUNCTION("(fileName = %s)", fileName);
+
+		if (!graph.GetLazyEntities().empty())
+		{
+			PRINT_DEBUG_INFO("Lazy entities must be loaded before saving a snapshot.");
+			return false;
+		}
+		// Only the writer's own buffers are modified.
+		DxfData& source = const_cast<DxfData&>(graph);
+		try
+		{
+			std::vector<EntAttribute*> entities;
+			std::map<const EntAttribute*, unsigned int> indexes;
+			SnapshotCollector collector(entities, indexes);
+			Field(collector, source);
+
+			SnapshotWriter writer(indexes);
+			std::vector<SnapshotEntity> records(entities.size());
+			for (size_t i = 0; i < entities.size(); ++i)
+			{
+				records[i].m_Type = GetSnapshotType(*entities[i]);
+				records[i].m_Reserved = 0;
+				records[i].m_Record = writer.m_Records.size();
+				g_SnapshotTypes[records[i].m_Type].m_Save(writer, *entities[i]);
+			}
+			unsigned long long graphRecord = writer.m_Records.size();
+			Field(writer, source);
+			return writer.Write(fileName, records, graphRecord);
+		}
+		catch (const std::logic_error&)
+		{
+			return false;
+		}
+	}
+
+	bool DxfSnapshot::Load(DxfData& graph, const char* fileName)
+	{
+		TRACE_FUNCTION("(fileName = %s)", fileName);
+
+		graph.Reset();
+		CFileMapping file;
+		file.Open(fileName);
+		SnapshotReader reader(file.GetStart(), file.GetFileSize());
+		if (!reader.Open())
+		{
+			PRINT_DEBUG_INFO("%s isn't a snapshot of this version.", fileName);
+			return false;
+		}
+		try
+		{
+			const SnapshotHeader& header = reader.GetHeader();
+			reader.m_Entities.resize(size_t(header.m_EntityCount));
+			for (size_t i = 0; i < reader.m_Entities.size(); ++i)
+			{
+				unsigned int type = reader.GetEntity(i).m_Type;
+				if (type >= _countof(g_SnapshotTypes))
+					ThrowInvalidSnapshot();
+				reader.m_Entities[i] = g_SnapshotTypes[type].m_Create();
+			}
+			for (size_t i = 0; i < reader.m_Entities.size(); ++i)
+			{
+				reader.Seek(reader.GetEntity(i).m_Record);
+				g_SnapshotTypes[reader.GetEntity(i).m_Type].m_Load(reader, *reader.m_Entities[i]);
+			}
+			reader.Seek(header.m_GraphRecord);
+			Field(reader, graph);
+		}
+		catch (const std::runtime_error&)
+		{
+			graph.Reset();
+			return false;
+		}
+		return true;
+	}
+
+	std::string DxfSnapshot::GetCacheFileName(const char* dxfFileName, const char* cacheDir, bool OnlyReadModelSpace)
+	{
+		CFileMapping file;
+		file.Open(dxfFileName);
+		if (file.GetStart() == nullptr && file.GetFileSize() != 0)
+			return std::string();
+		// What is read depends on OnlyReadModelSpace as well.
+		unsigned long long hash = HashBytes(file.GetStart(), size_t(file.GetFileSize()));
+		hash = HashBytes(&OnlyReadModelSpace, sizeof(OnlyReadModelSpace), hash);
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.dxfsnap", hash);
+		std::string fileName = cacheDir;
+		if (!fileName.empty() && fileName.back() != '/' && fileName.back() != '\\')
+			fileName += '/';
+		return fileName + name;
+	}
+
+} // namespace DXF
@@ -0,0 +1,37 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <string>
+
+#include "ImpExpMacro.h"
+
+namespace DXF
+{
+	class DxfData;
+
+	// Native binary snapshot of a DxfData(*.dxfsnap), loaded without parsing DXF.
+	// It holds a string table, pools of points and reals, one typed record per entity and the tables,
+	// blocks and layouts. Links between entities, e.g. reactors, hatch associations and viewport clip
+	// entities, are stored as indexes of entities. Numbers are little-endian, the same as the supported platforms.
+	// The format is private to this version of the library, snapshots of other versions are rejected.
+	class DXF_API DxfSnapshot
+	{
+	public:
+		// Return false if graph has lazy entities, see ReadOptions::m_Lazy, or it can't be written.
+		static bool Save(const DxfData &graph, const char *fileName);
+		// graph is reset first. Return false if the snapshot is missing or invalid, graph is kept empty then.
+		static bool Load(DxfData &graph, const char *fileName);
+		// Snapshot file in cacheDir named by the hash of the content of dxfFileName, see ReadOptions::m_SnapshotDir.
+		// Return an empty string if dxfFileName can't be read.
+		static std::string GetCacheFileName(const char *dxfFileName, const char *cacheDir, bool OnlyReadModelSpace);
+	};
+
+} // namespace DXF
@@ -0,0 +1,644 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+
+#include <climits>
+#include <cstring>
+#include <cwctype>
+#include <algorithm>
+#include <memory>
+
+#include "DxfTokenizer.h"
+#include "ifstream.h"
+#include "Compression.h"
+#include "DxfPipeline.h"
+#include "utility.h"
+
+using namespace std;
+#pragma warning(disable:4996)
+
+namespace DXF
+{
+	// Buffer of ifstream when reading from a source
+	const size_t g_SourceBufferSize = 64 << 10;
+	// Decompressed bytes waiting for the tokenizer
+	const size_t g_DecompressRingSize = 4 << 20;
+
+	DxfTokenizer::DxfTokenizer()
+		: m_DxfFile(*new DXF::ifstream)
+		, m_Decompressor(*new Decompressor)
+		, m_Binary(false)
+		, m_Seekable(false)
+		, m_PairOffset(0)
+		, m_pPairValue(nullptr)
+		, m_PairIsNumber(false)
+		, m_PairReal(0.0)
+		, m_PairInt(0)
+		, m_WindowSize(0)
+		, m_PipelineBatchSize(0)
+		, m_PipelineRingSize(0)
+		, m_PipelineValueSize(0)
+		, m_PipelineSize(0)
+		, m_NextOffset(0)
+		, m_PipelineFail(false)
+	{
+	}
+
+	DxfTokenizer::~DxfTokenizer()
+	{
+		m_pPipeline.reset();
+		delete &m_Decompressor;
+		delete &m_DxfFile;
+	}
+
+	void DxfTokenizer::SetMappingWindowSize(size_t windowSize)
+	{
+		m_WindowSize = windowSize;
+		m_DxfFile.setwindowsize(windowSize);
+	}
+
+	void DxfTokenizer::SetPipeline(size_t batchSize, size_t ringSize, int valueSize)
+	{
+		m_PipelineBatchSize = batchSize;
+		m_PipelineRingSize = ringSize;
+		m_PipelineValueSize = valueSize;
+	}
+
+	void DxfTokenizer::GetPipelineStats(PipelineStats& stats) const
+	{
+		if (m_pPipeline)
+			m_pPipeline->GetStats(stats);
+	}
+
+	bool DxfTokenizer::OpenPipeline(const std::function<bool(DxfTokenizer&)>& open)
+	{
+		m_pPipeline.reset(new PairPipeline(m_PipelineBatchSize, m_PipelineRingSize, m_PipelineValueSize));
+		DxfTokenizer& source = m_pPipeline->GetSource();
+		source.SetMappingWindowSize(m_WindowSize);
+		if (!open(source))
+		{
+			m_pPipeline.reset();
+			return false;
+		}
+		m_Binary = source.m_Binary;
+		m_Seekable = source.m_Seekable;
+		// The source is read by the tokenizing thread from now on.
+		m_PipelineSize = source.GetSize();
+		m_pPipeline->Start();
+		return true;
+	}
+
+	void DxfTokenizer::Reset()
+	{
+		m_PutBackPairs.clear();
+		m_Binary = false;
+		m_Seekable = false;
+		m_PairOffset = 0;
+		m_pPairValue = nullptr;
+		m_PairIsNumber = false;
+		m_pPipeline.reset();
+		m_PipelineSize = 0;
+		m_NextOffset = 0;
+		m_PipelineFail = false;
+	}
+
+	bool DxfTokenizer::Open(const char* fileName)
+	{
+		Reset();
+		if (m_PipelineBatchSize > 0)
+			return OpenPipeline([fileName](DxfTokenizer& source) { return source.Open(fileName); });
+		Compression compression = DetectFileCompression(fileName);
+		if (compression == Compression::None)
+		{
+			m_DxfFile.open(fileName);
+			m_Seekable = true;
+			return BeginRead();
+		}
+		FILE* fp = fopen(fileName, "rb");
+		if (fp == nullptr)
+			return false;
+		std::shared_ptr<FILE> file(fp, fclose);
+		OpenDecompressed(compression, [file](char* buffer, size_t size)
+		{
+			return fread(buffer, 1, size, file.get());
+		}, g_SourceBufferSize);
+		return BeginRead();
+	}
+
+	bool DxfTokenizer::Open(const char* data, size_t len)
+	{
+		Reset();
+		if (m_PipelineBatchSize > 0)
+			return OpenPipeline([data, len](DxfTokenizer& source) { return source.Open(data, len); });
+		Compression compression = DetectCompression(data, len);
+		if (compression == Compression::None)
+		{
+			m_DxfFile.open(data, len);
+			m_Seekable = true;
+			return BeginRead();
+		}
+		size_t pos = 0;
+		OpenDecompressed(compression, [data, len, pos](char* buffer, size_t size) mutable
+		{
+			size_t count = std::min(size, len - pos);
+			memcpy(buffer, data + pos, count);
+			pos += count;
+			return count;
+		}, g_SourceBufferSize);
+		return BeginRead();
+	}
+
+	bool DxfTokenizer::Open(const Source& source, size_t bufferSize)
+	{
+		Reset();
+		if (m_PipelineBatchSize > 0)
+			return OpenPipeline([&source, bufferSize](DxfTokenizer& pipelineSource) { return pipelineSource.Open(source, bufferSize); });
+		// Read the magic bytes, then give them back before the rest of source.
+		auto magic = std::make_shared<std::string>();
+		char buffer[4];
+		size_t count;
+		while (magic->size() < sizeof(buffer) && (count = source(buffer, sizeof(buffer) - magic->size())) > 0)
+			magic->append(buffer, count);
+		Compression compression = DetectCompression(magic->data(), magic->size());
+		Source input = [magic, source](char* buffer, size_t size)
+		{
+			if (magic->empty())
+				return source(buffer, size);
+			size_t count = std::min(size, magic->size());
+			memcpy(buffer, magic->data(), count);
+			magic->erase(0, count);
+			return count;
+		};
+		if (compression == Compression::None)
+			m_DxfFile.open(input, bufferSize);
+		else
+			OpenDecompressed(compression, input, bufferSize);
+		return BeginRead();
+	}
+
+	void DxfTokenizer::OpenDecompressed(Compression compression, const Source& input, size_t bufferSize)
+	{
+		if (!IsCompressionSupported(compression))
+		{
+			PRINT_DEBUG_INFO("The library is built without the codec of the compression.");
+			return;
+		}
+		m_Decompressor.Start(compression, input, g_DecompressRingSize);
+		m_DxfFile.open([this](char* buffer, size_t size)
+		{
+			return m_Decompressor.Read(buffer, size);
+		}, bufferSize);
+	}
+
+	void DxfTokenizer::Close()
+	{
+		// The pipeline is kept for its stats.
+		if (m_pPipeline)
+		{
+			m_pPipeline->Stop();
+			m_PipelineFail = true;
+		}
+		if (m_DxfFile.is_open())
+			m_DxfFile.close();
+		m_Decompressor.Stop();
+		m_PutBackPairs.clear();
+		m_Seekable = false;
+	}
+
+	void DxfTokenizer::CheckEnd()
+	{
+		if (m_pPipeline)
+		{
+			// The tokenizing thread checks the end after EOF, its error comes with the last batch.
+			const char* value;
+			while (m_pPipeline->Next(value) != nullptr)
+			{
+			}
+			m_PipelineFail = true;
+			return;
+		}
+		m_Decompressor.Drain();
+	}
+
+	bool DxfTokenizer::fail()
+	{
+		return m_PutBackPairs.empty() && (m_pPipeline ? m_PipelineFail : m_DxfFile.fail());
+	}
+
+	bool DxfTokenizer::Tell(unsigned long long& offset)
+	{
+		if (!m_PutBackPairs.empty())
+			return false;
+		offset = m_pPipeline ? m_NextOffset : (unsigned long long)m_DxfFile.tellg();
+		return true;
+	}
+
+	unsigned long long DxfTokenizer::GetSize()
+	{
+		if (m_pPipeline)
+			return m_PipelineSize;
+		return m_Seekable ? m_DxfFile.getsize() : 0;
+	}
+
+	void DxfTokenizer::Seek(unsigned long long offset)
+	{
+		ASSERT_DEBUG_INFO(IsSeekable());
+		m_PutBackPairs.clear();
+		m_DxfFile.clear();
+		m_DxfFile.seekg(offset);
+	}
+
+	void DxfTokenizer::ReadPair(int& groupCode, char* value, int bufsize)
+	{
+		// Don't use TRACE_FUNCTION, it is a high frequent function.
+
+		if (!m_PutBackPairs.empty())
+		{
+			const DxfPair& pair = m_PutBackPairs.back();
+			groupCode = pair.m_GroupCode;
+			strncpy(value, pair.m_Value.c_str(), bufsize - 1);
+			value[bufsize - 1] = 0;
+			m_pPairValue = value;
+			m_PairIsNumber = pair.m_IsNumber;
+			m_PairReal = pair.m_Real;
+			m_PairInt = pair.m_Int;
+			m_PutBackPairs.pop_back();
+			return;
+		}
+		if (m_pPipeline)
+		{
+			ReadPipelinedPair(groupCode, value, bufsize);
+			return;
+		}
+		m_PairOffset = m_DxfFile.tellg();
+		if (m_Binary)
+		{
+			ReadBinaryPair(groupCode, value, bufsize);
+			return;
+		}
+
+		m_DxfFile >> groupCode;
+		m_DxfFile.ignore(INT_MAX, '\n');
+		ReadTextValue(value, bufsize);
+	}
+
+	void DxfTokenizer::ReadPipelinedPair(int& groupCode, char* value, int bufsize)
+	{
+		const char* pValue = nullptr;
+		const PipelinedPair* pPair = m_PipelineFail ? nullptr : m_pPipeline->Next(pValue);
+		m_pPairValue = value;
+		if (pPair == nullptr)
+		{
+			// Past the end of data
+			m_PipelineFail = true;
+			m_PairIsNumber = false;
+			groupCode = -1;
+			value[0] = 0;
+			return;
+		}
+		groupCode = pPair->m_GroupCode;
+		strncpy(value, pValue, bufsize - 1);
+		value[bufsize - 1] = 0;
+		m_PairIsNumber = pPair->m_IsNumber;
+		m_PairReal = pPair->m_Real;
+		m_PairInt = pPair->m_Int;
+		m_PairOffset = pPair->m_Offset;
+		m_NextOffset = pPair->m_End;
+		m_PipelineFail = pPair->m_Fail;
+	}
+
+	// The same as memchr(p, '\n', pEnd - p), but faster for lines of DXF, which are short.
+	static const char* FindLineEnd(const char* p, const char* pEnd)
+	{
+		// Test 8 bytes at a time for a byte of '\n'.
+		const unsigned long long ones = 0x0101010101010101ULL;
+		const unsigned long long highs = 0x8080808080808080ULL;
+		while (pEnd - p >= 8)
+		{
+			unsigned long long word;
+			memcpy(&word, p, 8);
+			word ^= ones * '\n';
+			if (((word - ones) & ~word & highs) != 0)
+				break;
+			p += 8;
+		}
+		while (p < pEnd)
+		{
+			if (*p == '\n')
+				return p;
+			++p;
+		}
+		return nullptr;
+	}
+
+	// Return the length of the leading pairs of ASCII DXF in [pStart, pStart + count) whose group codes
+	// aren't 0 or code. It stops at a pair not entirely in the range or whose group code isn't a number.
+	// If it stops at a pair of group code 0 or code, pValueEnd is the end of its value line.
+	static size_t SkipTextPairs(const char* pStart, size_t count, int code, int& groupCode, const char*& pValueEnd)
+	{
+		const char* pEnd = pStart + count;
+		const char* pPair = pStart;
+		pValueEnd = nullptr;
+		while (true)
+		{
+			// The group code line is parsed as it is scanned.
+			const char* p = pPair;
+			while (p < pEnd && (*p == ' ' || *p == '\t'))
+				++p;
+			bool bNegative = p < pEnd && *p == '-';
+			if (bNegative)
+				++p;
+			const char* pDigits = p;
+			groupCode = 0;
+			while (p < pEnd && unsigned(*p - '0') < 10 && p - pDigits < 6)
+				groupCode = groupCode * 10 + (*p++ - '0');
+			if (p == pDigits)
+				return size_t(pPair - pStart);
+			while (p < pEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+				++p;
+			if (p == pEnd || *p != '\n')
+				return size_t(pPair - pStart);
+			if (bNegative)
+				groupCode = -groupCode;
+			const char* pLineEnd = FindLineEnd(p + 1, pEnd);
+			if (pLineEnd == nullptr)
+				return size_t(pPair - pStart);
+			if (groupCode == 0 || groupCode == code)
+			{
+				pValueEnd = pLineEnd;
+				return size_t(pPair - pStart);
+			}
+			pPair = pLineEnd + 1;
+		}
+	}
+
+	// The same as SkipTextPairs for binary DXF.
+	static size_t SkipBinaryPairs(const char* pStart, size_t count, int code)
+	{
+		const char* pEnd = pStart + count;
+		const char* pPair = pStart;
+		while (pEnd - pPair >= 2)
+		{
+			int groupCode = (unsigned char)pPair[0] | ((unsigned char)pPair[1] << 8);
+			if (groupCode == 0 || groupCode == code)
+				break;
+			const char* p = pPair + 2;
+			size_t size = 0;
+			switch (GetBinaryValueType(groupCode))
+			{
+			case BinaryValueType::String:
+			{
+				const char* pNul = (const char*)memchr(p, 0, size_t(pEnd - p));
+				if (pNul == nullptr)
+					return size_t(pPair - pStart);
+				size = size_t(pNul - p) + 1;
+				break;
+			}
+			case BinaryValueType::Chunk:
+				if (p == pEnd)
+					return size_t(pPair - pStart);
+				size = 1 + (unsigned char)*p;
+				break;
+			case BinaryValueType::Real:
+			case BinaryValueType::Int64:
+				size = 8;
+				break;
+			case BinaryValueType::Int32:
+				size = 4;
+				break;
+			case BinaryValueType::Int16:
+				size = 2;
+				break;
+			case BinaryValueType::Bool:
+				size = 1;
+				break;
+			}
+			if (size_t(pEnd - p) < size)
+				break;
+			pPair = p + size;
+		}
+		return size_t(pPair - pStart);
+	}
+
+	void DxfTokenizer::SkipToPair(int code, int& groupCode, char* value, int bufsize)
+	{
+		// Don't use TRACE_FUNCTION, it is a high frequent function.
+
+		while (!m_PutBackPairs.empty())
+		{
+			ReadPair(groupCode, value, bufsize);
+			if (groupCode == 0 || groupCode == code)
+				return;
+		}
+		value[0] = 0;
+		if (m_pPipeline)
+		{
+			// The tokenizing thread has read the values already.
+			while (!fail())
+			{
+				ReadPair(groupCode, value, bufsize);
+				if (groupCode == 0 || groupCode == code)
+					return;
+			}
+			groupCode = -1;
+			value[0] = 0;
+			return;
+		}
+		while (!m_DxfFile.fail())
+		{
+			// Skip the pairs in the buffer of m_DxfFile at once, then read the pair found or across the end of the buffer.
+			size_t count;
+			const char* pStart = m_DxfFile.peekbuf(count);
+			if (m_Binary)
+			{
+				m_DxfFile.advance(SkipBinaryPairs(pStart, count, code));
+				if (m_DxfFile.fail())
+					break;
+				m_PairOffset = m_DxfFile.tellg();
+				ReadBinaryPair(groupCode, value, bufsize);
+				if (groupCode == 0 || groupCode == code)
+					return;
+				continue;
+			}
+			const char* pValueEnd;
+			size_t skipped = SkipTextPairs(pStart, count, code, groupCode, pValueEnd);
+			m_DxfFile.advance(skipped);
+			if (m_DxfFile.fail())
+				break;
+			m_PairOffset = m_DxfFile.tellg();
+			if (pValueEnd != nullptr)
+			{
+				// The pair found is in the buffer, take its value the same way as ReadTextValue.
+				const char* pValue = (const char*)memchr(pStart + skipped, '\n', size_t(pValueEnd - pStart - skipped)) + 1;
+				const char* pValueStart = pValue;
+				while (pValueStart < pValueEnd && iswspace((unsigned char)*pValueStart))
+					++pValueStart;
+				const char* pValueStop = pValueEnd;
+				while (pValueStop > pValueStart && iswspace((unsigned char)pValueStop[-1]))
+					--pValueStop;
+				size_t len = std::min(size_t(pValueStop - pValueStart), size_t(bufsize - 1));
+				memcpy(value, pValueStart, len);
+				value[len] = 0;
+				m_DxfFile.advance(size_t(pValueEnd + 1 - pStart - skipped));
+				return;
+			}
+			m_DxfFile >> groupCode;
+			m_DxfFile.ignore(INT_MAX, '\n');
+			if (groupCode == 0 || groupCode == code)
+			{
+				ReadTextValue(value, bufsize);
+				return;
+			}
+			m_DxfFile.ignore(INT_MAX, '\n');
+		}
+		groupCode = -1;
+	}
+
+	void DxfTokenizer::ReadTextValue(char* value, int bufsize)
+	{
+		m_DxfFile.getline(value, bufsize);
+		// The line is longer than the buffer, skip the rest of it.
+		if (strlen(value) == size_t(bufsize - 1))
+			m_DxfFile.ignore(INT_MAX, '\n');
+		// Trim whitespace from both ends of value
+		size_t len = strlen(value);
+		char* pStart = value;
+		char* pEnd = value + len;
+		while (pStart < pEnd)
+		{
+			if (iswspace(*pStart) == 0)
+				break;
+			++pStart;
+		}
+		while (pEnd > pStart)
+		{
+			char* pTemp = pEnd - 1;
+			if (iswspace(*pTemp))
+			{
+				pEnd = pTemp;
+			}
+			else
+			{
+				break;
+			}
+		}
+		*pEnd = 0;
+		if (value != pStart)
+		{
+			size_t len = size_t(pEnd - pStart);
+			memmove(value, pStart, len);
+			value[len] = 0;
+		}
+	}
+
+	void DxfTokenizer::ReadBinaryPair(int& groupCode, char* value, int bufsize)
+	{
+		// Numbers are little-endian, the same as the supported platforms.
+		unsigned short code = 0;
+		m_DxfFile.readraw(&code, sizeof(code));
+		groupCode = code;
+		m_pPairValue = value;
+		m_PairIsNumber = true;
+		value[0] = 0;
+		switch (GetBinaryValueType(groupCode))
+		{
+		case BinaryValueType::String:
+			m_PairIsNumber = false;
+			m_DxfFile.getline(value, bufsize, '\0');
+			// The string is longer than the buffer, skip the rest of it.
+			if (strlen(value) == size_t(bufsize - 1))
+				m_DxfFile.ignore(INT_MAX, '\0');
+			break;
+		case BinaryValueType::Chunk:
+		{
+			// Written as hex digits, the same as in ASCII DXF.
+			m_PairIsNumber = false;
+			unsigned char len = 0;
+			unsigned char bytes[UCHAR_MAX];
+			m_DxfFile.readraw(&len, 1);
+			m_DxfFile.readraw(bytes, len);
+			int count = std::min(int(len), (bufsize - 1) / 2);
+			for (int i = 0; i < count; ++i)
+			{
+				value[2 * i] = "0123456789ABCDEF"[bytes[i] >> 4];
+				value[2 * i + 1] = "0123456789ABCDEF"[bytes[i] & 0xF];
+			}
+			value[2 * count] = 0;
+			break;
+		}
+		case BinaryValueType::Real:
+			m_DxfFile.readraw(&m_PairReal, sizeof(double));
+			m_PairInt = (long long)m_PairReal;
+			break;
+		case BinaryValueType::Int16:
+		{
+			short v = 0;
+			m_DxfFile.readraw(&v, sizeof(v));
+			m_PairInt = v;
+			m_PairReal = double(v);
+			break;
+		}
+		case BinaryValueType::Int32:
+		{
+			int v = 0;
+			m_DxfFile.readraw(&v, sizeof(v));
+			m_PairInt = v;
+			m_PairReal = double(v);
+			break;
+		}
+		case BinaryValueType::Int64:
+			m_DxfFile.readraw(&m_PairInt, sizeof(long long));
+			m_PairReal = double(m_PairInt);
+			break;
+		case BinaryValueType::Bool:
+		{
+			unsigned char v = 0;
+			m_DxfFile.readraw(&v, 1);
+			m_PairInt = v;
+			m_PairReal = double(v);
+			break;
+		}
+		}
+	}
+
+	bool DxfTokenizer::BeginRead()
+	{
+		if (!m_DxfFile.is_open() || !m_DxfFile.good())
+			return false;
+		// ASCII DXF begins with a group code.
+		if (m_DxfFile.peek() != g_BinaryDxfSentinel[0])
+			return true;
+		char sentinel[sizeof(g_BinaryDxfSentinel)];
+		m_DxfFile.readraw(sentinel, sizeof(sentinel));
+		if (m_DxfFile.fail() || memcmp(sentinel, g_BinaryDxfSentinel, sizeof(sentinel)) != 0)
+		{
+			PRINT_DEBUG_INFO("Invalid binary DXF sentinel.");
+			return false;
+		}
+		m_Binary = true;
+		return true;
+	}
+
+	void DxfTokenizer::MakePair(int groupCode, const char* value, DxfPair& pair) const
+	{
+		pair.m_GroupCode = groupCode;
+		pair.m_Value = value;
+		pair.m_IsNumber = m_PairIsNumber && value == m_pPairValue;
+		pair.m_Real = m_PairReal;
+		pair.m_Int = m_PairInt;
+	}
+
+	void DxfTokenizer::PutBackPair(int groupCode, const char* value)
+	{
+		m_PutBackPairs.emplace_back();
+		MakePair(groupCode, value, m_PutBackPairs.back());
+	}
+
+} // namespace DXF
@@ -0,0 +1,162 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace DXF
+{
+	class ifstream;
+	class Decompressor;
+	class PairPipeline;
+	struct PipelineStats;
+	enum class Compression;
+
+	// A group code and its value.
+	struct DxfPair
+	{
+		DxfPair()
+			: m_GroupCode(0)
+			, m_IsNumber(false)
+			, m_Real(0.0)
+			, m_Int(0)
+		{
+		}
+		double Real() const
+		{
+			return m_IsNumber ? m_Real : atof(m_Value.c_str());
+		}
+		int Int() const
+		{
+			return m_IsNumber ? int(m_Int) : atoi(m_Value.c_str());
+		}
+
+		int m_GroupCode;
+		// Empty for numbers of binary DXF, they are kept in m_Real and m_Int as they are read.
+		std::string m_Value;
+		bool m_IsNumber;
+		double m_Real;
+		long long m_Int;
+	};
+
+	// Splits ASCII or binary DXF, gzip or zstd compressed or not, into group pairs.
+	// It never seeks backward while reading, pairs read ahead are put back instead.
+	class DxfTokenizer
+	{
+	public:
+		// Fill buffer with at most size bytes and return the count, 0 means the end of data.
+		typedef std::function<size_t(char *buffer, size_t size)> Source;
+
+		DxfTokenizer();
+		DxfTokenizer(const DxfTokenizer &) = delete;
+		~DxfTokenizer();
+		// See DxfReader::SetMappingWindowSize
+		void SetMappingWindowSize(size_t windowSize);
+		// Tokenize data opened later on another thread, in batches of batchSize pairs, ringSize batches ahead at most.
+		// Values are read with buffers of valueSize bytes. batchSize 0 turns it off.
+		// The data isn't seekable then and ReadPair may throw std::runtime_error if reading fails.
+		void SetPipeline(size_t batchSize, size_t ringSize, int valueSize);
+		// Stats of the pipeline of the data opened, kept after Close.
+		void GetPipelineStats(PipelineStats &stats) const;
+		// The Open functions detect compression and binary DXF, return false if the data can't be read.
+		bool Open(const char *fileName);
+		// data is owned by the caller and not copied.
+		bool Open(const char *data, size_t len);
+		// If the data is compressed, source is called on the decompressing thread.
+		bool Open(const Source &source, size_t bufferSize);
+		void Close();
+		// Call when the last pair needed is read, e.g. EOF. The rest of compressed data is decompressed
+		// without being tokenized, so that a truncated or corrupt end of it throws std::runtime_error.
+		void CheckEnd();
+		// Reading failed, e.g. at the end of data.
+		bool fail();
+		// Tell and Seek work on files and data opened without compression.
+		bool IsSeekable() const
+		{
+			return m_Seekable && !m_pPipeline;
+		}
+		// Offset of the next pair in the data, return false if pairs are put back.
+		bool Tell(unsigned long long &offset);
+		// Read pairs from offset on, pairs put back are discarded.
+		void Seek(unsigned long long offset);
+		// Size of the data if it is seekable, otherwise 0.
+		unsigned long long GetSize();
+		// Offset of the last pair read from the data, reading pairs put back doesn't change it.
+		unsigned long long LastPairOffset() const
+		{
+			return m_PairOffset;
+		}
+
+		void ReadPair(int &groupCode, char *value, int bufsize);
+		// Skip pairs up to the next one of group code 0 or code, which is read as ReadPair does.
+		// Values of the pairs skipped aren't copied or trimmed, so it is much faster than ReadPair.
+		// groupCode is -1 if no such pair is left.
+		void SkipToPair(int code, int &groupCode, char *value, int bufsize);
+		// The next ReadPair returns this pair, the last put back pair first.
+		void PutBackPair(int groupCode, const char *value);
+		void PutBackPair(const DxfPair &pair)
+		{
+			m_PutBackPairs.push_back(pair);
+		}
+		// value must be the buffer just passed to ReadPair.
+		void MakePair(int groupCode, const char *value, DxfPair &pair) const;
+		// Numbers of binary DXF are kept as they are read, value of such pairs is empty.
+		// value must be the buffer just passed to ReadPair.
+		double ToReal(const char *value) const
+		{
+			return m_PairIsNumber && value == m_pPairValue ? m_PairReal : atof(value);
+		}
+		int ToInt(const char *value) const
+		{
+			return m_PairIsNumber && value == m_pPairValue ? int(m_PairInt) : atoi(value);
+		}
+
+	private:
+		friend class PairPipeline;
+
+		void Reset();
+		bool OpenPipeline(const std::function<bool(DxfTokenizer &)> &open);
+		// Take the next pair from m_pPipeline.
+		void ReadPipelinedPair(int &groupCode, char *value, int bufsize);
+		void OpenDecompressed(Compression compression, const Source &input, size_t bufferSize);
+		// Check the stream just opened and read the binary DXF sentinel if any.
+		bool BeginRead();
+		void ReadBinaryPair(int &groupCode, char *value, int bufsize);
+		// Read the value line of an ASCII pair.
+		void ReadTextValue(char *value, int bufsize);
+
+		DXF::ifstream &m_DxfFile;
+		Decompressor &m_Decompressor;
+		// Pairs to be returned by ReadPair before reading the file, the last one first.
+		std::vector<DxfPair> m_PutBackPairs;
+		bool m_Binary;
+		bool m_Seekable;
+		unsigned long long m_PairOffset;
+		// Number of the last pair read from binary DXF into m_pPairValue.
+		const char *m_pPairValue;
+		bool m_PairIsNumber;
+		double m_PairReal;
+		long long m_PairInt;
+		size_t m_WindowSize;
+		size_t m_PipelineBatchSize;
+		size_t m_PipelineRingSize;
+		int m_PipelineValueSize;
+		std::unique_ptr<PairPipeline> m_pPipeline;
+		unsigned long long m_PipelineSize;
+		// Offset after the last pair taken from m_pPipeline, and whether reading failed there.
+		unsigned long long m_NextOffset;
+		bool m_PipelineFail;
+	};
+
+} // namespace DXF
@@ -10,6 +10,10 @@
 #include "stdafx.h"
 
 #include <time.h>
+#include <cstdio>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <algorithm>
 #include <string>
 
@@ -18,50 +22,103 @@
 #include "AcadEntities.h"
 #include "DxfData.h"
 #include "DxfWriter.h"
+#include "ThreadPool.h"
 using namespace std;
 
 #pragma warning(disable:4996)
 
 namespace DXF {
-
-	VectorOfEntityList DxfWriter::s_PredefinedBlocks;
-	void InitPredefinedBlocks(VectorOfEntityList& g_PredefinedBlocks);
+	// Buffer of uncompressed output files
+	const size_t g_OutBufferSize = 64 << 10;
 
 	DxfWriter::DxfWriter(DxfData& graph)
-		: m_Graph(graph)
-		, m_Handle(0x2FF)
+		: DxfWriter(static_cast<const DxfData&>(graph))
+	{
+		m_pMutableGraph = &graph;
+	}
+
+	DxfWriter::DxfWriter(const DxfData& graph)
+		: m_CompressStream(&m_CompressBuf)
+		, m_pOut(&m_DxfFile)
+		, m_pRecording(nullptr)
+		, m_pRecordStream(nullptr)
+		, m_PredefinedEntityHandle(0)
+		, m_Graph(graph)
+		, m_pMutableGraph(nullptr)
 		, m_LayoutIndex(0)
+		, m_VPortHandle(0)
+		, m_AppIdHandle(0)
 	{
 	}
 
-	void DxfWriter::WriteDxf(const char* dxfFile, const char* linFile, const char* patFile, const CDblPoint& center, double height)
+	bool DxfWriter::WriteDxf(const char* dxfFile, const char* linFile, const char* patFile, const CDblPoint& center, double height)
 	{
 		srand((unsigned)time(NULL));
 
+		bool bSuccess = false;
+		bool bOpened = false;
 		try
 		{
+			// Missing files are reported by Load(), the built-in tables are used instead.
 			m_LinetypeManager.SetLinFile(linFile);
-			if (!m_LinetypeManager.IsValid())
+			m_PatternManager.SetPatFile(patFile);
+			// Lazy entities are checked before the file is created, so that no partial drawing is left.
+			if (m_pMutableGraph)
 			{
-				return;
+				if (!m_pMutableGraph->LoadAllEntities())
+				{
+					PRINT_DEBUG_INFO("Can't load the lazy entities.");
+					return false;
+				}
 			}
-			m_PatternManager.SetPatFile(patFile);
-			m_DxfFile.open(dxfFile);
-			if (!m_PatternManager.IsValid())
+			else if (!m_Graph.GetLazyEntities().empty())
 			{
-				return;
+				PRINT_DEBUG_INFO("Lazy entities must be loaded before writing with DxfWriter(const DxfData &).");
+				return false;
+			}
+			if (m_Options.m_Compression == Compression::None)
+			{
+				// The buffer is kept for the next file, and is larger than the default one so that there are fewer writes.
+				if (m_OutBuffer.empty())
+					m_OutBuffer.resize(g_OutBufferSize);
+				m_DxfFile.rdbuf()->pubsetbuf(m_OutBuffer.data(), std::streamsize(m_OutBuffer.size()));
+				m_DxfFile.open(dxfFile, m_Options.m_Binary ? std::ios::out | std::ios::binary : std::ios::out);
+				bOpened = m_DxfFile.is_open();
+				m_pOut = &m_DxfFile;
 			}
-			if (!m_DxfFile.is_open())
+			else if (!IsCompressionSupported(m_Options.m_Compression))
+			{
+				PRINT_DEBUG_INFO("The library is built without the codec of the compression.");
+				return false;
+			}
+			else
+			{
+				bOpened = m_CompressBuf.open(dxfFile, m_Options.m_Compression, m_Options.m_CompressionLevel);
+				m_CompressStream.clear();
+				m_pOut = &m_CompressStream;
+			}
+			if (!bOpened)
 			{
 				PRINT_DEBUG_INFO("Can't open file %s，Maybe because it is opened by AutoCAD.", dxfFile);
-				return;
+				return false;
 			}
 
+			m_Progress.Start(m_Options.m_Progress, m_Options.m_ProgressInterval, m_Options.m_CancelToken, [this]()
+			{
+				std::streamoff pos = m_pOut->tellp();
+				return pos < 0 ? 0ULL : (unsigned long long)pos;
+			}, 0);
+			if (m_Options.m_Binary)
+				m_pOut->write(g_BinaryDxfSentinel, sizeof(g_BinaryDxfSentinel));
+
 			// Clear writing state
 			Reset();
-			InitPredefinedBlocks(s_PredefinedBlocks);
-			int handle = m_Graph.PrepareBeforeWrite();
-			PrepareBeforeWrite(handle);
+			if (m_pMutableGraph)
+				m_pMutableGraph->GenerateDimensionBlocks();
+			m_Graph.PrepareBeforeWrite(m_Context);
+			if (m_pMutableGraph)
+				m_pMutableGraph->ApplyWriteContext(m_Context);
+			PrepareBeforeWrite();
 
 			// Header
 			HeaderSection();
@@ -71,25 +128,25 @@ namespace DXF {
 			{
 				VPortTable(center, height);
 
-				BeginLTypeTable(3 + int(m_Graph.m_Linetypes.size()));
+				BeginLTypeTable(3 + int(m_Context.m_Linetypes.size()));
 				LTypeEntry_ByBlock_ByLayer_Continuous();
-				for (const std::string& linetype : m_Graph.m_Linetypes)
+				for (const std::string& linetype : m_Context.m_Linetypes)
 				{
-					LTypeEntry(linetype.c_str(), ++m_Handle);
+					LTypeEntry(linetype.c_str(), LookupLinetypeHandle(linetype));
 				}
 				EndTable();
 
-				BeginLayerTable(int(m_Graph.m_Layers.size()));
-				for (const auto& layer : m_Graph.m_Layers)
+				BeginLayerTable(int(m_Context.m_Layers.size()));
+				for (const auto& layer : m_Context.m_Layers)
 				{
-					LayerEntry(layer, ++m_Handle);
+					LayerEntry(layer, m_LayerHandleTable[layer.first]);
 				}
 				EndTable();
 
-				BeginStyleTable(int(m_Graph.m_TextStyles.size()));
-				for (const auto& textStyle : m_Graph.m_TextStyles)
+				BeginStyleTable(int(m_Context.m_TextStyles.size()));
+				for (const auto& textStyle : m_Context.m_TextStyles)
 				{
-					StyleEntry(textStyle, ++m_Handle);
+					StyleEntry(textStyle, LookupTextStyleHandle(textStyle.first));
 				}
 				EndTable();
 
@@ -106,16 +163,17 @@ namespace DXF {
 						continue;
 					++predefinedBlockCount;
 				}
-				BeginBlock_RecordTable(1 + int(m_Graph.m_Layouts.size() + m_Graph.m_RealBlockDefs.size())
+				BeginBlock_RecordTable(1 + int(m_Context.m_Layouts.size() + m_Graph.m_RealBlockDefs.size())
 					+ predefinedBlockCount);
 				BlockRecordEntry_ModelSpace();
-				for (const auto& pair : m_Graph.m_Layouts)
+				for (const auto& layout : m_Context.m_Layouts)
 				{
-					BlockRecordEntry(pair.second->m_BlockName.c_str(), ++m_Handle, ++m_Handle);
+					BlockRecordEntry(layout.m_BlockName.c_str(), LookupBlockEntryHandle(layout.m_BlockName),
+						LookupLayoutHandle(layout.m_BlockName));
 				}
 				for (const auto & pair : m_Graph.m_RealBlockDefs)
 				{
-					BlockRecordEntry(pair.first.c_str(), ++m_Handle, 0);
+					BlockRecordEntry(pair.first.c_str(), LookupBlockEntryHandle(pair.first), 0);
 				}
 				for (int i = 0; i < 20; ++i)
 				{
@@ -123,14 +181,14 @@ namespace DXF {
 					// If this predefined block is defined in m_RealBlockDefs, don't repeat definition.
 					if (m_Graph.m_RealBlockDefs.find(blockName) != m_Graph.m_RealBlockDefs.end())
 						continue;
-					BlockRecordEntry(blockName, ++m_Handle, 0);
+					BlockRecordEntry(blockName, LookupBlockEntryHandle(blockName), 0);
 				}
 				EndTable();
 
-				BeginDimStyleTable(int(m_Graph.m_DimStyles.size()));
-				for (const auto& dimStyle : m_Graph.m_DimStyles)
+				BeginDimStyleTable(int(m_Context.m_DimStyles.size()));
+				for (const auto& dimStyle : m_Context.m_DimStyles)
 				{
-					DimStyleEntry(dimStyle, ++m_Handle);
+					DimStyleEntry(dimStyle, LookupDimStyleHandle(dimStyle.first));
 				}
 				EndTable();
 			}
@@ -139,38 +197,41 @@ namespace DXF {
 			BeginSection("BLOCKS");
 			{
 				Block_ModelSpace();
-				for (const auto& pair : m_Graph.m_Layouts)
+				for (const auto& layout : m_Context.m_Layouts)
 				{
-					const auto& pLayout = pair.second;
-					BeginBlock(pLayout->m_BlockName.c_str(), 0, 0, ++m_Handle);
+					const auto& blockHandles = m_BlockHandleTable[layout.m_BlockName];
+					BeginBlock(layout.m_BlockName.c_str(), 0, 0, blockHandles.first);
 					// *Paper_Space 块定义内不允许有图元
-					if (pLayout->m_BlockName != "*Paper_Space")
+					if (layout.m_BlockName != "*Paper_Space")
 					{
 						// viewport need write ID which starts from 1
 						m_CurrentViewportID = 0;
-						m_CurrentBlockEntryHandle = LookupBlockEntryHandle(pLayout->m_BlockName);
-						pLayout->WriteDxf(*this);
+						m_CurrentBlockEntryHandle = LookupBlockEntryHandle(layout.m_BlockName);
+						layout.m_Data->WriteDxf(*this);
 					}
-					EndBlock(pLayout->m_BlockName.c_str(), ++m_Handle);
+					EndBlock(layout.m_BlockName.c_str(), blockHandles.second);
 				}
 				for (const auto& pair : m_Graph.m_RealBlockDefs)
 				{
 					m_CurrentBlockEntryHandle = LookupBlockEntryHandle(pair.first);
 					Block(pair, false);
 				}
-				for (int i = 0; i < int(s_PredefinedBlocks.size()); ++i)
+				const auto& predefinedBlocks = PredefinedBlockTemplates(m_Options.m_Binary);
+				for (int i = 0; i < int(predefinedBlocks.size()); ++i)
 				{
 					const char* blockName = GetPredefinedArrowHeadBlockName(i);
 					// If this predefined block is defined in m_RealBlockDefs, don't repeat definition.
 					if (m_Graph.m_RealBlockDefs.find(blockName) != m_Graph.m_RealBlockDefs.end())
-						continue;
-					BeginBlock(blockName, 0, 0, ++m_Handle);
-					for (const auto& pEnt : *s_PredefinedBlocks[i])
 					{
-						m_CurrentBlockEntryHandle = LookupBlockEntryHandle(blockName);
-						pEnt->WriteDxf(*this, false);
+						// Keep handles of other predefined entities the same as it is written.
+						m_PredefinedEntityHandle += predefinedBlocks[i].m_EntityCount;
+						continue;
 					}
-					EndBlock(blockName, ++m_Handle);
+					const auto& blockHandles = m_BlockHandleTable[blockName];
+					BeginBlock(blockName, 0, 0, blockHandles.first);
+					m_CurrentBlockEntryHandle = LookupBlockEntryHandle(blockName);
+					PredefinedBlockEntities(predefinedBlocks[i], m_CurrentBlockEntryHandle);
+					EndBlock(blockName, blockHandles.second);
 				}
 			}
 			EndSection();
@@ -180,18 +241,18 @@ namespace DXF {
 				m_CurrentBlockEntryHandle = LookupBlockEntryHandle("*Model_Space");
 				for (const auto& pEnt : m_Graph.m_Objects)
 				{
-					pEnt->WriteDxf(*this, false);
+					WriteEntity(*pEnt, false);
 				}
 				// *Paper_Space 块定义内不允许有图元
 				// *Paper_Space 块中的图元定义在ENTITIES段
-				for (const auto& pair : m_Graph.m_Layouts)
+				for (const auto& layout : m_Context.m_Layouts)
 				{
-					if (pair.second->m_BlockName == "*Paper_Space")
+					if (layout.m_BlockName == "*Paper_Space")
 					{
 						// viewport need write ID which starts from 1
 						m_CurrentViewportID = 0;
 						m_CurrentBlockEntryHandle = LookupBlockEntryHandle("*Paper_Space");
-						pair.second->WriteDxf(*this);
+						layout.m_Data->WriteDxf(*this);
 					}
 				}
 			}
@@ -202,22 +263,25 @@ namespace DXF {
 				Dictionaries();
 
 				// Write Layouts
-				std::pair<std::string, std::shared_ptr<LayoutData>> modelLayout = { "Model", std::make_shared<LayoutData>() };
-				modelLayout.second->m_BlockName = "*Model_Space";
+				WriteContext::Layout modelLayout;
+				modelLayout.m_Name = "Model";
+				modelLayout.m_Data = std::make_shared<LayoutData>();
+				modelLayout.m_BlockName = "*Model_Space";
+				modelLayout.m_LayoutOrder = modelLayout.m_Data->m_LayoutOrder;
 				Layout(modelLayout);
-				for (const auto& pair : m_Graph.m_Layouts)
+				for (const auto& layout : m_Context.m_Layouts)
 				{
-					Layout(pair);
+					Layout(layout);
 				}
 
 				// Write MLEADERSTYLE
-				for (auto& ls : m_Graph.m_MLeaderStyles)
+				for (auto& ls : m_Context.m_MLeaderStyles)
 				{
 					ls.second.WriteDxf(*this, ls.first, m_MLeaderStyleHandleTable[ls.first]);
 				}
 
 				// Write TABLESTYLE
-				for (auto& ts : m_Graph.m_TableStyles)
+				for (auto& ts : m_Context.m_TableStyles)
 				{
 					ts.second.WriteDxf(*this, ts.first, m_TableStyleHandleTable[ts.first]);
 				}
@@ -225,8 +289,20 @@ namespace DXF {
 			EndSection();
 
 			dxfEOF();
+			m_Progress.Finish();
 
-			m_DxfFile.close();
+			if (m_pOut == &m_DxfFile)
+			{
+				m_DxfFile.close();
+				bSuccess = !m_DxfFile.fail();
+			}
+			else
+			{
+				m_CompressStream.flush();
+				bSuccess = m_CompressBuf.close();
+			}
+			if (!bSuccess)
+				PRINT_DEBUG_INFO("Failed to write file %s.", dxfFile);
 		}
 		catch (const std::logic_error&)
 		{
@@ -234,21 +310,81 @@ namespace DXF {
 		catch (const std::runtime_error&)
 		{
 		}
+		if (!bSuccess && bOpened)
+		{
+			// Cancelled or failed, don't leave the part written, and leave the writer ready for the next file.
+			if (m_pOut == &m_DxfFile)
+			{
+				if (m_DxfFile.is_open())
+					m_DxfFile.close();
+				m_DxfFile.clear();
+			}
+			else
+				m_CompressBuf.close();
+			remove(dxfFile);
+		}
+		m_Progress.Stop();
+		return bSuccess;
+	}
+
+	std::future<bool> DxfWriter::WriteDxfAsync(const char* dxfFile, const char* linFile, const char* patFile, const CDblPoint& center, double height)
+	{
+		// Null file names are kept null.
+		std::shared_ptr<std::string> pLinFile(linFile ? new std::string(linFile) : nullptr);
+		std::shared_ptr<std::string> pPatFile(patFile ? new std::string(patFile) : nullptr);
+		std::string fileName = dxfFile;
+		auto task = std::make_shared<std::packaged_task<bool()>>([this, fileName, pLinFile, pPatFile, center, height]()
+		{
+			return WriteDxf(fileName.c_str(), pLinFile ? pLinFile->c_str() : nullptr, pPatFile ? pPatFile->c_str() : nullptr,
+				center, height);
+		});
+		ThreadPool::GetAsyncPool().Submit([task]()
+		{
+			(*task)();
+		});
+		return task->get_future();
+	}
+
+	void DxfWriter::PreloadTables(const char* linFile, const char* patFile)
+	{
+		LinetypeLibrary::Builtin();
+		PatternLibrary::Builtin();
+		if (linFile != nullptr)
+			LinetypeLibrary::Load(linFile);
+		if (patFile != nullptr)
+			PatternLibrary::Load(patFile);
+		PredefinedBlockTemplates(false);
+		PredefinedBlockTemplates(true);
+	}
+
+	void DxfWriter::WriteEntity(const EntAttribute& ent, bool bInPaperSpace)
+	{
+		m_Progress.EntityDone();
+		ent.WriteDxf(*this, bInPaperSpace);
+	}
+
+	void DxfWriter::Recycle()
+	{
+		Reset();
 	}
 
 	void DxfWriter::Reset()
 	{
-		m_Handle = 0x2FF;
 		m_LayoutIndex = 0;
+		m_VPortHandle = 0;
+		m_AppIdHandle = 0;
 		m_TextStyleHandleTable.clear();
 		m_DimStyleHandleTable.clear();
+		m_LayerHandleTable.clear();
 		m_BlockEntryHandleTable.clear();
 		m_LayoutHandleTable.clear();
+		m_BlockHandleTable.clear();
 		m_MLeaderStyleHandleTable.clear();
 		m_TableStyleHandleTable.clear();
 		m_LinetypeHandleTable.clear();
 		m_MLeaderStyleEntities.clear();
 		m_TableStyleEntities.clear();
+		m_Context.Clear();
 	}
 
 	/**
@@ -259,8 +395,24 @@ namespace DXF {
 	*/
 	void DxfWriter::dxfReal(int gc, double value)
 	{
+		if (m_Options.m_Binary)
+		{
+			BinaryValueType type = GetBinaryValueType(gc);
+			if (type == BinaryValueType::Real)
+			{
+				BinaryGroupCode(gc);
+				m_pOut->write((const char*)&value, sizeof(value));
+				return;
+			}
+			if (type != BinaryValueType::String && type != BinaryValueType::Chunk)
+			{
+				BinaryGroupCode(gc);
+				BinaryInteger(type, (long long)value);
+				return;
+			}
+		}
 		char str[512];
-		sprintf_s(str, sizeof(str), "%f", value);
+		snprintf(str, sizeof(str), "%f", value);
 		char* pEnd = strchr(str, '.');
 		pEnd += 2;
 		char* pStart = pEnd + 4;
@@ -282,7 +434,26 @@ namespace DXF {
 	*/
 	void DxfWriter::dxfInt(int gc, int value)
 	{
-		m_DxfFile << gc << "\n" << value << "\n";
+		if (m_Options.m_Binary)
+		{
+			BinaryValueType type = GetBinaryValueType(gc);
+			if (type == BinaryValueType::Real)
+			{
+				dxfReal(gc, value);
+				return;
+			}
+			if (type != BinaryValueType::String && type != BinaryValueType::Chunk)
+			{
+				BinaryGroupCode(gc);
+				BinaryInteger(type, value);
+				return;
+			}
+			char str[20];
+			sprintf(str, "%d", value);
+			dxfString(gc, str);
+			return;
+		}
+		*m_pOut << gc << "\n" << value << "\n";
 	}
 
 	/**
@@ -291,10 +462,27 @@ namespace DXF {
 	* @param gc Group code.
 	* @param value Int value
 	*/
-	void DxfWriter::dxfHex(int gc, int value)
+	void DxfWriter::dxfHex(int gc, Handle value)
 	{
-		char str[12];
-		sprintf(str, "%0X", value);
+		if (m_pRecording && (gc == 5 || gc == 330))
+		{
+			// Predefined entities have no reactors, so 330 is always the owner block.
+			if (m_Options.m_Binary)
+				BinaryGroupCode(gc);
+			else
+				*m_pRecordStream << gc << "\n";
+			m_pRecording->m_Texts.push_back(m_pRecordStream->str());
+			m_pRecording->m_Slots.push_back(gc == 5 ? PredefinedBlockTemplate::EntityHandle : PredefinedBlockTemplate::OwnerHandle);
+			m_pRecordStream->str("");
+			// Terminator of the handle written in the slot
+			if (m_Options.m_Binary)
+				m_pRecordStream->put('\0');
+			else
+				*m_pRecordStream << "\n";
+			return;
+		}
+		char str[20];
+		sprintf(str, "%llX", value);
 		dxfString(gc, str);
 	}
 
@@ -307,14 +495,94 @@ namespace DXF {
 	void DxfWriter::dxfString(int gc, const char* value)
 	{
 		//ASSERT_DEBUG_INFO(value);
-		m_DxfFile << gc << "\n" << value << "\n";
+		if (m_Options.m_Binary)
+		{
+			BinaryString(gc, value, strlen(value));
+			return;
+		}
+		*m_pOut << gc << "\n" << value << "\n";
 	}
 
 	void DxfWriter::dxfString(int gc, const char * value, size_t count)
 	{
-		m_DxfFile << gc << "\n";
-		m_DxfFile.write(value, count);
-		m_DxfFile << "\n";
+		if (m_Options.m_Binary)
+		{
+			BinaryString(gc, value, count);
+			return;
+		}
+		*m_pOut << gc << "\n";
+		m_pOut->write(value, count);
+		*m_pOut << "\n";
+	}
+
+	void DxfWriter::BinaryGroupCode(int gc)
+	{
+		// Numbers are little-endian, the same as the supported platforms.
+		unsigned short code = (unsigned short)gc;
+		m_pOut->write((const char*)&code, sizeof(code));
+	}
+
+	void DxfWriter::BinaryInteger(BinaryValueType type, long long value)
+	{
+		switch (type)
+		{
+		case BinaryValueType::Int16:
+		{
+			short v = (short)value;
+			m_pOut->write((const char*)&v, sizeof(v));
+			break;
+		}
+		case BinaryValueType::Int32:
+		{
+			int v = (int)value;
+			m_pOut->write((const char*)&v, sizeof(v));
+			break;
+		}
+		case BinaryValueType::Int64:
+			m_pOut->write((const char*)&value, sizeof(value));
+			break;
+		case BinaryValueType::Bool:
+			m_pOut->put(value ? 1 : 0);
+			break;
+		default:
+			ASSERT_DEBUG_INFO(false);
+		}
+	}
+
+	void DxfWriter::BinaryString(int gc, const char* value, size_t count)
+	{
+		BinaryValueType type = GetBinaryValueType(gc);
+		BinaryGroupCode(gc);
+		switch (type)
+		{
+		case BinaryValueType::String:
+			m_pOut->write(value, count);
+			m_pOut->put('\0');
+			break;
+		case BinaryValueType::Chunk:
+		{
+			// Hex digits, at most 127 bytes in a chunk.
+			unsigned char bytes[UCHAR_MAX];
+			unsigned char len = 0;
+			for (size_t i = 0; i + 1 < count && len < 127; i += 2)
+			{
+				char hex[3] = { value[i], value[i + 1], 0 };
+				bytes[len++] = (unsigned char)strtoul(hex, nullptr, 16);
+			}
+			m_pOut->put((char)len);
+			m_pOut->write((const char*)bytes, len);
+			break;
+		}
+		case BinaryValueType::Real:
+		{
+			double v = atof(std::string(value, count).c_str());
+			m_pOut->write((const char*)&v, sizeof(v));
+			break;
+		}
+		default:
+			BinaryInteger(type, strtoll(std::string(value, count).c_str(), nullptr, 10));
+			break;
+		}
 	}
 
 	void DxfWriter::dxfText(int gc, int gcLast, const std::string & text)
@@ -336,20 +604,93 @@ namespace DXF {
 		}
 	}
 
-	int DxfWriter::PrepareBeforeWrite(int handle)
+	void DxfWriter::PredefinedBlockEntities(const PredefinedBlockTemplate& blockTemplate, Handle ownerHandle)
 	{
-		for (const auto& msi : m_Graph.m_MLeaderStyles)
+		char str[20];
+		for (size_t i = 0; i < blockTemplate.m_Slots.size(); ++i)
 		{
-			m_MLeaderStyleHandleTable[msi.first] = ++handle;
+			*m_pOut << blockTemplate.m_Texts[i];
+			if (blockTemplate.m_Slots[i] == PredefinedBlockTemplate::EntityHandle)
+				sprintf(str, "%llX", m_PredefinedEntityHandle++);
+			else
+				sprintf(str, "%llX", ownerHandle);
+			*m_pOut << str;
+		}
+		*m_pOut << blockTemplate.m_Texts.back();
+	}
+
+	void DxfWriter::PrepareBeforeWrite()
+	{
+		HandleAllocator& allocator = m_Context.m_HandleAllocator;
+		m_VPortHandle = allocator.Allocate();
+		m_AppIdHandle = allocator.Allocate();
+		for (const std::string& linetype : m_Context.m_Linetypes)
+		{
+			m_LinetypeHandleTable[linetype] = allocator.Allocate();
+		}
+		for (const auto& layer : m_Context.m_Layers)
+		{
+			m_LayerHandleTable[layer.first] = allocator.Allocate();
+		}
+		for (const auto& textStyle : m_Context.m_TextStyles)
+		{
+			m_TextStyleHandleTable[textStyle.first] = allocator.Allocate();
+		}
+		for (const auto& dimStyle : m_Context.m_DimStyles)
+		{
+			m_DimStyleHandleTable[dimStyle.first] = allocator.Allocate();
+		}
+
+		// Block records and BLOCK/ENDBLK of layouts, real blocks and predefined blocks
+		auto AllocateBlock = [this, &allocator](const std::string& blockName) {
+			m_BlockEntryHandleTable[blockName] = allocator.Allocate();
+			m_BlockHandleTable[blockName].first = allocator.Allocate();
+			m_BlockHandleTable[blockName].second = allocator.Allocate();
+		};
+		for (const auto& layout : m_Context.m_Layouts)
+		{
+			AllocateBlock(layout.m_BlockName);
+			m_LayoutHandleTable[layout.m_BlockName] = allocator.Allocate();
 		}
-		for (const auto& tsi : m_Graph.m_TableStyles)
+		for (const auto& pair : m_Graph.m_RealBlockDefs)
 		{
-			m_TableStyleHandleTable[tsi.first] = ++handle;
+			AllocateBlock(pair.first);
 		}
-		return handle;
+		const auto& predefinedBlocks = PredefinedBlockTemplates(m_Options.m_Binary);
+		for (int i = 0; i < int(predefinedBlocks.size()); ++i)
+		{
+			const char* blockName = GetPredefinedArrowHeadBlockName(i);
+			if (m_Graph.m_RealBlockDefs.find(blockName) == m_Graph.m_RealBlockDefs.end())
+				AllocateBlock(blockName);
+		}
+
+		// Reserve handles for entities in predefined blocks.
+		Handle count = 0;
+		for (const auto& blockTemplate : predefinedBlocks)
+		{
+			count += blockTemplate.m_EntityCount;
+		}
+		m_PredefinedEntityHandle = allocator.Allocate(count);
+
+		for (const auto& msi : m_Context.m_MLeaderStyles)
+		{
+			m_MLeaderStyleHandleTable[msi.first] = allocator.Allocate();
+		}
+		for (const auto& tsi : m_Context.m_TableStyles)
+		{
+			m_TableStyleHandleTable[tsi.first] = allocator.Allocate();
+		}
+	}
+
+	Handle DxfWriter::GetHandle(const EntAttribute* pEnt) const
+	{
+		auto it = m_Context.m_Handles.find(pEnt);
+		if (it != m_Context.m_Handles.end())
+			return it->second;
+		return 0;
 	}
 
-	int DxfWriter::LookupTextStyleHandle(const std::string& name)
+	Handle DxfWriter::LookupTextStyleHandle(const std::string& name)
 	{
 		auto it = m_TextStyleHandleTable.find(name);
 		if (it != m_TextStyleHandleTable.end())
@@ -357,7 +698,7 @@ namespace DXF {
 		return 0;
 	}
 
-	int DxfWriter::LookupDimStyleHandle(const std::string& name)
+	Handle DxfWriter::LookupDimStyleHandle(const std::string& name)
 	{
 		auto it = m_DimStyleHandleTable.find(name);
 		if (it != m_DimStyleHandleTable.end())
@@ -365,7 +706,7 @@ namespace DXF {
 		return 0;
 	}
 
-	int DxfWriter::LookupBlockEntryHandle(const std::string& blockName)
+	Handle DxfWriter::LookupBlockEntryHandle(const std::string& blockName)
 	{
 		auto it = m_BlockEntryHandleTable.find(blockName);
 		if (it != m_BlockEntryHandleTable.end())
@@ -373,7 +714,7 @@ namespace DXF {
 		return 0;
 	}
 
-	int DxfWriter::LookupLayoutHandle(const std::string& blockName)
+	Handle DxfWriter::LookupLayoutHandle(const std::string& blockName)
 	{
 		auto it = m_LayoutHandleTable.find(blockName);
 		if (it != m_LayoutHandleTable.end())
@@ -381,7 +722,7 @@ namespace DXF {
 		return 0;
 	}
 
-	int DxfWriter::LookupMLeaderStyleHandle(const std::string & name)
+	Handle DxfWriter::LookupMLeaderStyleHandle(const std::string & name)
 	{
 		auto it = m_MLeaderStyleHandleTable.find(name);
 		if (it != m_MLeaderStyleHandleTable.end())
@@ -389,7 +730,7 @@ namespace DXF {
 		return 0;
 	}
 
-	int DxfWriter::LookupTableStyleHandle(const std::string & name)
+	Handle DxfWriter::LookupTableStyleHandle(const std::string & name)
 	{
 		auto it = m_TableStyleHandleTable.find(name);
 		if (it != m_TableStyleHandleTable.end())
@@ -397,7 +738,7 @@ namespace DXF {
 		return 0;
 	}
 
-	int DxfWriter::LookupLinetypeHandle(const std::string & name)
+	Handle DxfWriter::LookupLinetypeHandle(const std::string & name)
 	{
 		auto it = m_LinetypeHandleTable.find(name);
 		if (it != m_LinetypeHandleTable.end())
@@ -452,11 +793,11 @@ namespace DXF {
 		dxfString(9, "$MEASUREMENT");
 		dxfInt(70, 1);//使用公制而不是英制
 		dxfString(9, "$HANDSEED");
-		dxfHex(5, 0xFFFFF);
+		dxfHex(5, m_Context.m_HandleAllocator.Seed());
 		EndSection();
 	}
 
-	void DxfWriter::BeginTable(const char* name, int num, int handle)
+	void DxfWriter::BeginTable(const char* name, int num, Handle handle)
 	{
 		dxfString(0, "TABLE");
 		dxfString(2, name);
@@ -466,7 +807,7 @@ namespace DXF {
 		dxfInt(70, num);
 	}
 
-	void DxfWriter::TableEntryHead(const char* name, int handle, int tableHandle)
+	void DxfWriter::TableEntryHead(const char* name, Handle handle, Handle tableHandle)
 	{
 		dxfString(0, name);
 		int gc;
@@ -486,7 +827,7 @@ namespace DXF {
 	{
 		BeginTable("VPORT", 1, 8);
 
-		TableEntryHead("VPORT", ++m_Handle, 8);
+		TableEntryHead("VPORT", m_VPortHandle, 8);
 		dxfString(100, "AcDbViewportTableRecord");
 		dxfString(2, "*Active");
 		dxfInt(70, 0);
@@ -552,14 +893,14 @@ namespace DXF {
 		LTypeEntry(lt, 0x16);
 	}
 
-	void DxfWriter::LTypeEntry(const char* name, int handle)
+	void DxfWriter::LTypeEntry(const char* name, Handle handle)
 	{
-		Linetype* lt = FindLinetype(name);
+		const Linetype* lt = FindLinetype(name);
 		ASSERT_DEBUG_INFO(lt);
 		LTypeEntry(*lt, handle);
 	}
 
-	void DxfWriter::LTypeEntry(const Linetype& lt, int handle)
+	void DxfWriter::LTypeEntry(const Linetype& lt, Handle handle)
 	{
 		m_LinetypeHandleTable[lt.line_name] = handle;
 		TableEntryHead("LTYPE", handle, 5);
@@ -587,7 +928,7 @@ namespace DXF {
 	* @param name: Layer name
 	* @param attrib: Attributes
 	*/
-	void DxfWriter::LayerEntry(const std::pair<std::string, LayerData>& pair, int handle)
+	void DxfWriter::LayerEntry(const std::pair<std::string, LayerData>& pair, Handle handle)
 	{
 		const auto& name = pair.first;
 		ASSERT_DEBUG_INFO(!name.empty());
@@ -683,7 +1024,7 @@ namespace DXF {
 		return F2FMap[0].FileName;
 	}
 
-	void DxfWriter::StyleEntry(const std::pair<std::string, TextStyleData>& pair, int handle)
+	void DxfWriter::StyleEntry(const std::pair<std::string, TextStyleData>& pair, Handle handle)
 	{
 		const auto& name = pair.first;
 		const auto& data = pair.second;
@@ -731,14 +1072,14 @@ namespace DXF {
 		dxfString(100, "AcDbRegAppTableRecord");
 		dxfString(2, "ACAD");
 		dxfInt(70, 0);
-		TableEntryHead("APPID", ++m_Handle, 9);
+		TableEntryHead("APPID", m_AppIdHandle, 9);
 		dxfString(100, "AcDbRegAppTableRecord");
 		dxfString(2, "ACADLL");
 		dxfInt(70, 0);
 		EndTable();
 	}
 
-	void DxfWriter::DimStyleEntry(const std::pair<std::string, DimStyleData>& pair, int handle)
+	void DxfWriter::DimStyleEntry(const std::pair<std::string, DimStyleData>& pair, Handle handle)
 	{
 		const auto& name = pair.first;
 		const DimStyleData& data = pair.second;
@@ -829,7 +1170,7 @@ namespace DXF {
 		dxfInt(372, data.ExtensionLineWeight);
 	}
 
-	void DxfWriter::BlockRecordEntry(const char* blockname, int handle, int layoutHandle)
+	void DxfWriter::BlockRecordEntry(const char* blockname, Handle handle, Handle layoutHandle)
 	{
 		if (layoutHandle != 0)
 		{
@@ -842,7 +1183,7 @@ namespace DXF {
 		dxfHex(340, layoutHandle);
 	}
 
-	void DxfWriter::BeginBlock(const char* blockName, double x, double y, int handle,
+	void DxfWriter::BeginBlock(const char* blockName, double x, double y, Handle handle,
 		bool bDimObliqueBlock)
 	{
 		dxfString(0, "BLOCK");
@@ -860,7 +1201,7 @@ namespace DXF {
 		dxfString(1, "");
 	}
 
-	void DxfWriter::EndBlock(const char* blockname, int handle)
+	void DxfWriter::EndBlock(const char* blockname, Handle handle)
 	{
 		dxfString(0, "ENDBLK");
 		dxfHex(5, handle);
@@ -885,15 +1226,16 @@ namespace DXF {
 	{
 		const auto& blockName = pair.first;
 		const auto& blockDef = pair.second;
-		BeginBlock(blockName.c_str(), blockDef->m_InsertPoint.x, blockDef->m_InsertPoint.y, ++m_Handle);
+		const auto& blockHandles = m_BlockHandleTable[blockName];
+		BeginBlock(blockName.c_str(), blockDef->m_InsertPoint.x, blockDef->m_InsertPoint.y, blockHandles.first);
 		for (const auto& pEnt : blockDef->m_Objects)
 		{
-			pEnt->WriteDxf(*this, bInPaperSpace);
+			WriteEntity(*pEnt, bInPaperSpace);
 		}
-		EndBlock(blockName.c_str(), ++m_Handle);
+		EndBlock(blockName.c_str(), blockHandles.second);
 	}
 
-	void DxfWriter::Dictionary(int handle, int parentHandle)
+	void DxfWriter::Dictionary(Handle handle, Handle parentHandle)
 	{
 		dxfString(0, "DICTIONARY");
 		dxfHex(5, handle);
@@ -932,10 +1274,9 @@ namespace DXF {
 		// Begin of ACAD_LAYOUT
 		Dictionary(0x1A, 0xC);
 		DictionaryEntry("Model", LookupLayoutHandle("*Model_Space"));
-		for (const auto& pair : m_Graph.m_Layouts)
+		for (const auto& layout : m_Context.m_Layouts)
 		{
-			const auto& pLayout = pair.second;
-			DictionaryEntry(pair.first.c_str(), LookupLayoutHandle(pLayout->m_BlockName));
+			DictionaryEntry(layout.m_Name.c_str(), LookupLayoutHandle(layout.m_BlockName));
 		}
 		// End of ACAD_LAYOUT
 		Dictionary(0x6A, 0xC); // ACAD_MATERIAL
@@ -973,13 +1314,13 @@ namespace DXF {
 		Dictionary(0x5E, 0xC); // AcDbVariableDictionary
 	}
 
-	void DxfWriter::Layout(const std::pair<std::string, std::shared_ptr<LayoutData>>& pair)
+	void DxfWriter::Layout(const WriteContext::Layout& layout)
 	{
-		const auto& layoutName = pair.first;
-		const auto& pLayout = pair.second;
-		const bool isPaperSpace = pLayout->m_BlockName != "*Model_Space";
+		const auto& layoutName = layout.m_Name;
+		const auto& pLayout = layout.m_Data;
+		const bool isPaperSpace = layout.m_BlockName != "*Model_Space";
 		dxfString(0, "LAYOUT");
-		dxfHex(5, m_LayoutHandleTable[pLayout->m_BlockName]);
+		dxfHex(5, m_LayoutHandleTable[layout.m_BlockName]);
 		dxfString(102, "{ACAD_REACTORS");
 		dxfHex(330, 0x1A);
 		dxfString(102, "}");
@@ -1035,7 +1376,7 @@ namespace DXF {
 		//	1 = 表示当此布局处于当前状态时的 PSLTSCALE 值
 		//	2 = 表示当此布局处于当前状态时的 LIMCHECK 值
 		dxfInt(70, 0);
-		dxfInt(71, pLayout->m_LayoutOrder);
+		dxfInt(71, layout.m_LayoutOrder);
 		coord(10, pLayout->m_MinLim.x, pLayout->m_MinLim.y);
 		coord(11, pLayout->m_MaxLim.x, pLayout->m_MaxLim.y);
 		coord(12, 0, 0);
@@ -1046,10 +1387,10 @@ namespace DXF {
 		coord(16, 1.0, 0);
 		coord(17, 0, 1.0);
 		dxfInt(76, 0);
-		int blockEntryHandle;
+		Handle blockEntryHandle;
 		if (isPaperSpace)
 		{
-			blockEntryHandle = LookupBlockEntryHandle(pLayout->m_BlockName);
+			blockEntryHandle = LookupBlockEntryHandle(layout.m_BlockName);
 		}
 		else
 		{
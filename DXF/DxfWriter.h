@@ -11,33 +11,96 @@
 
 #include <iostream>
 #include <math.h>
+#include <cassert>
 #include <vector>
 #include <map>
 #include <fstream>
+#include <sstream>
+#include <future>
 
 #include "AcadEntities.h"
 #include "Linetype.h"
 #include "Pattern.h"
+#include "DxfData.h"
+#include "Compression.h"
+#include "DxfProgress.h"
 
 namespace DXF
 {
+	struct WriteOptions
+	{
+		WriteOptions()
+			: m_Compression(Compression::None)
+			, m_CompressionLevel(-1)
+			, m_Binary(false)
+			, m_ProgressInterval(100)
+		{
+		}
+		// Compress the written file, e.g. *.dxf.gz with Gzip, *.dxf.zst with Zstd.
+		Compression m_Compression;
+		// Negative means the default level of the codec.
+		int m_CompressionLevel;
+		// Write binary DXF, reals are written as they are in memory without formatting.
+		bool m_Binary;
+		// Called at most once every m_ProgressInterval milliseconds while writing, at the start of each section
+		// and once at the end. Bytes are counted before compression.
+		ProgressCallback m_Progress;
+		unsigned int m_ProgressInterval;
+		// Checked before each entity, writing stops once it is cancelled and the file written is removed.
+		std::shared_ptr<CancelToken> m_CancelToken;
+	};
 
-	class DxfData;
 	class DXF_API DxfWriter
 	{
 	public:
+		// Writing stores the defaults(layer "0", text style "Standard", ...), layout block names
+		// and entity handles into graph.
 		DxfWriter(DxfData &graph);
+		// Writing doesn't modify graph, so several DxfWriters can write the same graph at the same time.
+		// The file is the same as DxfWriter(DxfData &) writes, except that blocks of dimensions without
+		// a block name aren't generated(DxfData::GenerateDimensionBlocks). It makes no difference for now,
+		// AcadDim::GenerateBlock generates nothing, so both write such dimensions without group 2 and block,
+		// and AutoCAD shows them only after they are modified, e.g. moved.
+		DxfWriter(const DxfData &graph);
 		DxfWriter(const DxfWriter &) = delete;
-		// linFile - file name of line type (*.lin)
-		// patFile - file name of pattern (*.pat)
+		// linFile - file name of line type (*.lin), can be nullptr
+		// patFile - file name of pattern (*.pat), can be nullptr
 		// center, height - center and height of model view when you open this dxf file.
-		void WriteDxf(const char *dxfFile, const char *linFile, const char *patFile, const CDblPoint &center, double height);
+		// Line types and patterns of acadiso.lin/acadiso.pat are built in, linFile and patFile
+		// only need to be provided to override them or to add new ones.
+		// Return false if the file can't be written or writing is cancelled, see WriteOptions::m_CancelToken.
+		// The part written is removed when writing fails, and the writer can write the next file.
+		// Lazy entities are loaded first by DxfWriter(DxfData &), writing fails if they can't be loaded.
+		// DxfWriter(const DxfData &) fails if there are lazy entities, they must be loaded before.
+		bool WriteDxf(const char *dxfFile, const char *linFile, const char *patFile, const CDblPoint &center, double height);
+		bool WriteDxf(const char *dxfFile, const CDblPoint &center, double height)
+		{
+			return WriteDxf(dxfFile, nullptr, nullptr, center, height);
+		}
+		// Write the file on a thread of the library, see SetAsyncThreadCount.
+		// The writer and its graph must not be used or modified until the future is ready.
+		std::future<bool> WriteDxfAsync(const char *dxfFile, const char *linFile, const char *patFile, const CDblPoint &center, double height);
+		std::future<bool> WriteDxfAsync(const char *dxfFile, const CDblPoint &center, double height)
+		{
+			return WriteDxfAsync(dxfFile, nullptr, nullptr, center, height);
+		}
+		void SetWriteOptions(const WriteOptions &options)
+		{
+			m_Options = options;
+		}
+		// Load the linetypes, patterns and predefined blocks shared by all writers of the process,
+		// so that writers started at the same time don't wait for the first one to load them.
+		static void PreloadTables(const char *linFile, const char *patFile);
+		// Release the handle tables of the last file written, the output buffer and the compressor are kept.
+		// A writer can write file after file without it, it only releases memory between files.
+		void Recycle();
 
 	private:
 		void Reset();
 
 		void BeginSection(const char *name)
 		{
+			m_Progress.BeginSection(name);
 			dxfString(0, "SECTION");
 			dxfString(2, name);
 		}
@@ -49,14 +112,14 @@ namespace DXF
 
 		void HeaderSection();
 
-		void BeginTable(const char *name, int num, int handle);
+		void BeginTable(const char *name, int num, Handle handle);
 
 		void EndTable()
 		{
 			dxfString(0, "ENDTAB");
 		}
 
-		void TableEntryHead(const char *name, int handle, int tableHandle);
+		void TableEntryHead(const char *name, Handle handle, Handle tableHandle);
 
 		void VPortTable(const CDblPoint &center, double height);
 
@@ -64,21 +127,21 @@ namespace DXF
 		{
 			BeginTable("LTYPE", num, 5);
 		}
-		void LTypeEntry(const Linetype &lt, int handle);
-		void LTypeEntry(const char *name, int handle);
+		void LTypeEntry(const Linetype &lt, Handle handle);
+		void LTypeEntry(const char *name, Handle handle);
 		void LTypeEntry_ByBlock_ByLayer_Continuous();
 
 		void BeginLayerTable(int num)
 		{
 			BeginTable("LAYER", num, 2);
 		}
-		void LayerEntry(const std::pair<std::string, LayerData> &pair, int handle);
+		void LayerEntry(const std::pair<std::string, LayerData> &pair, Handle handle);
 
 		void BeginStyleTable(int num)
 		{
 			BeginTable("STYLE", num, 3);
 		}
-		void StyleEntry(const std::pair<std::string, TextStyleData> &pair, int handle);
+		void StyleEntry(const std::pair<std::string, TextStyleData> &pair, Handle handle);
 
 		void ViewTable();
 
@@ -95,7 +158,7 @@ namespace DXF
 			dxfHex(340, 0x27); //handle of dimstyle ISO-25
 		}
 
-		void DimStyleEntry(const std::pair<std::string, DimStyleData> &pair, int handle);
+		void DimStyleEntry(const std::pair<std::string, DimStyleData> &pair, Handle handle);
 
 		//num = number of layouts + number of blocks + 2(*Model_Space,*Paper_Space)
 		void BeginBlock_RecordTable(int num)
@@ -103,7 +166,7 @@ namespace DXF
 			BeginTable("BLOCK_RECORD", num, 1);
 		}
 
-		void BlockRecordEntry(const char *blockname, int handle, int layoutHandle);
+		void BlockRecordEntry(const char *blockname, Handle handle, Handle layoutHandle);
 
 		//还有一些标注箭头块需要添加
 		void BlockRecordEntry_ModelSpace()
@@ -111,16 +174,16 @@ namespace DXF
 			BlockRecordEntry("*Model_Space", 0x1F, 0x22);
 		}
 
-		void BeginBlock(const char *blockName, double x, double y, int handle,
+		void BeginBlock(const char *blockName, double x, double y, Handle handle,
 						bool bDimObliqueBlock = false);
-		void EndBlock(const char *blockname, int handle);
+		void EndBlock(const char *blockname, Handle handle);
 		void Block_ModelSpace();
 
 		void Block(const std::pair<std::string, std::shared_ptr<BlockDef>> &blockDef, bool bInPaperSpace);
 
-		void Dictionary(int handle, int parentHandle);
+		void Dictionary(Handle handle, Handle parentHandle);
 		//handle是条目所指对象的句柄
-		void DictionaryEntry(const char *entryName, int handle)
+		void DictionaryEntry(const char *entryName, Handle handle)
 		{
 			dxfString(3, entryName);
 			dxfHex(350, handle);
@@ -128,38 +191,43 @@ namespace DXF
 		void Dictionaries();
 
 		//注意Layout的调用顺序。
-		void Layout(const std::pair<std::string, std::shared_ptr<LayoutData>> &pLayout);
+		void Layout(const WriteContext::Layout &layout);
 
 		//在ENTITIES段中先输出输出模型空间图元，再*Paper_Space图纸空间图元。
 		//区分图元属于模型空间和图纸空间的标志是组码 67。
 		//*Paper_Space(n)图纸空间图元输出在BLOCKS段中
 
 	public: // Used internally
-		int LookupTextStyleHandle(const std::string &name);
-		int LookupDimStyleHandle(const std::string &name);
-		int LookupBlockEntryHandle(const std::string &name);
-		int LookupLayoutHandle(const std::string &name);
-		int LookupMLeaderStyleHandle(const std::string &name);
-		int LookupTableStyleHandle(const std::string &name);
-		int LookupLinetypeHandle(const std::string &name);
+		// Handle of pEnt in current writing, 0 if pEnt isn't written.
+		Handle GetHandle(const EntAttribute *pEnt) const;
+		Handle LookupTextStyleHandle(const std::string &name);
+		Handle LookupDimStyleHandle(const std::string &name);
+		Handle LookupBlockEntryHandle(const std::string &name);
+		Handle LookupLayoutHandle(const std::string &name);
+		Handle LookupMLeaderStyleHandle(const std::string &name);
+		Handle LookupTableStyleHandle(const std::string &name);
+		Handle LookupLinetypeHandle(const std::string &name);
 		void AddMLeaderToItsStyle(const std::string &mleaderStyle, const EntAttribute *pMLeader);
 		const vector<const EntAttribute *> &GetMLeaders(const std::string &mleaderStyle);
 		void AddTableToItsStyle(const std::string &tableStyle, const EntAttribute *pTable);
 		const vector<const EntAttribute *> &GetTables(const std::string &tableStyle);
+		// Write an entity of model space, paper space or a block, progress is reported by it.
+		void WriteEntity(const EntAttribute &ent, bool bInPaperSpace);
 
 		void dxfReal(int gc, double value);
 		void dxfInt(int gc, int value);
-		void dxfHex(int gc, int value);
+		void dxfHex(int gc, Handle value);
 		void dxfString(int gc, const char *value);
 		void dxfString(int gc, const char *value, size_t count);
 		void dxfString(int groupCode, const std::string &value)
 		{
 			dxfString(groupCode, value.c_str());
 		}
-		//二进制DXF不得调用
+		//二进制DXF不能有注释，不输出
 		void Comment(const char *text)
 		{
-			dxfString(999, text);
+			if (!m_Options.m_Binary)
+				dxfString(999, text);
 		}
 
 		void dxfEOF()
@@ -175,45 +243,97 @@ namespace DXF
 
 		void coord(int gc, const double *value)
 		{
-			_ASSERTE(value);
+			assert(value);
 			coord(gc, value[0], value[1]);
 		}
 
 		void dxfText(int gc, int gcLast, const std::string &text);
 
-		Linetype *FindLinetype(const char *lineTypeName)
+		const Linetype *FindLinetype(const char *lineTypeName) const
 		{
 			return m_LinetypeManager.FindLinetype(lineTypeName);
 		}
 
-		Pattern *FindPattern(const char *ptname)
+		const Pattern *FindPattern(const char *ptname) const
 		{
 			return m_PatternManager.FindPattern(ptname);
 		}
 
-		static VectorOfEntityList s_PredefinedBlocks;
+		const HatchLines *GetHatchLines(const char *ptname, double angle, double scale)
+		{
+			return m_PatternManager.GetHatchLines(ptname, angle, scale);
+		}
 
-		int m_CurrentBlockEntryHandle;
+		Handle m_CurrentBlockEntryHandle;
 		int m_CurrentViewportID;
 
 	private:
-		int PrepareBeforeWrite(int handle);
+		// Pre-serialized DXF text of the entities of a predefined arrowhead block.
+		// Handles(group code 5) and owner handles(group code 330) are slots filled in by each write.
+		struct PredefinedBlockTemplate
+		{
+			enum SlotType
+			{
+				EntityHandle,
+				OwnerHandle
+			};
+			// m_Texts[i] is followed by slot m_Slots[i], the last text has no slot.
+			std::vector<std::string> m_Texts;
+			std::vector<SlotType> m_Slots;
+			int m_EntityCount;
+		};
+
+		// Templates of the 20 predefined arrowhead blocks, built once per process for each of ASCII
+		// and binary DXF and never modified.
+		static const std::vector<PredefinedBlockTemplate> &PredefinedBlockTemplates(bool binary);
+		void PredefinedBlockEntities(const PredefinedBlockTemplate &blockTemplate, Handle ownerHandle);
+
+		// Allocate handles of table entries, blocks and objects after entity handles,
+		// so that $HANDSEED is known before anything is written.
+		void PrepareBeforeWrite();
+
+		// Binary DXF: group code in 2 bytes, then the value in the type of GetBinaryValueType(gc).
+		void BinaryGroupCode(int gc);
+		// Write an integer in the size of type, which isn't String or Chunk.
+		void BinaryInteger(BinaryValueType type, long long value);
+		// Write a value given as text in its binary type.
+		void BinaryString(int gc, const char *value, size_t count);
 
 		std::ofstream m_DxfFile;
-		DxfData &m_Graph;
+		std::vector<char> m_OutBuffer;
+		// Compressed output, used instead of m_DxfFile if m_Options.m_Compression isn't None.
+		CompressStreambuf m_CompressBuf;
+		std::ostream m_CompressStream;
+		// Where dxfString writes to, m_DxfFile or m_CompressStream.
+		std::ostream *m_pOut;
+		// Template being recorded and the stream holding its current text.
+		PredefinedBlockTemplate *m_pRecording;
+		std::ostringstream *m_pRecordStream;
+		// Handle of next entity in predefined blocks.
+		Handle m_PredefinedEntityHandle;
+		WriteOptions m_Options;
+		ProgressReporter m_Progress;
+		const DxfData &m_Graph;
+		// Not null if DxfWriter(DxfData &) is used.
+		DxfData *m_pMutableGraph;
+		WriteContext m_Context;
 		LinetypeManager m_LinetypeManager;
 		PatternManager m_PatternManager;
-		int m_Handle;
 		int m_LayoutIndex;
-		std::map<std::string, int> m_TextStyleHandleTable;
-		std::map<std::string, int> m_DimStyleHandleTable;
+		Handle m_VPortHandle;
+		Handle m_AppIdHandle;
+		std::map<std::string, Handle> m_TextStyleHandleTable;
+		std::map<std::string, Handle> m_DimStyleHandleTable;
+		std::map<std::string, Handle> m_LayerHandleTable;
 		// block name -> block entry handle
-		std::map<std::string, int> m_BlockEntryHandleTable;
+		std::map<std::string, Handle> m_BlockEntryHandleTable;
 		// layout block name -> layout handle
-		std::map<std::string, int> m_LayoutHandleTable;
-		std::map<std::string, int> m_MLeaderStyleHandleTable;
-		std::map<std::string, int> m_TableStyleHandleTable;
-		std::map<std::string, int> m_LinetypeHandleTable;
+		std::map<std::string, Handle> m_LayoutHandleTable;
+		// block name -> handles of BLOCK and ENDBLK
+		std::map<std::string, std::pair<Handle, Handle>> m_BlockHandleTable;
+		std::map<std::string, Handle> m_MLeaderStyleHandleTable;
+		std::map<std::string, Handle> m_TableStyleHandleTable;
+		std::map<std::string, Handle> m_LinetypeHandleTable;
 		std::map<std::string, std::vector<const EntAttribute *>> m_MLeaderStyleEntities;
 		std::map<std::string, std::vector<const EntAttribute *>> m_TableStyleEntities;
 	};
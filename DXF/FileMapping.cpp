@@ -10,25 +10,38 @@
 #include "stdafx.h"
 #include "FileMapping.h"
 #include "utility.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace DXF
 {
+#ifdef _WIN32
 	CFileMapping::CFileMapping()
 	{
 		m_hFile = INVALID_HANDLE_VALUE;
-		m_hMapFile = INVALID_HANDLE_VALUE;
+		m_hMapFile = nullptr;
 		m_pStart = nullptr;
+		m_pEnd = nullptr;
+		m_Offset = 0;
+		m_FileSize = 0;
+		m_WindowSize = 0;
 	}
 
 	CFileMapping::CFileMapping(const char* FileName)
+		: CFileMapping()
 	{
-		m_hFile = INVALID_HANDLE_VALUE;
-		m_hMapFile = INVALID_HANDLE_VALUE;
-		m_pStart = nullptr;
 		Open(FileName);
 	}
 
-	void CFileMapping::Open(const char* FileName)
+	void CFileMapping::Open(const char* FileName, size_t windowSize)
 	{
 		ASSERT_DEBUG_INFO(m_hFile == INVALID_HANDLE_VALUE);
 		m_hFile = CreateFileA(FileName, // file to open
@@ -53,6 +66,14 @@ namespace DXF
 			return;
 		}
 
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_hFile, &fileSize))
+		{
+			PRINT_DEBUG_INFO("Could not get file size (%d).\n", GetLastError());
+			return;
+		}
+		m_FileSize = (unsigned long long)fileSize.QuadPart;
+
 		m_hMapFile = CreateFileMapping(
 			m_hFile,				// use paging file
 			nullptr,                   // default security 
@@ -61,24 +82,90 @@ namespace DXF
 			0,
 			nullptr);                // name of mapping object
 
-		if (m_hMapFile == INVALID_HANDLE_VALUE) 
+		if (m_hMapFile == nullptr)
 		{ 
 			PRINT_DEBUG_INFO("Could not create file mapping object (%d).\n", GetLastError());
 			return;
 		}
 
-		DWORD FileLen = GetFileSize(m_hFile, nullptr);
+		if (windowSize == 0 || windowSize >= m_FileSize)
+		{
+			m_WindowSize = m_FileSize;
+		}
+		else
+		{
+			// Views must start at multiples of the allocation granularity.
+			SYSTEM_INFO si;
+			GetSystemInfo(&si);
+			unsigned long long granularity = si.dwAllocationGranularity;
+			m_WindowSize = (windowSize + granularity - 1) / granularity * granularity;
+		}
+		MapWindow(0);
+	}
+
+	bool CFileMapping::MapWindow(unsigned long long offset)
+	{
+		ASSERT_DEBUG_INFO(m_hMapFile != nullptr);
+		if (offset >= m_FileSize)
+			return false;
+		// m_WindowSize is a multiple of the allocation granularity unless the whole file is mapped.
+		unsigned long long start = offset - offset % m_WindowSize;
+		if (m_pStart && start == m_Offset)
+			return true;
+		if (m_pStart)
+		{
+			UnmapViewOfFile(m_pStart);
+			m_pStart = nullptr;
+		}
+
+		SIZE_T len = (SIZE_T)min(m_WindowSize, m_FileSize - start);
 		m_pStart = (const unsigned char*)MapViewOfFile(m_hMapFile,// handle to map object
 			FILE_MAP_READ, // read permission
-			0,                   
-			0,                   
-			FileLen);
-		m_pEnd = m_pStart + FileLen;
-
+			DWORD(start >> 32),
+			DWORD(start & 0xFFFFFFFF),
+			len);
 		if (m_pStart == nullptr) 
 		{
+			m_pEnd = nullptr;
 			PRINT_DEBUG_INFO("Could not map view of file (%d).\n", GetLastError());
+			return false;
+		}
+		m_pEnd = m_pStart + len;
+		m_Offset = start;
+		return true;
+	}
+
+	void CFileMapping::Release(unsigned long long offset)
+	{
+		// Pages of a view can't be dropped one by one, use a mapping window to bound memory.
+	}
+
+	void CFileMapping::Prefetch(const char* FileName, unsigned long long length)
+	{
+		HANDLE hFile = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+			return;
+		LARGE_INTEGER fileSize;
+		HANDLE hMapFile = nullptr;
+		if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0)
+			hMapFile = CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (hMapFile)
+		{
+			unsigned long long size = (unsigned long long)fileSize.QuadPart;
+			SIZE_T len = (SIZE_T)(length == 0 ? size : min(length, size));
+			void* p = MapViewOfFile(hMapFile, FILE_MAP_READ, 0, 0, len);
+			if (p)
+			{
+#if _WIN32_WINNT >= 0x0602 // _WIN32_WINNT_WIN8
+				// The pages are read into the standby list, they stay there after the view is unmapped.
+				WIN32_MEMORY_RANGE_ENTRY range = { p, len };
+				PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+				UnmapViewOfFile(p);
+			}
+			CloseHandle(hMapFile);
 		}
+		CloseHandle(hFile);
 	}
 
 	void CFileMapping::Close()
@@ -89,13 +176,17 @@ namespace DXF
 			m_pStart = nullptr;
 		}
 
+		m_pEnd = nullptr;
+		m_Offset = 0;
+		m_FileSize = 0;
+
 		if (m_hMapFile)
 		{
 			CloseHandle(m_hMapFile);
-			m_hMapFile = INVALID_HANDLE_VALUE;
+			m_hMapFile = nullptr;
 		}
 
-		if (m_hFile)
+		if (m_hFile != INVALID_HANDLE_VALUE)
 		{
 			CloseHandle(m_hFile);
 			m_hFile = INVALID_HANDLE_VALUE;
@@ -107,4 +198,167 @@ namespace DXF
 		Close();
 	}
 
+#else // POSIX
+
+	// Windows at least this large are backed by transparent huge pages if the system supports it.
+	const unsigned long long g_HugePageThreshold = 64ULL << 20;
+
+	CFileMapping::CFileMapping()
+	{
+		m_Fd = -1;
+		m_Released = 0;
+		m_pStart = nullptr;
+		m_pEnd = nullptr;
+		m_Offset = 0;
+		m_FileSize = 0;
+		m_WindowSize = 0;
+	}
+
+	CFileMapping::CFileMapping(const char* FileName)
+		: CFileMapping()
+	{
+		Open(FileName);
+	}
+
+	void CFileMapping::Open(const char* FileName, size_t windowSize)
+	{
+		ASSERT_DEBUG_INFO(m_Fd == -1);
+		m_Fd = ::open(FileName, O_RDONLY | O_CLOEXEC);
+		if (m_Fd == -1)
+		{
+			// Get file name without path
+			const char* pureFileName = strrchr(FileName, '/');
+			if (pureFileName == NULL)
+				pureFileName = FileName;
+			else
+				pureFileName += 1;
+
+			PRINT_DEBUG_INFO("Could not open %s(errno=%d).\n", pureFileName, errno);
+			return;
+		}
+
+		struct stat st;
+		if (fstat(m_Fd, &st) != 0)
+		{
+			PRINT_DEBUG_INFO("Could not get file size (%d).\n", errno);
+			return;
+		}
+		m_FileSize = (unsigned long long)st.st_size;
+
+		if (windowSize == 0 || windowSize >= m_FileSize)
+		{
+			m_WindowSize = m_FileSize;
+		}
+		else
+		{
+			// Mapping offsets must be multiples of the page size.
+			unsigned long long pageSize = (unsigned long long)sysconf(_SC_PAGESIZE);
+			m_WindowSize = (windowSize + pageSize - 1) / pageSize * pageSize;
+		}
+		MapWindow(0);
+	}
+
+	bool CFileMapping::MapWindow(unsigned long long offset)
+	{
+		ASSERT_DEBUG_INFO(m_Fd != -1);
+		if (offset >= m_FileSize)
+			return false;
+		// m_WindowSize is a multiple of the page size unless the whole file is mapped.
+		unsigned long long start = offset - offset % m_WindowSize;
+		if (m_pStart && start == m_Offset)
+			return true;
+		if (m_pStart)
+		{
+			munmap((void*)m_pStart, m_pEnd - m_pStart);
+			m_pStart = nullptr;
+		}
+
+		size_t len = (size_t)std::min(m_WindowSize, m_FileSize - start);
+		int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+		// A window is bounded, so fault it in at once. The whole file is faulted in as it is read.
+		if (m_WindowSize < m_FileSize)
+			flags |= MAP_POPULATE;
+#endif
+		void* p = mmap(nullptr, len, PROT_READ, flags, m_Fd, (off_t)start);
+		if (p == MAP_FAILED)
+		{
+			m_pEnd = nullptr;
+			PRINT_DEBUG_INFO("Could not map view of file (%d).\n", errno);
+			return false;
+		}
+		// DXF is parsed from begin to end, let the kernel read ahead aggressively.
+		madvise(p, len, MADV_SEQUENTIAL);
+		madvise(p, len, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+		if (len >= g_HugePageThreshold)
+			madvise(p, len, MADV_HUGEPAGE);
+#endif
+		m_pStart = (const unsigned char*)p;
+		m_pEnd = m_pStart + len;
+		m_Offset = start;
+		m_Released = start;
+		return true;
+	}
+
+	void CFileMapping::Release(unsigned long long offset)
+	{
+		if (m_pStart == nullptr || offset <= m_Released)
+			return;
+		unsigned long long pageSize = (unsigned long long)sysconf(_SC_PAGESIZE);
+		unsigned long long end = std::min(offset, m_Offset + (m_pEnd - m_pStart));
+		end -= (end - m_Offset) % pageSize;
+		if (end <= m_Released)
+			return;
+		madvise((void*)(m_pStart + (m_Released - m_Offset)), size_t(end - m_Released), MADV_DONTNEED);
+		m_Released = end;
+	}
+
+	void CFileMapping::Prefetch(const char* FileName, unsigned long long length)
+	{
+		int fd = ::open(FileName, O_RDONLY | O_CLOEXEC);
+		if (fd == -1)
+			return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			size_t len = (size_t)(length == 0 ? st.st_size : std::min(length, (unsigned long long)st.st_size));
+			void* p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED)
+			{
+				// The kernel goes on reading after the mapping is gone, the pages stay in the page cache.
+				madvise(p, len, MADV_WILLNEED);
+				munmap(p, len);
+			}
+		}
+		::close(fd);
+	}
+
+	void CFileMapping::Close()
+	{
+		if (m_pStart)
+		{
+			munmap((void*)m_pStart, m_pEnd - m_pStart);
+			m_pStart = nullptr;
+		}
+
+		m_pEnd = nullptr;
+		m_Offset = 0;
+		m_FileSize = 0;
+		m_Released = 0;
+
+		if (m_Fd != -1)
+		{
+			::close(m_Fd);
+			m_Fd = -1;
+		}
+	}
+
+	CFileMapping::~CFileMapping(void)
+	{
+		Close();
+	}
+
+#endif
+
 }
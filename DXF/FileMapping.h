@@ -9,7 +9,11 @@
 ***************************************************************************/
 #pragma once
 
+#include <cstddef>
+
+#ifdef _WIN32
 typedef void *HANDLE;
+#endif
 
 namespace DXF
 {
@@ -19,17 +23,38 @@ namespace DXF
 		CFileMapping();
 		CFileMapping(const char *FileName);
 		~CFileMapping(void);
-		void Open(const char *FileName);
+		// windowSize == 0 maps the whole file, otherwise only a window of about windowSize bytes
+		// is mapped at a time and MapWindow moves it.
+		void Open(const char *FileName, size_t windowSize = 0);
 		void Close();
+		// Map the window containing offset, the window starts at or before offset.
+		bool MapWindow(unsigned long long offset);
+		// Tell the system that the mapped bytes before offset won't be read any more,
+		// so that their pages can be dropped.
+		void Release(unsigned long long offset);
+		// Map the first length bytes of the file(0 for all) and ask the system to read them into the file cache
+		// without waiting, so that the file is mapped and read quickly later.
+		static void Prefetch(const char *FileName, unsigned long long length = 0);
 
 		const unsigned char *GetStart() const { return m_pStart; }
 		const unsigned char *GetEnd() const { return m_pEnd; }
+		// File offset of GetStart()
+		unsigned long long GetOffset() const { return m_Offset; }
+		unsigned long long GetFileSize() const { return m_FileSize; }
 
 	private:
+#ifdef _WIN32
 		HANDLE m_hFile;				   //打开的文件句柄
 		HANDLE m_hMapFile;			   //文件映射句柄
-		const unsigned char *m_pStart; //文件的起点映射至虚拟内存的位置
-		const unsigned char *m_pEnd;   //文件的终点映射至虚拟内存的位置
+#else
+		int m_Fd;					   //打开的文件描述符
+		unsigned long long m_Released; //窗口中已释放到的文件偏移
+#endif
+		const unsigned char *m_pStart; //窗口的起点映射至虚拟内存的位置
+		const unsigned char *m_pEnd;   //窗口的终点映射至虚拟内存的位置
+		unsigned long long m_Offset;   //窗口起点在文件中的偏移
+		unsigned long long m_FileSize; //文件大小
+		unsigned long long m_WindowSize;
 	};
 
 } // namespace DXF
@@ -9,7 +9,9 @@
 ***************************************************************************/
 #pragma once
 
-#ifdef DXF_LIB
+#if !defined(_WIN32)
+	#define DXF_API __attribute__((visibility("default")))
+#elif defined(DXF_LIB)
 	#define DXF_API __declspec(dllexport)
 #else
 	#define DXF_API __declspec(dllimport)
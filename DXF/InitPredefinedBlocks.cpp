@@ -9,7 +9,10 @@
 ***************************************************************************/
 #include "stdafx.h"
 #include "AcadEntities.h"
+#include "DxfData.h"
+#include "DxfWriter.h"
 #include <mutex>
+#include <sstream>
 
 namespace
 {
@@ -110,7 +113,7 @@ void Dot(VectorOfEntityList& g_PredefinedBlocks)
 	ent0->m_Layer = "0";
 	ent0->m_Linetype = "ByBlock";
 	ent0->m_Color = acByBlock;
-	ent0->m_Closed = TRUE;
+	ent0->m_Closed = true;
 	ent0->SetConstWidth(0.5);
 	ent0->m_Vertices.push_back(CDblPoint(-0.25, 0));
 	ent0->SetBulge(0, 1.0);
@@ -136,7 +139,7 @@ void ArchTick(VectorOfEntityList& g_PredefinedBlocks)
 	ent0->m_Layer = "0";
 	ent0->m_Linetype = "ByBlock";
 	ent0->m_Color = acByBlock;
-	ent0->m_Closed = FALSE;
+	ent0->m_Closed = false;
 	ent0->SetConstWidth(0.15);
 	ent0->m_Vertices.push_back(CDblPoint(-0.5, -0.5));
 	ent0->m_Vertices.push_back(CDblPoint(0.5, 0.5));
@@ -320,7 +323,7 @@ void DotSmall(VectorOfEntityList& g_PredefinedBlocks)
 	ent0->m_Layer = "0";
 	ent0->m_Linetype = "ByBlock";
 	ent0->m_Color = acByBlock;
-	ent0->m_Closed = TRUE;
+	ent0->m_Closed = true;
 	ent0->SetConstWidth(0.5);
 	ent0->m_Vertices.push_back(CDblPoint(-0.0625, 0));
 	ent0->SetBulge(0, 1.0);
@@ -525,10 +528,6 @@ namespace DXF {
 
 void InitPredefinedBlocks(VectorOfEntityList& g_PredefinedBlocks)
 {
-	static std::mutex g_mutex;
-	std::lock_guard<std::mutex> lock(g_mutex);
-	if (!g_PredefinedBlocks.empty())
-		return;
 	Solid(g_PredefinedBlocks);
 	ClosedBlank(g_PredefinedBlocks);
 	Closed(g_PredefinedBlocks);
@@ -551,4 +550,36 @@ void InitPredefinedBlocks(VectorOfEntityList& g_PredefinedBlocks)
 	None(g_PredefinedBlocks);
 }
 
+const std::vector<DxfWriter::PredefinedBlockTemplate>& DxfWriter::PredefinedBlockTemplates(bool binary)
+{
+	static std::vector<PredefinedBlockTemplate> s_Templates[2];
+	static std::once_flag s_Flags[2];
+	std::vector<PredefinedBlockTemplate>& templates = s_Templates[binary];
+	std::call_once(s_Flags[binary], [binary, &templates] {
+		VectorOfEntityList predefinedBlocks;
+		InitPredefinedBlocks(predefinedBlocks);
+		// Record what the entities write, handles are written as slots.
+		DxfData graph;
+		DxfWriter writer(graph);
+		writer.m_Options.m_Binary = binary;
+		std::ostringstream os(std::ios::out | std::ios::binary);
+		writer.m_pOut = &os;
+		writer.m_pRecordStream = &os;
+		for (const auto& pb : predefinedBlocks)
+		{
+			PredefinedBlockTemplate blockTemplate;
+			writer.m_pRecording = &blockTemplate;
+			os.str("");
+			for (const auto& pEnt : *pb)
+			{
+				pEnt->WriteDxf(writer, false);
+			}
+			blockTemplate.m_Texts.push_back(os.str());
+			blockTemplate.m_EntityCount = int(pb->size());
+			templates.push_back(std::move(blockTemplate));
+		}
+	});
+	return templates;
+}
+
 }
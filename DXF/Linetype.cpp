@@ -9,195 +9,251 @@
 ***************************************************************************/
 #include "stdafx.h"
 
-#include <AtlConv.h>
 #include <string>
+#include <cstring>
+#include <climits>
+#include <map>
+#include <mutex>
 #include "ifstream.h"
+#ifndef _USE_MATH_DEFINES
 #define _USE_MATH_DEFINES
+#endif
 #include <math.h>
 
-#include "linetype.h"
+#include "Linetype.h"
 #include "utility.h"
+#include "BuiltinTables.h"
 
 using namespace std;
 #pragma warning(disable:4996)
 
 namespace DXF {
 
-LinetypeManager::LinetypeManager() = default;
-
-LinetypeManager::~LinetypeManager() = default;
+namespace
+{
+	std::mutex g_LinetypeLibrariesMutex;
+	// path -> (stamp of the parsed file, library)
+	std::map<std::string, std::pair<FileStamp, std::shared_ptr<const LinetypeLibrary>>> g_LinetypeLibraries;
+}
 
-void LinetypeManager::SetLinFile(const char* pLinFile)
+std::shared_ptr<const LinetypeLibrary> LinetypeLibrary::Load(const char* linFileName)
 {
-	if (!m_LinFile)
-		m_LinFile = std::make_unique<DXF::ifstream>();
-	if (m_LinFile->is_open())
+	if (linFileName == nullptr || linFileName[0] == '\0')
+		return nullptr;
+	FileStamp stamp;
+	if (!GetFileStamp(linFileName, stamp))
 	{
-		m_LinFile->close();
-		m_Linetypes.clear();
+		PRINT_DEBUG_INFO("Can't find linetype file %s.", linFileName);
+		return nullptr;
 	}
-	m_LinFile->open(pLinFile);
+
+	// Parse under the lock, so concurrent writers wait for the first one instead of parsing the same file again.
+	std::lock_guard<std::mutex> lock(g_LinetypeLibrariesMutex);
+	auto it = g_LinetypeLibraries.find(linFileName);
+	if (it != g_LinetypeLibraries.end() && it->second.first == stamp)
+		return it->second.second;
+
+	DXF::ifstream linFile(linFileName);
+	if (!linFile.is_open())
+		return nullptr;
+	std::shared_ptr<LinetypeLibrary> library(new LinetypeLibrary);
+	library->Parse(linFile);
+	g_LinetypeLibraries[linFileName] = std::make_pair(stamp, library);
+	return library;
 }
 
-bool LinetypeManager::IsValid() const
+std::shared_ptr<const LinetypeLibrary> LinetypeLibrary::Builtin()
 {
-	return m_LinFile && m_LinFile->is_open();
+	static const std::shared_ptr<const LinetypeLibrary> s_Builtin = [] {
+		DXF::ifstream linFile(g_BuiltinLinFile, g_BuiltinLinFileSize);
+		std::shared_ptr<LinetypeLibrary> library(new LinetypeLibrary);
+		library->Parse(linFile);
+		return library;
+	}();
+	return s_Builtin;
 }
 
-Linetype* LinetypeManager::FindLinetype(const char* lineTypeName)
+const Linetype* LinetypeLibrary::Find(const char* lineTypeName) const
 {
-	for (auto& pLt : m_Linetypes)
-	{
-		if (_stricmp(lineTypeName, pLt->line_name.c_str()) == 0)
-			return pLt.get();
-	}
-	if (m_LinFile->is_open())
-	{
-		auto plt = std::make_unique<Linetype>();
-		if (plt->LoadLinetype(*this, lineTypeName))
-		{
-			auto* ret = plt.get();
-			m_Linetypes.push_back(std::move(plt));
-			return ret;
-		}
-	}
+	auto it = m_Index.find(UpperCase(lineTypeName));
+	if (it != m_Index.end())
+		return &m_Linetypes[it->second];
 	return nullptr;
 }
 
-bool Linetype::LoadLinetype(LinetypeManager& manager, const char* lineTypeName)
+void LinetypeLibrary::Parse(DXF::ifstream& linFile)
 {
-	bool bFound = false;
-	ASSERT_DEBUG_INFO(manager.m_LinFile);
-	DXF::ifstream& s_LinFile = *manager.m_LinFile;
-	ASSERT_DEBUG_INFO(s_LinFile.is_open());
-	s_LinFile.reset();
-	s_LinFile.setdelimiter(",");
+	linFile.reset();
+	linFile.setdelimiter(",");
+	// Index of the linetype whose descriptors are expected on next line, -1 means none.
+	int current = -1;
 	char buffer[128];
-	while (s_LinFile)
+	while (linFile)
 	{
-		s_LinFile >> buffer;
+		linFile >> buffer;
 		if (buffer[0] == ';')
 		{
-			s_LinFile.ignore(INT_MAX, '\n');
+			linFile.ignore(INT_MAX, '\n');
 		}
 		else if (buffer[0] == '*')
 		{
-			line_name = &buffer[1];
-			if (stricmp(line_name.c_str(), lineTypeName) == 0)
+			Linetype lt;
+			lt.line_name = &buffer[1];
+			linFile.ignore(INT_MAX, ',');
+			linFile.getline(buffer, sizeof(buffer));
+			lt.line_descrip = buffer;
+			// The first definition wins, the same as AutoCAD does.
+			std::string key = UpperCase(lt.line_name.c_str());
+			if (m_Index.find(key) == m_Index.end())
+			{
+				m_Index[key] = m_Linetypes.size();
+				current = int(m_Linetypes.size());
+				m_Linetypes.push_back(std::move(lt));
+			}
+			else
 			{
-				bFound = true;
+				current = -1;
 			}
-			s_LinFile.ignore(INT_MAX, ',');
-			s_LinFile.getline(buffer, sizeof(buffer));
-			if (bFound)
-				line_descrip = buffer;
 		}
 		else
 		{
-			if (!bFound)
+			if (current == -1)
 			{
-				s_LinFile.ignore(INT_MAX, '\n');
+				linFile.ignore(INT_MAX, '\n');
 				continue;
 			}
+			ReadDescriptors(linFile, m_Linetypes[current]);
+			current = -1;
+		}
+	}
+}
+
+void LinetypeLibrary::ReadDescriptors(DXF::ifstream& linFile, Linetype& lt)
+{
+	char buffer[128];
+	char onechar;
+	linFile >> onechar;
+	while (onechar == ',')
+	{
+		Linetype_Descriptor lts;
+		linFile >> buffer;
+		if (buffer[0] == '[')
+		{
+			char anotherchar;
+			lts.shapename_text = &buffer[1];
+			linFile.skipws();
+			linFile >> anotherchar;
+			linFile >> buffer;
+			linFile.skipws();
+			linFile >> onechar;
+			lts.shxfilename_style = buffer;
+			if (lts.shapename_text.find(".shx") != std::string::npos)
+				lts.type = 1;//shape linetype
+			else
+				lts.type = 2;//text linetype
 
-			char onechar;
-			s_LinFile >> onechar;
-			while (onechar == ',')
+			do
 			{
-				Linetype_Descriptor lts;
-				s_LinFile >> buffer;
-				if (buffer[0] == '[')
+				ifstream::pos_type streampos1 = linFile.tellg();
+				linFile.ignore(INT_MAX, ",]");
+				ifstream::pos_type streampos2 = linFile.tellg();
+				linFile.seekg(streampos1);
+				linFile.read(buffer, (unsigned int)(streampos2 - streampos1));
+				linFile >> anotherchar;
+				std::string transformtype = strtok(buffer, "=");
+				transformtype = TrimSpace(transformtype);
+				char code = transformtype[0];
+				char* pValue = strtok(NULL, "=");
+				char* pEnd;
+				double value = strtod(pValue, &pEnd);
+				switch (code)
 				{
-					char anotherchar;
-					lts.shapename_text = &buffer[1];
-					s_LinFile.skipws();
-					s_LinFile >> anotherchar;
-					s_LinFile >> buffer;
-					s_LinFile.skipws();
-					s_LinFile >> onechar;
-					lts.shxfilename_style = buffer;
-					if (lts.shapename_text.find(".shx") != std::string::npos)
-						lts.type = 1;//shape linetype
-					else
-						lts.type = 2;//text linetype
-
-					do
+				case 's':
+				case 'S':
+					lts.scale_length = value;
+					break;
+				case 'a':
+				case 'A':
+					lts.bRelative = false;
+					//break;
+				case 'r':
+				case 'R':
 					{
-						unsigned long streampos1 = s_LinFile.tellg();
-						s_LinFile.ignore(INT_MAX, ",]");
-						unsigned long streampos2 = s_LinFile.tellg();
-						s_LinFile.seekg(streampos1);
-						s_LinFile.read(buffer, streampos2 - streampos1);
-						s_LinFile >> anotherchar;
-						std::string transformtype = strtok(buffer, "=");
-						transformtype = TrimSpace(transformtype);
-						char code = transformtype[0];
-						char* pValue = strtok(NULL, "=");
-						char* pEnd;
-						double value = strtod(pValue, &pEnd);
-						switch (code)
+						char EndChar = *pEnd;
+						switch (EndChar)
 						{
-						case 's':
-						case 'S':
-							lts.scale_length = value;
+						case 0:
+						case 'd':
+						case 'D':
+							value *= M_PI / 180.0;
 							break;
-						case 'a':
-						case 'A':
-							lts.bRelative = false;
-							//break;
 						case 'r':
 						case 'R':
-							{
-								char EndChar = *pEnd;
-								switch (EndChar)
-								{
-								case 0:
-								case 'd':
-								case 'D':
-									value *= M_PI / 180.0;
-									break;
-								case 'r':
-								case 'R':
-									break;
-								case 'g':
-								case 'G':
-									value = atan(value / 100);
-									break;
-								default:
-									ASSERT_DEBUG_INFO(false);
-									break;
-								};
-								lts.rotate = value;
-							}
 							break;
-						case 'x':
-						case 'X':
-							lts.xoffset = value;
-							break;
-						case 'y':
-						case 'Y':
-							lts.yoffset = value;
+						case 'g':
+						case 'G':
+							value = atan(value / 100);
 							break;
 						default:
 							ASSERT_DEBUG_INFO(false);
 							break;
 						};
-					} while (anotherchar == ',');
-				}
-				else
-				{
-					double temp = strtod(buffer, NULL);
-					lts.scale_length = temp;
-				}
-				descriptors.push_back(lts);
-				s_LinFile.skipws();
-				s_LinFile >> onechar;
-			}
-			return true;
+						lts.rotate = value;
+					}
+					break;
+				case 'x':
+				case 'X':
+					lts.xoffset = value;
+					break;
+				case 'y':
+				case 'Y':
+					lts.yoffset = value;
+					break;
+				default:
+					ASSERT_DEBUG_INFO(false);
+					break;
+				};
+			} while (anotherchar == ',');
+		}
+		else
+		{
+			double temp = strtod(buffer, NULL);
+			lts.scale_length = temp;
 		}
+		lt.descriptors.push_back(lts);
+		linFile.skipws();
+		linFile >> onechar;
 	}
+	// onechar is the first character of next line, give it back to the stream.
+	if (onechar != 0)
+		linFile.backward(1);
+}
+
+LinetypeManager::LinetypeManager()
+	: m_Builtin(LinetypeLibrary::Builtin())
+{
+}
+
+LinetypeManager::~LinetypeManager() = default;
 
-	return false;
+void LinetypeManager::SetLinFile(const char* pLinFile)
+{
+	m_Library = LinetypeLibrary::Load(pLinFile);
+}
+
+bool LinetypeManager::IsValid() const
+{
+	return m_Library != nullptr;
+}
+
+const Linetype* LinetypeManager::FindLinetype(const char* lineTypeName) const
+{
+	if (m_Library)
+	{
+		if (auto p = m_Library->Find(lineTypeName))
+			return p;
+	}
+	return m_Builtin->Find(lineTypeName);
 }
 
 }
@@ -12,6 +12,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <unordered_map>
 
 namespace DXF
 {
@@ -30,31 +31,46 @@ namespace DXF
 			yoffset = 0;
 		}
 		int type; //0 -- simple, 1--shape, 2--text
-		struct
-		{
-			std::string shapename_text;
-			std::string shxfilename_style;
-			double scale_length;
-			bool bRelative;
-			double rotate; //in radians
-			double xoffset;
-			double yoffset;
-		};
+		std::string shapename_text;
+		std::string shxfilename_style;
+		double scale_length;
+		bool bRelative;
+		double rotate; //in radians
+		double xoffset;
+		double yoffset;
 	};
 
-	class LinetypeManager;
 	class Linetype
 	{
-	public:
-		//返回true表示在线型文件linFileName中找到lineTypeName线型，否则没找到。
-		bool LoadLinetype(LinetypeManager &manager, const char *lineTypeName);
-
 	public:
 		std::string line_name;
 		std::string line_descrip;
 		std::vector<Linetype_Descriptor> descriptors;
 	};
 
+	// All linetypes of one .lin file, parsed in one pass and indexed by upper-case name.
+	// A library is immutable after Load(), so it can be shared by writers in different threads.
+	class LinetypeLibrary
+	{
+	public:
+		LinetypeLibrary(const LinetypeLibrary &) = delete;
+		// Returns the library of linFileName, or nullptr if the file can't be opened.
+		// The file is parsed only once per (path, modification time) in the whole process.
+		static std::shared_ptr<const LinetypeLibrary> Load(const char *linFileName);
+		// Returns the library of the compiled-in acadiso.lin, which is parsed only once.
+		static std::shared_ptr<const LinetypeLibrary> Builtin();
+		const Linetype *Find(const char *lineTypeName) const;
+		size_t Size() const { return m_Linetypes.size(); }
+
+	private:
+		LinetypeLibrary() = default;
+		void Parse(DXF::ifstream &linFile);
+		static void ReadDescriptors(DXF::ifstream &linFile, Linetype &lt);
+
+		std::vector<Linetype> m_Linetypes;
+		std::unordered_map<std::string, size_t> m_Index;
+	};
+
 	class LinetypeManager
 	{
 	public:
@@ -62,13 +78,14 @@ namespace DXF
 		~LinetypeManager();
 		LinetypeManager(const LinetypeManager &) = delete;
 		void SetLinFile(const char *pLinFile);
+		// Returns true if the external file set by SetLinFile() is loaded.
+		// The built-in linetypes are always available, the external file only overrides them.
 		bool IsValid() const;
-		Linetype *FindLinetype(const char *lineTypeName);
+		const Linetype *FindLinetype(const char *lineTypeName) const;
 
 	private:
-		friend class Linetype;
-		std::unique_ptr<DXF::ifstream> m_LinFile;
-		std::vector<std::unique_ptr<Linetype>> m_Linetypes;
+		std::shared_ptr<const LinetypeLibrary> m_Library;
+		std::shared_ptr<const LinetypeLibrary> m_Builtin;
 	};
 
 } // namespace DXF
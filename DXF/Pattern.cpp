@@ -9,88 +9,117 @@
 ***************************************************************************/
 #include "stdafx.h"
 
+#include <map>
+#include <mutex>
+#include <cstring>
+#include <climits>
+#ifndef _USE_MATH_DEFINES
+#define _USE_MATH_DEFINES
+#endif
+#include <math.h>
+
 #include "Pattern.h"
 #include "ifstream.h"
 #include "utility.h"
+#include "BuiltinTables.h"
 
 namespace DXF {
 
-	PatternManager::PatternManager() = default;
-
-	PatternManager::~PatternManager() = default;
+	namespace
+	{
+		std::mutex g_PatternLibrariesMutex;
+		// path -> (stamp of the parsed file, library)
+		std::map<std::string, std::pair<FileStamp, std::shared_ptr<const PatternLibrary>>> g_PatternLibraries;
+	}
 
-	void PatternManager::SetPatFile(const char* pLinFile)
+	std::shared_ptr<const PatternLibrary> PatternLibrary::Load(const char* patFileName)
 	{
-		if (!m_PatFile)
-			m_PatFile = std::make_unique<DXF::ifstream>();
-		if (m_PatFile->is_open())
+		if (patFileName == nullptr || patFileName[0] == '\0')
+			return nullptr;
+		FileStamp stamp;
+		if (!GetFileStamp(patFileName, stamp))
 		{
-			m_PatFile->close();
-			m_Patterns.clear();
+			PRINT_DEBUG_INFO("Can't find pattern file %s.", patFileName);
+			return nullptr;
 		}
-		m_PatFile->open(pLinFile);
+
+		// Parse under the lock, so concurrent writers wait for the first one instead of parsing the same file again.
+		std::lock_guard<std::mutex> lock(g_PatternLibrariesMutex);
+		auto it = g_PatternLibraries.find(patFileName);
+		if (it != g_PatternLibraries.end() && it->second.first == stamp)
+			return it->second.second;
+
+		DXF::ifstream patFile(patFileName);
+		if (!patFile.is_open())
+			return nullptr;
+		std::shared_ptr<PatternLibrary> library(new PatternLibrary);
+		library->Parse(patFile);
+		g_PatternLibraries[patFileName] = std::make_pair(stamp, library);
+		return library;
 	}
 
-	bool PatternManager::IsValid() const
+	std::shared_ptr<const PatternLibrary> PatternLibrary::Builtin()
 	{
-		return m_PatFile && m_PatFile->is_open();
+		static const std::shared_ptr<const PatternLibrary> s_Builtin = [] {
+			DXF::ifstream patFile(g_BuiltinPatFile, g_BuiltinPatFileSize);
+			std::shared_ptr<PatternLibrary> library(new PatternLibrary);
+			library->Parse(patFile);
+			return library;
+		}();
+		return s_Builtin;
 	}
 
-	Pattern* PatternManager::FindPattern(const char* patName)
+	const Pattern* PatternLibrary::Find(const char* patName) const
 	{
-		for (auto& pPattern : m_Patterns)
-		{
-			if (_stricmp(patName, pPattern->name.c_str()) == 0)
-				return pPattern.get();
-		}
-		if (m_PatFile->is_open())
-		{
-			auto pPat = std::make_unique<Pattern>();
-			if (pPat->LoadPattern(*this, patName))
-			{
-				auto* ret = pPat.get();
-				m_Patterns.push_back(std::move(pPat));
-				return ret;
-			}
-		}
+		auto it = m_Index.find(UpperCase(patName));
+		if (it != m_Index.end())
+			return m_Patterns[it->second].get();
 		return nullptr;
 	}
 
-	bool Pattern::LoadPattern(PatternManager& manager, const char* patName)
+	void PatternLibrary::Parse(DXF::ifstream& s_PatFile)
 	{
-		bool bFound = false;
-		ASSERT_DEBUG_INFO(manager.m_PatFile);
-		DXF::ifstream& s_PatFile = *manager.m_PatFile;
-		ASSERT_DEBUG_INFO(s_PatFile.is_open());
 		s_PatFile.reset();
 		s_PatFile.setdelimiter(",");
+		// Pattern which following line families belong to, nullptr means they are skipped.
+		Pattern* current = nullptr;
 		char buffer[512];
 		while (s_PatFile)
 		{
 			s_PatFile >> buffer;
-			if (buffer[0] == ';')
+			if (buffer[0] == '\0')
 			{
-				if (bFound)
-					return true;
+				// Trailing blank at end of file.
+				continue;
+			}
+			else if (buffer[0] == ';')
+			{
+				current = nullptr;
 				s_PatFile.ignore(INT_MAX, '\n');
 			}
 			else if (buffer[0] == '*')
 			{
-				if (bFound)
-					return true;
-				name = &buffer[1];
-				if (_stricmp(name.c_str(), patName) == 0)
-				{
-					bFound = true;
-				}
+				auto pPat = std::make_unique<Pattern>();
+				pPat->name = &buffer[1];
 				s_PatFile.ignore(INT_MAX, ',');
 				s_PatFile.getline(buffer, sizeof(buffer));
-				if (bFound)
-					description = buffer;
+				pPat->description = buffer;
+				// The first definition wins, the same as the old sequential search.
+				std::string key = UpperCase(pPat->name.c_str());
+				if (m_Index.find(key) == m_Index.end())
+				{
+					m_Index[key] = m_Patterns.size();
+					current = pPat.get();
+					m_Patterns.push_back(std::move(pPat));
+				}
+				else
+				{
+					current = nullptr;
+				}
 			}
 			else
 			{
-				if (!bFound)
+				if (!current)
 				{
 					s_PatFile.ignore(INT_MAX, '\n');
 					continue;
@@ -117,11 +146,69 @@ namespace DXF {
 					dashline->dashes.push_back(dash);
 					part = strchr(part, ',');
 				}
-				dashlines.push_back(std::move(dashline));
+				current->dashlines.push_back(std::move(dashline));
 			}
 		}
+	}
+
+	PatternManager::PatternManager()
+		: m_Builtin(PatternLibrary::Builtin())
+	{
+	}
+
+	PatternManager::~PatternManager() = default;
+
+	void PatternManager::SetPatFile(const char* pPatFile)
+	{
+		auto library = PatternLibrary::Load(pPatFile);
+		// Cached hatch lines point into patterns of the old library.
+		if (library != m_Library)
+			m_HatchLinesCache.clear();
+		m_Library = std::move(library);
+	}
+
+	bool PatternManager::IsValid() const
+	{
+		return m_Library != nullptr;
+	}
 
-		return false;
+	const Pattern* PatternManager::FindPattern(const char* patName) const
+	{
+		if (m_Library)
+		{
+			if (auto p = m_Library->Find(patName))
+				return p;
+		}
+		return m_Builtin->Find(patName);
+	}
+
+	const HatchLines* PatternManager::GetHatchLines(const char* patName, double angle, double scale)
+	{
+		const Pattern* pPat = FindPattern(patName);
+		if (!pPat)
+			return nullptr;
+		auto key = std::make_tuple(pPat, angle, scale);
+		auto it = m_HatchLinesCache.find(key);
+		if (it != m_HatchLinesCache.end())
+			return &it->second;
+
+		HatchLines& lines = m_HatchLinesCache[key];
+		lines.reserve(pPat->dashlines.size());
+		const CDblPoint zero;
+		for (auto& pLine : pPat->dashlines)
+		{
+			HatchLine line;
+			line.angle = pLine->angle + angle;
+			line.origin = CDblPoint(pLine->x_origin * scale, pLine->y_origin * scale);
+			zero.Rotate(line.origin, angle * M_PI / 180.0);
+			line.delta = CDblPoint(pLine->delta_x * scale, pLine->delta_y * scale);
+			zero.Rotate(line.delta, line.angle * M_PI / 180.0);
+			line.dashes.reserve(pLine->dashes.size());
+			for (double dash : pLine->dashes)
+				line.dashes.push_back(dash * scale);
+			lines.push_back(std::move(line));
+		}
+		return &lines;
 	}
 
 }
@@ -11,6 +11,10 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include "utility.h"
 
 namespace DXF
 {
@@ -26,19 +30,46 @@ namespace DXF
 		std::vector<double> dashes;
 	};
 
-	class PatternManager;
 	class Pattern
 	{
-	public:
-		//返回true表示在图案文件patFile中找到patName图案，否则没找到。
-		bool LoadPattern(PatternManager &manager, const char *patName);
-
 	public:
 		std::string name;
 		std::string description;
 		std::vector<std::unique_ptr<Pattern_Line>> dashlines;
 	};
 
+	// One line family of a pattern, rotated and scaled for a concrete hatch.
+	struct HatchLine
+	{
+		double angle; // in degrees
+		CDblPoint origin;
+		CDblPoint delta;
+		std::vector<double> dashes;
+	};
+	using HatchLines = std::vector<HatchLine>;
+
+	// All patterns of one .pat file, parsed in one pass and indexed by upper-case name.
+	// A library is immutable after Load(), so it can be shared by writers in different threads.
+	class PatternLibrary
+	{
+	public:
+		PatternLibrary(const PatternLibrary &) = delete;
+		// Returns the library of patFileName, or nullptr if the file can't be opened.
+		// The file is parsed only once per (path, modification time) in the whole process.
+		static std::shared_ptr<const PatternLibrary> Load(const char *patFileName);
+		// Returns the library of the compiled-in acadiso.pat, which is parsed only once.
+		static std::shared_ptr<const PatternLibrary> Builtin();
+		const Pattern *Find(const char *patName) const;
+		size_t Size() const { return m_Patterns.size(); }
+
+	private:
+		PatternLibrary() = default;
+		void Parse(DXF::ifstream &patFile);
+
+		std::vector<std::unique_ptr<Pattern>> m_Patterns;
+		std::unordered_map<std::string, size_t> m_Index;
+	};
+
 	class PatternManager
 	{
 	public:
@@ -46,13 +77,18 @@ namespace DXF
 		~PatternManager();
 		PatternManager(const PatternManager &) = delete;
 		void SetPatFile(const char *pPatFile);
+		// Returns true if the external file set by SetPatFile() is loaded.
+		// The built-in patterns are always available, the external file only overrides them.
 		bool IsValid() const;
-		Pattern *FindPattern(const char *ptname);
+		const Pattern *FindPattern(const char *ptname) const;
+		// Returns line families of pattern ptname rotated by angle(in degrees) and scaled by scale,
+		// or nullptr if the pattern isn't found. They are computed only once for the same arguments.
+		const HatchLines *GetHatchLines(const char *ptname, double angle, double scale);
 
 	private:
-		friend class Pattern;
-		std::unique_ptr<DXF::ifstream> m_PatFile;
-		std::vector<std::unique_ptr<Pattern>> m_Patterns;
+		std::shared_ptr<const PatternLibrary> m_Library;
+		std::shared_ptr<const PatternLibrary> m_Builtin;
+		std::map<std::tuple<const Pattern *, double, double>, HatchLines> m_HatchLinesCache;
 	};
 
 } // namespace DXF
@@ -0,0 +1,115 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#include "stdafx.h"
+#include <algorithm>
+#include "ThreadPool.h"
+#include "utility.h"
+
+namespace DXF
+{
+	// The pool whose job the thread is running, if any
+	static thread_local const ThreadPool* t_pCurrentPool = nullptr;
+
+	void SetAsyncThreadCount(unsigned int count)
+	{
+		ThreadPool::GetAsyncPool().SetThreadCount(count);
+	}
+
+	unsigned int GetAsyncThreadCount()
+	{
+		return ThreadPool::GetAsyncPool().GetThreadCount();
+	}
+
+	ThreadPool& ThreadPool::GetAsyncPool()
+	{
+		static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+		return pool;
+	}
+
+	ThreadPool::ThreadPool(unsigned int threadCount)
+		: m_Stopping(false)
+	{
+		Start(threadCount);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		Stop();
+	}
+
+	void ThreadPool::SetThreadCount(unsigned int threadCount)
+	{
+		ASSERT_DEBUG_INFO(threadCount > 0);
+		// A job would wait for its own thread to stop.
+		ASSERT_DEBUG_INFO(t_pCurrentPool != this);
+		// Concurrent calls would each start their threads after both have stopped the old ones.
+		std::lock_guard<std::mutex> lock(m_ResizeMutex);
+		Stop();
+		Start(threadCount);
+	}
+
+	unsigned int ThreadPool::GetThreadCount()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return (unsigned int)m_Threads.size();
+	}
+
+	void ThreadPool::Submit(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Jobs.push_back(std::move(job));
+		}
+		m_Condition.notify_one();
+	}
+
+	void ThreadPool::Run()
+	{
+		t_pCurrentPool = this;
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this]()
+				{
+					return m_Stopping || !m_Jobs.empty();
+				});
+				if (m_Stopping)
+					return;
+				job = std::move(m_Jobs.front());
+				m_Jobs.pop_front();
+			}
+			job();
+		}
+	}
+
+	void ThreadPool::Start(unsigned int threadCount)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = false;
+		for (unsigned int i = 0; i < threadCount; ++i)
+			m_Threads.emplace_back(&ThreadPool::Run, this);
+	}
+
+	void ThreadPool::Stop()
+	{
+		std::vector<std::thread> threads;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stopping = true;
+			threads.swap(m_Threads);
+		}
+		m_Condition.notify_all();
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+} // namespace DXF
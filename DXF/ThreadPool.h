@@ -0,0 +1,62 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ImpExpMacro.h"
+
+namespace DXF
+{
+	// Threads running DxfReader::ReadDxfAsync and DxfWriter::WriteDxfAsync.
+	// There are std::thread::hardware_concurrency() threads by default. Setting the count waits for
+	// the running jobs, the queued ones are kept. It throws std::logic_error if it is called on a thread
+	// of the pool, e.g. from a progress callback of ReadDxfAsync.
+	DXF_API void SetAsyncThreadCount(unsigned int count);
+	DXF_API unsigned int GetAsyncThreadCount();
+
+	// Runs jobs in the order they are submitted on a fixed number of threads, for internal use.
+	class ThreadPool
+	{
+	public:
+		explicit ThreadPool(unsigned int threadCount);
+		ThreadPool(const ThreadPool &) = delete;
+		// Jobs not started are dropped.
+		~ThreadPool();
+		// Not on a thread of the pool.
+		void SetThreadCount(unsigned int threadCount);
+		unsigned int GetThreadCount();
+		void Submit(std::function<void()> job);
+
+		// The pool of SetAsyncThreadCount, created when it is first used.
+		static ThreadPool &GetAsyncPool();
+
+	private:
+		void Run();
+		// Start threadCount threads, m_Mutex isn't locked.
+		void Start(unsigned int threadCount);
+		// Stop and join the threads after their running jobs, m_Mutex isn't locked.
+		void Stop();
+
+		// Held by SetThreadCount while the threads are replaced.
+		std::mutex m_ResizeMutex;
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		std::deque<std::function<void()>> m_Jobs;
+		std::vector<std::thread> m_Threads;
+		bool m_Stopping;
+	};
+
+} // namespace DXF
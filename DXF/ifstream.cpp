@@ -10,9 +10,18 @@
 #include "ifstream.h"
 
 #include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <cwctype>
 
+#ifdef _WIN32
 #include <atlconv.h>
 #include <atlexcept.h>
+#else
+#include <iterator>
+#include "utf8.h"
+#endif
 
 #include "utility.h"
 
@@ -26,11 +35,18 @@
 
 namespace DXF
 {
+	//ÿôֽڣͷǰôֽ֮ǰѶҳ
+	const size_t g_ReleaseStep = 16 << 20;
+
 	void ifstream::init()
 	{
 		m_pStart = nullptr;
 		m_pEnd = nullptr;
 		m_pCur = nullptr;
+		m_pLimit = nullptr;
+		m_Offset = 0;
+		m_Size = 0;
+		m_WindowSize = 0;
 		m_state = statmask;
 		m_delimiter = 0;
 	}
@@ -52,6 +68,12 @@ namespace DXF
 		open(filename);
 	}
 
+	ifstream::ifstream(const char* data, size_t size)
+	{
+		init();
+		open(data, size);
+	}
+
 	ifstream::~ifstream(void)
 	{
 		close();
@@ -59,10 +81,14 @@ namespace DXF
 
 	void ifstream::open(const char* filename)
 	{
-		m_FileMapping.Open(filename);
+		m_Source = nullptr;
+		m_FileMapping.Open(filename, m_WindowSize);
 		m_pStart = (const char*)m_FileMapping.GetStart();
 		m_pEnd = (const char*)m_FileMapping.GetEnd();
 		m_pCur = m_pStart;
+		m_Offset = m_FileMapping.GetOffset();
+		m_Size = m_FileMapping.GetFileSize();
+		setlimit();
 		m_state = goodbit;
 		if(nullptr == m_pStart)
 			m_state |= failbit;
@@ -70,21 +96,69 @@ namespace DXF
 
 	void ifstream::open(const wchar_t* filename)
 	{
-		m_FileMapping.Open(ATL::CW2A(filename));
+		m_Source = nullptr;
+#ifdef _WIN32
+		m_FileMapping.Open(ATL::CW2A(filename), m_WindowSize);
+#else
+		//wchar_tUTF-32ļUTF-8
+		std::string name;
+		utf8::utf32to8(filename, filename + wcslen(filename), std::back_inserter(name));
+		m_FileMapping.Open(name.c_str(), m_WindowSize);
+#endif
 		m_pStart = (const char*)m_FileMapping.GetStart();
 		m_pEnd = (const char*)m_FileMapping.GetEnd();
 		m_pCur = m_pStart;
+		m_Offset = m_FileMapping.GetOffset();
+		m_Size = m_FileMapping.GetFileSize();
+		setlimit();
+		m_state = goodbit;
+		if(nullptr == m_pStart)
+			m_state |= failbit;
+	}
+
+	void ifstream::open(const char* data, size_t size)
+	{
+		m_FileMapping.Close();
+		m_Source = nullptr;
+		m_pStart = data;
+		m_pEnd = data ? data + size : nullptr;
+		m_pCur = m_pStart;
+		m_Offset = 0;
+		m_Size = data ? size : 0;
+		setlimit();
 		m_state = goodbit;
 		if(nullptr == m_pStart)
 			m_state |= failbit;
 	}
 
+	void ifstream::open(const source_type& source, size_t bufferSize)
+	{
+		ASSERT_DEBUG_INFO(source && bufferSize > 0);
+		m_FileMapping.Close();
+		m_Source = source;
+		m_Buffer.resize(bufferSize);
+		m_pStart = m_Buffer.data();
+		m_pEnd = m_pStart;
+		m_pCur = m_pStart;
+		m_Offset = 0;
+		//֮ǰ֪С
+		m_Size = pos_type(-1);
+		m_state = goodbit;
+		if(!refill())
+			m_state |= eofbit;
+	}
+
 	void ifstream::close()
 	{
 		m_FileMapping.Close();
+		m_Source = nullptr;
+		m_Buffer.clear();
 		m_pStart = nullptr;
 		m_pEnd = nullptr;
 		m_pCur = nullptr;
+		m_pLimit = nullptr;
+		m_Offset = 0;
+		m_Size = 0;
 		m_state = statmask;
 
 		if(m_delimiter)
@@ -147,8 +221,8 @@ namespace DXF
 			if(iswspace(*m_pCur))//ʹisspaceıļַʱµʱʧ
 			{
 				++m_pCur;
-				if(m_pCur == m_pEnd)
-					setstate(eofbit);
+				if(m_pCur == m_pLimit)
+					underflow();
 			}
 			else
 				break;
@@ -182,17 +256,17 @@ namespace DXF
 			if(isdelim(*m_pCur))
 				break;
 			*buffer++ = *m_pCur++;
-			if(m_pCur == m_pEnd)
-				setstate(eofbit);
+			if(m_pCur == m_pLimit)
+				underflow();
 		}
 		*buffer = 0;
 	}
 
-	void ifstream::do_get(__int64& Val)
+	void ifstream::do_get(long long& Val)
 	{
 		char buffer[MAX_INT_DIG], *Ep;
 		getfld(buffer);
-		__int64 Ans = _strtoi64(buffer, &Ep, 10);
+		long long Ans = strtoll(buffer, &Ep, 10);
 
 		if (*Ep != 0 || buffer == Ep)
 			setstate(failbit);
@@ -220,21 +294,21 @@ namespace DXF
 
 	ifstream& ifstream::operator>>(char& Val)
 	{
-		//__int64 temp;
+		//long long temp;
 		//do_get(temp);
 		//Val = (char)temp;
 		if(!fail())
 			Val = *m_pCur++;
 		else
 			Val = 0;
-		if(m_pCur == m_pEnd)
-			setstate(eofbit);
+		if(m_pCur == m_pLimit)
+			underflow();
 		return (*this);
 	}
 
 	ifstream& ifstream::operator>>(short& Val)
 	{
-		__int64 temp;
+		long long temp;
 		do_get(temp);
 		Val = (short)temp;
 		return (*this);
@@ -242,7 +316,7 @@ namespace DXF
 
 	ifstream& ifstream::operator>>(unsigned short& Val)
 	{
-		__int64 temp;
+		long long temp;
 		do_get(temp);
 		Val = (unsigned short)temp;
 		return (*this);
@@ -250,7 +324,7 @@ namespace DXF
 
 	ifstream& ifstream::operator>>(int& Val)
 	{
-		__int64 temp;
+		long long temp;
 		do_get(temp);
 		Val = (int)temp;
 		return (*this);
@@ -258,7 +332,7 @@ namespace DXF
 
 	ifstream& ifstream::operator>>(unsigned int& Val)
 	{
-		__int64 temp;
+		long long temp;
 		do_get(temp);
 		Val = (unsigned int)temp;
 		return (*this);
@@ -266,7 +340,7 @@ namespace DXF
 
 	ifstream& ifstream::operator>>(long& Val)
 	{
-		__int64 temp;
+		long long temp;
 		do_get(temp);
 		Val = (long)temp;
 		return (*this);
@@ -274,7 +348,7 @@ namespace DXF
 
 	ifstream& ifstream::operator>>(unsigned long& Val)
 	{
-		__int64 temp;
+		long long temp;
 		do_get(temp);
 		Val = (unsigned long)temp;
 		return (*this);
@@ -307,7 +381,7 @@ namespace DXF
 				return (*this);
 			}
 		}
-		__int64 temp = _strtoi64(buffer, &Ep, 10);
+		long long temp = strtoll(buffer, &Ep, 10);
 		if((temp != 0 && temp != 1) || (*Ep != 0))
 		{
 			setstate(failbit);
@@ -334,62 +408,141 @@ namespace DXF
 		strcpy(m_delimiter, delimiter);
 	}
 
-	unsigned long ifstream::tellg()
+	void ifstream::setwindowsize(size_t windowSize)
+	{
+		m_WindowSize = windowSize;
+	}
+
+	bool ifstream::mapwindow(pos_type pos)
 	{
-		return (unsigned long)(m_pCur - m_pStart);
+		if(!m_FileMapping.MapWindow(pos))
+			return false;
+		m_pStart = (const char*)m_FileMapping.GetStart();
+		m_pEnd = (const char*)m_FileMapping.GetEnd();
+		m_Offset = m_FileMapping.GetOffset();
+		m_pCur = m_pStart + (pos - m_Offset);
+		setlimit();
+		return true;
+	}
+
+	void ifstream::setlimit()
+	{
+		m_pLimit = m_pEnd;
+		//ڴеݲͷ
+		if(m_FileMapping.GetStart() != nullptr)
+		{
+			size_t next = (size_t(m_pCur - m_pStart) / g_ReleaseStep + 1) * g_ReleaseStep;
+			if(next < size_t(m_pEnd - m_pStart))
+				m_pLimit = m_pStart + next;
+		}
+	}
+
+	void ifstream::underflow()
+	{
+		if(m_pCur != m_pEnd)
+		{
+			//ͷŵ㣬g_ReleaseStepֽڹ
+			pos_type pos = tellg();
+			if(pos > g_ReleaseStep)
+				m_FileMapping.Release(pos - g_ReleaseStep);
+			setlimit();
+			return;
+		}
+		if(m_Source)
+		{
+			if(!refill())
+				setstate(eofbit);
+			return;
+		}
+		pos_type pos = m_Offset + (m_pEnd - m_pStart);
+		if(pos == m_Size || !mapwindow(pos))
+			setstate(eofbit);
+	}
+
+	bool ifstream::refill()
+	{
+		size_t count = m_Source(m_Buffer.data(), m_Buffer.size());
+		if(count == 0)
+		{
+			m_Size = tellg();
+			return false;
+		}
+		ASSERT_DEBUG_INFO(count <= m_Buffer.size());
+		m_Offset += m_pEnd - m_pStart;
+		m_pStart = m_Buffer.data();
+		m_pEnd = m_pStart + count;
+		m_pCur = m_pStart;
+		setlimit();
+		return true;
 	}
 
-	unsigned long ifstream::getsize()
+	ifstream::pos_type ifstream::tellg()
 	{
-		return (unsigned long)(m_pEnd - m_pStart);
+		return m_Offset + (m_pCur - m_pStart);
 	}
 
-	ifstream& ifstream::seekg(unsigned long pos)
+	ifstream::pos_type ifstream::getsize()
 	{
-		m_pCur = m_pStart + pos;
-		if((m_pCur < m_pStart) || (m_pCur == m_pEnd))
+		return m_Size;
+	}
+
+	ifstream& ifstream::seekg(pos_type pos)
+	{
+		if(pos >= m_Size)
 			setstate(failbit|eofbit);
+		else if(pos >= m_Offset && pos < m_Offset + (m_pEnd - m_pStart))
+		{
+			m_pCur = m_pStart + (pos - m_Offset);
+			setlimit();
+		}
+		//Դܻ˵֮ǰ
+		else if(m_Source || !mapwindow(pos))
+			setstate(failbit);
 		return *this;
 	}
 
-	ifstream& ifstream::seekg(long off, seekdir origin)
+	ifstream& ifstream::seekg(off_type off, seekdir origin)
 	{
+		off_type pos = 0;
 		switch(origin)
 		{
 		case beg:
-			m_pCur = m_pStart + off;
+			pos = off;
 			break;
 		case cur:
-			m_pCur = m_pCur + off;
+			pos = off_type(tellg()) + off;
 			break;
 		case end:
-			m_pCur = m_pEnd + off;
+			pos = off_type(m_Size) + off;
 			break;
 		default:
 			ASSERT_DEBUG_INFO(false);
 			break;
 		};
-		if((m_pCur < m_pStart) || (m_pCur >= m_pEnd))
+		if(pos < 0)
 			setstate(failbit|eofbit);
+		else
+			seekg(pos_type(pos));
 		return *this;
 	}
 
 	ifstream& ifstream::getline(char *Str, unsigned int count)
 	{
+		char *First = Str;
 		for(unsigned int i=0; (i<count-1) && !fail(); ++i)
 		{
 			if((*m_pCur) != '\n')
 			{
 				*Str++ = *m_pCur++;
-				if(m_pCur == m_pEnd)
-					setstate(eofbit);
+				if(m_pCur == m_pLimit)
+					underflow();
 			}
 			else
 			{
 				++m_pCur;
-				if(m_pCur == m_pEnd)
-					setstate(eofbit);
-				if(*(Str-1) == '\r')
+				if(m_pCur == m_pLimit)
+					underflow();
+				if(Str != First && *(Str-1) == '\r')
 					*(Str-1) = 0;
 				break;
 			}
@@ -398,29 +551,98 @@ namespace DXF
 		return *this;
 	}
 
+	ifstream& ifstream::getline(char *Str, unsigned int count, char delim)
+	{
+		for(unsigned int i=0; (i<count-1) && !fail(); ++i)
+		{
+			char code = *m_pCur++;
+			if(m_pCur == m_pLimit)
+				underflow();
+			if(code == delim)
+				break;
+			*Str++ = code;
+		}
+		*Str = 0;
+		return *this;
+	}
+
+	ifstream& ifstream::readraw(void *buffer, size_t count)
+	{
+		char *pDest = (char*)buffer;
+		while(count > 0)
+		{
+			if(fail())
+			{
+				setstate(failbit);
+				break;
+			}
+			size_t count2 = std::min(count, size_t(m_pLimit-m_pCur));
+			memcpy(pDest, m_pCur, count2);
+			pDest += count2;
+			count -= count2;
+			m_pCur += count2;
+			if(m_pCur == m_pLimit)
+				underflow();
+		}
+		return *this;
+	}
+
+	int ifstream::peek()
+	{
+		if(fail())
+			return EOF;
+		return (unsigned char)*m_pCur;
+	}
+
+	const char* ifstream::peekbuf(size_t& count)
+	{
+		count = fail() ? 0 : size_t(m_pLimit - m_pCur);
+		return m_pCur;
+	}
+
+	ifstream& ifstream::advance(size_t count)
+	{
+		ASSERT_DEBUG_INFO(count <= size_t(m_pLimit - m_pCur));
+		m_pCur += count;
+		if(m_pCur == m_pLimit)
+			underflow();
+		return *this;
+	}
+
 	ifstream& ifstream::read(char *Str, unsigned int count)
 	{
 		if(!fail())
 		{
-			int count2 = min(count-1, (unsigned int)(m_pEnd-m_pCur));
-			strncpy(Str, m_pCur, count2);
-			*(Str+count2) = '\0';
-			m_pCur += count2;
-			if(m_pCur == m_pEnd)
-				setstate(eofbit);
+			//ӳʱҪּζ
+			unsigned int total = 0;
+			while(total < count-1 && !fail())
+			{
+				unsigned int count2 = std::min(count-1-total, (unsigned int)(m_pLimit-m_pCur));
+				strncpy(Str+total, m_pCur, count2);
+				total += count2;
+				m_pCur += count2;
+				if(m_pCur == m_pLimit)
+					underflow();
+			}
+			*(Str+total) = '\0';
 		}
 		return *this;
 	}
 
 	ifstream& ifstream::ignore(unsigned int count, char stop)
 	{
-		for(unsigned int i=1; (i<=count) && !fail(); ++i)
+		//memchrڵǰָ뵽m_pLimit֮stopֽڱȽ
+		while(count > 0 && !fail())
 		{
-			char code = (*m_pCur);
-			++m_pCur;
-			if(m_pCur == m_pEnd)
-				setstate(eofbit);
-			if(code == stop)
+			size_t len = std::min(size_t(count), size_t(m_pLimit - m_pCur));
+			const char* pStop = (const char*)memchr(m_pCur, stop, len);
+			if(pStop != nullptr)
+				len = size_t(pStop - m_pCur) + 1;
+			m_pCur += len;
+			count -= (unsigned int)len;
+			if(m_pCur == m_pLimit)
+				underflow();
+			if(pStop != nullptr)
 				break;
 		}
 		return *this;
@@ -434,8 +656,8 @@ namespace DXF
 		{
 			char code = (*m_pCur);
 			++m_pCur;
-			if(m_pCur == m_pEnd)
-				setstate(eofbit);
+			if(m_pCur == m_pLimit)
+				underflow();
 			for(size_t j=0; j<len; ++j)
 			{
 				if(code == stop[j])
@@ -450,12 +672,14 @@ namespace DXF
 	{
 		if(!fail())
 		{
-			m_pCur -= count;
-			if(m_pCur < m_pStart)
+			pos_type pos = tellg();
+			if(count > pos)
 			{
-				m_pCur = m_pStart;
+				seekg(pos_type(0));
 				setstate(failbit);
 			}
+			else
+				seekg(pos - count);
 		}
 		return *this;
 	}
@@ -9,6 +9,9 @@
 ***************************************************************************/
 #pragma once
 
+#include <cstddef>
+#include <functional>
+#include <vector>
 #include "FileMapping.h"
 #ifndef EOF
 #define EOF -1
@@ -32,9 +35,16 @@ namespace DXF
 	class ifstream
 	{
 	public:
+		//文件中的位置和偏移，大于4G的文件也可以定位
+		typedef unsigned long long pos_type;
+		typedef long long off_type;
+		//数据源，向buffer填充最多size字节，返回实际填充的字节数，返回0表示数据已读完
+		typedef std::function<size_t(char *buffer, size_t size)> source_type;
+
 		ifstream(void);
 		ifstream(const char *filename);
 		ifstream(const wchar_t *filename);
+		ifstream(const char *data, size_t size);
 		void reset()
 		{
 			clear();
@@ -45,8 +55,16 @@ namespace DXF
 		//open a file
 		void open(const char *filename);
 		void open(const wchar_t *filename);
+		//open a memory buffer, which must be valid until the stream is closed
+		void open(const char *data, size_t size);
+		//open a pull-based source such as a pipe or socket, read through a buffer of bufferSize
+		//bytes. seekg can only move inside the current buffer.
+		void open(const source_type &source, size_t bufferSize);
 		//close a file
 		void close();
+		//设置文件映射窗口的大小，在open之前调用。0表示映射整个文件，否则每次只映射
+		//windowSize左右字节，读到窗口末尾时自动移动窗口，这样读很大的文件也只占用有限的地址空间。
+		void setwindowsize(size_t windowSize);
 		//status
 		//Determines if a file is open.
 		bool is_open();
@@ -86,15 +104,25 @@ namespace DXF
 		ifstream &operator>>(long &Val);
 		ifstream &operator>>(unsigned long &Val);
 		//取得流的当前指针
-		unsigned long tellg();
+		pos_type tellg();
 		//设置流的当前指针
-		ifstream &seekg(unsigned long pos);
-		ifstream &seekg(long off, seekdir origin);
+		ifstream &seekg(pos_type pos);
+		ifstream &seekg(off_type off, seekdir origin);
 		//取得文件大小
-		unsigned long getsize();
+		pos_type getsize();
 		//getline & read
 		ifstream &getline(char *Str, unsigned int count);
+		//读到delim为止，delim被读过但不存入Str，不处理'\r'。
+		ifstream &getline(char *Str, unsigned int count, char delim);
 		ifstream &read(char *Str, unsigned int count);
+		//读取count个字节，不加结尾0，用于二进制数据。
+		ifstream &readraw(void *buffer, size_t count);
+		//返回当前字符但不前进，流状态失败时返回EOF。
+		int peek();
+		//返回当前指针，count为不用移动窗口或填充缓冲区就可以连续读取的字节数，流状态失败时为0。
+		const char *peekbuf(size_t &count);
+		//流的当前指针前进count个字节，count不能超过peekbuf返回的字节数。
+		ifstream &advance(size_t count);
 		//当count等于numeric_limits<unsigned int>::max()时表示只考虑stop,不考虑count。
 		//流的当前指针前进count个字节。如果在这之前找到stop字符，那么流的当前指针停在stop
 		//字符之后。
@@ -110,13 +138,28 @@ namespace DXF
 	private:
 		void init();
 		void getfld(char *buffer);
-		void do_get(__int64 &Val);
+		void do_get(long long &Val);
 		void do_get(double &Val);
 		bool isdelim(char code);
+		//映射包含pos的窗口并把当前指针指向pos
+		bool mapwindow(pos_type pos);
+		//设置下一个释放点
+		void setlimit();
+		//当前指针到达m_pLimit时调用。在释放点释放已读过的页；在窗口末尾时，
+		//文件还有数据就移动窗口，数据源还有数据就重新填充缓冲区，否则设置eofbit。
+		void underflow();
+		//从数据源填充缓冲区，数据源已读完时返回false
+		bool refill();
 		CFileMapping m_FileMapping;
-		const char *m_pStart; //文件的起点映射至虚拟内存的位置
-		const char *m_pEnd;	  //文件的终点映射至虚拟内存的位置
+		const char *m_pStart; //窗口的起点映射至虚拟内存的位置
+		const char *m_pEnd;	  //窗口的终点映射至虚拟内存的位置
 		const char *m_pCur;	  //当前文件指针位置
+		const char *m_pLimit; //下一个释放点或窗口的终点
+		pos_type m_Offset;	  //窗口起点在文件中的位置
+		pos_type m_Size;	  //文件大小
+		size_t m_WindowSize;
+		source_type m_Source;
+		std::vector<char> m_Buffer; //数据源的缓冲区
 		int m_state;
 		char *m_delimiter;
 	};
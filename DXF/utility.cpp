@@ -9,131 +9,295 @@
 ***************************************************************************/
 #include "utility.h"
 #include <stdarg.h>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
 #include <algorithm>
-#include <fstream>
-#include <map>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 #include <sstream>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "utf8.h"
 
-namespace DXF {
+#pragma warning(disable:4996)
 
-struct ThreadDebugInfo
-{
-	// ofstream can not be copied.
-	std::ofstream m_DebugInfo;
-	std::string m_FileName;
-	bool m_Enabled;
-};
+namespace DXF {
 
-std::map<std::thread::id, std::unique_ptr<ThreadDebugInfo>> g_ThreadDebugInfos;
+// Lines are appended to a buffer of the thread, which is passed to the sink when it reaches this size.
+const size_t g_LogChunkSize = 64 << 10;
+// Buffers which may wait for the sink, a thread passing one more waits.
+const size_t g_LogRingSize = 64;
 
-void SetThreadDebugInfo(const char* fileName)
+struct LogFile
 {
-	auto it = g_ThreadDebugInfos.find(std::this_thread::get_id());
-	if (it == g_ThreadDebugInfos.end())
+	explicit LogFile(const std::string& fileName)
+		: m_pFile(fopen(fileName.c_str(), "w"))
 	{
-		g_ThreadDebugInfos[std::this_thread::get_id()] = std::make_unique<ThreadDebugInfo>();
-		it = g_ThreadDebugInfos.find(std::this_thread::get_id());
-		it->second->m_Enabled = true;
 	}
-	if (it != g_ThreadDebugInfos.end())
+	LogFile(const LogFile&) = delete;
+	~LogFile()
 	{
-		if (it->second->m_DebugInfo.is_open())
-			it->second->m_DebugInfo.close();
-		it->second->m_FileName = fileName;
+		if (m_pFile)
+			fclose(m_pFile);
 	}
-}
+	FILE* m_pFile;
+};
 
-std::string GetThreadDebugInfoFileName()
+struct LogChunk
 {
-	std::thread::id tid = std::this_thread::get_id();
-	auto it = g_ThreadDebugInfos.find(tid);
-	if (it != g_ThreadDebugInfos.end())
+	// Shared by the chunks waiting, the file is closed after the last one is written.
+	std::shared_ptr<LogFile> m_pFile;
+	std::string m_Text;
+};
+
+static void WriteLogChunk(LogChunk& chunk)
+{
+	if (chunk.m_pFile && chunk.m_pFile->m_pFile)
 	{
-		return it->second->m_FileName;
+		fwrite(chunk.m_Text.data(), 1, chunk.m_Text.size(), chunk.m_pFile->m_pFile);
+		fflush(chunk.m_pFile->m_pFile);
 	}
-	std::stringstream ss;
-	ss << "DxfDebugInfo-";
-	tid._To_text(ss);
-	ss << ".log";
-	return ss.str();
+	chunk.m_Text.clear();
 }
 
-void EnableDebugInfo(bool value)
+// Set when the sink is destroyed at exit, threads exiting later, e.g. those of static thread pools, write their lines themselves.
+std::atomic<bool> g_LogSinkDestroyed(false);
+
+// Writes the buffers of all threads on its own thread. The slots of the ring are swapped with the buffers
+// of the threads, so that the memory of a buffer is reused after it is written.
+class LogSink
 {
-	std::thread::id tid = std::this_thread::get_id();
-	auto it = g_ThreadDebugInfos.find(tid);
-	if (it == g_ThreadDebugInfos.end())
+public:
+	static LogSink& Get()
 	{
-		SetThreadDebugInfo(GetThreadDebugInfoFileName().c_str());
-		it = g_ThreadDebugInfos.find(tid);
+		static LogSink sink;
+		return sink;
 	}
-	if (it != g_ThreadDebugInfos.end())
+	LogSink(const LogSink&) = delete;
+	~LogSink()
 	{
-		it->second->m_Enabled = value;
+		g_LogSinkDestroyed.store(true);
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stopping = true;
+		}
+		m_Posted.notify_all();
+		m_Thread.join();
+	}
+	// Take the text of chunk, which gets an empty buffer back.
+	void Post(LogChunk& chunk)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Written.wait(lock, [this]() { return m_Tail - m_Head < m_Ring.size(); });
+			LogChunk& slot = m_Ring[m_Tail % m_Ring.size()];
+			slot.m_pFile = chunk.m_pFile;
+			slot.m_Text.swap(chunk.m_Text);
+			++m_Tail;
+		}
+		m_Posted.notify_one();
+	}
+	// Wait until the chunks posted are written.
+	void Flush()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		size_t tail = m_Tail;
+		m_Written.wait(lock, [this, tail]() { return m_Done >= tail; });
 	}
-}
 
-std::ofstream* GetThreadDebugInfoStream()
-{
-	std::thread::id tid = std::this_thread::get_id();
-	auto it = g_ThreadDebugInfos.find(tid);
-	if (it == g_ThreadDebugInfos.end())
+private:
+	LogSink()
+		: m_Ring(g_LogRingSize)
+		, m_Head(0)
+		, m_Tail(0)
+		, m_Done(0)
+		, m_Stopping(false)
 	{
-		SetThreadDebugInfo(GetThreadDebugInfoFileName().c_str());
-		it = g_ThreadDebugInfos.find(tid);
+		m_Thread = std::thread(&LogSink::Run, this);
 	}
-	if (it != g_ThreadDebugInfos.end())
+
+	void Run()
 	{
-		if (it->second->m_Enabled)
+		LogChunk chunk;
+		while (true)
 		{
-			if (!it->second->m_DebugInfo.is_open())
-				it->second->m_DebugInfo.open(it->second->m_FileName);
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Posted.wait(lock, [this]() { return m_Stopping || m_Head != m_Tail; });
+				if (m_Head == m_Tail)
+					return;
+				LogChunk& slot = m_Ring[m_Head % m_Ring.size()];
+				chunk.m_pFile.swap(slot.m_pFile);
+				chunk.m_Text.swap(slot.m_Text);
+				++m_Head;
+			}
+			// The slot is free, notify after writing so that Flush sees the chunk written.
+			WriteLogChunk(chunk);
+			chunk.m_pFile.reset();
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				++m_Done;
+			}
+			m_Written.notify_all();
+		}
+	}
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Posted;
+	std::condition_variable m_Written;
+	std::vector<LogChunk> m_Ring;
+	// Chunks taken by the sink, posted and written
+	size_t m_Head;
+	size_t m_Tail;
+	size_t m_Done;
+	bool m_Stopping;
+	std::thread m_Thread;
+};
+
+std::atomic<int> g_LogLevel((int)LogLevel::Trace);
+// Checked for each line, so it is a plain flag rather than a member of ThreadDebugInfo,
+// which would be constructed on the first check.
+thread_local bool t_DebugInfoEnabled = true;
 
-			return &it->second->m_DebugInfo;
+// Debug info of a thread, only the thread uses it.
+struct ThreadDebugInfo
+{
+	~ThreadDebugInfo()
+	{
+		Post();
+	}
+	void Post()
+	{
+		if (m_Chunk.m_Text.empty())
+			return;
+		if (g_LogSinkDestroyed.load())
+			WriteLogChunk(m_Chunk);
+		else
+			LogSink::Get().Post(m_Chunk);
+	}
+	std::string& GetFileName()
+	{
+		if (m_FileName.empty())
+		{
+			std::stringstream ss;
+			ss << "DxfDebugInfo-";
+			ss << std::this_thread::get_id();
+			ss << ".log";
+			m_FileName = ss.str();
 		}
+		return m_FileName;
 	}
-	return nullptr;
+	// Buffer to append a line to, null if the file can't be opened.
+	std::string* Begin()
+	{
+		if (!m_Chunk.m_pFile)
+			m_Chunk.m_pFile = std::make_shared<LogFile>(GetFileName());
+		return m_Chunk.m_pFile->m_pFile ? &m_Chunk.m_Text : nullptr;
+	}
+	void End(LogLevel level)
+	{
+		m_Chunk.m_Text += '\n';
+		if (level >= LogLevel::Error || m_Chunk.m_Text.size() >= g_LogChunkSize)
+			Post();
+	}
+
+	LogChunk m_Chunk;
+	std::string m_FileName;
+};
+
+thread_local ThreadDebugInfo t_DebugInfo;
+
+void SetThreadDebugInfo(const char* fileName)
+{
+	t_DebugInfo.Post();
+	t_DebugInfo.m_Chunk.m_pFile.reset();
+	t_DebugInfo.m_FileName = fileName;
+}
+
+std::string GetThreadDebugInfoFileName()
+{
+	return t_DebugInfo.GetFileName();
 }
 
-void __cdecl PrintDebugInfo(const char* szMsg, ...)
+void EnableDebugInfo(bool value)
+{
+	t_DebugInfoEnabled = value;
+}
+
+void SetLogLevel(LogLevel level)
+{
+	g_LogLevel.store((int)level, std::memory_order_relaxed);
+}
+
+LogLevel GetLogLevel()
+{
+	return (LogLevel)g_LogLevel.load(std::memory_order_relaxed);
+}
+
+void FlushDebugInfo()
+{
+	t_DebugInfo.Post();
+	if (!g_LogSinkDestroyed.load())
+		LogSink::Get().Flush();
+}
+
+bool IsLogEnabled(LogLevel level)
+{
+	return t_DebugInfoEnabled && (int)level >= g_LogLevel.load(std::memory_order_relaxed);
+}
+
+static void AppendDebugInfo(std::string& text, const char* szMsg, va_list args)
 {
-	auto debugInfo = GetThreadDebugInfoStream();
-	if (!debugInfo || !debugInfo->is_open())
-		return;
 	char buffer[1024];
-	va_list args;
-	va_start(args, szMsg);
 	int len = vsnprintf(buffer, sizeof(buffer) - 1, szMsg, args);
-	va_end(args);
 	buffer[sizeof(buffer) - 1] = '\0';
 	if (len != -1)
 	{
-		buffer[len] = '\0';
+		buffer[std::min(len, int(sizeof(buffer) - 1))] = '\0';
 	}
-	*debugInfo << buffer << std::endl;
+	text += buffer;
 }
 
-void __cdecl PrintDebugInfo(const char* fileName, int lineNo, const char* funcName, const char* szMsg, ...)
+void __cdecl PrintDebugInfo(LogLevel level, const char* szMsg, ...)
 {
-	auto debugInfo = GetThreadDebugInfoStream();
-	if (!debugInfo || !debugInfo->is_open())
+	if (!IsLogEnabled(level))
+		return;
+	std::string* pText = t_DebugInfo.Begin();
+	if (!pText)
 		return;
-	char buffer[1024];
 	va_list args;
 	va_start(args, szMsg);
-	int len = vsnprintf(buffer, sizeof(buffer) - 1, szMsg, args);
+	AppendDebugInfo(*pText, szMsg, args);
 	va_end(args);
-	buffer[sizeof(buffer) - 1] = '\0';
-	if (len != -1)
-	{
-		buffer[len] = '\0';
-	}
+	t_DebugInfo.End(level);
+}
+
+void __cdecl PrintDebugInfo(LogLevel level, const char* fileName, int lineNo, const char* funcName, const char* szMsg, ...)
+{
+	if (!IsLogEnabled(level))
+		return;
+	std::string* pText = t_DebugInfo.Begin();
+	if (!pText)
+		return;
 	const char* sep = strrchr(fileName, '\\');
 	if (sep)
 		fileName = sep + 1;
-	*debugInfo << fileName << ':' << lineNo << '@' << funcName << ' ' << buffer << std::endl;
+	char prefix[32];
+	sprintf(prefix, ":%d@", lineNo);
+	*pText += fileName;
+	*pText += prefix;
+	*pText += funcName;
+	*pText += ' ';
+	va_list args;
+	va_start(args, szMsg);
+	AppendDebugInfo(*pText, szMsg, args);
+	va_end(args);
+	t_DebugInfo.End(level);
 }
 
 const char* right(const std::string& src, size_t num)
@@ -177,6 +341,75 @@ std::string TrimSpace(const std::string& str)
 	return str.substr(pos1, pos2 + 1);
 }
 
+std::string UpperCase(const char* str)
+{
+	std::string result(str);
+	for (auto& c : result)
+	{
+		if (c >= 'a' && c <= 'z')
+			c = c - 'a' + 'A';
+	}
+	return result;
+}
+
+BinaryValueType GetBinaryValueType(int groupCode)
+{
+	if ((groupCode >= 10 && groupCode <= 59) || (groupCode >= 110 && groupCode <= 149)
+		|| (groupCode >= 210 && groupCode <= 239) || (groupCode >= 460 && groupCode <= 469)
+		|| (groupCode >= 1010 && groupCode <= 1059))
+		return BinaryValueType::Real;
+	if ((groupCode >= 60 && groupCode <= 79) || (groupCode >= 170 && groupCode <= 179)
+		|| (groupCode >= 270 && groupCode <= 289) || (groupCode >= 370 && groupCode <= 389)
+		|| (groupCode >= 400 && groupCode <= 409) || (groupCode >= 1060 && groupCode <= 1070))
+		return BinaryValueType::Int16;
+	if ((groupCode >= 90 && groupCode <= 99) || (groupCode >= 420 && groupCode <= 429)
+		|| (groupCode >= 440 && groupCode <= 459) || groupCode == 1071)
+		return BinaryValueType::Int32;
+	if (groupCode >= 160 && groupCode <= 169)
+		return BinaryValueType::Int64;
+	if (groupCode >= 290 && groupCode <= 299)
+		return BinaryValueType::Bool;
+	if ((groupCode >= 310 && groupCode <= 319) || groupCode == 1004)
+		return BinaryValueType::Chunk;
+	return BinaryValueType::String;
+}
+
+bool GetFileStamp(const char* fileName, FileStamp& stamp)
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_stat64(fileName, &st) != 0)
+		return false;
+#else
+	struct stat st;
+	if (stat(fileName, &st) != 0)
+		return false;
+#endif
+	stamp.m_Size = (long long)st.st_size;
+	stamp.m_ModifyTime = (long long)st.st_mtime;
+	return true;
+}
+
+unsigned long long HashBytes(const void* data, size_t size, unsigned long long hash)
+{
+	// 8 bytes at a time, FNV-1a for the rest.
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t words = size / 8;
+	for (size_t i = 0; i < words; ++i, bytes += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, bytes, 8);
+		hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+		hash ^= hash >> 29;
+	}
+	for (size_t i = words * 8; i < size; ++i, ++bytes)
+	{
+		hash ^= *bytes;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
 const char * AdvanceUtf8(const char * pStart, const char* pEnd, int bytes)
 {
 	//ASSERT_DEBUG_INFO(pStart && pEnd >= pStart && bytes > 0);
@@ -224,12 +457,14 @@ void CDblPoint::Rotate(CDblPoint& point, double angle) const
 TraceFunction::TraceFunction(const char* fileName, const char* funcName)
 	: m_FileName(fileName)
 	, m_FuncName(funcName)
+	, m_Enabled(IsLogEnabled(LogLevel::Debug))
 {
 }
 
 TraceFunction::~TraceFunction()
 {
-	PrintDebugInfo(m_FileName, 0, m_FuncName, "Exit");
+	if (m_Enabled)
+		PrintDebugInfo(LogLevel::Debug, m_FileName, 0, m_FuncName, "Exit");
 }
 
 }
@@ -8,40 +8,123 @@
 * KIND, either express or implied.
 ***************************************************************************/
 #pragma once
+#include <cfloat>
 #include <stdexcept>
 #include <string>
 #include "ImpExpMacro.h"
 
+#ifndef _WIN32
+// MSVC names used by the sources
+#include <strings.h>
+#define __cdecl
+#define stricmp strcasecmp
+#define _stricmp strcasecmp
+#define strnicmp strncasecmp
+#endif
+#ifndef _countof
+#define _countof(a) (sizeof(a) / sizeof((a)[0]))
+#endif
+
 namespace DXF {
 
+	// Severity of a line of debug info.
+	enum class LogLevel
+	{
+		Trace,		// each table entry, block and entity read
+		Debug,		// functions entered and exited
+		Warning,	// what is skipped or fails, e.g. handles which can't be converted
+		Error,		// failed assertions and invalid DXF
+		Off
+	};
+
+	// Each thread writes its debug info to its own file, DxfDebugInfo-<thread id>.log by default.
+	// Lines are buffered per thread and written by a background thread, a buffer is passed to it when
+	// it is full, when an error is logged, when the file is changed and when the thread exits.
 	DXF_API void SetThreadDebugInfo(const char* fileName);
 	DXF_API std::string GetThreadDebugInfoFileName();
+	// Enable or disable the debug info of the calling thread, it is enabled by default.
 	DXF_API void EnableDebugInfo(bool value);
+	// Lines below the level aren't formatted by any thread, LogLevel::Trace by default.
+	// Tracing of entities can also be compiled out with the CMake option DXF_ENTITY_TRACE.
+	DXF_API void SetLogLevel(LogLevel level);
+	DXF_API LogLevel GetLogLevel();
+	// Write the lines buffered by the calling thread and those other threads have passed, e.g. before reading the file.
+	DXF_API void FlushDebugInfo();
 
 	// The following functions/classes are just for internal use, so they are not exported.
-	void __cdecl PrintDebugInfo(const char* szMsg, ...);
-	void __cdecl PrintDebugInfo(const char* fileName, int lineNo, const char* funcName, const char* szMsg, ...);
+	// Whether the calling thread logs lines of the level, checked before the arguments are evaluated.
+	bool IsLogEnabled(LogLevel level);
+	void __cdecl PrintDebugInfo(LogLevel level, const char* szMsg, ...);
+	void __cdecl PrintDebugInfo(LogLevel level, const char* fileName, int lineNo, const char* funcName, const char* szMsg, ...);
+#define LOG_DEBUG_INFO(level, msg, ...) \
+	if (!IsLogEnabled(level)) {} else PrintDebugInfo(level, msg, ##__VA_ARGS__)
 #define PRINT_DEBUG_INFO(msg, ...) \
-	PrintDebugInfo(__FILE__, __LINE__, __FUNCTION__, msg, __VA_ARGS__)
+	if (!IsLogEnabled(LogLevel::Warning)) {} else PrintDebugInfo(LogLevel::Warning, __FILE__, __LINE__, __FUNCTION__, msg, ##__VA_ARGS__)
 #define ASSERT_DEBUG_INFO(boolExp)														\
 	if (!(boolExp)) {																	\
-		PrintDebugInfo(__FILE__, __LINE__, __FUNCTION__, "Assertion failed:" #boolExp);	\
+		PrintDebugInfo(LogLevel::Error, __FILE__, __LINE__, __FUNCTION__, "Assertion failed:" #boolExp);	\
 		throw std::logic_error("Program error!");																	\
 	}
 #define THROW_INVALID_DXF()													\
-	PrintDebugInfo(__FILE__, __LINE__, __FUNCTION__, "Invalid DXF file.");	\
+	PrintDebugInfo(LogLevel::Error, __FILE__, __LINE__, __FUNCTION__, "Invalid DXF file.");	\
 	throw std::runtime_error("Invalid DXF file.")																\
 
+	// A line for each entity read, built with DXF_ENTITY_TRACE=OFF it is compiled out.
+#ifdef DXF_NO_ENTITY_TRACE
+#define TRACE_ENTITY(msg, ...) ((void)0)
+#else
+#define TRACE_ENTITY(msg, ...) LOG_DEBUG_INFO(LogLevel::Trace, msg, ##__VA_ARGS__)
+#endif
 
-	inline int hextoi(const char* src)
+	// DXF handles are hex strings of up to 16 digits.
+	using Handle = unsigned long long;
+	inline Handle hextoi(const char* src)
 	{
-		return std::stoi(src, nullptr, 16);
+		return std::stoull(src, nullptr, 16);
 	}
+
+	// Binary DXF begins with this sentinel including its terminating 0.
+	const char g_BinaryDxfSentinel[] = "AutoCAD Binary DXF\r\n\x1a";
+	// How the value of a group code is stored in binary DXF, all numbers are little-endian.
+	enum class BinaryValueType
+	{
+		String, // 0 terminated
+		Real,	// 8 bytes double
+		Int16,
+		Int32,
+		Int64,
+		Bool,	// 1 byte
+		Chunk	// 1 byte length followed by the bytes
+	};
+	BinaryValueType GetBinaryValueType(int groupCode);
 	const char* right(const std::string& src, size_t num);
 	bool RightCompareNoCase(const std::string& str1, size_t num, const char* str2);
 	std::string TrimLeftSpace(const std::string& str);
 	std::string TrimRightSpace(const std::string& str);
 	std::string TrimSpace(const std::string& str);
+	// Only ASCII letters are converted, the same as _stricmp does in "C" locale.
+	std::string UpperCase(const char* str);
+
+	// Size and last modification time of a file, used to validate cached data derived from it.
+	struct FileStamp
+	{
+		long long m_Size;
+		long long m_ModifyTime;
+		bool operator==(const FileStamp& other) const
+		{
+			return m_Size == other.m_Size && m_ModifyTime == other.m_ModifyTime;
+		}
+		bool operator!=(const FileStamp& other) const
+		{
+			return !(*this == other);
+		}
+	};
+	// Returns false if the file doesn't exist.
+	bool GetFileStamp(const char* fileName, FileStamp& stamp);
+	// 64-bit hash of size bytes continuing from hash, for validating and keying data derived from files.
+	// It isn't cryptographic.
+	const unsigned long long g_HashSeed = 14695981039346656037ULL;
+	unsigned long long HashBytes(const void* data, size_t size, unsigned long long hash = g_HashSeed);
 	typedef const char* cstr;
 	DXF_API cstr AdvanceUtf8(const char* pStart, const char* pEnd, int bytes);
 
@@ -79,19 +162,85 @@ namespace DXF {
 		double y;
 	};
 
+	// Axis-aligned rectangle, it is empty if left > right.
+	class CDblRect
+	{
+	public:
+		CDblRect()
+		{
+			SetEmpty();
+		}
+		CDblRect(double Left, double Bottom, double Right, double Top)
+		{
+			left = Left;
+			bottom = Bottom;
+			right = Right;
+			top = Top;
+		}
+		bool IsEmpty() const
+		{
+			return left > right;
+		}
+		void SetEmpty()
+		{
+			left = bottom = DBL_MAX;
+			right = top = -DBL_MAX;
+		}
+		// Extend this to contain the point.
+		void Add(double x, double y)
+		{
+			left = x < left ? x : left;
+			right = x > right ? x : right;
+			bottom = y < bottom ? y : bottom;
+			top = y > top ? y : top;
+		}
+		void Add(const CDblRect& rect)
+		{
+			if (rect.IsEmpty())
+				return;
+			Add(rect.left, rect.bottom);
+			Add(rect.right, rect.top);
+		}
+		void Inflate(double d)
+		{
+			if (IsEmpty())
+				return;
+			left -= d;
+			bottom -= d;
+			right += d;
+			top += d;
+		}
+		bool Intersects(const CDblRect& rect) const
+		{
+			return !IsEmpty() && !rect.IsEmpty() && left <= rect.right && rect.left <= right
+				&& bottom <= rect.top && rect.bottom <= top;
+		}
+
+		double left;
+		double bottom;
+		double right;
+		double top;
+	};
+
+	// Logs the exit of a function if its entry is logged.
 	class TraceFunction
 	{
 	public:
 		TraceFunction(const char* fileName, const char* funcName);
 		~TraceFunction();
+		bool IsEnabled() const
+		{
+			return m_Enabled;
+		}
 
 	private:
 		const char* m_FileName;
 		const char* m_FuncName;
+		bool m_Enabled;
 	};
 
 #define TRACE_FUNCTION(arguments, ...)										\
-PrintDebugInfo(__FILE__, __LINE__, __FUNCTION__, arguments, __VA_ARGS__);	\
-TraceFunction func##__LINE__(__FILE__, __FUNCTION__);
+TraceFunction func##__LINE__(__FILE__, __FUNCTION__);						\
+if (!func##__LINE__.IsEnabled()) {} else PrintDebugInfo(LogLevel::Debug, __FILE__, __LINE__, __FUNCTION__, arguments, ##__VA_ARGS__);
 
 }
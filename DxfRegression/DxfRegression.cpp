@@ -0,0 +1,869 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+// DxfRegression.cpp : Round-trips a sample drawing through each mode of reading and writing, run by ctest.
+//
+#pragma warning(disable:4996)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DxfData.h"
+#include "DxfIndex.h"
+#include "DxfReader.h"
+#include "DxfSnapshot.h"
+#include "DxfWriter.h"
+#include "ThreadPool.h"
+
+using namespace DXF;
+
+static int g_Failures = 0;
+
+#define CHECK(expr) \
+	do \
+	{ \
+		if (!(expr)) \
+		{ \
+			printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			++g_Failures; \
+		} \
+	} while (0)
+
+const int LINE_COUNT = 200;
+const int CIRCLE_COUNT = 100;
+const int INSERT_COUNT = 10;
+const size_t ENTITY_COUNT = LINE_COUNT + CIRCLE_COUNT + INSERT_COUNT;
+
+static void InitAttribute(EntAttribute &ent, const char *layer)
+{
+	ent.m_Handle = 0; // Assigned on writing
+	ent.m_IsInPaperspace = false;
+	ent.m_Color = (AcColor)acByLayer;
+	ent.m_Lineweight = (AcLineWeight)acLnWtByLayer;
+	ent.m_LinetypeScale = 1.;
+	ent.m_Layer = layer;
+}
+
+static void MakeSample(DxfData &graph)
+{
+	graph.m_Layers["Walls"].m_Color = 1;
+	auto pDoor = std::make_shared<BlockDef>();
+	auto pLeaf = std::make_shared<AcadLine>();
+	InitAttribute(*pLeaf, "0");
+	pLeaf->m_StartPoint = CDblPoint(0, 0);
+	pLeaf->m_EndPoint = CDblPoint(0, 900);
+	pDoor->m_Objects.push_back(pLeaf);
+	graph.m_RealBlockDefs["Door"] = pDoor;
+
+	for (int i = 0; i < LINE_COUNT; ++i)
+	{
+		auto pLine = std::make_shared<AcadLine>();
+		InitAttribute(*pLine, "Walls");
+		pLine->m_StartPoint = CDblPoint(i * 10.0, 0.125);
+		pLine->m_EndPoint = CDblPoint(i * 10.0 + 5, 1000.5);
+		graph.m_Objects.push_back(pLine);
+	}
+	for (int i = 0; i < CIRCLE_COUNT; ++i)
+	{
+		auto pCircle = std::make_shared<AcadCircle>();
+		InitAttribute(*pCircle, "0");
+		pCircle->m_Center = CDblPoint(i * 20.0, -500);
+		pCircle->m_Radius = 1.5 + i;
+		graph.m_Objects.push_back(pCircle);
+	}
+	for (int i = 0; i < INSERT_COUNT; ++i)
+	{
+		auto pInsert = std::make_shared<AcadBlockInstance>();
+		InitAttribute(*pInsert, "Walls");
+		pInsert->m_Name = "Door";
+		pInsert->m_InsertionPoint = CDblPoint(i * 100.0, 2000);
+		graph.m_Objects.push_back(pInsert);
+	}
+}
+
+// An entity without its handle, which is assigned on writing.
+static std::string Summary(const EntAttribute &ent)
+{
+	char buf[256];
+	if (auto pLine = dynamic_cast<const AcadLine *>(&ent))
+		sprintf(buf, "LINE %s %g,%g %g,%g\n", pLine->m_Layer.c_str(), pLine->m_StartPoint.x, pLine->m_StartPoint.y,
+			pLine->m_EndPoint.x, pLine->m_EndPoint.y);
+	else if (auto pCircle = dynamic_cast<const AcadCircle *>(&ent))
+		sprintf(buf, "CIRCLE %s %g,%g %g\n", pCircle->m_Layer.c_str(), pCircle->m_Center.x, pCircle->m_Center.y,
+			pCircle->m_Radius);
+	else if (auto pInsert = dynamic_cast<const AcadBlockInstance *>(&ent))
+		sprintf(buf, "INSERT %s %s %g,%g\n", pInsert->m_Layer.c_str(), pInsert->m_Name.c_str(),
+			pInsert->m_InsertionPoint.x, pInsert->m_InsertionPoint.y);
+	else
+		sprintf(buf, "? %s\n", ent.m_Layer.c_str());
+	return buf;
+}
+
+// Entities of model space
+static std::string Summary(const DxfData &graph)
+{
+	std::string summary;
+	for (const auto &pEnt : graph.m_Objects)
+		summary += Summary(*pEnt);
+	return summary;
+}
+
+static bool Exists(const char *fileName)
+{
+	FILE *fp = fopen(fileName, "rb");
+	if (fp)
+		fclose(fp);
+	return fp != nullptr;
+}
+
+static std::vector<char> LoadFile(const char *fileName)
+{
+	std::vector<char> data;
+	FILE *fp = fopen(fileName, "rb");
+	if (!fp)
+		return data;
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		data.insert(data.end(), buf, buf + n);
+	fclose(fp);
+	return data;
+}
+
+static bool Write(DxfWriter &writer, const char *fileName, const WriteOptions &options = WriteOptions())
+{
+	writer.SetWriteOptions(options);
+	return writer.WriteDxf(fileName, CDblPoint(0, 0), 1000);
+}
+
+static bool Read(DxfData &graph, const char *fileName, const ReadOptions &options = ReadOptions())
+{
+	DxfReader reader(graph);
+	reader.SetReadOptions(options);
+	return reader.ReadDxf(fileName, true);
+}
+
+// The file is mapped as a whole, and by windows of one page which records straddle.
+static void TestMapping(const DxfData &sample, const std::string &expected)
+{
+	DxfWriter writer(sample);
+	CHECK(Write(writer, "regression_ascii.dxf"));
+	DxfData graph;
+	CHECK(Read(graph, "regression_ascii.dxf"));
+	CHECK(Summary(graph) == expected);
+	CHECK(graph.m_RealBlockDefs.count("Door") == 1);
+
+	DxfData windowed;
+	DxfReader reader(windowed);
+	reader.SetMappingWindowSize(4096);
+	CHECK(reader.ReadDxf("regression_ascii.dxf", true));
+	CHECK(Summary(windowed) == expected);
+
+	remove("regression_missing.dxf");
+	DxfData missing;
+	CHECK(!Read(missing, "regression_missing.dxf"));
+}
+
+// The file read from a buffer, and pulled from a source in pieces smaller than the reading buffer.
+static void TestSources(const std::string &expected)
+{
+	std::vector<char> data = LoadFile("regression_ascii.dxf");
+	DxfData graph;
+	DxfReader reader(graph);
+	CHECK(reader.ReadDxf(data.data(), data.size(), true));
+	CHECK(Summary(graph) == expected);
+
+	size_t pos = 0;
+	auto source = [&](char *buffer, size_t size) {
+		size_t n = std::min(std::min(size, size_t(1000)), data.size() - pos);
+		memcpy(buffer, data.data() + pos, n);
+		pos += n;
+		return n;
+	};
+	DxfData pulled;
+	DxfReader pullReader(pulled);
+	CHECK(pullReader.ReadDxf(source, true, 256));
+	CHECK(Summary(pulled) == expected);
+}
+
+// Pad graph with TEXT entities until it is written as size bytes of ASCII DXF.
+static bool PadTo(DxfData &graph, size_t size)
+{
+	const size_t maxText = 200;
+	std::vector<std::shared_ptr<AcadText>> texts;
+	for (int i = 0; i < 100; ++i)
+	{
+		DxfWriter writer(static_cast<const DxfData &>(graph));
+		if (!Write(writer, "regression_padded.dxf"))
+			return false;
+		size_t written = LoadFile("regression_padded.dxf").size();
+		if (written == size)
+			return true;
+		if (written < size)
+		{
+			size_t more = size - written;
+			for (auto &pText : texts)
+			{
+				size_t n = std::min(more, maxText - pText->m_Text.size());
+				pText->m_Text.append(n, 'x');
+				more -= n;
+			}
+			// Each TEXT takes less than maxText bytes besides its text.
+			for (size_t n = more ? more / maxText + 1 : 0; n > 0; --n)
+			{
+				auto pText = std::make_shared<AcadText>();
+				InitAttribute(*pText, "0");
+				pText->m_Text = "x";
+				graph.m_Objects.push_back(pText);
+				texts.push_back(pText);
+			}
+		}
+		else
+		{
+			size_t less = written - size;
+			for (auto &pText : texts)
+			{
+				size_t n = std::min(less, pText->m_Text.size() - 1);
+				pText->m_Text.resize(pText->m_Text.size() - n);
+				less -= n;
+			}
+			if (less)
+			{
+				if (texts.empty())
+					return false;
+				graph.m_Objects.pop_back();
+				texts.pop_back();
+			}
+		}
+	}
+	return false;
+}
+
+static void TestCompression(const DxfData &sample, const std::string &expected)
+{
+	struct Format
+	{
+		const char *m_FileName;
+		Compression m_Compression;
+	} formats[] = {
+		{ "regression_gzip.dxf.gz", Compression::Gzip },
+		{ "regression_zstd.dxf.zst", Compression::Zstd },
+	};
+	for (const auto &format : formats)
+	{
+		if (!IsCompressionSupported(format.m_Compression))
+		{
+			printf("Skipped %s, the compression isn't built.\n", format.m_FileName);
+			continue;
+		}
+		WriteOptions options;
+		options.m_Compression = format.m_Compression;
+		DxfWriter writer(sample);
+		CHECK(Write(writer, format.m_FileName, options));
+		DxfData graph;
+		CHECK(Read(graph, format.m_FileName));
+		CHECK(Summary(graph) == expected);
+
+		// A file cut off before its end isn't read as a complete one.
+		std::vector<char> data = LoadFile(format.m_FileName);
+		CHECK(data.size() > 8);
+		FILE *fp = fopen("regression_truncated.dxf", "wb");
+		CHECK(fp != nullptr);
+		if (fp)
+		{
+			fwrite(data.data(), 1, data.size() - 8, fp);
+			fclose(fp);
+			DxfData truncated;
+			CHECK(!Read(truncated, "regression_truncated.dxf"));
+		}
+
+		// The stream ends exactly as the output buffer of the decompressor fills up.
+		for (size_t size : { size_t(128) << 10, size_t(192) << 10 })
+		{
+			DxfData padded;
+			MakeSample(padded);
+			CHECK(PadTo(padded, size));
+			std::string paddedExpected = Summary(padded);
+			DxfWriter paddedWriter(static_cast<const DxfData &>(padded));
+			CHECK(Write(paddedWriter, format.m_FileName, options));
+			DxfData reread;
+			CHECK(Read(reread, format.m_FileName));
+			CHECK(Summary(reread) == paddedExpected);
+		}
+	}
+}
+
+// Bytes of the value of groupCode in binary DXF, 0 for a string and -1 for a chunk of binary data.
+static int BinaryValueSize(int groupCode)
+{
+	if ((groupCode >= 10 && groupCode <= 59) || (groupCode >= 110 && groupCode <= 149)
+		|| (groupCode >= 210 && groupCode <= 239) || (groupCode >= 460 && groupCode <= 469)
+		|| (groupCode >= 1010 && groupCode <= 1059) || (groupCode >= 160 && groupCode <= 169))
+		return 8;
+	if ((groupCode >= 60 && groupCode <= 79) || (groupCode >= 170 && groupCode <= 179)
+		|| (groupCode >= 270 && groupCode <= 289) || (groupCode >= 370 && groupCode <= 389)
+		|| (groupCode >= 400 && groupCode <= 409) || (groupCode >= 1060 && groupCode <= 1070))
+		return 2;
+	if ((groupCode >= 90 && groupCode <= 99) || (groupCode >= 420 && groupCode <= 429)
+		|| (groupCode >= 440 && groupCode <= 459) || groupCode == 1071)
+		return 4;
+	if (groupCode >= 290 && groupCode <= 299)
+		return 1;
+	if ((groupCode >= 310 && groupCode <= 319) || groupCode == 1004)
+		return -1;
+	return 0;
+}
+
+// Convert ASCII DXF to binary DXF independently of the library.
+static std::vector<char> ToBinary(const std::vector<char> &ascii)
+{
+	std::vector<std::string> lines;
+	std::string line;
+	for (char c : ascii)
+	{
+		if (c == '\n')
+		{
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			lines.push_back(line);
+			line.clear();
+		}
+		else
+			line += c;
+	}
+	const char sentinel[] = "AutoCAD Binary DXF\r\n\x1a";
+	std::vector<char> binary(sentinel, sentinel + sizeof(sentinel));
+	auto append = [&binary](const void *p, size_t size) {
+		binary.insert(binary.end(), (const char *)p, (const char *)p + size);
+	};
+	for (size_t i = 0; i + 1 < lines.size(); i += 2)
+	{
+		int groupCode = atoi(lines[i].c_str());
+		unsigned short code = (unsigned short)groupCode;
+		append(&code, sizeof(code));
+		const std::string &value = lines[i + 1];
+		int size = BinaryValueSize(groupCode);
+		if (size == 8 && groupCode >= 160 && groupCode <= 169)
+		{
+			long long v = strtoll(value.c_str(), nullptr, 10);
+			append(&v, sizeof(v));
+		}
+		else if (size == 8)
+		{
+			double v = atof(value.c_str());
+			append(&v, sizeof(v));
+		}
+		else if (size == 4)
+		{
+			int v = atoi(value.c_str());
+			append(&v, sizeof(v));
+		}
+		else if (size == 2)
+		{
+			short v = (short)atoi(value.c_str());
+			append(&v, sizeof(v));
+		}
+		else if (size == 1)
+			binary.push_back((char)atoi(value.c_str()));
+		else if (size == -1)
+		{
+			binary.push_back((char)(value.size() / 2));
+			for (size_t j = 0; j + 1 < value.size(); j += 2)
+				binary.push_back((char)strtol(value.substr(j, 2).c_str(), nullptr, 16));
+		}
+		else
+			append(value.c_str(), value.size() + 1);
+	}
+	return binary;
+}
+
+// The sample converted to binary DXF is read from a file and from a buffer.
+static void TestBinaryRead(const std::string &expected)
+{
+	std::vector<char> binary = ToBinary(LoadFile("regression_ascii.dxf"));
+	FILE *fp = fopen("regression_converted.dxf", "wb");
+	CHECK(fp != nullptr);
+	if (fp)
+	{
+		fwrite(binary.data(), 1, binary.size(), fp);
+		fclose(fp);
+	}
+	DxfData graph;
+	CHECK(Read(graph, "regression_converted.dxf"));
+	CHECK(Summary(graph) == expected);
+	CHECK(graph.m_RealBlockDefs.count("Door") == 1);
+
+	DxfData buffered;
+	DxfReader reader(buffered);
+	CHECK(reader.ReadDxf(binary.data(), binary.size(), true));
+	CHECK(Summary(buffered) == expected);
+}
+
+// Binary DXF written by the library, also compressed.
+static void TestBinaryWrite(const DxfData &sample, const std::string &expected)
+{
+	WriteOptions options;
+	options.m_Binary = true;
+	DxfWriter writer(sample);
+	CHECK(Write(writer, "regression_binary.dxf", options));
+	std::vector<char> data = LoadFile("regression_binary.dxf");
+	CHECK(data.size() > 22 && memcmp(data.data(), "AutoCAD Binary DXF\r\n\x1a", 22) == 0);
+	DxfData graph;
+	CHECK(Read(graph, "regression_binary.dxf"));
+	CHECK(Summary(graph) == expected);
+	CHECK(graph.m_RealBlockDefs.count("Door") == 1);
+
+	if (IsCompressionSupported(Compression::Gzip))
+	{
+		options.m_Compression = Compression::Gzip;
+		CHECK(Write(writer, "regression_binary.dxf.gz", options));
+		DxfData compressed;
+		CHECK(Read(compressed, "regression_binary.dxf.gz"));
+		CHECK(Summary(compressed) == expected);
+	}
+}
+
+// Entities of type in model space and in the layouts.
+static void CountEntities(const DxfData &graph, const char *type, size_t &modelSpace, size_t &paperSpace)
+{
+	std::string prefix = std::string(type) + " ";
+	auto count = [&prefix](const EntityList &list) {
+		size_t n = 0;
+		for (const auto &pEnt : list)
+			n += Summary(*pEnt).compare(0, prefix.size(), prefix) == 0;
+		return n;
+	};
+	modelSpace = count(graph.m_Objects);
+	paperSpace = 0;
+	for (const auto &layout : graph.m_Layouts)
+		paperSpace += count(layout.second->m_Objects);
+}
+
+static void TestFilters()
+{
+	// The sample with circles on layer "Walls" in paper space
+	const size_t paperCircles = 5;
+	DxfData graph;
+	MakeSample(graph);
+	auto pLayout = std::make_shared<LayoutData>();
+	for (size_t i = 0; i < paperCircles; ++i)
+	{
+		auto pCircle = std::make_shared<AcadCircle>();
+		InitAttribute(*pCircle, "Walls");
+		pCircle->m_IsInPaperspace = true;
+		pCircle->m_Center = CDblPoint(i * 10.0, 10);
+		pCircle->m_Radius = 2;
+		pLayout->m_Objects.push_back(pCircle);
+	}
+	graph.m_Layouts["Layout1"] = pLayout;
+	DxfWriter writer(graph);
+	CHECK(Write(writer, "regression_filters.dxf"));
+
+	struct Case
+	{
+		const char *m_Type;
+		size_t m_ModelSpace;
+		size_t m_PaperSpace;
+	};
+	auto check = [](const ReadOptions &options, std::initializer_list<Case> cases) {
+		DxfData filtered;
+		DxfReader reader(filtered);
+		reader.SetReadOptions(options);
+		CHECK(reader.ReadDxf("regression_filters.dxf", false));
+		for (const Case &c : cases)
+		{
+			size_t modelSpace, paperSpace;
+			CountEntities(filtered, c.m_Type, modelSpace, paperSpace);
+			CHECK(modelSpace == c.m_ModelSpace);
+			CHECK(paperSpace == c.m_PaperSpace);
+		}
+		return filtered.m_RealBlockDefs.count("Door") ? filtered.m_RealBlockDefs["Door"]->m_Objects.size() : 0;
+	};
+
+	ReadOptions options;
+	CHECK(check(options, { { "LINE", LINE_COUNT, 0 }, { "CIRCLE", CIRCLE_COUNT, paperCircles }, { "INSERT", INSERT_COUNT, 0 } }) == 1);
+
+	options.m_EntityTypes = { "CIRCLE" };
+	CHECK(check(options, { { "LINE", 0, 0 }, { "CIRCLE", CIRCLE_COUNT, paperCircles }, { "INSERT", 0, 0 } }) == 0);
+
+	options = ReadOptions();
+	options.m_Layers = { "Walls" };
+	check(options, { { "LINE", LINE_COUNT, 0 }, { "CIRCLE", 0, paperCircles }, { "INSERT", INSERT_COUNT, 0 } });
+
+	options = ReadOptions();
+	options.m_ExcludedLayers = { "Walls" };
+	check(options, { { "LINE", 0, 0 }, { "CIRCLE", CIRCLE_COUNT, 0 }, { "INSERT", 0, 0 } });
+
+	options = ReadOptions();
+	options.m_ReadModelSpace = false;
+	check(options, { { "LINE", 0, 0 }, { "CIRCLE", 0, paperCircles }, { "INSERT", 0, 0 } });
+
+	options = ReadOptions();
+	options.m_ReadPaperSpace = false;
+	check(options, { { "LINE", LINE_COUNT, 0 }, { "CIRCLE", CIRCLE_COUNT, 0 }, { "INSERT", INSERT_COUNT, 0 } });
+
+	// The block is kept empty, its INSERTs are still read.
+	options = ReadOptions();
+	options.m_BlockFilter = [](const std::string &blockName) { return blockName != "Door"; };
+	CHECK(check(options, { { "LINE", LINE_COUNT, 0 }, { "INSERT", INSERT_COUNT, 0 } }) == 0);
+}
+
+static void TestWindow()
+{
+	struct Case
+	{
+		CDblRect m_Window;
+		size_t m_Lines;
+		size_t m_Circles;
+		size_t m_Inserts;
+	} cases[] = {
+		// Lines 50 to 70, circles 24 to 37 by their radii and INSERTs 5 to 7 at their insertion points
+		{ CDblRect(497, -520, 703, 2500), 21, 14, 3 },
+		// Insertion points of INSERTs 5 to 7 are below the window, the block crosses it.
+		{ CDblRect(497, 2500, 703, 3000), 0, 0, 3 },
+		{ CDblRect(-1000, 5000, -500, 6000), 0, 0, 0 },
+	};
+	for (const Case &c : cases)
+	{
+		ReadOptions options;
+		options.m_Window = c.m_Window;
+		DxfData graph;
+		CHECK(Read(graph, "regression_ascii.dxf", options));
+		size_t lines, circles, inserts, paperSpace;
+		CountEntities(graph, "LINE", lines, paperSpace);
+		CountEntities(graph, "CIRCLE", circles, paperSpace);
+		CountEntities(graph, "INSERT", inserts, paperSpace);
+		CHECK(lines == c.m_Lines);
+		CHECK(circles == c.m_Circles);
+		CHECK(inserts == c.m_Inserts);
+		CHECK(graph.m_RealBlockDefs.count("Door") == 1);
+	}
+}
+
+static void TestLazy(const std::string &expected)
+{
+	ReadOptions options;
+	options.m_Lazy = true;
+	DxfData graph;
+	CHECK(Read(graph, "regression_ascii.dxf", options));
+	CHECK(graph.GetLazyEntities().size() == ENTITY_COUNT);
+	CHECK(graph.m_Objects.empty());
+
+	// The const writer can't load the lazy entities, it must fail rather than drop them.
+	remove("regression_lazy.dxf");
+	{
+		const DxfData &constGraph = graph;
+		DxfWriter writer(constGraph);
+		CHECK(!Write(writer, "regression_lazy.dxf"));
+		CHECK(!Exists("regression_lazy.dxf"));
+	}
+	DxfWriter writer(graph);
+	CHECK(Write(writer, "regression_lazy.dxf"));
+	CHECK(graph.GetLazyEntities().empty());
+	CHECK(Summary(graph) == expected);
+
+	DxfData reread;
+	CHECK(Read(reread, "regression_lazy.dxf"));
+	CHECK(Summary(reread) == expected);
+}
+
+static bool SaveFile(const char *fileName, const std::vector<char> &data)
+{
+	FILE *fp = fopen(fileName, "wb");
+	if (!fp)
+		return false;
+	bool bSuccess = fwrite(data.data(), 1, data.size(), fp) == data.size();
+	return fclose(fp) == 0 && bSuccess;
+}
+
+static void TestIndex(const std::string &expected)
+{
+	const char *fileName = "regression_ascii.dxf";
+	std::string indexName = DxfIndex::GetIndexFileName(fileName);
+	remove(indexName.c_str());
+
+	ReadOptions options;
+	options.m_WriteIndex = true;
+	DxfData graph;
+	CHECK(Read(graph, fileName, options));
+	CHECK(Summary(graph) == expected);
+
+	DxfIndex index;
+	CHECK(index.Open(fileName));
+	Handle handle = graph.m_Objects.back()->m_Handle;
+	if (index.IsOpen())
+	{
+		CHECK(index.GetEntityCount() == ENTITY_COUNT);
+		size_t i = index.FindEntity(handle);
+		CHECK(i != size_t(-1) && index.GetEntity(i).m_Handle == handle);
+		CHECK(index.FindBlock("Door") != nullptr);
+		CHECK(index.FindSection("ENTITIES") != nullptr);
+		index.Close();
+	}
+
+	options = ReadOptions();
+	options.m_UseIndex = true;
+	DxfData indexed;
+	CHECK(Read(indexed, fileName, options));
+	CHECK(Summary(indexed) == expected);
+
+	options.m_EntityTypes.insert("CIRCLE");
+	DxfData circles;
+	CHECK(Read(circles, fileName, options));
+	CHECK(circles.m_Objects.size() == CIRCLE_COUNT);
+
+	// A corrupt index passing the checks of Open: entities of handles out of range and the last string cut off.
+	// Offsets are those of IndexHeader in DxfIndex.cpp.
+	std::vector<char> data = LoadFile(indexName.c_str());
+	unsigned long long entityCount = 0, handlesOffset = 0, stringCount = 0;
+	CHECK(data.size() > 112);
+	if (data.size() > 112)
+	{
+		memcpy(&entityCount, &data[72], 8);
+		memcpy(&handlesOffset, &data[88], 8);
+		memcpy(&stringCount, &data[96], 8);
+	}
+	CHECK(entityCount == ENTITY_COUNT && stringCount > 0 && handlesOffset + entityCount * 16 <= data.size());
+	if (entityCount == ENTITY_COUNT && stringCount > 0 && handlesOffset + entityCount * 16 <= data.size())
+	{
+		for (unsigned long long i = 0; i < entityCount; ++i)
+			memset(&data[size_t(handlesOffset + i * 16 + 8)], 0x7F, 8);
+		data.pop_back();
+		CHECK(SaveFile("regression_corrupt.dxfidx", data));
+		CHECK(index.Open(fileName, "regression_corrupt.dxfidx"));
+		CHECK(index.FindEntity(handle) == size_t(-1));
+		CHECK(*index.GetString((unsigned int)stringCount - 1) == 0);
+		index.Close();
+	}
+	remove(indexName.c_str());
+}
+
+static void TestSnapshot(const std::string &expected)
+{
+	DxfData graph;
+	CHECK(Read(graph, "regression_ascii.dxf"));
+	CHECK(DxfSnapshot::Save(graph, "regression.dxfsnap"));
+	DxfData loaded;
+	CHECK(DxfSnapshot::Load(loaded, "regression.dxfsnap"));
+	CHECK(Summary(loaded) == expected);
+	CHECK(loaded.m_RealBlockDefs.count("Door") == 1);
+
+	// Read the first time, loaded from the snapshot the second time with a single report of progress.
+	const char *fileName = "regression_ascii.dxf";
+	std::string cacheName = DxfSnapshot::GetCacheFileName(fileName, ".", true);
+	remove(cacheName.c_str());
+	ReadOptions options;
+	options.m_SnapshotDir = ".";
+	std::vector<DxfProgress> reports;
+	options.m_Progress = [&reports](const DxfProgress &progress) { reports.push_back(progress); };
+	std::vector<DxfProgress> lastReports;
+	for (int i = 0; i < 2; ++i)
+	{
+		reports.clear();
+		DxfData cached;
+		CHECK(Read(cached, fileName, options));
+		CHECK(Summary(cached) == expected);
+		CHECK(Exists(cacheName.c_str()));
+		CHECK(!reports.empty());
+		if (!reports.empty())
+			lastReports.push_back(reports.back());
+	}
+	CHECK(reports.size() == 1);
+	if (lastReports.size() == 2)
+	{
+		CHECK(lastReports[1].m_Entities == lastReports[0].m_Entities);
+		CHECK(lastReports[1].m_Bytes == LoadFile(fileName).size());
+		CHECK(lastReports[1].m_TotalBytes == lastReports[1].m_Bytes);
+	}
+
+	// The index isn't written for a file loaded from its snapshot.
+	std::string indexName = DxfIndex::GetIndexFileName(fileName);
+	remove(indexName.c_str());
+	options.m_WriteIndex = true;
+	DxfData cached;
+	CHECK(Read(cached, fileName, options));
+	CHECK(!Exists(indexName.c_str()));
+
+	options.m_CancelToken = std::make_shared<CancelToken>();
+	options.m_CancelToken->Cancel();
+	DxfData cancelled;
+	CHECK(!Read(cancelled, fileName, options));
+	CHECK(cancelled.m_Objects.empty());
+	remove(cacheName.c_str());
+}
+
+// Probe the file written by TestFilters, with circles in paper space.
+static void TestProbe()
+{
+	std::vector<char> data = LoadFile("regression_filters.dxf");
+	for (int i = 0; i < 2; ++i)
+	{
+		DxfData graph;
+		DxfReader reader(graph);
+		DxfProbe probe;
+		CHECK(i == 0 ? reader.ProbeDxf("regression_filters.dxf", probe) : reader.ProbeDxf(data.data(), data.size(), probe));
+		CHECK(probe.m_AcadVer == "AC1024");
+		CHECK(graph.m_Layers.count("0") == 1 && graph.m_Layers.count("Walls") == 1);
+		CHECK(graph.m_Objects.empty());
+		auto hasBlock = [&probe](const char *name) {
+			return std::find(probe.m_Blocks.begin(), probe.m_Blocks.end(), name) != probe.m_Blocks.end();
+		};
+		CHECK(hasBlock("Door") && hasBlock("*Model_Space") && hasBlock("*Paper_Space"));
+		std::map<std::string, size_t> modelSpace = { { "CIRCLE", CIRCLE_COUNT }, { "INSERT", INSERT_COUNT }, { "LINE", LINE_COUNT } };
+		CHECK(probe.m_ModelSpaceCounts == modelSpace);
+		CHECK(probe.m_PaperSpaceCounts["CIRCLE"] == 5);
+		CHECK(probe.m_BlockCounts["LINE"] >= 1);
+	}
+}
+
+static void TestCancel(const std::string &expected)
+{
+	ReadOptions readOptions;
+	readOptions.m_CancelToken = std::make_shared<CancelToken>();
+	readOptions.m_CancelToken->Cancel();
+	DxfData graph;
+	CHECK(!Read(graph, "regression_ascii.dxf", readOptions));
+	CHECK(graph.m_Objects.empty());
+
+	// Cancelled and failed writes leave no file and the writer can write the next one.
+	DxfData sample;
+	MakeSample(sample);
+	DxfWriter writer(sample);
+	WriteOptions writeOptions;
+	writeOptions.m_CancelToken = std::make_shared<CancelToken>();
+	writeOptions.m_CancelToken->Cancel();
+	remove("regression_cancelled.dxf");
+	CHECK(!Write(writer, "regression_cancelled.dxf", writeOptions));
+	CHECK(!Exists("regression_cancelled.dxf"));
+
+	sample.m_LinetypeScale = 0; // Asserted after the file is created
+	CHECK(!Write(writer, "regression_failed.dxf"));
+	CHECK(!Exists("regression_failed.dxf"));
+	if (IsCompressionSupported(Compression::Gzip))
+	{
+		WriteOptions gzipOptions;
+		gzipOptions.m_Compression = Compression::Gzip;
+		CHECK(!Write(writer, "regression_failed.dxf.gz", gzipOptions));
+		CHECK(!Exists("regression_failed.dxf.gz"));
+	}
+
+	sample.m_LinetypeScale = 1;
+	CHECK(Write(writer, "regression_reused.dxf"));
+	DxfData reread;
+	CHECK(Read(reread, "regression_reused.dxf"));
+	CHECK(Summary(reread) == expected);
+}
+
+static void TestAsync(const DxfData &sample, const std::string &expected)
+{
+	// Concurrent resizes don't add up their threads.
+	std::thread resize([]() { SetAsyncThreadCount(3); });
+	SetAsyncThreadCount(3);
+	resize.join();
+	CHECK(GetAsyncThreadCount() == 3);
+
+	DxfWriter writer(sample);
+	CHECK(writer.WriteDxfAsync("regression_async.dxf", CDblPoint(0, 0), 1000).get());
+
+	// The pool can't be resized from its own thread.
+	bool bRejected = false;
+	ReadOptions options;
+	options.m_Progress = [&bRejected](const DxfProgress &) {
+		try
+		{
+			SetAsyncThreadCount(2);
+		}
+		catch (const std::logic_error &)
+		{
+			bRejected = true;
+		}
+	};
+	DxfData graph;
+	DxfReader reader(graph);
+	reader.SetReadOptions(options);
+	CHECK(reader.ReadDxfAsync("regression_async.dxf", true).get());
+	CHECK(bRejected);
+	CHECK(Summary(graph) == expected);
+	CHECK(GetAsyncThreadCount() == 3);
+}
+
+static void TestPipelined(const std::string &expected)
+{
+	ReadOptions options;
+	options.m_Pipelined = true;
+	// Small batches so that the threads wait for each other
+	options.m_PipelineBatchSize = 7;
+	options.m_PipelineRingSize = 2;
+	std::vector<const char *> fileNames = { "regression_ascii.dxf", "regression_binary.dxf" };
+	if (IsCompressionSupported(Compression::Gzip))
+		fileNames.push_back("regression_binary.dxf.gz");
+	for (const char *fileName : fileNames)
+	{
+		DxfData graph;
+		CHECK(Read(graph, fileName, options));
+		CHECK(Summary(graph) == expected);
+		CHECK(graph.m_RealBlockDefs.count("Door") == 1);
+	}
+
+	// Paper space and layouts are read the same as without the pipeline.
+	DxfData pipelined, normal;
+	CHECK(Read(pipelined, "regression_filters.dxf", options));
+	CHECK(Read(normal, "regression_filters.dxf"));
+	CHECK(Summary(pipelined) == Summary(normal));
+	CHECK(pipelined.m_Layouts.size() == normal.m_Layouts.size());
+
+	std::vector<char> data = LoadFile("regression_ascii.dxf");
+	DxfData buffered;
+	DxfReader reader(buffered);
+	reader.SetReadOptions(options);
+	// The reader reads twice, reusing its rings.
+	for (int i = 0; i < 2; ++i)
+	{
+		CHECK(reader.ReadDxf(data.data(), data.size(), true));
+		CHECK(Summary(buffered) == expected);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	DxfData sample;
+	MakeSample(sample);
+	std::string expected = Summary(sample);
+
+	TestMapping(sample, expected);
+	TestSources(expected);
+	TestCompression(sample, expected);
+	TestBinaryRead(expected);
+	TestBinaryWrite(sample, expected);
+	TestFilters();
+	TestWindow();
+	TestLazy(expected);
+	TestIndex(expected);
+	TestSnapshot(expected);
+	TestProbe();
+	TestCancel(expected);
+	TestAsync(sample, expected);
+	TestPipelined(expected);
+
+	if (g_Failures)
+	{
+		printf("%d checks failed.\n", g_Failures);
+		return 1;
+	}
+	printf("All checks passed.\n");
+	return 0;
+}
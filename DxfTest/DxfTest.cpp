@@ -5,14 +5,18 @@
 #include "DxfData.h"
 #include "DxfReader.h"
 #include "DxfWriter.h"
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 int main(int argc, char* argv[])
 {
 	using namespace DXF;
 
 	// Test AdvanceUtf8
+#ifdef _WIN32
 	SetConsoleOutputCP(CP_UTF8);
+#endif
 	//std::string text(u8"һ߰˾Ŷ߰˾߰˾Ķ߰˾߰˾߰˾߶߰˾Ű˶߰˾žŶ߰˾ʮ߰˾");
 	//size_t len = text.length();
 	//const char* pStart = text.data();
@@ -0,0 +1,322 @@
+/***************************************************************************
+* Copyright (C) 2017, Deping Chen, cdp97531@sina.com
+*
+* All rights reserved.
+* For permission requests, write to the publisher.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+***************************************************************************/
+// DxfTool.cpp : Command line tools on DXF files.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "DxfBatch.h"
+#include "DxfData.h"
+#include "DxfEventReader.h"
+#include "DxfReader.h"
+#include "DxfIndex.h"
+
+using namespace DXF;
+
+static void Usage()
+{
+	printf("Usage:\n");
+	printf("  DxfTool index <dxf>...          Write the sidecar index(*.dxfidx) of the files.\n");
+	printf("  DxfTool info <dxf>              Print the index of the file, or scan the file if it has no index.\n");
+	printf("  DxfTool find <dxf> <handle>...  Print the entities of the handles(hex) in the index,\n");
+	printf("                                  or scan the file for them if it has no index.\n");
+	printf("  DxfTool batch [-j threads] [-m budgetMB] <list>\n");
+	printf("                                  Read and write the files of the list, - for stdin. Each line is\n");
+	printf("                                  an input and an output separated by a tab, or only an input to\n");
+	printf("                                  read. A line of JSON is printed for each file as it is done.\n");
+}
+
+static int Index(int argc, char* argv[])
+{
+	int failures = 0;
+	for (int i = 0; i < argc; ++i)
+	{
+		// Entities are only indexed, not parsed.
+		DxfData graph;
+		DxfReader reader(graph);
+		ReadOptions options;
+		options.m_Lazy = true;
+		options.m_WriteIndex = true;
+		reader.SetReadOptions(options);
+		DxfIndex index;
+		if (!reader.ReadDxf(argv[i], true) || !index.Open(argv[i]))
+		{
+			fprintf(stderr, "Can't index %s.\n", argv[i]);
+			++failures;
+			continue;
+		}
+		printf("%s: %zu entities, %zu blocks\n", argv[i], index.GetEntityCount(), index.GetBlockCount());
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+static void PrintEntity(const DxfIndex& index, size_t i)
+{
+	const DxfIndex::Entity& entity = index.GetEntity(i);
+	printf("%llX %s layer=%s offset=%llu length=%u%s", (unsigned long long)entity.m_Handle,
+		index.GetString(entity.m_Type), index.GetString(entity.m_Layer), entity.m_Offset, entity.m_Length,
+		(entity.m_Flags & DxfIndex::Entity::PaperSpace) ? " paper" : "");
+	if (entity.m_Flags & DxfIndex::Entity::Bounded)
+		printf(" extents=(%g,%g)-(%g,%g)", entity.m_Extents.left, entity.m_Extents.bottom,
+			entity.m_Extents.right, entity.m_Extents.top);
+	printf("\n");
+}
+
+// Lists the sections and blocks of a file without index, and counts its entities.
+class InfoHandler : public DxfEventHandler
+{
+public:
+	InfoHandler()
+		: m_Entities(0)
+		, m_bEntities(false)
+	{
+	}
+	bool OnSectionBegin(const char* name) override
+	{
+		m_Sections.push_back(name);
+		m_bEntities = strcmp(name, "ENTITIES") == 0;
+		return true;
+	}
+	bool OnBlockBegin(const char* name, DxfPairs& fields) override
+	{
+		m_Blocks.push_back(name);
+		return true;
+	}
+	bool OnEntity(const char* type, const EntAttribute& attributes, DxfPairs& fields) override
+	{
+		if (m_bEntities)
+			++m_Entities;
+		return true;
+	}
+
+	std::vector<std::string> m_Sections;
+	std::vector<std::string> m_Blocks;
+	size_t m_Entities;
+
+private:
+	bool m_bEntities;
+};
+
+static int ScanInfo(const char* fileName)
+{
+	InfoHandler handler;
+	DxfEventReader reader;
+	if (!reader.ReadDxf(fileName, handler))
+	{
+		fprintf(stderr, "Can't read %s.\n", fileName);
+		return 1;
+	}
+	printf("Sections:\n");
+	for (const auto& section : handler.m_Sections)
+		printf("  %s\n", section.c_str());
+	printf("Blocks: %zu\n", handler.m_Blocks.size());
+	for (const auto& block : handler.m_Blocks)
+		printf("  %s\n", block.c_str());
+	printf("Entities: %zu\n", handler.m_Entities);
+	return 0;
+}
+
+static int Info(int argc, char* argv[])
+{
+	if (argc < 1)
+	{
+		Usage();
+		return 1;
+	}
+	DxfIndex index;
+	if (!index.Open(argv[0]))
+		return ScanInfo(argv[0]);
+	printf("Sections:\n");
+	for (size_t i = 0; i < index.GetSectionCount(); ++i)
+	{
+		const DxfIndex::Range& section = index.GetSection(i);
+		printf("  %s offset=%llu length=%llu\n", index.GetString(section.m_Name), section.m_Offset, section.m_Length);
+	}
+	printf("Blocks: %zu\n", index.GetBlockCount());
+	for (size_t i = 0; i < index.GetBlockCount(); ++i)
+	{
+		const DxfIndex::Range& block = index.GetBlock(i);
+		printf("  %s offset=%llu length=%llu\n", index.GetString(block.m_Name), block.m_Offset, block.m_Length);
+	}
+	printf("Entities: %zu\n", index.GetEntityCount());
+	return 0;
+}
+
+// Prints the entities of ENTITIES with the handles, and stops when all are found.
+class FindHandler : public DxfEventHandler
+{
+public:
+	explicit FindHandler(const std::vector<Handle>& handles)
+		: m_Handles(handles)
+		, m_Found(handles.size(), false)
+		, m_FoundCount(0)
+		, m_bEntities(false)
+	{
+	}
+	bool OnSectionBegin(const char* name) override
+	{
+		m_bEntities = strcmp(name, "ENTITIES") == 0;
+		return true;
+	}
+	bool OnEntity(const char* type, const EntAttribute& attributes, DxfPairs& fields) override
+	{
+		if (!m_bEntities)
+			return true;
+		for (size_t i = 0; i < m_Handles.size(); ++i)
+		{
+			if (!m_Found[i] && m_Handles[i] == attributes.m_Handle)
+			{
+				printf("%llX %s layer=%s%s\n", (unsigned long long)attributes.m_Handle, type, attributes.m_Layer.c_str(),
+					attributes.m_IsInPaperspace ? " paper" : "");
+				m_Found[i] = true;
+				++m_FoundCount;
+			}
+		}
+		return m_FoundCount < m_Handles.size();
+	}
+
+	std::vector<Handle> m_Handles;
+	std::vector<bool> m_Found;
+	size_t m_FoundCount;
+
+private:
+	bool m_bEntities;
+};
+
+static int ScanFind(int argc, char* argv[])
+{
+	std::vector<Handle> handles;
+	for (int i = 1; i < argc; ++i)
+		handles.push_back(Handle(strtoull(argv[i], nullptr, 16)));
+	FindHandler handler(handles);
+	DxfEventReader reader;
+	if (!reader.ReadDxf(argv[0], handler))
+	{
+		fprintf(stderr, "Can't read %s.\n", argv[0]);
+		return 1;
+	}
+	int failures = 0;
+	for (size_t i = 0; i < handles.size(); ++i)
+	{
+		if (!handler.m_Found[i])
+		{
+			fprintf(stderr, "%s isn't found.\n", argv[i + 1]);
+			++failures;
+		}
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+static int Find(int argc, char* argv[])
+{
+	if (argc < 1)
+	{
+		Usage();
+		return 1;
+	}
+	DxfIndex index;
+	if (!index.Open(argv[0]))
+		return ScanFind(argc, argv);
+	int failures = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		size_t entity = index.FindEntity(Handle(strtoull(argv[i], nullptr, 16)));
+		if (entity == size_t(-1))
+		{
+			fprintf(stderr, "%s isn't found.\n", argv[i]);
+			++failures;
+			continue;
+		}
+		PrintEntity(index, entity);
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+static int Batch(int argc, char* argv[])
+{
+	BatchOptions options;
+	int i = 0;
+	for (; i + 1 < argc && argv[i][0] == '-' && argv[i][1] != 0; i += 2)
+	{
+		if (strcmp(argv[i], "-j") == 0)
+			options.m_ThreadCount = (unsigned int)atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-m") == 0)
+			options.m_MemoryBudget = strtoull(argv[i + 1], nullptr, 10) << 20;
+		else
+			break;
+	}
+	if (i + 1 != argc)
+	{
+		Usage();
+		return 1;
+	}
+	FILE* fp = strcmp(argv[i], "-") == 0 ? stdin : fopen(argv[i], "r");
+	if (fp == nullptr)
+	{
+		fprintf(stderr, "Can't open %s.\n", argv[i]);
+		return 1;
+	}
+	std::vector<BatchJob> jobs;
+	char line[4096];
+	while (fgets(line, sizeof(line), fp) != nullptr)
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		if (line[0] == 0)
+			continue;
+		BatchJob job;
+		char* tab = strchr(line, '\t');
+		if (tab != nullptr)
+		{
+			*tab = 0;
+			job.m_Output = tab + 1;
+		}
+		job.m_Input = line;
+		jobs.push_back(job);
+	}
+	if (fp != stdin)
+		fclose(fp);
+
+	options.m_Done = [](const BatchJob& job, const BatchResult& result)
+	{
+		printf("%s\n", DxfBatch::ToJson(job, result).c_str());
+		fflush(stdout);
+	};
+	DxfBatch batch(options);
+	int failures = 0;
+	for (const BatchResult& result : batch.Run(jobs))
+	{
+		if (!result.m_Success)
+			++failures;
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		Usage();
+		return 1;
+	}
+	if (strcmp(argv[1], "index") == 0)
+		return Index(argc - 2, argv + 2);
+	if (strcmp(argv[1], "info") == 0)
+		return Info(argc - 2, argv + 2);
+	if (strcmp(argv[1], "find") == 0)
+		return Find(argc - 2, argv + 2);
+	if (strcmp(argv[1], "batch") == 0)
+		return Batch(argc - 2, argv + 2);
+	Usage();
+	return 1;
+}